@@ -1,6 +1,9 @@
 #define _CRT_SECURE_NO_WARNINGS
 #include <Core/Engine.hpp>
 #include <SDL_main.h>
+#include <algorithm>
+#include <stdlib.h>
+#include <thread>
 
 using namespace worlds;
 
@@ -79,7 +82,7 @@ int main(int argc, char **argv)
 
     EngineArguments::parseArguments(argc, argv);
     initOptions.runAsEditor = EngineArguments::hasArgument("editor");
-    initOptions.enableVR = !EngineArguments::hasArgument("novr");
+    initOptions.enableVR = !EngineArguments::hasArgument("novr") && !EngineArguments::hasArgument("benchmark");
     initOptions.dedicatedServer = EngineArguments::hasArgument("dedicated-server");
 
     if (initOptions.dedicatedServer && (initOptions.enableVR || initOptions.runAsEditor))
@@ -90,6 +93,24 @@ int main(int argc, char **argv)
 
     initOptions.useEventThread = false;
 
+    // Lets several server instances share a host without each one spawning a worker per core
+    if (EngineArguments::hasArgument("workers"))
+    {
+        std::string workersArg{EngineArguments::argumentValue("workers")};
+        char* end = nullptr;
+        long workers = strtol(workersArg.c_str(), &end, 10);
+
+        if (workersArg.empty() || *end != '\0')
+        {
+            fprintf(stderr, "%s: invalid worker count '%s', using the default.\n", argv[0], workersArg.c_str());
+        }
+        else
+        {
+            long maxWorkers = std::max(1u, std::thread::hardware_concurrency());
+            initOptions.workerThreadOverride = (int)std::clamp(workers, 1L, maxWorkers);
+        }
+    }
+
     worlds::WorldsEngine* engine = createEngine(initOptions, argv[0]);
     engine->run();
     delete engine;
@@ -0,0 +1,89 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <stdint.h>
+
+namespace wanm
+{
+    typedef uint32_t CountType;
+    typedef uint64_t OffsetType;
+
+    // Enforce tight packing for structs as they'll be saved to disk
+#pragma pack(push, 1)
+    // Animations are resampled to a fixed rate when compiled, so sampling a clip is just a lerp
+    // between two neighbouring samples. Each clip has one track per bone of the model it was
+    // compiled with, in the same order as the model's bones.
+    enum TrackFlags : uint8_t
+    {
+        // The channel only has a single sample that's used for the whole clip
+        ConstantTranslation = 1,
+        ConstantRotation = 2,
+        ConstantScale = 4
+    };
+
+    // Rotations are stored with each component scaled to the full int16_t range
+    struct QuantizedQuat
+    {
+        int16_t x, y, z, w;
+    };
+
+    struct Track
+    {
+        uint8_t flags;
+        OffsetType translationOffset; // glm::vec3 per sample
+        OffsetType rotationOffset;    // QuantizedQuat per sample
+        OffsetType scaleOffset;       // glm::vec3 per sample
+    };
+
+    struct Clip
+    {
+        char name[32] = {0};
+        float duration;
+        float sampleRate;
+        CountType numSamples;
+        OffsetType trackOffset;
+
+        void setName(const char *name)
+        {
+            int i = 0;
+            for (; i < 31 && name[i] != '\0'; i++)
+            {
+                this->name[i] = name[i];
+            }
+
+            for (; i < 32; i++)
+            {
+                this->name[i] = 0;
+            }
+        }
+    };
+
+    struct Header
+    {
+        char magic[4] = {'W', 'A', 'N', 'M'};
+        int version = 1;
+        CountType numClips;
+        CountType numBones;
+        OffsetType clipOffset;
+
+        bool verifyMagic()
+        {
+            return magic[0] == 'W' && magic[1] == 'A' && magic[2] == 'N' && magic[3] == 'M';
+        }
+
+        void *getRelPtr(size_t offset)
+        {
+            return ((char *)this) + offset;
+        }
+
+        Clip *getClips()
+        {
+            return (Clip *)getRelPtr(clipOffset);
+        }
+
+        Track *getTracks(const Clip &clip)
+        {
+            return (Track *)getRelPtr(clip.trackOffset);
+        }
+    };
+#pragma pack(pop)
+}
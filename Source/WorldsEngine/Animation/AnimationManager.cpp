@@ -0,0 +1,225 @@
+#include "AnimationManager.hpp"
+#include <Core/AllocTracking.hpp>
+#include <Core/Log.hpp>
+#include <Tracy.hpp>
+#include <WANM.hpp>
+#include <physfs.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace worlds
+{
+    robin_hood::unordered_node_map<AssetID, LoadedAnimationSet> AnimationManager::loadedSets;
+    LoadedAnimationSet emptySet{.numBones = 0};
+
+    int LoadedAnimationSet::findClip(const char* name) const
+    {
+        for (size_t i = 0; i < clips.size(); i++)
+        {
+            if (strcmp(clips[i].name.cStr(), name) == 0)
+                return (int)i;
+        }
+
+        return -1;
+    }
+
+    glm::vec4 dequantize(const wanm::QuantizedQuat& q)
+    {
+        glm::vec4 v{q.x, q.y, q.z, q.w};
+        return v / glm::sqrt(glm::dot(v, v));
+    }
+
+    // Expands a channel to one value per sample, writing every numBones'th element of out
+    template <typename T, typename ConvertFunc>
+    void expandChannel(const T* data, bool constant, const wanm::Clip& clip, uint32_t numBones, glm::vec4* out,
+                       ConvertFunc convert)
+    {
+        for (uint32_t i = 0; i < clip.numSamples; i++)
+        {
+            out[i * numBones] = convert(data[constant ? 0 : i]);
+        }
+    }
+
+    // True if size bytes starting at offset are inside the file
+    static bool inFile(uint64_t offset, uint64_t size, size_t fileSize)
+    {
+        return offset <= fileSize && size <= fileSize - offset;
+    }
+
+    template <typename T>
+    static bool channelInFile(wanm::OffsetType offset, bool constant, const wanm::Clip& clip, size_t fileSize)
+    {
+        uint64_t count = constant ? 1 : clip.numSamples;
+        return inFile(offset, count * sizeof(T), fileSize);
+    }
+
+    // Checks that every clip, track and channel the header refers to is inside the file
+    static bool validateAnimationSet(wanm::Header* hdr, size_t fileSize, const char* path)
+    {
+        if (hdr->numBones > 0 && hdr->numClips == 0)
+        {
+            logErr("Failed to load %s: header has %u bones but no clips", path, hdr->numBones);
+            return false;
+        }
+
+        if (!inFile(hdr->clipOffset, (uint64_t)hdr->numClips * sizeof(wanm::Clip), fileSize))
+        {
+            logErr("Failed to load %s: %u clips don't fit in the file", path, hdr->numClips);
+            return false;
+        }
+
+        for (wanm::CountType i = 0; i < hdr->numClips; i++)
+        {
+            const wanm::Clip& clip = hdr->getClips()[i];
+
+            if (!inFile(clip.trackOffset, (uint64_t)hdr->numBones * sizeof(wanm::Track), fileSize))
+            {
+                logErr("Failed to load %s: tracks for clip %u don't fit in the file", path, i);
+                return false;
+            }
+
+            const wanm::Track* tracks = hdr->getTracks(clip);
+            for (uint32_t b = 0; b < hdr->numBones; b++)
+            {
+                const wanm::Track& track = tracks[b];
+                bool valid =
+                    channelInFile<glm::vec3>(track.translationOffset, track.flags & wanm::ConstantTranslation, clip,
+                                             fileSize) &&
+                    channelInFile<wanm::QuantizedQuat>(track.rotationOffset, track.flags & wanm::ConstantRotation,
+                                                       clip, fileSize) &&
+                    channelInFile<glm::vec3>(track.scaleOffset, track.flags & wanm::ConstantScale, clip, fileSize);
+
+                if (!valid)
+                {
+                    logErr("Failed to load %s: channel data for clip %u bone %u doesn't fit in the file", path, i, b);
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    static bool loadAnimationSet(AssetID id, LoadedAnimationSet& set)
+    {
+        ZoneScoped;
+        PHYSFS_File* f = AssetDB::openAssetFileRead(id);
+
+        if (f == nullptr)
+        {
+            logErr("Failed to open animation %s", AssetDB::idToPath(id).c_str());
+            return false;
+        }
+
+        size_t fileSize = PHYSFS_fileLength(f);
+
+        if (fileSize < sizeof(wanm::Header))
+        {
+            logErr("Failed to load %s: file too short", AssetDB::idToPath(id).c_str());
+            PHYSFS_close(f);
+            return false;
+        }
+
+        void* buf = malloc(fileSize);
+        int64_t bytesRead = PHYSFS_readBytes(f, buf, fileSize);
+        PHYSFS_close(f);
+
+        if (bytesRead != (int64_t)fileSize)
+        {
+            logErr("Failed to load %s: couldn't read file", AssetDB::idToPath(id).c_str());
+            free(buf);
+            return false;
+        }
+
+        wanm::Header* hdr = (wanm::Header*)buf;
+
+        if (!hdr->verifyMagic() || hdr->version != 1)
+        {
+            logErr("Failed to load %s: invalid header", AssetDB::idToPath(id).c_str());
+            free(buf);
+            return false;
+        }
+
+        if (!validateAnimationSet(hdr, fileSize, AssetDB::idToPath(id).c_str()))
+        {
+            free(buf);
+            return false;
+        }
+
+        uint32_t numBones = hdr->numBones;
+        set.numBones = numBones;
+        set.clips.resize(hdr->numClips);
+
+        for (wanm::CountType i = 0; i < hdr->numClips; i++)
+        {
+            const wanm::Clip& srcClip = hdr->getClips()[i];
+            const wanm::Track* tracks = hdr->getTracks(srcClip);
+            AnimationClip& clip = set.clips[i];
+
+            // The name might not be null terminated in a corrupt file
+            char name[sizeof(srcClip.name) + 1]{};
+            memcpy(name, srcClip.name, sizeof(srcClip.name));
+            clip.name = name;
+            clip.duration = srcClip.duration;
+            clip.sampleRate = srcClip.sampleRate;
+            clip.numSamples = srcClip.numSamples;
+            clip.numBones = numBones;
+
+            size_t count = (size_t)srcClip.numSamples * numBones;
+            clip.translations.resize(count);
+            clip.rotations.resize(count);
+            clip.scales.resize(count);
+
+            auto toVec4 = [](const glm::vec3& v) { return glm::vec4{v, 0.0f}; };
+
+            for (uint32_t b = 0; b < numBones; b++)
+            {
+                const wanm::Track& track = tracks[b];
+                expandChannel((const glm::vec3*)hdr->getRelPtr(track.translationOffset),
+                              track.flags & wanm::ConstantTranslation, srcClip, numBones, &clip.translations[b],
+                              toVec4);
+                expandChannel((const wanm::QuantizedQuat*)hdr->getRelPtr(track.rotationOffset),
+                              track.flags & wanm::ConstantRotation, srcClip, numBones, &clip.rotations[b],
+                              dequantize);
+                expandChannel((const glm::vec3*)hdr->getRelPtr(track.scaleOffset), track.flags & wanm::ConstantScale,
+                              srcClip, numBones, &clip.scales[b], toVec4);
+            }
+        }
+
+        free(buf);
+        return true;
+    }
+
+    const LoadedAnimationSet& AnimationManager::loadOrGet(AssetID id)
+    {
+        ZoneScoped;
+        AllocTagScope allocTag{AllocTag::Assets};
+        auto it = loadedSets.find(id);
+        if (it != loadedSets.end())
+            return it->second;
+
+        if (!AssetDB::exists(id))
+        {
+            logErr("Animation ID %u doesn't exist!", id);
+            return emptySet;
+        }
+
+        LoadedAnimationSet set;
+        if (!loadAnimationSet(id, set))
+        {
+            return emptySet;
+        }
+
+        return loadedSets.insert({id, std::move(set)}).first->second;
+    }
+
+    void AnimationManager::unload(AssetID id)
+    {
+        loadedSets.erase(id);
+    }
+
+    bool AnimationManager::isLoaded(AssetID id)
+    {
+        return loadedSets.contains(id);
+    }
+}
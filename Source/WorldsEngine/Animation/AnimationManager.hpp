@@ -0,0 +1,46 @@
+#pragma once
+#include <Core/AssetDB.hpp>
+#include <glm/vec4.hpp>
+#include <robin_hood.h>
+#include <slib/String.hpp>
+#include <vector>
+
+namespace worlds
+{
+    // A clip resampled at a fixed rate. Channels are stored as vec4s so they can be loaded
+    // straight into SIMD registers, with rotations as (x, y, z, w) quaternions.
+    // All arrays are indexed by sample * numBones + bone.
+    struct AnimationClip
+    {
+        slib::String name;
+        float duration;
+        float sampleRate;
+        uint32_t numSamples;
+        uint32_t numBones;
+        std::vector<glm::vec4> translations;
+        std::vector<glm::vec4> rotations;
+        std::vector<glm::vec4> scales;
+    };
+
+    // All the clips compiled from one model. Clips only work on the model they were compiled with
+    // (or ones with the same skeleton).
+    struct LoadedAnimationSet
+    {
+        uint32_t numBones;
+        std::vector<AnimationClip> clips;
+
+        // Returns -1 if there's no clip with that name
+        int findClip(const char* name) const;
+    };
+
+    class AnimationManager
+    {
+      public:
+        static const LoadedAnimationSet& loadOrGet(AssetID id);
+        static void unload(AssetID id);
+        static bool isLoaded(AssetID id);
+
+      private:
+        static robin_hood::unordered_node_map<AssetID, LoadedAnimationSet> loadedSets;
+    };
+}
@@ -0,0 +1,358 @@
+#include "AnimationSystem.hpp"
+#include "AnimationManager.hpp"
+#include "PoseEvaluation.hpp"
+#include <Core/Console.hpp>
+#include <Core/Log.hpp>
+#include <Core/MeshManager.hpp>
+#include <Core/Profiler.hpp>
+#include <Core/TaskScheduler.hpp>
+#include <Core/WorldComponents.hpp>
+#include <Util/FrameArena.hpp>
+#include <Util/TimingUtil.hpp>
+#include <entt/entity/registry.hpp>
+#include <algorithm>
+#include <glm/gtc/quaternion.hpp>
+#include <math.h>
+#include <stdio.h>
+
+namespace worlds
+{
+    struct LayerEval
+    {
+        const AnimationClip* clip;
+        float time;
+        float weight;
+        const float* mask;
+    };
+
+    struct PoseJob
+    {
+        Pose* pose;
+        const LoadedMesh* mesh;
+        const LayerEval* layers;
+        uint32_t numLayers;
+    };
+
+    void evaluatePose(const PoseJob& job)
+    {
+        const std::vector<Bone>& bones = job.mesh->bones;
+        uint32_t numBones = (uint32_t)bones.size();
+
+        // Room for two local poses and the model space matrices, kept around between frames
+        thread_local std::vector<glm::vec4> poseStorage;
+        thread_local std::vector<glm::mat4> modelSpace;
+        if (poseStorage.size() < numBones * 6)
+            poseStorage.resize(numBones * 6);
+        if (modelSpace.size() < numBones)
+            modelSpace.resize(numBones);
+
+        glm::mat4* localTransforms = job.pose->boneTransforms.data();
+
+        if (job.numLayers > 0)
+        {
+            LocalPose result = LocalPose::fromStorage(poseStorage.data(), numBones);
+            LocalPose sampled = LocalPose::fromStorage(poseStorage.data() + numBones * 3, numBones);
+
+            for (uint32_t i = 0; i < job.numLayers; i++)
+            {
+                const LayerEval& layer = job.layers[i];
+
+                // A full weight base layer replaces the rest pose entirely, so skip the blend
+                if (i == 0 && layer.weight >= 1.0f && layer.mask == nullptr)
+                {
+                    sampleClip(*layer.clip, layer.time, result);
+                    continue;
+                }
+
+                if (i == 0)
+                    restPose(bones, result);
+
+                sampleClip(*layer.clip, layer.time, sampled);
+                blendPose(result, sampled, layer.weight, layer.mask);
+            }
+
+            poseToMatrices(result, localTransforms);
+        }
+
+        computeSkinningMatrices(bones, job.mesh->boneOrder, localTransforms, modelSpace.data(),
+                                job.pose->skinningMatrices.data());
+
+        // The model space transforms are already here, so bounding the pose for culling is nearly free
+        Pose& pose = *job.pose;
+        pose.hasBounds = job.mesh->boneRadii.size() == numBones &&
+                         computePoseBounds(modelSpace.data(), pose.skinningMatrices.data(),
+                                           job.mesh->boneRadii.data(), numBones, pose.boundsMin, pose.boundsMax);
+    }
+
+    struct PoseEvaluationTask : public enki::ITaskSet
+    {
+        const PoseJob* jobs;
+
+        void ExecuteRange(enki::TaskSetPartition range, uint32_t threadnum) override
+        {
+            ProfileScopedN("Evaluate Poses");
+            for (uint32_t i = range.start; i < range.end; i++)
+            {
+                evaluatePose(jobs[i]);
+            }
+        }
+    };
+
+    void evaluatePoses(const PoseJob* jobs, size_t count)
+    {
+        if (count == 0)
+            return;
+
+        PoseEvaluationTask task;
+        task.jobs = jobs;
+        task.m_SetSize = (uint32_t)count;
+        task.m_MinRange = 8;
+
+        g_taskSched.AddTaskSetToPipe(&task);
+        g_taskSched.WaitforTask(&task);
+    }
+
+    void advanceLayer(AnimationLayer& layer, const AnimationClip& clip, float deltaTime)
+    {
+        layer.time += deltaTime * layer.speed;
+
+        if (layer.loop && clip.duration > 0.0f)
+        {
+            layer.time = fmodf(layer.time, clip.duration);
+            if (layer.time < 0.0f)
+                layer.time += clip.duration;
+        }
+        else
+        {
+            layer.time = std::clamp(layer.time, 0.0f, clip.duration);
+        }
+    }
+
+    // Builds a 64 bone skeleton out of chains of 8 bones, with every chain after the first
+    // hanging off a bone in the first one.
+    void makeBenchmarkSkeleton(LoadedMesh& mesh)
+    {
+        const uint32_t NumBones = 64;
+        const uint32_t ChainLength = 8;
+
+        mesh.bones.resize(NumBones);
+        mesh.boneOrder.resize(NumBones);
+        mesh.boneRadii.assign(NumBones, 0.05f);
+
+        for (uint32_t i = 0; i < NumBones; i++)
+        {
+            Bone& b = mesh.bones[i];
+            b.id = i;
+
+            if (i == 0)
+                b.parentId = ~0u;
+            else if (i % ChainLength == 0)
+                b.parentId = i / ChainLength;
+            else
+                b.parentId = i - 1;
+
+            b.restTransform = Transform{glm::vec3{0.0f, 0.1f, 0.0f}, glm::quat{1.0f, 0.0f, 0.0f, 0.0f}};
+            b.restPose = b.restTransform.getMatrix();
+            b.inverseBindPose = glm::mat4{1.0f};
+            mesh.boneOrder[i] = i;
+        }
+    }
+
+    void makeBenchmarkClip(AnimationClip& clip, uint32_t numBones, float phase)
+    {
+        clip.duration = 2.0f;
+        clip.sampleRate = 30.0f;
+        clip.numSamples = 61;
+        clip.numBones = numBones;
+        clip.translations.resize(clip.numSamples * numBones);
+        clip.rotations.resize(clip.numSamples * numBones);
+        clip.scales.resize(clip.numSamples * numBones);
+
+        for (uint32_t s = 0; s < clip.numSamples; s++)
+        {
+            for (uint32_t b = 0; b < numBones; b++)
+            {
+                size_t idx = s * numBones + b;
+                float angle = sinf(s / (float)(clip.numSamples - 1) * 6.2831853f + b * 0.3f + phase) * 0.5f;
+                glm::quat q = glm::angleAxis(angle, glm::normalize(glm::vec3{1.0f, (float)(b % 3), 0.5f}));
+
+                clip.translations[idx] = glm::vec4{0.0f, 0.1f, 0.0f, 0.0f};
+                clip.rotations[idx] = glm::vec4{q.x, q.y, q.z, q.w};
+                clip.scales[idx] = glm::vec4{1.0f, 1.0f, 1.0f, 0.0f};
+            }
+        }
+    }
+
+    double percentile(const std::vector<double>& sorted, double p)
+    {
+        return sorted[std::min((size_t)(p * (sorted.size() - 1) + 0.5), sorted.size() - 1)];
+    }
+
+    // Evaluates a full body clip plus an arm layer blended over it for a crowd of characters,
+    // with the same code the animation system uses.
+    void runBenchmark(int characters, int frames)
+    {
+        LoadedMesh mesh{};
+        makeBenchmarkSkeleton(mesh);
+        uint32_t numBones = (uint32_t)mesh.bones.size();
+
+        AnimationClip walk;
+        AnimationClip wave;
+        makeBenchmarkClip(walk, numBones, 0.0f);
+        makeBenchmarkClip(wave, numBones, 1.5f);
+
+        std::vector<float> armMask;
+        AnimationSystem::maskBoneHierarchy(mesh, 24, 1.0f, armMask);
+
+        std::vector<Pose> poses(characters);
+        std::vector<LayerEval> layers(characters * 2);
+        std::vector<PoseJob> jobs(characters);
+
+        for (int i = 0; i < characters; i++)
+        {
+            poses[i].boneTransforms.resize(numBones);
+            poses[i].skinningMatrices.resize(numBones);
+            layers[i * 2] = LayerEval{&walk, 0.0f, 1.0f, nullptr};
+            layers[i * 2 + 1] = LayerEval{&wave, 0.0f, 0.7f, armMask.data()};
+            jobs[i] = PoseJob{&poses[i], &mesh, &layers[i * 2], 2};
+        }
+
+        std::vector<double> parallelTimes;
+        std::vector<double> serialTimes;
+
+        for (int frame = 0; frame < frames; frame++)
+        {
+            for (int i = 0; i < characters; i++)
+            {
+                float time = frame / 60.0f + i * 0.037f;
+                layers[i * 2].time = fmodf(time, walk.duration);
+                layers[i * 2 + 1].time = fmodf(time * 1.3f, wave.duration);
+            }
+
+            PerfTimer parallelTimer;
+            evaluatePoses(jobs.data(), jobs.size());
+            parallelTimes.push_back(parallelTimer.stopGetMs());
+
+            PerfTimer serialTimer;
+            for (const PoseJob& job : jobs)
+            {
+                evaluatePose(job);
+            }
+            serialTimes.push_back(serialTimer.stopGetMs());
+        }
+
+        std::sort(parallelTimes.begin(), parallelTimes.end());
+        std::sort(serialTimes.begin(), serialTimes.end());
+
+        double parallelMean = 0.0;
+        double serialMean = 0.0;
+        for (int i = 0; i < frames; i++)
+        {
+            parallelMean += parallelTimes[i] / frames;
+            serialMean += serialTimes[i] / frames;
+        }
+
+        logMsg("animation benchmark: %i characters, %u bones, 2 layers, %i frames", characters, numBones, frames);
+        logMsg("parallel: mean %.3fms, p50 %.3fms, p99 %.3fms, max %.3fms (%.2fus per character) on %u threads",
+               parallelMean, percentile(parallelTimes, 0.5), percentile(parallelTimes, 0.99), parallelTimes.back(),
+               parallelMean * 1000.0 / characters, g_taskSched.GetNumTaskThreads());
+        logMsg("serial: mean %.3fms, p50 %.3fms, p99 %.3fms (%.2fx)", serialMean, percentile(serialTimes, 0.5),
+               percentile(serialTimes, 0.99), serialMean / parallelMean);
+    }
+
+    void AnimationSystem::initialize()
+    {
+        g_console->registerCommand(
+            [](const char* arg) {
+                int characters = 500;
+                int frames = 300;
+                sscanf(arg, "%i %i", &characters, &frames);
+                runBenchmark(std::max(characters, 1), std::max(frames, 1));
+            },
+            "anim_benchmark", "Evaluates poses for a crowd of generated characters. Args: [characters] [frames]");
+    }
+
+    void AnimationSystem::update(entt::registry& registry, float deltaTime)
+    {
+        auto view = registry.view<SkinnedWorldObject>();
+        FrameVector<PoseJob> jobs;
+        jobs.reserve(view.size());
+
+        // Anything touching the registry or loading assets happens here before the tasks start, the
+        // tasks only see their own pose.
+        view.each(
+            [&](entt::entity entity, SkinnedWorldObject& swo)
+            {
+                const LoadedMesh& lm = MeshManager::loadOrGet(swo.mesh);
+                if (lm.bones.empty())
+                    return;
+
+                Pose& pose = swo.currentPose;
+                if (pose.boneTransforms.size() != lm.bones.size())
+                    swo.resetPose();
+                pose.skinningMatrices.resize(lm.bones.size());
+
+                PoseJob job{&pose, &lm, nullptr, 0};
+                Animator* animator = registry.try_get<Animator>(entity);
+
+                if (animator && !animator->layers.empty())
+                {
+                    LayerEval* layers = FrameArena::allocArray<LayerEval>(animator->layers.size());
+
+                    for (AnimationLayer& layer : animator->layers)
+                    {
+                        if (layer.animation == INVALID_ASSET)
+                            continue;
+
+                        // Layers with the wrong skeleton or a missing clip are left out
+                        const LoadedAnimationSet& set = AnimationManager::loadOrGet(layer.animation);
+                        if (layer.clip >= set.clips.size() || set.numBones != lm.bones.size())
+                            continue;
+
+                        const AnimationClip& clip = set.clips[layer.clip];
+                        if (clip.numSamples == 0)
+                            continue;
+
+                        advanceLayer(layer, clip, deltaTime);
+
+                        if (layer.weight <= 0.0f)
+                            continue;
+
+                        const float* mask = layer.boneMask.size() == lm.bones.size() ? layer.boneMask.data() : nullptr;
+                        layers[job.numLayers++] = LayerEval{&clip, layer.time, std::min(layer.weight, 1.0f), mask};
+                    }
+
+                    job.layers = layers;
+                }
+
+                jobs.push_back(job);
+            }
+        );
+
+        evaluatePoses(jobs.data(), jobs.size());
+    }
+
+    void AnimationSystem::maskBoneHierarchy(const LoadedMesh& mesh, uint32_t rootBone, float weight,
+                                            std::vector<float>& mask)
+    {
+        if (rootBone >= mesh.bones.size())
+        {
+            logErr("Can't mask bone %u, the mesh only has %zu bones", rootBone, mesh.bones.size());
+            return;
+        }
+
+        mask.resize(mesh.bones.size(), 0.0f);
+
+        // Parents come first in boneOrder, so one pass reaches every descendant
+        std::vector<bool> inHierarchy(mesh.bones.size());
+        for (uint32_t i : mesh.boneOrder)
+        {
+            uint32_t parent = mesh.bones[i].parentId;
+            if (i == rootBone || (parent != ~0u && inHierarchy[parent]))
+            {
+                inHierarchy[i] = true;
+                mask[i] = weight;
+            }
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <Core/AssetDB.hpp>
+#include <entt/entity/fwd.hpp>
+#include <stdint.h>
+#include <vector>
+
+namespace worlds
+{
+    struct LoadedMesh;
+
+    struct AnimationLayer
+    {
+        // A compiled .wanm file, made alongside the model when it has animations
+        AssetID animation = INVALID_ASSET;
+        uint32_t clip = 0;
+        float time = 0.0f;
+        float speed = 1.0f;
+        float weight = 1.0f;
+        bool loop = true;
+        // Optional per bone multiplier for the layer's weight, indexed by bone. Leave empty for the
+        // layer to cover the whole skeleton.
+        std::vector<float> boneMask;
+    };
+
+    // Animates the entity's SkinnedWorldObject. Layers are blended over the rest pose in order,
+    // so a later layer with a weight of 1 replaces everything below it (within its mask).
+    struct Animator
+    {
+        std::vector<AnimationLayer> layers;
+    };
+
+    class AnimationSystem
+    {
+      public:
+        static void initialize();
+        // Advances animators and evaluates the poses of every skinned object in parallel, leaving
+        // skinning matrices ready for the renderer.
+        static void update(entt::registry& registry, float deltaTime);
+        // Sets the mask weight of a bone and everything parented to it
+        static void maskBoneHierarchy(const LoadedMesh& mesh, uint32_t rootBone, float weight,
+                                      std::vector<float>& mask);
+    };
+}
@@ -0,0 +1,189 @@
+#include "PoseEvaluation.hpp"
+#include "AnimationManager.hpp"
+#include <Core/MeshManager.hpp>
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define ANIM_USE_SSE
+#include <emmintrin.h>
+#endif
+
+namespace worlds
+{
+#ifdef ANIM_USE_SSE
+    // Dot product of two vec4s, broadcast to every lane
+    inline __m128 dot4(__m128 a, __m128 b)
+    {
+        __m128 m = _mm_mul_ps(a, b);
+        __m128 s = _mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_add_ps(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 0, 3, 2)));
+    }
+
+    inline __m128 lerp4(__m128 a, __m128 b, __m128 t)
+    {
+        return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+    }
+#endif
+
+    inline void lerpVec(const glm::vec4& a, const glm::vec4& b, float t, glm::vec4& out)
+    {
+#ifdef ANIM_USE_SSE
+        _mm_storeu_ps(&out.x, lerp4(_mm_loadu_ps(&a.x), _mm_loadu_ps(&b.x), _mm_set1_ps(t)));
+#else
+        out = a + (b - a) * t;
+#endif
+    }
+
+    // Normalized lerp along the shortest path. Samples are close together so this is close
+    // enough to slerp.
+    inline void nlerpQuat(const glm::vec4& a, const glm::vec4& b, float t, glm::vec4& out)
+    {
+#ifdef ANIM_USE_SSE
+        __m128 va = _mm_loadu_ps(&a.x);
+        __m128 vb = _mm_loadu_ps(&b.x);
+        __m128 negative = _mm_cmplt_ps(dot4(va, vb), _mm_setzero_ps());
+        vb = _mm_xor_ps(vb, _mm_and_ps(negative, _mm_set1_ps(-0.0f)));
+
+        __m128 q = lerp4(va, vb, _mm_set1_ps(t));
+        _mm_storeu_ps(&out.x, _mm_div_ps(q, _mm_sqrt_ps(dot4(q, q))));
+#else
+        glm::vec4 target = glm::dot(a, b) < 0.0f ? -b : b;
+        glm::vec4 q = a + (target - a) * t;
+        out = q / glm::sqrt(glm::dot(q, q));
+#endif
+    }
+
+    inline void mulMat4(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+    {
+#ifdef ANIM_USE_SSE
+        __m128 a0 = _mm_loadu_ps(&a[0][0]);
+        __m128 a1 = _mm_loadu_ps(&a[1][0]);
+        __m128 a2 = _mm_loadu_ps(&a[2][0]);
+        __m128 a3 = _mm_loadu_ps(&a[3][0]);
+
+        for (int i = 0; i < 4; i++)
+        {
+            __m128 xy = _mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(b[i][0])), _mm_mul_ps(a1, _mm_set1_ps(b[i][1])));
+            __m128 zw = _mm_add_ps(_mm_mul_ps(a2, _mm_set1_ps(b[i][2])), _mm_mul_ps(a3, _mm_set1_ps(b[i][3])));
+            _mm_storeu_ps(&out[i][0], _mm_add_ps(xy, zw));
+        }
+#else
+        out = a * b;
+#endif
+    }
+
+    LocalPose LocalPose::fromStorage(glm::vec4* storage, uint32_t numBones)
+    {
+        return LocalPose{numBones, storage, storage + numBones, storage + numBones * 2};
+    }
+
+    void restPose(const std::vector<Bone>& bones, LocalPose& out)
+    {
+        for (uint32_t i = 0; i < out.numBones; i++)
+        {
+            const Transform& t = bones[i].restTransform;
+            out.translations[i] = glm::vec4{t.position, 0.0f};
+            out.rotations[i] = glm::vec4{t.rotation.x, t.rotation.y, t.rotation.z, t.rotation.w};
+            out.scales[i] = glm::vec4{t.scale, 0.0f};
+        }
+    }
+
+    void sampleClip(const AnimationClip& clip, float time, LocalPose& out)
+    {
+        float position = std::clamp(time * clip.sampleRate, 0.0f, (float)(clip.numSamples - 1));
+        uint32_t sampleA = (uint32_t)position;
+        uint32_t sampleB = std::min(sampleA + 1, clip.numSamples - 1);
+        float t = position - sampleA;
+
+        size_t offsetA = (size_t)sampleA * clip.numBones;
+        size_t offsetB = (size_t)sampleB * clip.numBones;
+        uint32_t numBones = std::min(out.numBones, clip.numBones);
+
+        for (uint32_t i = 0; i < numBones; i++)
+        {
+            lerpVec(clip.translations[offsetA + i], clip.translations[offsetB + i], t, out.translations[i]);
+            nlerpQuat(clip.rotations[offsetA + i], clip.rotations[offsetB + i], t, out.rotations[i]);
+            lerpVec(clip.scales[offsetA + i], clip.scales[offsetB + i], t, out.scales[i]);
+        }
+    }
+
+    void blendPose(LocalPose& dst, const LocalPose& src, float weight, const float* boneWeights)
+    {
+        uint32_t numBones = std::min(dst.numBones, src.numBones);
+
+        for (uint32_t i = 0; i < numBones; i++)
+        {
+            float w = boneWeights ? weight * boneWeights[i] : weight;
+            if (w <= 0.0f)
+                continue;
+
+            lerpVec(dst.translations[i], src.translations[i], w, dst.translations[i]);
+            nlerpQuat(dst.rotations[i], src.rotations[i], w, dst.rotations[i]);
+            lerpVec(dst.scales[i], src.scales[i], w, dst.scales[i]);
+        }
+    }
+
+    void poseToMatrices(const LocalPose& pose, glm::mat4* out)
+    {
+        for (uint32_t i = 0; i < pose.numBones; i++)
+        {
+            const glm::vec4& q = pose.rotations[i];
+            const glm::vec4& s = pose.scales[i];
+            float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+            float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+            float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+            glm::mat4& m = out[i];
+            m[0] = glm::vec4{1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f} * s.x;
+            m[1] = glm::vec4{2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f} * s.y;
+            m[2] = glm::vec4{2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f} * s.z;
+            m[3] = glm::vec4{glm::vec3{pose.translations[i]}, 1.0f};
+        }
+    }
+
+    void computeSkinningMatrices(const std::vector<Bone>& bones, const std::vector<uint32_t>& boneOrder,
+                                 const glm::mat4* localTransforms, glm::mat4* modelSpace, glm::mat4* out)
+    {
+        for (uint32_t i : boneOrder)
+        {
+            uint32_t parent = bones[i].parentId;
+
+            if (parent == ~0u)
+                modelSpace[i] = localTransforms[i];
+            else
+                mulMat4(modelSpace[parent], localTransforms[i], modelSpace[i]);
+
+            mulMat4(modelSpace[i], bones[i].inverseBindPose, out[i]);
+        }
+    }
+
+    bool computePoseBounds(const glm::mat4* modelSpace, const glm::mat4* skinningMatrices, const float* boneRadii,
+                           uint32_t numBones, glm::vec3& outMin, glm::vec3& outMax)
+    {
+        glm::vec3 boundsMin{FLT_MAX};
+        glm::vec3 boundsMax{-FLT_MAX};
+        bool any = false;
+
+        for (uint32_t i = 0; i < numBones; i++)
+        {
+            if (boneRadii[i] < 0.0f)
+                continue;
+
+            // Scaled bones stretch their vertices too, so grow the radius by the largest axis scale
+            const glm::mat4& m = skinningMatrices[i];
+            float maxScaleSq = glm::max(glm::dot(m[0], m[0]), glm::max(glm::dot(m[1], m[1]), glm::dot(m[2], m[2])));
+            float radius = boneRadii[i] * glm::sqrt(maxScaleSq);
+
+            glm::vec3 position = modelSpace[i][3];
+            boundsMin = glm::min(boundsMin, position - radius);
+            boundsMax = glm::max(boundsMax, position + radius);
+            any = true;
+        }
+
+        outMin = boundsMin;
+        outMax = boundsMax;
+        return any;
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <stdint.h>
+#include <vector>
+
+namespace worlds
+{
+    struct AnimationClip;
+    struct Bone;
+
+    // Bone transforms relative to their parents, split into arrays so they can be worked on four
+    // floats at a time. Rotations are (x, y, z, w) quaternions.
+    struct LocalPose
+    {
+        uint32_t numBones;
+        glm::vec4* translations;
+        glm::vec4* rotations;
+        glm::vec4* scales;
+
+        // Splits storage, which has to hold numBones * 3 vec4s, into the three arrays
+        static LocalPose fromStorage(glm::vec4* storage, uint32_t numBones);
+    };
+
+    // Sets the pose to the bones' rest transforms
+    void restPose(const std::vector<Bone>& bones, LocalPose& out);
+    // time is clamped to the clip, wrapping looping clips is up to the caller
+    void sampleClip(const AnimationClip& clip, float time, LocalPose& out);
+    // Blends src into dst by weight. boneWeights optionally scales the weight per bone, which is
+    // how layers get masked to part of the skeleton.
+    void blendPose(LocalPose& dst, const LocalPose& src, float weight, const float* boneWeights);
+    void poseToMatrices(const LocalPose& pose, glm::mat4* out);
+    // Goes through the bones once in parent-before-child order to get their model space
+    // transforms, then multiplies them by the inverse bind pose. modelSpace is scratch space for
+    // one matrix per bone.
+    void computeSkinningMatrices(const std::vector<Bone>& bones, const std::vector<uint32_t>& boneOrder,
+                                 const glm::mat4* localTransforms, glm::mat4* modelSpace, glm::mat4* out);
+    // Bounds the posed mesh with a sphere around each bone reaching its furthest vertex, using the
+    // model space and skinning matrices from computeSkinningMatrices. Returns false if none of the
+    // bones move any vertices.
+    bool computePoseBounds(const glm::mat4* modelSpace, const glm::mat4* skinningMatrices, const float* boneRadii,
+                           uint32_t numBones, glm::vec3& outMin, glm::vec3& outMax);
+}
@@ -1,6 +1,7 @@
 #include "ModelCompiler.hpp"
 #include "AssetCompilation/AssetCompilerUtil.hpp"
 #include "Core/Log.hpp"
+#include "Core/Transform.hpp"
 #include "IO/IOUtil.hpp"
 #include "glm/gtc/type_ptr.hpp"
 #include "nlohmann/json.hpp"
@@ -8,6 +9,7 @@
 #include <Libs/mikktspace.h>
 #include <Libs/weldmesh.h>
 #include "robin_hood.h"
+#include <WANM.hpp>
 #include <WMDL.hpp>
 #ifdef ENABLE_ASSIMP
 #include <assimp/DefaultLogger.hpp>
@@ -17,6 +19,7 @@
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 #endif
+#include <algorithm>
 #include <filesystem>
 #include <optional>
 #include <slib/Path.hpp>
@@ -42,6 +45,9 @@ namespace worlds
         bool removeRedundantMaterials = true;
         bool combineSubmeshes = false;
         float uniformScale = 1.0f;
+        float animationSampleRate = 30.0f;
+        // Where the model's animations get written. Nothing is written if the model has none.
+        std::string animationOutputPath;
     };
 
     namespace mc_internal
@@ -139,6 +145,178 @@ namespace worlds
             return 3;
         }
 
+        // Keyframes for a single bone as they are in the source file. Channels without any keys
+        // use the bone's rest pose.
+        struct SourceTrack
+        {
+            std::vector<float> translationTimes;
+            std::vector<glm::vec3> translations;
+            std::vector<float> rotationTimes;
+            std::vector<glm::quat> rotations;
+            std::vector<float> scaleTimes;
+            std::vector<glm::vec3> scales;
+        };
+
+        struct SourceClip
+        {
+            std::string name;
+            float duration = 0.0f;
+            // Indexed by bone
+            std::vector<SourceTrack> tracks;
+        };
+
+        template <typename T, typename InterpFunc>
+        T sampleKeys(const std::vector<float>& times, const std::vector<T>& values, float time, InterpFunc interp)
+        {
+            if (values.size() == 1 || time <= times.front())
+                return values.front();
+
+            if (time >= times.back())
+                return values.back();
+
+            size_t next = std::upper_bound(times.begin(), times.end(), time) - times.begin();
+            float t = (time - times[next - 1]) / (times[next] - times[next - 1]);
+            return interp(values[next - 1], values[next], t);
+        }
+
+        wanm::QuantizedQuat quantizeQuat(glm::quat q)
+        {
+            q = glm::normalize(q);
+            return wanm::QuantizedQuat{(int16_t)roundf(q.x * 32767.0f), (int16_t)roundf(q.y * 32767.0f),
+                                       (int16_t)roundf(q.z * 32767.0f), (int16_t)roundf(q.w * 32767.0f)};
+        }
+
+        template <typename T> wanm::OffsetType appendData(std::vector<uint8_t>& buffer, const T* data, size_t count)
+        {
+            wanm::OffsetType offset = buffer.size();
+            buffer.resize(buffer.size() + sizeof(T) * count);
+            memcpy(buffer.data() + offset, data, sizeof(T) * count);
+            return offset;
+        }
+
+        // Resamples the clips at a fixed rate and writes them out, dropping channels that don't
+        // change over the clip down to a single sample.
+        void writeAnimations(const std::string& path, const std::vector<SourceClip>& clips,
+                             const std::vector<wmdl::Bone>& bones, float sampleRate)
+        {
+            if (clips.empty())
+                return;
+
+            std::vector<Transform> restPose;
+            restPose.reserve(bones.size());
+            for (const wmdl::Bone& b : bones)
+            {
+                restPose.emplace_back(b.transform);
+            }
+
+            std::vector<uint8_t> buffer;
+            buffer.resize(sizeof(wanm::Header) + sizeof(wanm::Clip) * clips.size());
+
+            wanm::Header hdr;
+            hdr.numClips = clips.size();
+            hdr.numBones = bones.size();
+            hdr.clipOffset = sizeof(wanm::Header);
+
+            std::vector<wanm::Clip> outClips(clips.size());
+            std::vector<wanm::Track> tracks(bones.size());
+            std::vector<glm::vec3> translations;
+            std::vector<wanm::QuantizedQuat> rotations;
+            std::vector<glm::vec3> scales;
+
+            auto lerpVec = [](glm::vec3 a, glm::vec3 b, float t) { return glm::mix(a, b, t); };
+            auto slerpQuat = [](glm::quat a, glm::quat b, float t) { return glm::slerp(a, b, t); };
+
+            for (size_t clipIdx = 0; clipIdx < clips.size(); clipIdx++)
+            {
+                const SourceClip& clip = clips[clipIdx];
+                wanm::Clip& outClip = outClips[clipIdx];
+
+                // Spread the samples evenly over the clip so the last one lands exactly on the end
+                uint32_t numSamples = clip.duration > 0.0f ? (uint32_t)ceilf(clip.duration * sampleRate) + 1 : 1;
+                outClip.setName(clip.name.c_str());
+                outClip.duration = clip.duration;
+                outClip.numSamples = numSamples;
+                outClip.sampleRate = numSamples > 1 ? (numSamples - 1) / clip.duration : 0.0f;
+
+                size_t trackOffset = appendData(buffer, tracks.data(), tracks.size());
+                outClip.trackOffset = trackOffset;
+
+                for (size_t boneIdx = 0; boneIdx < bones.size(); boneIdx++)
+                {
+                    const SourceTrack* st = boneIdx < clip.tracks.size() ? &clip.tracks[boneIdx] : nullptr;
+                    const Transform& rest = restPose[boneIdx];
+                    translations.resize(numSamples);
+                    rotations.resize(numSamples);
+                    scales.resize(numSamples);
+
+                    glm::quat lastRotation = rest.rotation;
+                    for (uint32_t i = 0; i < numSamples; i++)
+                    {
+                        float time = numSamples > 1 ? std::min(i / outClip.sampleRate, clip.duration) : 0.0f;
+
+                        translations[i] = st && !st->translations.empty()
+                                              ? sampleKeys(st->translationTimes, st->translations, time, lerpVec)
+                                              : rest.position;
+                        scales[i] = st && !st->scales.empty() ? sampleKeys(st->scaleTimes, st->scales, time, lerpVec)
+                                                              : rest.scale;
+
+                        glm::quat rotation = st && !st->rotations.empty()
+                                                 ? sampleKeys(st->rotationTimes, st->rotations, time, slerpQuat)
+                                                 : rest.rotation;
+
+                        // Keep neighbouring samples in the same hemisphere so they can be lerped
+                        if (glm::dot(rotation, lastRotation) < 0.0f)
+                            rotation = -rotation;
+                        lastRotation = rotation;
+                        rotations[i] = quantizeQuat(rotation);
+                    }
+
+                    wanm::Track& track = tracks[boneIdx];
+                    track.flags = 0;
+
+                    bool constantTranslation = true;
+                    bool constantRotation = true;
+                    bool constantScale = true;
+                    for (uint32_t i = 1; i < numSamples; i++)
+                    {
+                        constantTranslation &= glm::all(glm::lessThan(glm::abs(translations[i] - translations[0]),
+                                                                      glm::vec3{0.00001f}));
+                        constantScale &= glm::all(glm::lessThan(glm::abs(scales[i] - scales[0]), glm::vec3{0.00001f}));
+                        constantRotation &= memcmp(&rotations[i], &rotations[0], sizeof(wanm::QuantizedQuat)) == 0;
+                    }
+
+                    if (constantTranslation)
+                        track.flags |= wanm::ConstantTranslation;
+                    if (constantRotation)
+                        track.flags |= wanm::ConstantRotation;
+                    if (constantScale)
+                        track.flags |= wanm::ConstantScale;
+
+                    track.translationOffset =
+                        appendData(buffer, translations.data(), constantTranslation ? 1 : numSamples);
+                    track.rotationOffset = appendData(buffer, rotations.data(), constantRotation ? 1 : numSamples);
+                    track.scaleOffset = appendData(buffer, scales.data(), constantScale ? 1 : numSamples);
+                }
+
+                memcpy(buffer.data() + trackOffset, tracks.data(), sizeof(wanm::Track) * tracks.size());
+                logMsg("Animation %s: %.2fs, %u samples", clip.name.c_str(), clip.duration, numSamples);
+            }
+
+            memcpy(buffer.data(), &hdr, sizeof(hdr));
+            memcpy(buffer.data() + hdr.clipOffset, outClips.data(), sizeof(wanm::Clip) * outClips.size());
+
+            PHYSFS_File* outFile = PHYSFS_openWrite(path.c_str());
+            if (outFile == nullptr)
+            {
+                logErr("Failed to open %s for writing animations", path.c_str());
+                return;
+            }
+
+            PHYSFS_writeBytes(outFile, buffer.data(), buffer.size());
+            PHYSFS_close(outFile);
+            logMsg("Wrote %zu animations to %s (%zu bytes)", clips.size(), path.c_str(), buffer.size());
+        }
+
 #ifdef ENABLE_ASSIMP
         struct IntermediateBone
         {
@@ -558,6 +736,51 @@ namespace worlds
             PHYSFS_writeBytes(outFile, combinedVertSkinningInfo.data(),
                               combinedVertSkinningInfo.size() * sizeof(wmdl::VertexSkinningInfo));
 
+            if (hasBones && scene->mNumAnimations > 0)
+            {
+                std::vector<SourceClip> clips;
+                for (unsigned int i = 0; i < scene->mNumAnimations; i++)
+                {
+                    const aiAnimation* anim = scene->mAnimations[i];
+                    double ticksPerSecond = anim->mTicksPerSecond != 0.0 ? anim->mTicksPerSecond : 25.0;
+
+                    SourceClip& clip = clips.emplace_back();
+                    clip.name = anim->mName.length > 0 ? anim->mName.C_Str() : "Animation " + std::to_string(i);
+                    clip.duration = (float)(anim->mDuration / ticksPerSecond);
+                    clip.tracks.resize(combinedBones.size());
+
+                    for (unsigned int j = 0; j < anim->mNumChannels; j++)
+                    {
+                        const aiNodeAnim* channel = anim->mChannels[j];
+                        auto boneIt = combinedBoneIds.find(channel->mNodeName.C_Str());
+                        if (boneIt == combinedBoneIds.end())
+                            continue;
+
+                        SourceTrack& track = clip.tracks[boneIt->second];
+                        for (unsigned int k = 0; k < channel->mNumPositionKeys; k++)
+                        {
+                            track.translationTimes.push_back((float)(channel->mPositionKeys[k].mTime / ticksPerSecond));
+                            track.translations.push_back(toGlm(channel->mPositionKeys[k].mValue));
+                        }
+
+                        for (unsigned int k = 0; k < channel->mNumRotationKeys; k++)
+                        {
+                            const aiQuaternion& q = channel->mRotationKeys[k].mValue;
+                            track.rotationTimes.push_back((float)(channel->mRotationKeys[k].mTime / ticksPerSecond));
+                            track.rotations.push_back(glm::quat{q.w, q.x, q.y, q.z});
+                        }
+
+                        for (unsigned int k = 0; k < channel->mNumScalingKeys; k++)
+                        {
+                            track.scaleTimes.push_back((float)(channel->mScalingKeys[k].mTime / ticksPerSecond));
+                            track.scales.push_back(toGlm(channel->mScalingKeys[k].mValue));
+                        }
+                    }
+                }
+
+                writeAnimations(settings.animationOutputPath, clips, combinedBones, settings.animationSampleRate);
+            }
+
             int i = 0;
             for (auto& mesh : meshes)
             {
@@ -642,7 +865,7 @@ namespace worlds
                     // Either way, convert to a matrix to make it easier everywhere else
                     if (n.matrix.size())
                     {
-                        convertedNode.transform = glm::make_mat4x4(n.matrix.data());
+                        convertedNode.localTransform = glm::make_mat4x4(n.matrix.data());
                     }
                     else
                     {
@@ -907,6 +1130,110 @@ namespace worlds
                 return prim.attributes.contains(attribute);
             }
 
+            // Copies out an accessor's elements. Interleaved buffer views are read using their stride.
+            template <typename T> std::vector<T> getAccessorData(int accessorIdx)
+            {
+                const tinygltf::Accessor& accessor = model.accessors[accessorIdx];
+                const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+                size_t totalOffset = accessor.byteOffset + bufferView.byteOffset;
+                const unsigned char* src = &model.buffers[bufferView.buffer].data[totalOffset];
+                size_t stride = bufferView.byteStride != 0 ? bufferView.byteStride : sizeof(T);
+
+                std::vector<T> data(accessor.count);
+                for (size_t i = 0; i < accessor.count; i++)
+                {
+                    memcpy(&data[i], src + i * stride, sizeof(T));
+                }
+
+                return data;
+            }
+
+            // Copies keyframes into a track, expanding step interpolation into pairs of keys and
+            // dropping the tangents of cubic splines.
+            template <typename T>
+            void readChannelKeys(const tinygltf::AnimationSampler& sampler, const T* values, std::vector<float>& outTimes,
+                                 std::vector<T>& outValues)
+            {
+                const tinygltf::Accessor& input = model.accessors[sampler.input];
+                std::vector<float> times = getAccessorData<float>(sampler.input);
+                bool cubic = sampler.interpolation == "CUBICSPLINE";
+                bool step = sampler.interpolation == "STEP";
+
+                for (size_t i = 0; i < input.count; i++)
+                {
+                    T value = values[cubic ? i * 3 + 1 : i];
+
+                    if (step && i > 0)
+                    {
+                        outTimes.push_back(glm::max(times[i] - 0.0001f, times[i - 1]));
+                        outValues.push_back(outValues.back());
+                    }
+
+                    outTimes.push_back(times[i]);
+                    outValues.push_back(value);
+                }
+            }
+
+            void readAnimations(std::vector<SourceClip>& clips, const robin_hood::unordered_map<int, int>& nodeToBone,
+                                size_t numBones)
+            {
+                for (size_t i = 0; i < model.animations.size(); i++)
+                {
+                    const tinygltf::Animation& anim = model.animations[i];
+                    SourceClip& clip = clips.emplace_back();
+                    clip.name = anim.name.empty() ? "Animation " + std::to_string(i) : anim.name;
+                    clip.tracks.resize(numBones);
+
+                    for (const tinygltf::AnimationChannel& channel : anim.channels)
+                    {
+                        auto boneIt = nodeToBone.find(channel.target_node);
+                        if (boneIt == nodeToBone.end())
+                            continue;
+
+                        const tinygltf::AnimationSampler& sampler = anim.samplers[channel.sampler];
+                        const tinygltf::Accessor& input = model.accessors[sampler.input];
+                        const tinygltf::Accessor& output = model.accessors[sampler.output];
+
+                        if (input.count == 0)
+                            continue;
+
+                        if (output.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT)
+                        {
+                            logWarn("Animation %s: skipping %s channel with non-float keys", clip.name.c_str(),
+                                    channel.target_path.c_str());
+                            continue;
+                        }
+
+                        clip.duration = glm::max(clip.duration, getAccessorData<float>(sampler.input).back());
+                        SourceTrack& track = clip.tracks[boneIt->second];
+
+                        if (channel.target_path == "translation")
+                        {
+                            readChannelKeys(sampler, getAccessorData<glm::vec3>(sampler.output).data(),
+                                            track.translationTimes, track.translations);
+                        }
+                        else if (channel.target_path == "scale")
+                        {
+                            readChannelKeys(sampler, getAccessorData<glm::vec3>(sampler.output).data(),
+                                            track.scaleTimes, track.scales);
+                        }
+                        else if (channel.target_path == "rotation")
+                        {
+                            // glTF quaternions are XYZW, which is how make_quat reads them
+                            std::vector<glm::vec4> data = getAccessorData<glm::vec4>(sampler.output);
+                            std::vector<glm::quat> values;
+                            values.reserve(output.count);
+                            for (const glm::vec4& v : data)
+                            {
+                                values.push_back(glm::make_quat(glm::value_ptr(v)));
+                            }
+
+                            readChannelKeys(sampler, values.data(), track.rotationTimes, track.rotations);
+                        }
+                    }
+                }
+            }
+
             void combineSubmeshes()
             {
                 std::vector<std::vector<wmdl::SubmeshInfo>> submeshesByMaterial;
@@ -991,17 +1318,11 @@ namespace worlds
                 }
 
                 std::vector<wmdl::Bone> bones;
+                robin_hood::unordered_map<int, int> nodeToBone;
 
                 for (const tinygltf::Skin& skin : model.skins)
                 {
-                    const tinygltf::Accessor& accessor = model.accessors[skin.inverseBindMatrices];
-                    const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
-                    const tinygltf::Buffer& buffer = model.buffers[bufferView.buffer];
-
-                    std::vector<glm::mat4> inverseBindMatrices;
-                    inverseBindMatrices.resize(accessor.count);
-                    memcpy(inverseBindMatrices.data(), &buffer.data[accessor.byteOffset + bufferView.byteOffset],
-                           accessor.count * sizeof(glm::mat4));
+                    std::vector<glm::mat4> inverseBindMatrices = getAccessorData<glm::mat4>(skin.inverseBindMatrices);
 
                     robin_hood::unordered_map<int, int> nodeToJoint;
                     size_t i = 0;
@@ -1009,6 +1330,7 @@ namespace worlds
                     {
                         ConvertedGltfNode& jointNode = convertedNodes.at(jointIdx);
                         nodeToJoint.insert({jointNode.index, i});
+                        nodeToBone.insert({jointIdx, (int)bones.size()});
                         glm::mat4 transform = convertedNodes.at(jointIdx).localTransform;
 
                         wmdl::Bone b;
@@ -1057,6 +1379,13 @@ namespace worlds
 
                 PHYSFS_writeBytes(outFile, bones.data(), boneLength);
                 PHYSFS_writeBytes(outFile, skinInfo.data(), vertSkinInfoLength);
+
+                if (!bones.empty() && !model.animations.empty())
+                {
+                    std::vector<SourceClip> clips;
+                    readAnimations(clips, nodeToBone, bones.size());
+                    writeAnimations(settings.animationOutputPath, clips, bones, settings.animationSampleRate);
+                }
                 PHYSFS_writeBytes(outFile, submeshes.data(), sizeof(wmdl::SubmeshInfo) * submeshes.size());
                 PHYSFS_writeBytes(outFile, verts.data(), sizeof(wmdl::Vertex2) * verts.size());
                 if (!hdr.useSmallIndices)
@@ -1140,6 +1469,14 @@ namespace worlds
         settings.removeRedundantMaterials = j.value("removeRedundantMaterials", true);
         settings.uniformScale = j.value("uniformScale", 1.0f);
         settings.combineSubmeshes = j.value("combineSubmeshes", false);
+        settings.animationSampleRate = j.value("animationSampleRate", 30.0f);
+        settings.animationOutputPath = outputPath.substr(0, outputPath.find_last_of('.')) + ".wanm";
+
+        if (settings.animationSampleRate <= 0.0f)
+        {
+            logWarn("Invalid animation sample rate %.2f, using 30", settings.animationSampleRate);
+            settings.animationSampleRate = 30.0f;
+        }
 
         std::thread([compileOp, outputPath, fullSourcePath, path, result, fileLen, settings]() {
             PHYSFS_File* outFile = PHYSFS_openWrite(outputPath.c_str());
@@ -0,0 +1,207 @@
+#include "AcousticGeometry.hpp"
+#include <Core/Log.hpp>
+#include <Core/MaterialManager.hpp>
+#include <Core/MeshManager.hpp>
+#include <Core/TaskScheduler.hpp>
+#include <Util/EnumUtil.hpp>
+#include <entt/entity/registry.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <Tracy.hpp>
+
+namespace worlds
+{
+    const IPLMaterial DefaultAcousticMaterial{{0.1f, 0.2f, 0.3f}, 0.05f, {0.1f, 0.05f, 0.03f}};
+
+    std::shared_ptr<const AcousticMesh> AcousticGeometryCache::getMesh(AssetID id)
+    {
+        auto it = meshes.find(id);
+        if (it != meshes.end())
+            return it->second;
+
+        const LoadedMesh& lm = MeshManager::loadOrGet(id);
+        auto mesh = std::make_shared<AcousticMesh>();
+
+        mesh->positions.resize(lm.vertices.size());
+        for (size_t i = 0; i < lm.vertices.size(); i++)
+        {
+            mesh->positions[i] = lm.vertices[i].position;
+        }
+
+        size_t triCount = 0;
+        for (int submeshIdx = 0; submeshIdx < lm.numSubmeshes; submeshIdx++)
+        {
+            triCount += lm.submeshes[submeshIdx].indexCount / 3;
+        }
+
+        mesh->triangles.reserve(triCount);
+        mesh->materialIndices.reserve(triCount);
+
+        for (int submeshIdx = 0; submeshIdx < lm.numSubmeshes; submeshIdx++)
+        {
+            const SubmeshInfo& submesh = lm.submeshes[submeshIdx];
+
+            for (uint32_t i = 0; i + 2 < submesh.indexCount; i += 3)
+            {
+                const uint32_t* idx = &lm.indices[submesh.indexOffset + i];
+                mesh->triangles.push_back({(IPLint32)idx[0], (IPLint32)idx[1], (IPLint32)idx[2]});
+                mesh->materialIndices.push_back(submesh.materialIndex);
+            }
+        }
+
+        meshes.insert({id, mesh});
+        return mesh;
+    }
+
+    const IPLMaterial& AcousticGeometryCache::getMaterial(AssetID id)
+    {
+        auto it = materials.find(id);
+        if (it != materials.end())
+            return it->second;
+
+        IPLMaterial mat = DefaultAcousticMaterial;
+        auto& jMat = MaterialManager::loadOrGet(id);
+        mat.scattering = jMat.value("soundScattering", mat.scattering);
+
+        if (jMat.contains("soundAbsorption"))
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                mat.absorption[i] = jMat["soundAbsorption"][i];
+            }
+        }
+
+        if (jMat.contains("soundTransmission"))
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                mat.transmission[i] = jMat["soundTransmission"][i];
+            }
+        }
+
+        return materials.insert({id, mat}).first->second;
+    }
+
+    void AcousticGeometryCache::clear()
+    {
+        meshes.clear();
+        materials.clear();
+    }
+
+    size_t AcousticGeometryCache::meshCount() const
+    {
+        return meshes.size();
+    }
+
+    uint64_t gatherAcousticInstances(entt::registry& reg, AcousticGeometryCache& cache,
+                                     std::vector<AcousticInstance>& instances)
+    {
+        ZoneScoped;
+        instances.clear();
+        uint64_t sceneHash = 0;
+
+        reg.view<WorldObject, Transform>().each([&](WorldObject& wo, Transform& t) {
+            if (!enumHasFlag(wo.staticFlags, StaticFlags::Audio))
+                return;
+
+            AcousticInstance& instance = instances.emplace_back();
+            instance.mesh = cache.getMesh(wo.mesh);
+            instance.transform = t.getMatrix();
+
+            for (int i = 0; i < NUM_SUBMESH_MATS; i++)
+            {
+                instance.materials[i] =
+                    wo.presentMaterials[i] ? cache.getMaterial(wo.materials[i]) : DefaultAcousticMaterial;
+            }
+
+            // 64-bit FNV-1a per object, summed so entity order doesn't matter
+            uint64_t hash = 14695981039346656037ull;
+            auto hashBytes = [&](const void* data, size_t size) {
+                const uint8_t* bytes = (const uint8_t*)data;
+                for (size_t i = 0; i < size; i++)
+                {
+                    hash ^= bytes[i];
+                    hash *= 1099511628211ull;
+                }
+            };
+
+            hashBytes(&wo.mesh, sizeof(wo.mesh));
+            hashBytes(glm::value_ptr(instance.transform), sizeof(instance.transform));
+            hashBytes(instance.materials.data(), sizeof(IPLMaterial) * instance.materials.size());
+            sceneHash += hash;
+        });
+
+        return sceneHash;
+    }
+
+    IPLScene buildAcousticScene(IPLContext context, const std::vector<AcousticInstance>& instances)
+    {
+        ZoneScoped;
+
+        IPLSceneSettings sceneSettings{};
+        sceneSettings.type = IPL_SCENETYPE_DEFAULT;
+
+        IPLScene scene = nullptr;
+        if (iplSceneCreate(context, &sceneSettings, &scene) != IPL_STATUS_SUCCESS)
+        {
+            logErr(WELogCategoryAudio, "Failed to create audio scene");
+            return nullptr;
+        }
+
+        // Transforming the vertices is the slow part, so that gets spread across workers.
+        // Adding the meshes to the scene has to happen one at a time.
+        std::vector<std::vector<IPLVector3>> transformed(instances.size());
+
+        enki::TaskSet transformTask{
+            (uint32_t)instances.size(), [&](enki::TaskSetPartition range, uint32_t) {
+                ZoneScopedN("Transform Acoustic Geometry");
+                for (uint32_t i = range.start; i < range.end; i++)
+                {
+                    const AcousticInstance& instance = instances[i];
+                    std::vector<IPLVector3>& verts = transformed[i];
+                    verts.resize(instance.mesh->positions.size());
+
+                    for (size_t j = 0; j < verts.size(); j++)
+                    {
+                        glm::vec3 pos = instance.transform * glm::vec4(instance.mesh->positions[j], 1.0f);
+                        verts[j] = {pos.x, pos.y, pos.z};
+                    }
+                }
+            }};
+        transformTask.m_MinRange = 16;
+
+        g_taskSched.AddTaskSetToPipe(&transformTask);
+        g_taskSched.WaitforTask(&transformTask);
+
+        for (size_t i = 0; i < instances.size(); i++)
+        {
+            const AcousticInstance& instance = instances[i];
+            if (instance.mesh->triangles.empty())
+                continue;
+
+            IPLStaticMeshSettings settings{};
+            settings.numVertices = (IPLint32)transformed[i].size();
+            settings.numTriangles = (IPLint32)instance.mesh->triangles.size();
+            settings.numMaterials = (IPLint32)instance.materials.size();
+            settings.vertices = transformed[i].data();
+            settings.triangles = const_cast<IPLTriangle*>(instance.mesh->triangles.data());
+            settings.materialIndices = const_cast<IPLint32*>(instance.mesh->materialIndices.data());
+            settings.materials = const_cast<IPLMaterial*>(instance.materials.data());
+
+            IPLStaticMesh mesh = nullptr;
+            if (iplStaticMeshCreate(scene, &settings, &mesh) != IPL_STATUS_SUCCESS)
+            {
+                logErr(WELogCategoryAudio, "Failed to create audio static mesh");
+                continue;
+            }
+
+            iplStaticMeshAdd(mesh, scene);
+            iplStaticMeshRelease(&mesh);
+
+            // Steam Audio keeps its own copy
+            std::vector<IPLVector3>().swap(transformed[i]);
+        }
+
+        iplSceneCommit(scene);
+        return scene;
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <Core/AssetDB.hpp>
+#include <Core/WorldComponents.hpp>
+#include <array>
+#include <entt/entity/lw_fwd.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <memory>
+#include <phonon.h>
+#include <robin_hood.h>
+#include <vector>
+
+namespace worlds
+{
+    // Untransformed triangles of a mesh in the form Steam Audio wants them.
+    struct AcousticMesh
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<IPLTriangle> triangles;
+        std::vector<IPLint32> materialIndices;
+    };
+
+    // A static audio object that's going to be put into an audio scene.
+    struct AcousticInstance
+    {
+        std::shared_ptr<const AcousticMesh> mesh;
+        glm::mat4 transform;
+        std::array<IPLMaterial, NUM_SUBMESH_MATS> materials;
+    };
+
+    // Keeps acoustic geometry and materials around between scene loads, so loading a scene
+    // that shares meshes with the previous one doesn't have to convert them again.
+    // Only used from the main thread. Meshes are shared with any scene build using them.
+    class AcousticGeometryCache
+    {
+      public:
+        std::shared_ptr<const AcousticMesh> getMesh(AssetID id);
+        const IPLMaterial& getMaterial(AssetID id);
+        void clear();
+        size_t meshCount() const;
+
+      private:
+        robin_hood::unordered_map<AssetID, std::shared_ptr<const AcousticMesh>> meshes;
+        robin_hood::unordered_map<AssetID, IPLMaterial> materials;
+    };
+
+    // Collects every audio static object in the registry. Returns a hash of the geometry
+    // that doesn't depend on the order the objects are in.
+    uint64_t gatherAcousticInstances(entt::registry& reg, AcousticGeometryCache& cache,
+                                     std::vector<AcousticInstance>& instances);
+
+    // Creates a committed scene out of the instances. Safe to call from any thread.
+    IPLScene buildAcousticScene(IPLContext context, const std::vector<AcousticInstance>& instances);
+}
@@ -1,18 +1,23 @@
 #include "Audio.hpp"
+#include <Core/AllocTracking.hpp>
+#include "AcousticGeometry.hpp"
 #include <Core/Fatal.hpp>
 #include <Core/MaterialManager.hpp>
 #include <Core/MeshManager.hpp>
+#include <Core/Profiler.hpp>
+#include <Core/TaskScheduler.hpp>
 #include <ImGui/imgui.h>
 #include <Libs/IconsFontaudio.h>
 #include <fmod_errors.h>
 #include <Audio/PhononFmod.hpp>
-#include <mutex>
 #include <Util/EnumUtil.hpp>
 #include <Util/TimingUtil.hpp>
 #include <slib/DynamicLibrary.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <Tracy.hpp>
-#include <condition_variable>
+#include <Util/SpscRing.hpp>
+#include <Util/TripleBuffer.hpp>
+#include <thread>
 
 #define FMCHECK(_result) checkFmodErr(_result, __FILE__, __LINE__)
 #define SACHECK(_result) checkSteamAudioErr(_result, __FILE__, __LINE__)
@@ -205,12 +210,55 @@ namespace worlds
         return FMOD_OK;
     }
 
+    enum class SimCommandType : uint8_t
+    {
+        AddSource,
+        RemoveSource,
+        SetScene
+    };
+
+    // Changes to the simulator's contents. The simulator holds a reference to everything sent to it.
+    struct SimCommand
+    {
+        SimCommandType type;
+        IPLSource source = nullptr;
+        IPLScene scene = nullptr;
+    };
+
+    // Reflection inputs for one simulation run. Holds a reference to each source so they stay alive
+    // until the simulation thread gets around to them.
+    struct SimInputFrame
+    {
+        IPLSimulationSharedInputs sharedInputs{};
+        std::vector<IPLSource> sources;
+        std::vector<IPLSimulationInputs> inputs;
+
+        void clear()
+        {
+            for (IPLSource& source : sources)
+            {
+                iplSourceRelease(&source);
+            }
+
+            sources.clear();
+            inputs.clear();
+        }
+    };
+
+    struct SimOutputFrame
+    {
+        double runTime = 0.0;
+        int sourcesInSim = 0;
+    };
+
+    // Runs reflection and pathing simulation on its own thread. The main thread sends it simulator
+    // changes through a lock-free ring and inputs through a triple buffer, so it never has to wait
+    // for a simulation to finish.
     class AudioSystem::SteamAudioSimThread
     {
       public:
-        std::mutex commitMutex;
-
-        SteamAudioSimThread(IPLSimulator simulator, AudioSystem* system) : simulator{simulator}, system(system)
+        SteamAudioSimThread(IPLSimulator simulator, IPLScene scene)
+            : simulator{simulator}, currentScene{iplSceneRetain(scene)}
         {
             thread = std::thread([this]() { actualThread(); });
         }
@@ -219,80 +267,259 @@ namespace worlds
         {
             return simRunning;
         }
+
+        // Main thread only. Commands that don't fit in the ring are kept and sent next frame.
+        void queueCommand(const SimCommand& command)
+        {
+            if (!overflow.empty() || !commands.tryPush(command))
+                overflow.push_back(command);
+        }
+
+        void flushCommands()
+        {
+            size_t sent = 0;
+            while (sent < overflow.size() && commands.tryPush(overflow[sent]))
+                sent++;
+
+            overflow.erase(overflow.begin(), overflow.begin() + sent);
+        }
+
+        // Main thread only. Fill this in before calling runSimulation.
+        SimInputFrame& beginInputFrame()
+        {
+            SimInputFrame& frame = inputs.back();
+            frame.clear();
+            return frame;
+        }
+
         void runSimulation()
         {
+            inputs.publish();
+            simRunning = true;
             simThreadKickoff = true;
-            conVar.notify_one();
+            simThreadKickoff.notify_one();
+        }
+
+        // The main thread doesn't need to wait to run direct simulation, it just skips it
+        // for the frame if the simulation thread is committing changes
+        bool tryBeginDirect()
+        {
+            uint8_t expected = SimulatorIdle;
+            return simulatorAccess.compare_exchange_strong(expected, SimulatorDirect, std::memory_order_acquire);
+        }
+
+        void endDirect()
+        {
+            simulatorAccess.store(SimulatorIdle, std::memory_order_release);
+        }
+
+        // Main thread only. Picks up the results of the last finished simulation.
+        const SimOutputFrame& pollOutputs()
+        {
+            outputs.consume();
+            return outputs.front();
         }
 
-        double lastStepTime() const
+        double lastStepTime()
         {
-            return lastRunTime;
+            return outputs.front().runTime;
         }
 
         ~SteamAudioSimThread()
         {
             threadAlive = false;
             simThreadKickoff = true;
-            conVar.notify_one();
+            simThreadKickoff.notify_one();
             thread.join();
+
+            // The simulation thread clears the frames it takes, so anything left over is in the other two
+            for (int i = 0; i < 2; i++)
+            {
+                inputs.back().clear();
+                inputs.publish();
+            }
+
+            iplSceneRelease(&currentScene);
         }
 
       private:
-        void actualThread()
+        enum : uint8_t
         {
-            while (threadAlive)
+            SimulatorIdle,
+            SimulatorDirect,
+            SimulatorCommitting
+        };
+
+        void applyCommands()
+        {
+            SimCommand command;
+            bool needsCommit = false;
+
+            while (commands.tryPop(command))
             {
+                needsCommit = true;
+                switch (command.type)
                 {
-                    std::unique_lock lock{mutex};
-                    conVar.wait(lock, [this]() { return simThreadKickoff.load(); });
-                    simThreadKickoff.store(false);
+                case SimCommandType::AddSource:
+                    iplSourceAdd(command.source, simulator);
+                    sourcesInSim++;
+                    break;
+                case SimCommandType::RemoveSource:
+                    iplSourceRemove(command.source, simulator);
+                    releasedSources.push_back(command.source);
+                    sourcesInSim--;
+                    break;
+                case SimCommandType::SetScene:
+                    iplSimulatorSetScene(simulator, command.scene);
+                    releasedScenes.push_back(currentScene);
+                    currentScene = command.scene;
+                    break;
                 }
+            }
 
-                if (system->needsSimCommit)
-                {
-                    std::unique_lock lock{commitMutex};
-                    while (!system->sourcesToAdd.empty())
-                    {
-                        IPLSource source = system->sourcesToAdd.front();
-                        iplSourceAdd(source, simulator);
-                        system->sourcesToAdd.pop();
-                    }
-                    iplSimulatorCommit(simulator);
+            if (!needsCommit)
+                return;
 
-                    while (!system->sourcesToRemove.empty())
+            uint8_t expected = SimulatorIdle;
+            while (!simulatorAccess.compare_exchange_weak(expected, SimulatorCommitting, std::memory_order_acquire))
+            {
+                expected = SimulatorIdle;
+                std::this_thread::yield();
+            }
+
+            iplSimulatorCommit(simulator);
+            simulatorAccess.store(SimulatorIdle, std::memory_order_release);
+
+            // Safe to let go of these now that the simulator isn't using them
+            for (IPLSource& source : releasedSources)
+            {
+                iplSourceRelease(&source);
+            }
+
+            for (IPLScene& scene : releasedScenes)
+            {
+                iplSceneRelease(&scene);
+            }
+
+            releasedSources.clear();
+            releasedScenes.clear();
+        }
+
+        void actualThread()
+        {
+            AllocTagScope allocTag{AllocTag::Audio};
+            Profiler::setThreadName("Audio simulation");
+
+            while (true)
+            {
+                simThreadKickoff.wait(false);
+                simThreadKickoff = false;
+
+                if (!threadAlive)
+                    break;
+
+                ProfileScopedN("Audio simulation");
+                PerfTimer pt;
+
+                // Inputs go in before removals get applied since the frame might mention
+                // sources that were removed after it was filled in
+                if (inputs.consume())
+                {
+                    SimInputFrame& frame = inputs.front();
+                    for (size_t i = 0; i < frame.sources.size(); i++)
                     {
-                        IPLSource source = system->sourcesToRemove.front();
-                        iplSourceRemove(source, simulator);
-                        iplSourceRelease(&source);
-                        system->sourcesToRemove.pop();
-                        system->sourcesInSim--;
+                        iplSourceSetInputs(frame.sources[i], IPL_SIMULATIONFLAGS_REFLECTIONS, &frame.inputs[i]);
                     }
 
-                    iplSimulatorCommit(simulator);
-                    system->needsSimCommit = false;
+                    iplSimulatorSetSharedInputs(simulator, IPL_SIMULATIONFLAGS_REFLECTIONS, &frame.sharedInputs);
+                    frame.clear();
                 }
 
-                {
-                    PerfTimer pt;
-                    simRunning = true;
-                    iplSimulatorRunReflections(simulator);
-                    iplSimulatorRunPathing(simulator);
-                    simRunning = false;
-                    lastRunTime = pt.stopGetMs();
-                }
+                applyCommands();
+
+                iplSimulatorRunReflections(simulator);
+                iplSimulatorRunPathing(simulator);
+
+                SimOutputFrame& result = outputs.back();
+                result.runTime = pt.stopGetMs();
+                result.sourcesInSim = sourcesInSim;
+                outputs.publish();
+                simRunning = false;
             }
         }
 
         std::atomic<bool> simRunning = false;
-        std::atomic<bool> simThreadKickoff;
-        std::condition_variable conVar;
-        std::mutex mutex;
-        std::thread thread;
+        std::atomic<bool> simThreadKickoff = false;
         std::atomic<bool> threadAlive = true;
+        std::atomic<uint8_t> simulatorAccess = SimulatorIdle;
+        std::thread thread;
         IPLSimulator simulator;
+
+        SpscRing<SimCommand, 1024> commands;
+        std::vector<SimCommand> overflow;
+        TripleBuffer<SimInputFrame> inputs;
+        TripleBuffer<SimOutputFrame> outputs;
+
+        // Only touched by the simulation thread
+        IPLScene currentScene;
+        std::vector<IPLSource> releasedSources;
+        std::vector<IPLScene> releasedScenes;
+        int sourcesInSim = 0;
+    };
+
+    const uint32_t AudioSceneFileMagic = ('W' << 24) | ('A' << 16) | ('S' << 8) | 'C';
+    const uint32_t AudioSceneFileVersion = 1;
+
+    // Saved audio scenes start with this, followed by the serialized Steam Audio scene.
+    // Files from before the header was added are just the serialized scene.
+    struct AudioSceneFileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t geometryHash;
+    };
+
+    struct AudioSystem::OneshotCallbackData
+    {
+        IPLSource phononSource = nullptr;
+        bool stopped = false;
+    };
+
+    // Loads the saved scene if it matches the geometry, otherwise builds it from scratch.
+    class AudioSystem::AudioSceneJob : public enki::ITaskSet
+    {
+      public:
+        AudioSceneJob(AudioSystem* system) : system(system)
+        {
+        }
+
+        void ExecuteRange(enki::TaskSetPartition, uint32_t) override
+        {
+            ProfileScopedN("Audio Scene Job");
+            PerfTimer pt;
+
+            if (PHYSFS_exists(savedPath.c_str()))
+                result = system->loadScene(savedPath.c_str(), geometryHash, geometryKnown);
+            else
+                logWarn(WELogCategoryAudio, "Scene %s doesn't have baked audio data!", sceneName.c_str());
+
+            if (result == nullptr)
+            {
+                result = buildAcousticScene(system->phononContext, instances);
+                geometryKnown = true;
+            }
+
+            buildTime = pt.stopGetMs();
+        }
+
         AudioSystem* system;
-        double lastRunTime = 0.0;
+        std::string sceneName;
+        std::string savedPath;
+        std::vector<AcousticInstance> instances;
+        uint64_t geometryHash = 0;
+        bool geometryKnown = false;
+        IPLScene result = nullptr;
+        double buildTime = 0.0;
     };
 
     FMOD_RESULT audioSourcePhononEventCallback(FMOD_STUDIO_EVENT_CALLBACK_TYPE type, FMOD_STUDIO_EVENTINSTANCE* cevent,
@@ -367,6 +594,18 @@ namespace worlds
         }
 
         _eventPath.assign(eventPath);
+        cachedState = FMOD_STUDIO_PLAYBACK_STOPPED;
+        cullBucket = AudioCullBucket::Audible;
+        sentAttributes = false;
+
+        bool is3D = false;
+        float minDistance;
+        maxDistance = 0.0f;
+        FMCHECK(desc->is3D(&is3D));
+        FMCHECK(desc->isOneshot(&isOneshot));
+
+        if (is3D)
+            FMCHECK(desc->getMinMaxDistance(&minDistance, &maxDistance));
 
         if (createPhononSource)
         {
@@ -394,6 +633,7 @@ namespace worlds
     AudioSystem::AudioSystem()
     {
         instance = this;
+        acousticCache = new AcousticGeometryCache();
         const char* phononPluginName;
 
 #ifdef _WIN32
@@ -514,7 +754,7 @@ namespace worlds
 
         iplFMODSetSimulationSettings(simulationSettings);
         iplFMODSetReverbSource(listenerCentricSource);
-        simThread = new SteamAudioSimThread(simulator, this);
+        simThread = new SteamAudioSimThread(simulator, scene);
 
         lastListenerPos = glm::vec3(0.0f, 0.0f, 0.0f);
     }
@@ -576,6 +816,13 @@ namespace worlds
 
         g_console->registerCommand([&](const char*) { iplSceneSaveOBJ(scene, "audioScene.obj"); }, "a_dumpToObj",
                                    "Dumps the Steam Audio scene to an obj file.");
+
+        g_console->registerCommand(
+            [&](const char*) {
+                acousticCache->clear();
+                sceneGeometryKnown = false;
+            },
+            "a_clearAudioSceneCache", "Clears cached acoustic geometry and materials.");
     }
 
     void AudioSystem::onAudioSourceDestroy(entt::registry& reg, entt::entity entity)
@@ -592,8 +839,7 @@ namespace worlds
 
         if (as.phononSource && as.inPhononSim)
         {
-            std::unique_lock lock{simThread->commitMutex};
-            sourcesToRemove.push(as.phononSource);
+            simThread->queueCommand({.type = SimCommandType::RemoveSource, .source = as.phononSource});
         }
     }
 
@@ -639,12 +885,138 @@ namespace worlds
     }
 
     ConVar a_phononUpdateRate{"a_phononUpdateRate", "0.1"};
+    ConVar a_virtualDistanceScale{"a_virtualDistanceScale", "1.2",
+                                  "Sources further away than their max distance times this get paused."};
+    ConVar a_stopDistanceScale{"a_stopDistanceScale", "2.0",
+                               "One-shot sources further away than their max distance times this get stopped."};
+
+    void AudioSystem::pushSourceAttributes(AudioSource& as, const Transform& t)
+    {
+        if (as.sentAttributes && as.sentPosition == t.position && as.sentRotation == t.rotation)
+            return;
+
+        FMOD_3D_ATTRIBUTES sourceAttributes{};
+        sourceAttributes.position = convVec(t.position);
+        sourceAttributes.forward = convVec(t.rotation * glm::vec3(0.0f, 0.0f, 1.0f));
+        sourceAttributes.up = convVec(t.rotation * glm::vec3(0.0f, 1.0f, 0.0f));
+
+        FMCHECK(as.eventInstance->set3DAttributes(&sourceAttributes));
+        as.sentAttributes = true;
+        as.sentPosition = t.position;
+        as.sentRotation = t.rotation;
+        debugStats.attributeUpdates++;
+    }
+
+    void AudioSystem::updateSources(entt::registry& registry, glm::vec3 listenerPos)
+    {
+        ZoneScoped;
+        float virtualScale = a_virtualDistanceScale.getFloat();
+        float stopScale = a_stopDistanceScale.getFloat();
+
+        registry.view<AudioSource, Transform>().each([&](AudioSource& as, const Transform& t) {
+            if (as.eventInstance == nullptr || !as.eventInstance->isValid())
+            {
+                as.cachedState = FMOD_STUDIO_PLAYBACK_STOPPED;
+                return;
+            }
+
+            FMCHECK(as.eventInstance->getPlaybackState(&as.cachedState));
+            if (as.cachedState == FMOD_STUDIO_PLAYBACK_STOPPED)
+            {
+                // Anything can restart a stopped source, so forget how it was culled. Otherwise a
+                // restarted source would stay in the bucket it was in and never get culled again.
+                if (as.cullBucket != AudioCullBucket::Audible)
+                {
+                    if (as.cullBucket == AudioCullBucket::Virtual)
+                        FMCHECK(as.eventInstance->setPaused(false));
+
+                    as.cullBucket = AudioCullBucket::Audible;
+                    as.sentAttributes = false;
+                }
+                return;
+            }
+
+            debugStats.playingSources++;
+
+            AudioCullBucket bucket = AudioCullBucket::Audible;
+            if (as.maxDistance > 0.0f)
+            {
+                float relativeDistance = glm::distance(t.position, listenerPos) / as.maxDistance;
+
+                // Sources have to come a bit closer to leave a bucket than they had to go to enter it,
+                // so ones sitting on the edge don't switch every frame
+                if (as.cullBucket != AudioCullBucket::Audible)
+                    relativeDistance /= 0.9f;
+
+                if (as.isOneshot && relativeDistance > stopScale)
+                    bucket = AudioCullBucket::Stopped;
+                else if (relativeDistance > virtualScale)
+                    bucket = AudioCullBucket::Virtual;
+            }
+
+            if (bucket != as.cullBucket)
+            {
+                // Pausing sticks across stop and start, so always undo it
+                if (as.cullBucket == AudioCullBucket::Virtual)
+                    FMCHECK(as.eventInstance->setPaused(false));
+
+                if (bucket == AudioCullBucket::Virtual)
+                {
+                    FMCHECK(as.eventInstance->setPaused(true));
+                }
+                else if (bucket == AudioCullBucket::Stopped)
+                {
+                    FMCHECK(as.eventInstance->stop(FMOD_STUDIO_STOP_IMMEDIATE));
+                    debugStats.distanceStops++;
+                }
+
+                as.cullBucket = bucket;
+            }
+
+            if (bucket != AudioCullBucket::Audible)
+            {
+                debugStats.virtualSources++;
+                return;
+            }
+
+            pushSourceAttributes(as, t);
+        });
+    }
+
     void AudioSystem::updateSteamAudio(entt::registry& registry, float deltaTime, glm::vec3 listenerPos,
                                        glm::quat listenerRot)
     {
         IPLSimulationFlags simFlags =
             (IPLSimulationFlags)(IPL_SIMULATIONFLAGS_REFLECTIONS);
 
+        simThread->flushCommands();
+        sourcesInSim = simThread->pollOutputs().sourcesInSim;
+
+        // Reflection inputs only need to be collected on frames that start a simulation
+        bool startSim = false;
+        timeSinceLastSim += deltaTime;
+        if (timeSinceLastSim > a_phononUpdateRate.getFloat())
+        {
+            if (!simThread->isSimRunning())
+            {
+                startSim = true;
+            }
+            else
+            {
+                logWarn(WELogCategoryAudio, "Phonon simulation thread is falling behind");
+            }
+            timeSinceLastSim = 0.0f;
+        }
+
+        SimInputFrame* frame = startSim ? &simThread->beginInputFrame() : nullptr;
+        auto addReflectionInputs = [frame](IPLSource source, const IPLSimulationInputs& inputs) {
+            if (frame == nullptr)
+                return;
+
+            frame->sources.push_back(iplSourceRetain(source));
+            frame->inputs.push_back(inputs);
+        };
+
         IPLSimulationInputs inputs{};
         inputs.flags = simFlags;
 
@@ -673,7 +1045,7 @@ namespace worlds
         inputs.hybridReverbOverlapPercent = 0.25f;
         inputs.baked = IPL_FALSE;
 
-        iplSourceSetInputs(listenerCentricSource, simFlags, &inputs);
+        addReflectionInputs(listenerCentricSource, inputs);
 
         for (AttachedOneshot* oneshot : attachedOneshots)
         {
@@ -698,26 +1070,19 @@ namespace worlds
             inputs.hybridReverbOverlapPercent = 0.25f;
             inputs.baked = IPL_FALSE;
 
-            iplSourceSetInputs(oneshot->phononSource, simFlags, &inputs);
+            addReflectionInputs(oneshot->phononSource, inputs);
         }
 
-        registry.view<AudioSource, Transform>().each([simFlags, this](AudioSource& as, const Transform& t) {
-            if (!as.eventInstance->isValid())
-                return;
-
-            FMOD_STUDIO_PLAYBACK_STATE playbackState;
-            FMCHECK(as.eventInstance->getPlaybackState(&playbackState));
+        registry.view<AudioSource, Transform>().each([&](AudioSource& as, const Transform& t) {
             if (as.phononSource == nullptr)
                 return;
 
-            if (playbackState == FMOD_STUDIO_PLAYBACK_STOPPED)
+            if (as.cachedState == FMOD_STUDIO_PLAYBACK_STOPPED)
             {
                 if (as.inPhononSim)
                 {
                     as.inPhononSim = false;
-                    std::unique_lock lock{simThread->commitMutex};
-                    needsSimCommit = true; 
-                    this->sourcesToRemove.push(as.phononSource);
+                    simThread->queueCommand({.type = SimCommandType::RemoveSource, .source = as.phononSource});
                 }
 
                 return;
@@ -726,16 +1091,16 @@ namespace worlds
             if (!as.inPhononSim)
             {
                 as.inPhononSim = true;
-                std::unique_lock lock{simThread->commitMutex};
-                needsSimCommit = true; 
-                iplSourceRetain(as.phononSource);
-                this->sourcesToAdd.push(as.phononSource);
-                sourcesInSim++;
+                simThread->queueCommand(
+                    {.type = SimCommandType::AddSource, .source = iplSourceRetain(as.phononSource)});
                 return;
             }
 
+            if (as.cullBucket != AudioCullBucket::Audible)
+                return;
+
             IPLSimulationInputs inputs{};
-            inputs.flags = simFlags;
+            inputs.flags = (IPLSimulationFlags)(IPL_SIMULATIONFLAGS_REFLECTIONS | IPL_SIMULATIONFLAGS_DIRECT);
             inputs.directFlags = (IPLDirectSimulationFlags)(IPL_DIRECTEFFECTFLAGS_APPLYOCCLUSION | IPL_DIRECTEFFECTFLAGS_APPLYDISTANCEATTENUATION);
             inputs.source.right = convVecSA(t.rotation * glm::vec3(1.0f, 0.0f, 0.0f));
             inputs.source.up = convVecSA(t.rotation * glm::vec3(0.0f, 1.0f, 0.0f));
@@ -753,7 +1118,9 @@ namespace worlds
             inputs.hybridReverbOverlapPercent = 0.25f;
             inputs.baked = IPL_FALSE;
 
-            iplSourceSetInputs(as.phononSource, simFlags, &inputs);
+            // Direct simulation runs on this thread, reflections get their inputs handed over
+            iplSourceSetInputs(as.phononSource, IPL_SIMULATIONFLAGS_DIRECT, &inputs);
+            addReflectionInputs(as.phononSource, inputs);
 
             IPLSimulationOutputs outputs{};
             iplSourceGetOutputs(as.phononSource, IPL_SIMULATIONFLAGS_DIRECT, &outputs);
@@ -774,29 +1141,32 @@ namespace worlds
         sharedInputs.order = 1;
         sharedInputs.irradianceMinDistance = 1.0f;
 
-        iplSimulatorSetSharedInputs(simulator, simFlags, &sharedInputs);
-        if (!needsSimCommit)
+        if (simThread->tryBeginDirect())
+        {
+            iplSimulatorSetSharedInputs(simulator, IPL_SIMULATIONFLAGS_DIRECT, &sharedInputs);
             iplSimulatorRunDirect(simulator);
+            simThread->endDirect();
+        }
 
-        timeSinceLastSim += deltaTime;
-        if (timeSinceLastSim > a_phononUpdateRate.getFloat())
+        if (frame)
         {
-            if (!simThread->isSimRunning())
-            {
-                simThread->runSimulation();
-            }
-            else
-            {
-                logWarn(WELogCategoryAudio, "Phonon simulation thread is falling behind");
-            }
-            timeSinceLastSim = 0.0f;
+            frame->sharedInputs = sharedInputs;
+            simThread->runSimulation();
         }
     }
 
     void AudioSystem::update(entt::registry& worldState, glm::vec3 listenerPos, glm::quat listenerRot, float deltaTime)
     {
+        ProfileScoped;
+        AllocTagScope allocTag{AllocTag::Audio};
         if (!available)
             return;
+
+        if (sceneJob && sceneJob->GetIsComplete())
+            finishSceneJob();
+
+        debugStats = AudioDebugStats{};
+
         glm::vec3 movement = listenerPos - lastListenerPos;
         movement /= deltaTime;
 
@@ -813,6 +1183,7 @@ namespace worlds
         listenerAttributes.position = convVec(listenerPos);
         listenerAttributes.velocity = convVec(movement);
 
+        updateSources(worldState, listenerPos);
         updateSteamAudio(worldState, deltaTime, listenerPos, listenerRot);
 
         worldState.view<AudioTrigger, AudioSource, Transform>()
@@ -820,23 +1191,15 @@ namespace worlds
                 glm::vec3 localPos = transform.inverseTransformPoint(listenerPos);
                 if (glm::all(glm::lessThan(localPos, transform.scale)) && glm::all(glm::greaterThan(localPos, -transform.scale)))
                 {
-                    if (source.playbackState() == FMOD_STUDIO_PLAYBACK_STOPPED)
+                    if (source.cachedState == FMOD_STUDIO_PLAYBACK_STOPPED && source.eventInstance)
+                    {
+                        pushSourceAttributes(source, transform);
                         FMCHECK(source.eventInstance->start());
+                        source.cachedState = FMOD_STUDIO_PLAYBACK_STARTING;
+                    }
                 }
             });
 
-        worldState.view<AudioSource, Transform>().each([](AudioSource& as, Transform& t) {
-            if (as.eventInstance == nullptr)
-                return;
-
-            FMOD_3D_ATTRIBUTES sourceAttributes{};
-            sourceAttributes.position = convVec(t.position);
-            sourceAttributes.forward = convVec(t.rotation * glm::vec3(0.0f, 0.0f, 1.0f));
-            sourceAttributes.up = convVec(t.rotation * glm::vec3(0.0f, 1.0f, 0.0f));
-
-            FMCHECK(as.eventInstance->set3DAttributes(&sourceAttributes));
-        });
-
         FMCHECK(studioSystem->setListenerAttributes(0, &listenerAttributes, &listenerAttributes.position));
 
         for (AttachedOneshot* ao : attachedOneshots)
@@ -849,10 +1212,7 @@ namespace worlds
                 continue;
             }
 
-            FMOD_STUDIO_PLAYBACK_STATE playbackState;
-            FMCHECK(ao->instance->getPlaybackState(&playbackState));
-
-            if (playbackState == FMOD_STUDIO_PLAYBACK_STOPPED)
+            if (ao->callbackData->stopped)
             {
                 ao->timeSinceStop += deltaTime;
 
@@ -867,6 +1227,11 @@ namespace worlds
             if (worldState.valid(ao->entity))
             {
                 Transform& t = worldState.get<Transform>(ao->entity);
+                bool moved = t.position != ao->lastPosition || t.rotation != ao->lastRotation;
+
+                // One more update after stopping so FMOD doesn't keep the old velocity
+                if (!moved && !ao->moving)
+                    continue;
 
                 FMOD_3D_ATTRIBUTES sourceAttributes{};
                 sourceAttributes.position = convVec(t.position);
@@ -875,31 +1240,37 @@ namespace worlds
                 sourceAttributes.velocity = convVec((t.position - ao->lastPosition) / deltaTime);
 
                 ao->lastPosition = t.position;
+                ao->lastRotation = t.rotation;
+                ao->moving = moved;
 
                 FMCHECK(ao->instance->set3DAttributes(&sourceAttributes));
+                debugStats.attributeUpdates++;
             }
         }
 
         FMCHECK(studioSystem->update());
+        FMCHECK(system->getChannelsPlaying(&debugStats.activeVoices, &debugStats.realVoices));
 
-        {
-            std::unique_lock lock{simThread->commitMutex};
-            attachedOneshots.erase(std::remove_if(attachedOneshots.begin(), attachedOneshots.end(),
-                [this](AttachedOneshot* ao) {
-                    bool marked = ao->markForRemoval;
-                    if (marked)
+        attachedOneshots.erase(std::remove_if(attachedOneshots.begin(), attachedOneshots.end(),
+            [this](AttachedOneshot* ao) {
+                bool marked = ao->markForRemoval;
+                if (marked)
+                {
+                    if (ao->phononSource)
                     {
-                        if (ao->phononSource)
-                        {
-                            sourcesToRemove.push(ao->phononSource);
-                        }
-                        needsSimCommit = true;
-                        delete ao;
+                        simThread->queueCommand({.type = SimCommandType::RemoveSource, .source = ao->phononSource});
                     }
-                    return marked;
-                }),
-                attachedOneshots.end());
-        }
+                    delete ao;
+                }
+                return marked;
+            }),
+            attachedOneshots.end());
+    }
+
+    void AudioSystem::drawDebugWindow()
+    {
+        if (!available)
+            return;
 
         if (a_showDebugInfo.getInt())
         {
@@ -912,10 +1283,16 @@ namespace worlds
 
                 ImGui::Text("AttachedOneshots: %i", (int)attachedOneshots.size());
                 ImGui::Text("Sources in simulation: %i", sourcesInSim);
+                ImGui::Text("Playing sources: %i (%i culled by distance)", debugStats.playingSources,
+                            debugStats.virtualSources);
+                ImGui::Text("3D attribute updates: %i", debugStats.attributeUpdates);
+                ImGui::Text("Voices: %i (%i real)", debugStats.activeVoices, debugStats.realVoices);
                 if (ImGui::CollapsingHeader("Phonon"))
                 {
                     ImGui::Text("Last Phonon simulation tick took %.3fms", simThread->lastStepTime());
                     ImGui::Text("Simulation running: %i", simThread->isSimRunning());
+                    ImGui::Text("Audio scene: %s", sceneJob ? "building" : "ready");
+                    ImGui::Text("Cached acoustic meshes: %zu", acousticCache->meshCount());
                 }
 
                 if (ImGui::CollapsingHeader("FMOD"))
@@ -982,49 +1359,47 @@ namespace worlds
         playOneShotAttachedEvent(eventPath, location, entt::null, volume);
     }
 
-    struct PhononEventInstanceCallbackData
+    FMOD_RESULT AudioSystem::oneshotEventInstanceCallback(FMOD_STUDIO_EVENT_CALLBACK_TYPE type,
+                                                          FMOD_STUDIO_EVENTINSTANCE* cevent, void* param)
     {
-        IPLSource phononSource;
-        glm::vec3 location;
-    };
-
-    FMOD_RESULT AudioSystem::phononEventInstanceCallback(FMOD_STUDIO_EVENT_CALLBACK_TYPE type,
-                                                         FMOD_STUDIO_EVENTINSTANCE* cevent, void* param)
-    {
-        if (type != FMOD_STUDIO_EVENT_CALLBACK_CREATED && type != FMOD_STUDIO_EVENT_CALLBACK_DESTROYED)
-            return FMOD_OK;
-
         // available is set to false while shutting down
         if (!AudioSystem::instance->available)
             return FMOD_OK;
 
         FMOD::Studio::EventInstance* event = (FMOD::Studio::EventInstance*)cevent;
 
-        PhononEventInstanceCallbackData* data;
+        OneshotCallbackData* data;
         FMCHECK(event->getUserData((void**)&data));
-        FMOD::DSP* phononDsp;
-        FMCHECK(findSteamAudioDSP(event, &phononDsp));
 
-        std::lock_guard lock{AudioSystem::instance->simThread->commitMutex};
-        // The FMOD plugin says here that it wants the simulation outputs.
-        // However, this is wrong. The code is actually looking for the IPLSource attached
-        // to the Steam Audio source!
+        // Studio runs callbacks from update() since it's initialised with synchronous updates,
+        // so this is on the main thread
+        if (type == FMOD_STUDIO_EVENT_CALLBACK_STOPPED || type == FMOD_STUDIO_EVENT_CALLBACK_START_FAILED)
+        {
+            data->stopped = true;
+            return FMOD_OK;
+        }
+
         if (type == FMOD_STUDIO_EVENT_CALLBACK_CREATED)
         {
+            if (data->phononSource == nullptr)
+                return FMOD_OK;
+
+            FMOD::DSP* phononDsp;
+            FMCHECK(findSteamAudioDSP(event, &phononDsp));
+
+            // The FMOD plugin says here that it wants the simulation outputs.
+            // However, this is wrong. The code is actually looking for the IPLSource attached
+            // to the Steam Audio source!
             FMCHECK(phononDsp->setParameterData(
                 SpatializerEffect::SIMULATION_OUTPUTS, &data->phononSource,
                 sizeof(IPLSource))
             );
-
-            FMOD_3D_ATTRIBUTES attr{};
-            attr.position = convVec(data->location);
-            attr.forward = convVec(glm::vec3(0.0f, 0.0f, 1.0f));
-            attr.up = convVec(glm::vec3(0.0f, 1.0f, 0.0f));
-            attr.velocity = convVec(glm::vec3(0.0f));
         }
-        else
+        else if (type == FMOD_STUDIO_EVENT_CALLBACK_DESTROYED)
         {
-            iplSourceRelease(&data->phononSource);
+            if (data->phononSource)
+                iplSourceRelease(&data->phononSource);
+
             delete data;
         }
 
@@ -1088,29 +1463,31 @@ namespace worlds
         FMCHECK(instance->set3DAttributes(&attr));
         FMCHECK(instance->setVolume(volume));
 
-        FMCHECK(instance->start());
-        FMCHECK(instance->set3DAttributes(&attr));
-
         AttachedOneshot* attachedOneshot =
             new AttachedOneshot{.instance = instance, .entity = attachedEntity, .lastPosition = location};
 
+        // The callback lets us know when the event stops instead of asking every frame
+        OneshotCallbackData* data = new OneshotCallbackData();
+        attachedOneshot->callbackData = data;
+        FMCHECK(instance->setUserData(data));
+        FMCHECK(instance->setCallback(oneshotEventInstanceCallback,
+                                      FMOD_STUDIO_EVENT_CALLBACK_CREATED | FMOD_STUDIO_EVENT_CALLBACK_DESTROYED |
+                                          FMOD_STUDIO_EVENT_CALLBACK_STOPPED |
+                                          FMOD_STUDIO_EVENT_CALLBACK_START_FAILED));
+
+        FMCHECK(instance->start());
+        FMCHECK(instance->set3DAttributes(&attr));
+
         if (createPhononSource)
         {
             IPLSourceSettings sourceSettings{
                 (IPLSimulationFlags)(IPL_SIMULATIONFLAGS_REFLECTIONS | IPL_SIMULATIONFLAGS_DIRECT)};
 
             SACHECK(iplSourceCreate(simulator, &sourceSettings, &attachedOneshot->phononSource));
-
-            PhononEventInstanceCallbackData* data = new PhononEventInstanceCallbackData();
             data->phononSource = attachedOneshot->phononSource;
-            instance->setUserData(data);
-            instance->setCallback(phononEventInstanceCallback, FMOD_STUDIO_EVENT_CALLBACK_CREATED | FMOD_STUDIO_EVENT_CALLBACK_DESTROYED);
 
-            std::unique_lock lock{simThread->commitMutex};
-            iplSourceRetain(attachedOneshot->phononSource);
-            sourcesToAdd.push(attachedOneshot->phononSource);
-            sourcesInSim++;
-            needsSimCommit = true;
+            simThread->queueCommand(
+                {.type = SimCommandType::AddSource, .source = iplSourceRetain(attachedOneshot->phononSource)});
         }
 
         attachedOneshots.push_back(attachedOneshot);
@@ -1124,9 +1501,15 @@ namespace worlds
         available = false;
         worldState.clear<AudioSource>();
 
+        cancelSceneJob();
+
         if (simThread)
             delete simThread;
 
+        // After the scene job's gone, since it can still be using cached meshes
+        delete acousticCache;
+        acousticCache = nullptr;
+
         FMCHECK(studioSystem->release());
     }
 
@@ -1181,155 +1564,110 @@ namespace worlds
         SACHECK(iplSerializedObjectCreate(phononContext, &settings, &serializedObject));
 
         // Create the audio scene just for this
-        IPLScene newScene = createScene(reg);
+        std::vector<AcousticInstance> instances;
+        AudioSceneFileHeader header{};
+        header.magic = AudioSceneFileMagic;
+        header.version = AudioSceneFileVersion;
+        header.geometryHash = gatherAcousticInstances(reg, *acousticCache, instances);
+
+        IPLScene newScene = buildAcousticScene(phononContext, instances);
+        if (newScene == nullptr)
+        {
+            iplSerializedObjectRelease(&serializedObject);
+            return;
+        }
+
         iplSceneSave(newScene, serializedObject);
         iplSceneRelease(&newScene);
 
         PHYSFS_File* file = PHYSFS_openWrite(path);
+        if (file == nullptr)
+        {
+            logErr(WELogCategoryAudio, "Failed to open %s for writing", path);
+            iplSerializedObjectRelease(&serializedObject);
+            return;
+        }
+
+        PHYSFS_writeBytes(file, &header, sizeof(header));
         PHYSFS_writeBytes(file, iplSerializedObjectGetData(serializedObject),
                           iplSerializedObjectGetSize(serializedObject));
         PHYSFS_close(file);
+        iplSerializedObjectRelease(&serializedObject);
     }
 
     void AudioSystem::updateAudioScene(entt::registry& reg)
     {
         ZoneScoped;
 
-        if (scene)
-            iplSceneRelease(&scene);
+        if (!available)
+            return;
 
-        std::string savedPath = "LevelData/PhononScenes/" + reg.ctx<SceneInfo>().name + ".bin";
+        // Whatever the previous job was building is out of date now
+        cancelSceneJob();
 
-        if (PHYSFS_exists(savedPath.c_str()))
-        {
-            scene = loadScene(savedPath.c_str());
-        }
-        else
-        {
-            logWarn(WELogCategoryAudio, "Scene %s doesn't have baked audio data!", reg.ctx<SceneInfo>().name.c_str());
-            scene = createScene(reg);
-        }
+        AudioSceneJob* job = new AudioSceneJob(this);
+        job->geometryHash = gatherAcousticInstances(reg, *acousticCache, job->instances);
 
-        while (simThread->isSimRunning())
+        if (scene && sceneGeometryKnown && job->geometryHash == sceneGeometryHash)
         {
+            // Reloading the same level, or one with the same static geometry
+            delete job;
+            return;
         }
-        iplSimulatorSetScene(simulator, scene);
-        needsSimCommit = true;
+
+        job->sceneName = reg.ctx<SceneInfo>().name;
+        job->savedPath = "LevelData/PhononScenes/" + job->sceneName + ".bin";
+
+        sceneJob = job;
+        g_taskSched.AddTaskSetToPipe(sceneJob);
     }
 
-    struct CacheableMeshInfo
-    {
-        std::vector<IPLTriangle> triangles;
-        std::vector<IPLMaterial> materials;
-        std::vector<int> materialIndices;
-    };
-    IPLScene AudioSystem::createScene(entt::registry& reg)
+    void AudioSystem::finishSceneJob()
     {
         ZoneScoped;
+        g_taskSched.WaitforTask(sceneJob);
 
-        IPLSceneSettings sceneSettings{};
-        sceneSettings.type = IPL_SCENETYPE_DEFAULT;
+        IPLScene newScene = sceneJob->result;
+        uint64_t newHash = sceneJob->geometryHash;
+        bool newHashKnown = sceneJob->geometryKnown;
+        logVrb(WELogCategoryAudio, "Audio scene for %s took %.3fms to prepare", sceneJob->sceneName.c_str(),
+               sceneJob->buildTime);
 
-        IPLScene scene = nullptr;
-        SACHECK(iplSceneCreate(phononContext, &sceneSettings, &scene));
-        robin_hood::unordered_map<AssetID, CacheableMeshInfo> cachedMeshes;
-
-        reg.view<WorldObject, Transform>().each([&](WorldObject& wo, Transform& t) {
-            if (!enumHasFlag(wo.staticFlags, StaticFlags::Audio))
-                return;
-            glm::mat4 tMat = t.getMatrix();
-
-            // oh boy
-            std::vector<IPLVector3> verts;
-
-            const LoadedMesh& lm = MeshManager::loadOrGet(wo.mesh);
-
-            if (!cachedMeshes.contains(wo.mesh))
-            {
-                CacheableMeshInfo cmi;
-                cmi.triangles.resize(lm.indices.size() / 3);
-                cmi.materialIndices.resize(cmi.triangles.size());
+        delete sceneJob;
+        sceneJob = nullptr;
 
-                uint32_t triCount = 0;
-
-                cmi.materials.resize(32);
-                for (int materialIndex = 0; materialIndex < 32; materialIndex++)
-                {
-                    IPLMaterial mat{{0.1f, 0.2f, 0.3f}, 0.05f, {0.1f, 0.05f, 0.03f}};
-
-                    if (wo.presentMaterials[materialIndex])
-                    {
-                        auto& jMat = MaterialManager::loadOrGet(wo.materials[materialIndex]);
-                        mat.scattering = jMat.value("soundScattering", mat.scattering);
-
-                        if (jMat.contains("soundAbsorption"))
-                        {
-                            for (int i = 0; i < 3; i++)
-                            {
-                                mat.absorption[i] = jMat["soundAbsorption"][i];
-                            }
-                        }
-
-                        if (jMat.contains("soundTransmission"))
-                        {
-                            for (int i = 0; i < 3; i++)
-                            {
-                                mat.transmission[i] = jMat["soundTransmission"][i];
-                            }
-                        }
-                    }
-
-                    cmi.materials[materialIndex] = mat;
-                }
-
-                for (int submeshIdx = 0; submeshIdx < lm.numSubmeshes; submeshIdx++)
-                {
-                    const SubmeshInfo& submesh = lm.submeshes[submeshIdx];
-
-                    for (uint32_t i = 0; i < submesh.indexCount; i += 3)
-                    {
-                        cmi.materialIndices[triCount] = submesh.materialIndex;
-                        cmi.triangles[triCount++] = {(int)lm.indices[submesh.indexOffset + i], (int)lm.indices[submesh.indexOffset + i + 1], (int)lm.indices[submesh.indexOffset + i + 2]};
-                    }
-                }
-
-                cachedMeshes.insert({wo.mesh, std::move(cmi)});
-            }
+        if (newScene == nullptr)
+            return;
 
-            CacheableMeshInfo& cmi = cachedMeshes.at(wo.mesh);
+        // The simulation thread switches over the next time it runs
+        if (scene)
+            iplSceneRelease(&scene);
 
-            verts.resize(lm.vertices.size());
+        scene = newScene;
+        sceneGeometryHash = newHash;
+        sceneGeometryKnown = newHashKnown;
+        simThread->queueCommand({.type = SimCommandType::SetScene, .scene = iplSceneRetain(scene)});
+    }
 
-            for (uint32_t i = 0; i < lm.vertices.size(); i++)
-            {
-                glm::vec3 pos = tMat * glm::vec4(lm.vertices[i].position, 1.0f);
-                verts[i].x = pos.x;
-                verts[i].y = pos.y;
-                verts[i].z = pos.z;
-            }
+    void AudioSystem::cancelSceneJob()
+    {
+        if (!sceneJob)
+            return;
 
-            IPLStaticMeshSettings settings{};
-            settings.numVertices = verts.size();
-            settings.numTriangles = cmi.triangles.size();
-            settings.numMaterials = cmi.materials.size();
-            settings.vertices = verts.data();
-            settings.triangles = cmi.triangles.data();
-            settings.materialIndices = cmi.materialIndices.data();
-            settings.materials = cmi.materials.data();
-
-            IPLStaticMesh mesh = nullptr;
-            SACHECK(iplStaticMeshCreate(scene, &settings, &mesh));
-            iplStaticMeshAdd(mesh, scene);
-            iplStaticMeshRelease(&mesh);
-        });
-        iplSceneCommit(scene);
+        g_taskSched.WaitforTask(sceneJob);
+        if (sceneJob->result)
+            iplSceneRelease(&sceneJob->result);
 
-        return scene;
+        delete sceneJob;
+        sceneJob = nullptr;
     }
 
-    IPLScene AudioSystem::loadScene(const char* path)
+    IPLScene AudioSystem::loadScene(const char* path, uint64_t geometryHash, bool& hashChecked)
     {
+        hashChecked = false;
         PHYSFS_File* file = PHYSFS_openRead(path);
+        if (file == nullptr)
+            return nullptr;
 
         size_t dataSize = PHYSFS_fileLength(file);
         uint8_t* buffer = new uint8_t[dataSize];
@@ -1337,9 +1675,33 @@ namespace worlds
         PHYSFS_readBytes(file, buffer, dataSize);
         PHYSFS_close(file);
 
+        uint8_t* sceneData = buffer;
+        size_t sceneSize = dataSize;
+
+        AudioSceneFileHeader header{};
+        if (dataSize >= sizeof(header) && memcmp(buffer, &AudioSceneFileMagic, sizeof(uint32_t)) == 0)
+        {
+            memcpy(&header, buffer, sizeof(header));
+
+            if (header.version != AudioSceneFileVersion || header.geometryHash != geometryHash)
+            {
+                logWarn(WELogCategoryAudio, "Baked audio data in %s is out of date, rebuilding", path);
+                delete[] buffer;
+                return nullptr;
+            }
+
+            sceneData += sizeof(header);
+            sceneSize -= sizeof(header);
+            hashChecked = true;
+        }
+        else
+        {
+            logWarn(WELogCategoryAudio, "Baked audio data in %s is from an older version and can't be checked", path);
+        }
+
         IPLSerializedObjectSettings serializedObjectSettings{};
-        serializedObjectSettings.data = buffer;
-        serializedObjectSettings.size = dataSize;
+        serializedObjectSettings.data = sceneData;
+        serializedObjectSettings.size = sceneSize;
 
         IPLSerializedObject serializedObject;
         SACHECK(iplSerializedObjectCreate(phononContext, &serializedObjectSettings, &serializedObject));
@@ -1350,6 +1712,7 @@ namespace worlds
         IPLScene scene = nullptr;
         SACHECK(iplSceneLoad(phononContext, &sceneSettings, serializedObject, nullptr, nullptr, &scene));
 
+        iplSerializedObjectRelease(&serializedObject);
         delete[] buffer;
 
         return scene;
@@ -1,6 +1,7 @@
 #pragma once
 #include <Core/AssetDB.hpp>
 #include <Core/Console.hpp>
+#include <Core/Transform.hpp>
 #include <SDL_audio.h>
 #include <entt/entity/lw_fwd.hpp>
 #include <glm/gtc/quaternion.hpp>
@@ -26,6 +27,8 @@ DECLARE_OPAQUE_HANDLE(IPLSimulator);
 
 namespace worlds
 {
+    class AcousticGeometryCache;
+
     enum class MixerChannel : uint32_t
     {
         Music,
@@ -33,6 +36,16 @@ namespace worlds
         Count
     };
 
+    // How far a source is from the listener relative to its attenuation range
+    enum class AudioCullBucket : uint8_t
+    {
+        Audible,
+        // Paused until the listener comes back in range
+        Virtual,
+        // One-shot events this far away get stopped
+        Stopped
+    };
+
     struct AudioSource
     {
         FMOD::Studio::EventInstance* eventInstance = nullptr;
@@ -49,6 +62,16 @@ namespace worlds
       private:
         std::string _eventPath;
         bool inPhononSim = false;
+
+        // Playback state as of the start of this frame's update
+        FMOD_STUDIO_PLAYBACK_STATE cachedState = FMOD_STUDIO_PLAYBACK_STOPPED;
+        AudioCullBucket cullBucket = AudioCullBucket::Audible;
+        // 0 for 2D events, which never get culled
+        float maxDistance = 0.0f;
+        bool isOneshot = false;
+        bool sentAttributes = false;
+        glm::vec3 sentPosition;
+        glm::quat sentRotation;
         friend class AudioSystem;
     };
 
@@ -68,13 +91,26 @@ namespace worlds
         int meh;
     };
 
+    struct AudioDebugStats
+    {
+        int attributeUpdates;
+        int playingSources;
+        int virtualSources;
+        int distanceStops;
+        int activeVoices;
+        int realVoices;
+    };
+
     class AudioSystem
     {
       public:
         AudioSystem();
         void initialise(entt::registry& worldState);
         void loadMasterBanks();
+        // Doesn't use ImGui, so it can run off the main thread as long as nothing else touches the sources.
         void update(entt::registry& worldState, glm::vec3 listenerPos, glm::quat listenerRot, float deltaTime);
+        // Has to be called from the main thread after update.
+        void drawDebugWindow();
         void stopEverything(entt::registry& reg);
         void playOneShotClip(AssetID id, glm::vec3 location, bool spatialise = false, float volume = 1.0f,
                              MixerChannel channel = MixerChannel::SFX);
@@ -89,16 +125,31 @@ namespace worlds
         FMOD::Studio::Bank* loadBank(const char* path);
         void bakeProbes(entt::registry& registry);
         void saveAudioScene(entt::registry& reg, const char* path);
+        // Starts building the audio scene for the registry in the background. The current scene stays
+        // in use until the new one is ready.
         void updateAudioScene(entt::registry& reg);
+        // Counters for the last update
+        const AudioDebugStats& getDebugStats() const
+        {
+            return debugStats;
+        }
 
       private:
         class SteamAudioSimThread;
+        class AudioSceneJob;
         void updateSteamAudio(entt::registry& registry, float deltaTime, glm::vec3 listenerPos, glm::quat listenerRot);
         void onAudioSourceDestroy(entt::registry& reg, entt::entity ent);
-        static FMOD_RESULT phononEventInstanceCallback(FMOD_STUDIO_EVENT_CALLBACK_TYPE type,
-                                                       FMOD_STUDIO_EVENTINSTANCE* event, void* param);
-        IPLScene createScene(entt::registry& reg);
-        IPLScene loadScene(const char* path);
+        void updateSources(entt::registry& registry, glm::vec3 listenerPos);
+        void pushSourceAttributes(AudioSource& as, const Transform& t);
+        static FMOD_RESULT oneshotEventInstanceCallback(FMOD_STUDIO_EVENT_CALLBACK_TYPE type,
+                                                        FMOD_STUDIO_EVENTINSTANCE* event, void* param);
+        // Returns nullptr if the file was saved from different geometry. Files without a geometry hash
+        // are loaded anyway and leave hashChecked false.
+        IPLScene loadScene(const char* path, uint64_t geometryHash, bool& hashChecked);
+        void finishSceneJob();
+        void cancelSceneJob();
+
+        struct OneshotCallbackData;
 
         struct AttachedOneshot
         {
@@ -106,6 +157,10 @@ namespace worlds
             IPLSource phononSource = nullptr;
             entt::entity entity;
             glm::vec3 lastPosition;
+            // Owned by the event instance's callback, only valid until the instance is released
+            OneshotCallbackData* callbackData = nullptr;
+            glm::quat lastRotation{1.0f, 0.0f, 0.0f, 0.0f};
+            bool moving = false;
             bool markForRemoval = false;
             float timeSinceStop = 0.0f;
         };
@@ -114,7 +169,6 @@ namespace worlds
 
         glm::vec3 lastListenerPos;
         bool available = true;
-        bool needsSimCommit = false;
         static AudioSystem* instance;
         FMOD::Studio::System* studioSystem;
         FMOD::System* system;
@@ -129,14 +183,18 @@ namespace worlds
         IPLSimulator simulator;
         IPLSource listenerCentricSource;
         IPLScene scene = nullptr;
+        uint64_t sceneGeometryHash = 0;
+        bool sceneGeometryKnown = true;
+        AudioSceneJob* sceneJob = nullptr;
+        AcousticGeometryCache* acousticCache = nullptr;
         float timeSinceLastSim = 0.0f;
         SteamAudioSimThread* simThread;
 
-        std::queue<IPLSource> sourcesToAdd;
-        std::queue<IPLSource> sourcesToRemove;
         robin_hood::unordered_map<const char*, FMOD::Studio::Bank*> loadedBanks;
         robin_hood::unordered_map<AssetID, FMOD::Sound*> sounds;
         std::vector<AttachedOneshot*> attachedOneshots;
+        // As of the last finished simulation
         int sourcesInSim = 0;
+        AudioDebugStats debugStats{};
     };
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include "ComponentFuncs.hpp"
+#include <Serialization/BinaryStream.hpp>
 #include <entt/core/type_info.hpp>
 #include <entt/entt.hpp>
 
@@ -62,5 +63,41 @@ namespace worlds
         {
             return entt::hashed_string{getName()};
         }
+
+        uint32_t getBulkElementSize() override
+        {
+            return sizeof(T);
+        }
+
+        void writeBulk(entt::registry& reg, const std::vector<entt::entity>& entities, BinaryWriter& writer) override
+        {
+            if constexpr (std::is_trivially_copyable_v<T> && !std::is_empty_v<T>)
+            {
+                for (entt::entity ent : entities)
+                    writer.write(reg.get<T>(ent));
+            }
+            else
+            {
+                assert(false);
+            }
+        }
+
+        void readBulk(entt::registry& reg, const std::vector<entt::entity>& entities, BinaryReader& reader) override
+        {
+            if constexpr (std::is_trivially_copyable_v<T> && !std::is_empty_v<T>)
+            {
+                // The binary serializer keeps chunk data 16-byte aligned, so the
+                // components can be handed to entt without copying them out first.
+                const T* components = (const T*)reader.current();
+                if (!reader.skip(sizeof(T) * entities.size()))
+                    return;
+
+                reg.insert<T>(entities.begin(), entities.end(), components, components + entities.size());
+            }
+            else
+            {
+                assert(false);
+            }
+        }
     };
 }
@@ -10,11 +10,13 @@
 #include <ImGui/imgui.h>
 #include <Libs/IconsFontAwesome5.h>
 #include <Libs/IconsFontaudio.h>
+#include <Navigation/NavCrowd.hpp>
 #include <Physics/D6Joint.hpp>
 #include <Physics/Physics.hpp>
 #include <Render/DebugLines.hpp>
 #include <Render/Render.hpp>
 #include <Scripting/ScriptComponent.hpp>
+#include <Serialization/BinaryStream.hpp>
 #include <Serialization/SceneSerialization.hpp>
 #include <UI/WorldTextComponent.hpp>
 #include <Util/CreateModelObject.hpp>
@@ -59,6 +61,31 @@ namespace worlds
         first->editor = this;
     }
 
+    void ComponentMetadata::writeBinary(entt::entity ent, entt::registry& reg, BinaryWriter& writer)
+    {
+        nlohmann::json j;
+        toJson(ent, reg, j);
+
+        std::vector<uint8_t> msgpack = nlohmann::json::to_msgpack(j);
+        writer.write((uint32_t)msgpack.size());
+        writer.write(msgpack.data(), msgpack.size());
+    }
+
+    void ComponentMetadata::readBinary(entt::entity ent, entt::registry& reg, EntityIDMap& entityRemap,
+                                       BinaryReader& reader)
+    {
+        uint32_t size = reader.read<uint32_t>();
+        const uint8_t* data = reader.current();
+        if (!reader.skip(size))
+            return;
+
+        nlohmann::json j = nlohmann::json::from_msgpack(data, data + size);
+        if (j.is_null())
+            return;
+
+        fromJson(ent, reg, entityRemap, j);
+    }
+
     class TransformEditor : public virtual BasicComponentUtil<Transform>
     {
     private:
@@ -91,13 +118,17 @@ namespace worlds
             return glm::quat{w, x, y, z};
         }
 
-        void showTransformControls(entt::registry& reg, Transform& selectedTransform, Editor* ed)
+        // Returns true if the transform was changed
+        bool showTransformControls(entt::registry& reg, Transform& selectedTransform, Editor* ed)
         {
+            bool changed = false;
+
             glm::vec3 pos = selectedTransform.position;
             if (ImGui::DragFloat3("Position", &pos.x))
             {
                 ed->undo.pushState(reg);
                 selectedTransform.position = pos;
+                changed = true;
             }
 
             glm::vec3 eulerRot = glm::degrees(getEulerAngles(selectedTransform.rotation));
@@ -105,12 +136,14 @@ namespace worlds
             {
                 ed->undo.pushState(reg);
                 selectedTransform.rotation = eulerQuat(glm::radians(eulerRot));
+                changed = true;
             }
 
             glm::vec3 scale = selectedTransform.scale;
             if (ImGui::DragFloat3("Scale", &scale.x) && !glm::any(glm::equal(scale, glm::vec3{0.0f})))
             {
                 selectedTransform.scale = scale;
+                changed = true;
             }
 
             if (ImGui::Button("Snap to world grid"))
@@ -120,6 +153,7 @@ namespace worlds
                 selectedTransform.scale = glm::round(selectedTransform.scale);
                 eulerRot = glm::round(eulerRot / 15.0f) * 15.0f;
                 selectedTransform.rotation = glm::radians(eulerRot);
+                changed = true;
             }
 
             ImGui::SameLine();
@@ -132,7 +166,10 @@ namespace worlds
                 const float ROUND_TO = glm::half_pi<float>() * 0.25f;
                 radEuler = glm::round(radEuler / ROUND_TO) * ROUND_TO;
                 selectedTransform.rotation = radEuler;
+                changed = true;
             }
+
+            return changed;
         }
 
     public:
@@ -151,6 +188,11 @@ namespace worlds
             return false;
         }
 
+        bool isBulkSerializable() override
+        {
+            return true;
+        }
+
 #ifdef BUILD_EDITOR
         void edit(entt::entity ent, entt::registry& reg, Editor* ed) override
         {
@@ -160,7 +202,8 @@ namespace worlds
 
                 if (!reg.has<ChildComponent>(ent))
                 {
-                    showTransformControls(reg, selectedTransform, ed);
+                    if (showTransformControls(reg, selectedTransform, ed))
+                        reg.patch<Transform>(ent);
                 }
                 else
                 {
@@ -169,7 +212,8 @@ namespace worlds
 
                     if (ImGui::TreeNode("World Space Transform"))
                     {
-                        showTransformControls(reg, selectedTransform, ed);
+                        if (showTransformControls(reg, selectedTransform, ed))
+                            reg.patch<Transform>(ent);
                         ImGui::TreePop();
                     }
                 }
@@ -226,6 +270,9 @@ namespace worlds
                 else
                 {
                     auto& worldObject = reg.get<WorldObject>(ent);
+                    StaticFlags oldFlags = worldObject.staticFlags;
+                    AssetID oldMesh = worldObject.mesh;
+
                     if (ImGui::TreeNode("Static Flags"))
                     {
                         for (int i = 1; i < 8; i <<= 1)
@@ -328,6 +375,9 @@ namespace worlds
 
                         ImGui::TreePop();
                     }
+
+                    if (worldObject.staticFlags != oldFlags || worldObject.mesh != oldMesh)
+                        reg.patch<WorldObject>(ent);
                 }
 
                 ImGui::Separator();
@@ -365,6 +415,11 @@ namespace worlds
             };
         }
 
+        void gatherAssetReferences(const json& j, SceneAssetReferences& refs) override
+        {
+            refs.meshes.push_back(AssetDB::pathToId(j["mesh"].get<std::string>()));
+        }
+
         void fromJson(entt::entity ent, entt::registry& reg, EntityIDMap&, const json& j) override
         {
             ZoneScoped;
@@ -397,6 +452,52 @@ namespace worlds
                 }
             }
         }
+
+        void writeBinary(entt::entity ent, entt::registry& reg, BinaryWriter& writer) override
+        {
+            auto& wo = reg.get<WorldObject>(ent);
+
+            writer.writeAssetID(wo.mesh);
+            writer.write(wo.texScaleOffset);
+            writer.write(wo.staticFlags);
+
+            uint32_t materialCount = wo.presentMaterials.count();
+            writer.write(materialCount);
+            for (uint32_t i = 0; i < materialCount; i++)
+            {
+                writer.writeAssetID(wo.materials[i]);
+            }
+
+            uint32_t drawnSubmeshBits = 0;
+            for (int i = 0; i < NUM_SUBMESH_MATS; i++)
+            {
+                if (wo.drawSubmeshes[i])
+                    drawnSubmeshBits |= 1u << i;
+            }
+            writer.write(drawnSubmeshBits);
+        }
+
+        void readBinary(entt::entity ent, entt::registry& reg, EntityIDMap&, BinaryReader& reader) override
+        {
+            ZoneScoped;
+            auto& wo = reg.emplace<WorldObject>(ent, 0, 0);
+            wo.mesh = reader.readAssetID();
+            wo.texScaleOffset = reader.read<glm::vec4>();
+            wo.staticFlags = reader.read<StaticFlags>();
+
+            uint32_t materialCount = glm::min(reader.read<uint32_t>(), (uint32_t)NUM_SUBMESH_MATS);
+            for (uint32_t i = 0; i < materialCount; i++)
+            {
+                wo.presentMaterials[i] = true;
+                wo.materials[i] = reader.readAssetID();
+            }
+
+            uint32_t drawnSubmeshBits = reader.read<uint32_t>();
+            for (int i = 0; i < NUM_SUBMESH_MATS; i++)
+            {
+                wo.drawSubmeshes[i] = (drawnSubmeshBits & (1u << i)) != 0;
+            }
+        }
     };
 
     class SkinnedWorldObjectEditor : public BasicComponentUtil<SkinnedWorldObject>
@@ -505,6 +606,11 @@ namespace worlds
             };
         }
 
+        void gatherAssetReferences(const json& j, SceneAssetReferences& refs) override
+        {
+            refs.meshes.push_back(AssetDB::pathToId(j["mesh"].get<std::string>()));
+        }
+
         void fromJson(entt::entity ent, entt::registry& reg, EntityIDMap&, const json& j) override
         {
             ZoneScoped;
@@ -755,6 +861,28 @@ namespace worlds
             wl.shadowFar = j.value("shadowFar", wl.shadowFar);
             wl.shadowBias = j.value("shadowBias", wl.shadowBias);
         }
+
+        bool isBulkSerializable() override
+        {
+            return true;
+        }
+
+        void readBulk(entt::registry& reg, const std::vector<entt::entity>& entities, BinaryReader& reader) override
+        {
+            BasicComponentUtil<WorldLight>::readBulk(reg, entities, reader);
+
+            // Shadowmap and light buffer indices are assigned by the renderer and
+            // mean nothing once loaded back in.
+            for (entt::entity ent : entities)
+            {
+                WorldLight* wl = reg.try_get<WorldLight>(ent);
+                if (wl == nullptr)
+                    continue;
+
+                wl->shadowmapIdx = ~0u;
+                wl->lightIdx = 0u;
+            }
+        }
     };
 
     const char* shapeTypeNames[(int)PhysicsShapeType::Count] = {"Sphere", "Box", "Capsule", "Mesh", "Convex Mesh"};
@@ -1121,6 +1249,15 @@ namespace worlds
             j["layer"] = pa.layer;
         }
 
+        void gatherAssetReferences(const json& j, SceneAssetReferences& refs) override
+        {
+            for (auto& shape : j["shapes"])
+            {
+                if (shape["type"] == PhysicsShapeType::Mesh)
+                    refs.collisionMeshes.push_back(AssetDB::pathToId(shape["mesh"].get<std::string>()));
+            }
+        }
+
         void fromJson(entt::entity ent, entt::registry& reg, EntityIDMap&, const json& j) override
         {
             ZoneScoped;
@@ -1329,6 +1466,16 @@ namespace worlds
                 j["enabled"] = false;
         }
 
+        void gatherAssetReferences(const json& j, SceneAssetReferences& refs) override
+        {
+            // Convex meshes aren't cached after cooking, but loading the mesh data still helps
+            for (auto& shape : j["shapes"])
+            {
+                if (shape["type"] == PhysicsShapeType::ConvexMesh)
+                    refs.meshes.push_back(AssetDB::pathToId(shape["mesh"].get<std::string>()));
+            }
+        }
+
         void fromJson(entt::entity ent, entt::registry& reg, EntityIDMap&, const json& j) override
         {
             ZoneScoped;
@@ -1954,6 +2101,59 @@ namespace worlds
         }
     };
 
+    class NavAgentEditor : public BasicComponentUtil<NavAgent>
+    {
+    public:
+        const char* getName() override
+        {
+            return "Nav Agent";
+        }
+
+#ifdef BUILD_EDITOR
+        void edit(entt::entity entity, entt::registry& reg, Editor* ed) override
+        {
+            auto& agent = reg.get<NavAgent>(entity);
+
+            if (ImGui::CollapsingHeader("Nav Agent"))
+            {
+                if (ImGui::Button("Remove##NavAgent"))
+                {
+                    reg.remove<NavAgent>(entity);
+                    return;
+                }
+
+                ImGui::DragFloat("Radius", &agent.radius, 0.05f, 0.05f, 2.0f);
+                ImGui::DragFloat("Height", &agent.height, 0.05f, 0.1f);
+                ImGui::DragFloat("Max Speed", &agent.maxSpeed, 0.1f, 0.0f);
+                ImGui::DragFloat("Max Acceleration", &agent.maxAcceleration, 0.1f, 0.0f);
+            }
+        }
+#endif
+
+        void toJson(entt::entity ent, entt::registry& reg, json& j) override
+        {
+            auto& agent = reg.get<NavAgent>(ent);
+
+            j = {
+                {"radius", agent.radius},
+                {"height", agent.height},
+                {"maxSpeed", agent.maxSpeed},
+                {"maxAcceleration", agent.maxAcceleration}
+            };
+        }
+
+        void fromJson(entt::entity ent, entt::registry& reg, EntityIDMap&, const json& j) override
+        {
+            ZoneScoped;
+            auto& agent = reg.emplace<NavAgent>(ent);
+
+            agent.radius = j.value("radius", 0.5f);
+            agent.height = j.value("height", 2.0f);
+            agent.maxSpeed = j.value("maxSpeed", 3.5f);
+            agent.maxAcceleration = j.value("maxAcceleration", 8.0f);
+        }
+    };
+
     class ChildComponentEditor : public BasicComponentUtil<ChildComponent>
     {
     public:
@@ -2110,6 +2310,7 @@ namespace worlds
     EditorLabelEditor ele;
     FMODAudioSourceEditor fase;
     AudioListenerOverrideEditor alo;
+    NavAgentEditor nae;
     ChildComponentEditor ced;
     ParticleSystemEditor pse;
 }
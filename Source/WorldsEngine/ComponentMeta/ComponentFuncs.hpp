@@ -3,14 +3,28 @@
 #include <entt/entity/fwd.hpp>
 #include <nlohmann/json_fwd.hpp>
 #include <physfs.h>
+#include <vector>
 
 namespace worlds
 {
     struct ComponentEditorLink;
     class Editor;
     struct EngineInterfaces;
+    class BinaryWriter;
+    class BinaryReader;
 
     typedef robin_hood::unordered_flat_map<entt::entity, entt::entity> EntityIDMap;
+    typedef uint32_t AssetID;
+
+    // Assets referenced by a scene, gathered so they can be loaded on a worker thread
+    // before the scene's components are deserialized.
+    struct SceneAssetReferences
+    {
+        std::vector<AssetID> meshes;
+        // Meshes used by triangle mesh colliders, which also need cooking
+        std::vector<AssetID> collisionMeshes;
+    };
+
     class ComponentMetadata
     {
       public:
@@ -38,6 +52,35 @@ namespace worlds
         virtual void toJson(entt::entity ent, entt::registry& reg, nlohmann::json& j) = 0;
         virtual void fromJson(entt::entity ent, entt::registry& reg, EntityIDMap& entityRemap,
                               const nlohmann::json& j) = 0;
+
+        // Binary scene hooks. By default these store the component's JSON as msgpack,
+        // so override them for components that show up a lot in scenes.
+        virtual void writeBinary(entt::entity ent, entt::registry& reg, BinaryWriter& writer);
+        virtual void readBinary(entt::entity ent, entt::registry& reg, EntityIDMap& entityRemap,
+                                BinaryReader& reader);
+
+        // Components that are safe to memcpy can opt into being read and written
+        // a whole chunk at a time, straight in and out of their storage.
+        virtual bool isBulkSerializable()
+        {
+            return false;
+        }
+        virtual uint32_t getBulkElementSize()
+        {
+            return 0;
+        }
+        virtual void writeBulk(entt::registry& reg, const std::vector<entt::entity>& entities, BinaryWriter& writer)
+        {
+        }
+        virtual void readBulk(entt::registry& reg, const std::vector<entt::entity>& entities, BinaryReader& reader)
+        {
+        }
+
+        // Adds the assets the component's JSON refers to. Called from worker threads, so it
+        // mustn't touch anything but the JSON.
+        virtual void gatherAssetReferences(const nlohmann::json& j, SceneAssetReferences& refs)
+        {
+        }
         virtual ~ComponentMetadata()
         {
         }
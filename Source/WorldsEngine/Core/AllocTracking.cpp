@@ -0,0 +1,419 @@
+#include "AllocTracking.hpp"
+#include <Core/Log.hpp>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef CHECK_NEW_DELETE
+#include <Core/ConVar.hpp>
+#include <Core/Fatal.hpp>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <robin_hood.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <Tracy.hpp>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#include <execinfo.h>
+#endif
+#endif
+
+namespace worlds
+{
+    const char* tagNames[] = {"Untagged", "Render", "Physics", "Audio", "Scripting", "Assets"};
+    static_assert(sizeof(tagNames) / sizeof(tagNames[0]) == (size_t)AllocTag::Count);
+
+    const char* AllocTracker::tagName(AllocTag tag)
+    {
+        return tagNames[(int)tag];
+    }
+
+#ifndef CHECK_NEW_DELETE
+    void AllocTracker::endFrame()
+    {
+    }
+
+    AllocTagStats AllocTracker::lastFrame(AllocTag)
+    {
+        return AllocTagStats{0, 0};
+    }
+
+    AllocTagStats AllocTracker::live(AllocTag)
+    {
+        return AllocTagStats{0, 0};
+    }
+
+    void AllocTracker::allocationHistory(float* out)
+    {
+        memset(out, 0, sizeof(float) * HistoryLength);
+    }
+
+    bool AllocTracker::exportStats(const char*)
+    {
+        logErr("Allocation tracking isn't enabled in this build");
+        return false;
+    }
+#else
+    const int TagCount = (int)AllocTag::Count;
+    const uint32_t AllocMagic = 0x57414C43; // WALC
+    const int MaxSampledFrames = 16;
+
+    // Sits in front of every allocation so delete knows how much is being freed and under which tag.
+    // Kept at 16 bytes so the returned pointer has the same alignment malloc gives.
+    struct AllocHeader
+    {
+        uint64_t size;
+        uint32_t magic;
+        AllocTag tag;
+        uint8_t pad[3];
+    };
+    static_assert(sizeof(AllocHeader) == 16);
+
+    // Only ever written by its own thread, so the atomics are just there to make reading them from
+    // the main thread well defined. Frees on a different thread to the allocation make an individual
+    // thread's numbers meaningless, but the sum across threads still works out.
+    struct ThreadAllocCounters
+    {
+        std::atomic<uint64_t> allocations[TagCount];
+        std::atomic<uint64_t> bytesAllocated[TagCount];
+        std::atomic<uint64_t> frees[TagCount];
+        std::atomic<uint64_t> bytesFreed[TagCount];
+        ThreadAllocCounters* next;
+    };
+
+    struct SampledSite
+    {
+        void* frames[MaxSampledFrames];
+        int frameCount;
+        AllocTag tag;
+        uint64_t count;
+        uint64_t bytes;
+    };
+
+    // Counters are never freed, since memory can be freed after the thread that allocated it is gone
+    std::atomic<ThreadAllocCounters*> counterListHead{nullptr};
+    thread_local ThreadAllocCounters* threadCounters = nullptr;
+    thread_local AllocTag currentTag = AllocTag::Untagged;
+    thread_local uint32_t sampleCountdown = 0;
+    thread_local bool inSampler = false;
+    std::atomic<uint32_t> sampleInterval{0};
+
+    ConVar allocSampleInterval{"mem_allocSampleInterval", "0",
+                               "Record the call stack of every Nth allocation. 0 disables sampling."};
+
+    struct TagTotals
+    {
+        uint64_t allocations[TagCount];
+        uint64_t bytesAllocated[TagCount];
+        uint64_t frees[TagCount];
+        uint64_t bytesFreed[TagCount];
+    };
+
+    TagTotals previousTotals{};
+    AllocTagStats lastFrameStats[TagCount]{};
+    float history[AllocTracker::HistoryLength]{};
+    int historyIdx = 0;
+
+    ThreadAllocCounters* getThreadCounters()
+    {
+        if (threadCounters)
+            return threadCounters;
+
+        void* mem = malloc(sizeof(ThreadAllocCounters));
+        ThreadAllocCounters* counters = new (mem) ThreadAllocCounters{};
+
+        counters->next = counterListHead.load(std::memory_order_relaxed);
+        while (!counterListHead.compare_exchange_weak(counters->next, counters, std::memory_order_release,
+                                                      std::memory_order_relaxed))
+            ;
+
+        threadCounters = counters;
+        return counters;
+    }
+
+    TagTotals sumCounters()
+    {
+        TagTotals totals{};
+        for (ThreadAllocCounters* c = counterListHead.load(std::memory_order_acquire); c; c = c->next)
+        {
+            for (int i = 0; i < TagCount; i++)
+            {
+                totals.allocations[i] += c->allocations[i].load(std::memory_order_relaxed);
+                totals.bytesAllocated[i] += c->bytesAllocated[i].load(std::memory_order_relaxed);
+                totals.frees[i] += c->frees[i].load(std::memory_order_relaxed);
+                totals.bytesFreed[i] += c->bytesFreed[i].load(std::memory_order_relaxed);
+            }
+        }
+        return totals;
+    }
+
+    std::mutex sitesMutex;
+
+    robin_hood::unordered_map<uint64_t, SampledSite>& getSites()
+    {
+        // Deliberately leaked so it outlives anything freeing memory during shutdown
+        static auto* sites = new robin_hood::unordered_map<uint64_t, SampledSite>;
+        return *sites;
+    }
+
+    int captureStack(void** frames)
+    {
+#ifdef _WIN32
+        return CaptureStackBackTrace(3, MaxSampledFrames, frames, nullptr);
+#else
+        return backtrace(frames, MaxSampledFrames);
+#endif
+    }
+
+    void sampleAllocation(size_t size, AllocTag tag)
+    {
+        inSampler = true;
+
+        SampledSite site;
+        site.frameCount = captureStack(site.frames);
+        site.tag = tag;
+
+        // 64-bit FNV-1a over the return addresses
+        uint64_t hash = 14695981039346656037ull;
+        const uint8_t* bytes = (const uint8_t*)site.frames;
+        for (size_t i = 0; i < site.frameCount * sizeof(void*); i++)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+
+        {
+            std::unique_lock lock{sitesMutex};
+            auto& sites = getSites();
+            auto it = sites.find(hash);
+
+            if (it == sites.end())
+            {
+                site.count = 1;
+                site.bytes = size;
+                sites.insert({hash, site});
+            }
+            else
+            {
+                it->second.count++;
+                it->second.bytes += size;
+            }
+        }
+
+        inSampler = false;
+    }
+
+    void* trackedAlloc(size_t count)
+    {
+        AllocHeader* header = (AllocHeader*)malloc(count + sizeof(AllocHeader));
+        if (header == nullptr)
+            throw std::bad_alloc();
+
+        header->size = count;
+        header->magic = AllocMagic;
+        header->tag = currentTag;
+
+        ThreadAllocCounters* counters = getThreadCounters();
+        int tagIdx = (int)header->tag;
+        counters->allocations[tagIdx].fetch_add(1, std::memory_order_relaxed);
+        counters->bytesAllocated[tagIdx].fetch_add(count, std::memory_order_relaxed);
+
+        uint32_t interval = sampleInterval.load(std::memory_order_relaxed);
+        if (interval != 0 && !inSampler)
+        {
+            if (sampleCountdown == 0 || sampleCountdown > interval)
+                sampleCountdown = interval;
+
+            if (--sampleCountdown == 0)
+                sampleAllocation(count, header->tag);
+        }
+
+        void* ptr = header + 1;
+#ifdef TRACY_ENABLE
+        TracyAlloc(ptr, count);
+#endif
+        return ptr;
+    }
+
+    void trackedFree(void* ptr)
+    {
+        if (ptr == nullptr)
+            return;
+
+        AllocHeader* header = (AllocHeader*)ptr - 1;
+        if (header->magic != AllocMagic)
+        {
+            fatalErr("Deleted non-existent pointer!");
+        }
+
+#ifdef TRACY_ENABLE
+        TracyFree(ptr);
+#endif
+
+        ThreadAllocCounters* counters = getThreadCounters();
+        int tagIdx = (int)header->tag;
+        counters->frees[tagIdx].fetch_add(1, std::memory_order_relaxed);
+        counters->bytesFreed[tagIdx].fetch_add(header->size, std::memory_order_relaxed);
+
+        header->magic = 0;
+        free(header);
+    }
+
+    AllocTagScope::AllocTagScope(AllocTag tag) : previous(currentTag)
+    {
+        currentTag = tag;
+    }
+
+    AllocTagScope::~AllocTagScope()
+    {
+        currentTag = previous;
+    }
+
+    void AllocTracker::endFrame()
+    {
+        sampleInterval.store((uint32_t)std::max(allocSampleInterval.getInt(), 0), std::memory_order_relaxed);
+
+        TagTotals totals = sumCounters();
+        uint64_t frameAllocations = 0;
+
+        for (int i = 0; i < TagCount; i++)
+        {
+            lastFrameStats[i].allocations = totals.allocations[i] - previousTotals.allocations[i];
+            lastFrameStats[i].bytes = totals.bytesAllocated[i] - previousTotals.bytesAllocated[i];
+            frameAllocations += lastFrameStats[i].allocations;
+        }
+
+        previousTotals = totals;
+        history[historyIdx] = (float)frameAllocations;
+        historyIdx = (historyIdx + 1) % HistoryLength;
+    }
+
+    AllocTagStats AllocTracker::lastFrame(AllocTag tag)
+    {
+        return lastFrameStats[(int)tag];
+    }
+
+    AllocTagStats AllocTracker::live(AllocTag tag)
+    {
+        TagTotals totals = sumCounters();
+        int i = (int)tag;
+        return AllocTagStats{totals.allocations[i] - totals.frees[i], totals.bytesAllocated[i] - totals.bytesFreed[i]};
+    }
+
+    void AllocTracker::allocationHistory(float* out)
+    {
+        for (int i = 0; i < HistoryLength; i++)
+        {
+            out[i] = history[(historyIdx + i) % HistoryLength];
+        }
+    }
+
+    std::string describeAddress(void* addr)
+    {
+        char buf[512];
+#ifdef _WIN32
+        HMODULE module = nullptr;
+        char moduleName[MAX_PATH] = "?";
+        if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                               (LPCSTR)addr, &module))
+        {
+            GetModuleFileNameA(module, moduleName, sizeof(moduleName));
+        }
+        const char* name = strrchr(moduleName, '\\');
+        snprintf(buf, sizeof(buf), "%s+0x%llx", name ? name + 1 : moduleName,
+                 (unsigned long long)((uintptr_t)addr - (uintptr_t)module));
+#else
+        Dl_info info{};
+        if (dladdr(addr, &info) && info.dli_fname)
+        {
+            const char* name = strrchr(info.dli_fname, '/');
+            snprintf(buf, sizeof(buf), "%s+0x%llx", name ? name + 1 : info.dli_fname,
+                     (unsigned long long)((uintptr_t)addr - (uintptr_t)info.dli_fbase));
+        }
+        else
+        {
+            snprintf(buf, sizeof(buf), "?+0x%llx", (unsigned long long)(uintptr_t)addr);
+        }
+#endif
+        return buf;
+    }
+
+    bool AllocTracker::exportStats(const char* path)
+    {
+        FILE* f = fopen(path, "w");
+        if (f == nullptr)
+        {
+            logErr("Failed to open %s for writing allocation stats", path);
+            return false;
+        }
+
+        TagTotals totals = sumCounters();
+
+        std::vector<SampledSite> sites;
+        {
+            std::unique_lock lock{sitesMutex};
+            for (auto& pair : getSites())
+            {
+                sites.push_back(pair.second);
+            }
+        }
+
+        std::sort(sites.begin(), sites.end(),
+                  [](const SampledSite& a, const SampledSite& b) { return a.bytes > b.bytes; });
+
+        fprintf(f, "{\n  \"sampleInterval\": %u,\n  \"tags\": [\n", sampleInterval.load());
+        for (int i = 0; i < TagCount; i++)
+        {
+            fprintf(f,
+                    "    {\"name\": \"%s\", \"totalAllocations\": %llu, \"totalBytes\": %llu, "
+                    "\"liveAllocations\": %llu, \"liveBytes\": %llu, "
+                    "\"frameAllocations\": %llu, \"frameBytes\": %llu}%s\n",
+                    tagNames[i], (unsigned long long)totals.allocations[i],
+                    (unsigned long long)totals.bytesAllocated[i],
+                    (unsigned long long)(totals.allocations[i] - totals.frees[i]),
+                    (unsigned long long)(totals.bytesAllocated[i] - totals.bytesFreed[i]),
+                    (unsigned long long)lastFrameStats[i].allocations, (unsigned long long)lastFrameStats[i].bytes,
+                    i == TagCount - 1 ? "" : ",");
+        }
+
+        fprintf(f, "  ],\n  \"callSites\": [\n");
+        for (size_t i = 0; i < sites.size(); i++)
+        {
+            const SampledSite& site = sites[i];
+            fprintf(f, "    {\"tag\": \"%s\", \"samples\": %llu, \"bytes\": %llu, \"frames\": [", tagNames[(int)site.tag],
+                    (unsigned long long)site.count, (unsigned long long)site.bytes);
+
+            for (int j = 0; j < site.frameCount; j++)
+            {
+                fprintf(f, "%s\"%s\"", j == 0 ? "" : ", ", describeAddress(site.frames[j]).c_str());
+            }
+
+            fprintf(f, "]}%s\n", i == sites.size() - 1 ? "" : ",");
+        }
+        fprintf(f, "  ]\n}\n");
+
+        fclose(f);
+        logMsg("Wrote allocation stats for %zu call sites to %s", sites.size(), path);
+        return true;
+    }
+#endif
+}
+
+#ifdef CHECK_NEW_DELETE
+void* operator new(size_t count)
+{
+    return worlds::trackedAlloc(count);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    worlds::trackedFree(ptr);
+}
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+#include <stdint.h>
+
+namespace worlds
+{
+    enum class AllocTag : uint8_t
+    {
+        Untagged,
+        Render,
+        Physics,
+        Audio,
+        Scripting,
+        Assets,
+        Count
+    };
+
+    struct AllocTagStats
+    {
+        uint64_t allocations;
+        uint64_t bytes;
+    };
+
+    // Everything allocated with new on this thread until the scope ends gets counted under the tag.
+    // Only does anything in CHECK_NEW_DELETE builds.
+    class AllocTagScope
+    {
+      public:
+#ifdef CHECK_NEW_DELETE
+        AllocTagScope(AllocTag tag);
+        ~AllocTagScope();
+
+      private:
+        AllocTag previous;
+#else
+        AllocTagScope(AllocTag)
+        {
+        }
+#endif
+    };
+
+    // Heap allocation telemetry for CHECK_NEW_DELETE builds. Counting happens in per-thread counters,
+    // so it's safe to use with allocations happening on any thread. Every Nth allocation can also
+    // have its call stack recorded (see the mem_allocSampleInterval convar).
+    class AllocTracker
+    {
+      public:
+        static const int HistoryLength = 128;
+
+        static const char* tagName(AllocTag tag);
+        // Call once per frame from the main thread.
+        static void endFrame();
+        static AllocTagStats lastFrame(AllocTag tag);
+        static AllocTagStats live(AllocTag tag);
+        // Allocations per frame over the last HistoryLength frames, oldest first.
+        static void allocationHistory(float* out);
+        // Writes the current numbers and sampled call sites as JSON. Addresses are module relative,
+        // so dumps from different runs and builds can be compared.
+        static bool exportStats(const char* path);
+    };
+}
@@ -0,0 +1,227 @@
+#include "Benchmark.hpp"
+#include <Core/Engine.hpp>
+#include <Core/Log.hpp>
+#include <IO/IOUtil.hpp>
+#include <Render/Camera.hpp>
+#include <Util/JsonUtil.hpp>
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace worlds
+{
+    struct BenchmarkColumn
+    {
+        const char* name;
+        double BenchmarkFrameTimes::*member;
+    };
+
+    const BenchmarkColumn columns[] = {
+        {"frame", &BenchmarkFrameTimes::frame},   {"update", &BenchmarkFrameTimes::update},
+        {"sim", &BenchmarkFrameTimes::sim},       {"script", &BenchmarkFrameTimes::script},
+        {"animation", &BenchmarkFrameTimes::animation},
+        {"audio", &BenchmarkFrameTimes::audio},   {"renderPrep", &BenchmarkFrameTimes::renderPrep},
+    };
+
+    int intArgument(const char* name, int defaultValue)
+    {
+        if (!EngineArguments::hasArgument(name))
+            return defaultValue;
+
+        return atoi(std::string(EngineArguments::argumentValue(name)).c_str());
+    }
+
+    BenchmarkRunner::BenchmarkRunner()
+        : scene(EngineArguments::argumentValue("benchmark"))
+        , outputName("benchmark")
+        , frameCount(std::max(intArgument("frames", 1000), 1))
+        , warmupLeft(std::max(intArgument("warmup", 30), 0))
+        , deltaTime(1.0 / 60.0)
+    {
+        if (EngineArguments::hasArgument("benchmark-output"))
+            outputName = EngineArguments::argumentValue("benchmark-output");
+
+        if (EngineArguments::hasArgument("benchmark-dt"))
+        {
+            double dt = atof(std::string(EngineArguments::argumentValue("benchmark-dt")).c_str());
+            if (dt > 0.0)
+                deltaTime = dt;
+            else
+                logWarn("Invalid benchmark delta time, using %.4f", deltaTime);
+        }
+
+        if (EngineArguments::hasArgument("camera-path"))
+            loadCameraPath(std::string(EngineArguments::argumentValue("camera-path")).c_str());
+
+        frames.reserve(frameCount);
+        logMsg("Benchmarking %s for %i frames (%i warmup) at %.4fs per frame", scene.c_str(), frameCount,
+               warmupLeft, deltaTime);
+    }
+
+    bool BenchmarkRunner::loadCameraPath(const char* path)
+    {
+        auto loadResult = LoadFileToString(path);
+        if (loadResult.error != IOError::None)
+        {
+            logErr("Failed to load camera path %s", path);
+            return false;
+        }
+
+        try
+        {
+            nlohmann::json j = nlohmann::json::parse(loadResult.value);
+            loopPath = j.value("loop", false);
+
+            for (const nlohmann::json& kf : j["keyframes"])
+            {
+                keyframes.push_back(
+                    {kf["time"].get<double>(), kf["position"].get<glm::vec3>(), kf["rotation"].get<glm::quat>()}
+                );
+            }
+        }
+        catch (nlohmann::detail::exception& ex)
+        {
+            logErr("Failed to parse camera path %s: %s", path, ex.what());
+            keyframes.clear();
+            return false;
+        }
+
+        std::sort(keyframes.begin(), keyframes.end(),
+                  [](const CameraKeyframe& a, const CameraKeyframe& b) { return a.time < b.time; });
+
+        return true;
+    }
+
+    void BenchmarkRunner::applyCamera(Camera& cam) const
+    {
+        if (keyframes.empty())
+            return;
+
+        double time = frames.size() * deltaTime;
+        double duration = keyframes.back().time - keyframes.front().time;
+
+        if (loopPath && duration > 0.0)
+            time = fmod(time, duration);
+        time += keyframes.front().time;
+
+        auto next = std::upper_bound(keyframes.begin(), keyframes.end(), time,
+                                     [](double t, const CameraKeyframe& kf) { return t < kf.time; });
+
+        if (next == keyframes.begin() || next == keyframes.end())
+        {
+            const CameraKeyframe& kf = next == keyframes.begin() ? keyframes.front() : keyframes.back();
+            cam.position = kf.position;
+            cam.rotation = kf.rotation;
+            return;
+        }
+
+        const CameraKeyframe& a = *(next - 1);
+        const CameraKeyframe& b = *next;
+        float t = (float)((time - a.time) / (b.time - a.time));
+
+        cam.position = glm::mix(a.position, b.position, t);
+        cam.rotation = glm::slerp(a.rotation, b.rotation, t);
+    }
+
+    void BenchmarkRunner::endFrame(const BenchmarkFrameTimes& times)
+    {
+        if (warmupLeft > 0)
+        {
+            warmupLeft--;
+            return;
+        }
+
+        if (!isFinished())
+            frames.push_back(times);
+    }
+
+    double percentile(const std::vector<double>& sorted, double p)
+    {
+        size_t idx = (size_t)(p * (sorted.size() - 1) + 0.5);
+        return sorted[std::min(idx, sorted.size() - 1)];
+    }
+
+    bool BenchmarkRunner::writeReport(bool headless) const
+    {
+        if (frames.empty())
+        {
+            logErr("No benchmark frames were recorded");
+            return false;
+        }
+
+        std::string csvPath = outputName + ".csv";
+        FILE* csv = fopen(csvPath.c_str(), "w");
+        if (csv == nullptr)
+        {
+            logErr("Failed to open %s for writing", csvPath.c_str());
+            return false;
+        }
+
+        fputs("index", csv);
+        for (const BenchmarkColumn& col : columns)
+            fprintf(csv, ",%s", col.name);
+        fputc('\n', csv);
+
+        for (size_t i = 0; i < frames.size(); i++)
+        {
+            fprintf(csv, "%zu", i);
+            for (const BenchmarkColumn& col : columns)
+                fprintf(csv, ",%.4f", frames[i].*col.member);
+            fputc('\n', csv);
+        }
+        fclose(csv);
+
+        nlohmann::json report{
+            {"scene", scene},
+            {"frames", frames.size()},
+            {"deltaTime", deltaTime},
+            {"headless", headless},
+        };
+
+        std::vector<double> values;
+        values.reserve(frames.size());
+
+        for (const BenchmarkColumn& col : columns)
+        {
+            values.clear();
+            double total = 0.0;
+            for (const BenchmarkFrameTimes& frame : frames)
+            {
+                values.push_back(frame.*col.member);
+                total += frame.*col.member;
+            }
+
+            std::sort(values.begin(), values.end());
+
+            report["timings"][col.name] = {
+                {"mean", total / values.size()},
+                {"min", values.front()},
+                {"p50", percentile(values, 0.5)},
+                {"p90", percentile(values, 0.9)},
+                {"p95", percentile(values, 0.95)},
+                {"p99", percentile(values, 0.99)},
+                {"max", values.back()},
+            };
+        }
+
+        std::string jsonPath = outputName + ".json";
+        FILE* jsonFile = fopen(jsonPath.c_str(), "w");
+        if (jsonFile == nullptr)
+        {
+            logErr("Failed to open %s for writing", jsonPath.c_str());
+            return false;
+        }
+
+        std::string serialized = report.dump(4);
+        fwrite(serialized.data(), 1, serialized.size(), jsonFile);
+        fclose(jsonFile);
+
+        const auto& frameStats = report["timings"]["frame"];
+        logMsg("Benchmark finished: %zu frames, mean %.3fms, p50 %.3fms, p99 %.3fms. Wrote %s and %s", frames.size(),
+               frameStats["mean"].get<double>(), frameStats["p50"].get<double>(), frameStats["p99"].get<double>(),
+               csvPath.c_str(), jsonPath.c_str());
+
+        return true;
+    }
+}
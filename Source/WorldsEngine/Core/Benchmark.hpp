@@ -0,0 +1,78 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <string>
+#include <vector>
+
+namespace worlds
+{
+    struct Camera;
+
+    // CPU time spent in each part of a frame, in milliseconds.
+    struct BenchmarkFrameTimes
+    {
+        double frame;
+        double update;
+        double sim;
+        double script;
+        double animation;
+        double audio;
+        double renderPrep;
+    };
+
+    // Runs a fixed number of frames with a fixed delta time and a scripted camera, then writes the
+    // per-frame timings and percentiles to <output>.csv and <output>.json.
+    // Arguments:
+    //   --benchmark <scene.escn>     scene to load
+    //   --frames <n>                 number of frames to record (default 1000)
+    //   --warmup <n>                 frames to run before recording (default 30)
+    //   --camera-path <path.json>    camera keyframes, see CameraPath
+    //   --benchmark-dt <seconds>     simulated time per frame (default 1/60)
+    //   --benchmark-output <name>    report file name without extension (default "benchmark")
+    class BenchmarkRunner
+    {
+      public:
+        // Keyframes are linearly interpolated. The file looks like:
+        // { "loop": false, "keyframes": [ { "time": 0.0, "position": [x, y, z], "rotation": [x, y, z, w] } ] }
+        struct CameraKeyframe
+        {
+            double time;
+            glm::vec3 position;
+            glm::quat rotation;
+        };
+
+        BenchmarkRunner();
+        const std::string& scenePath() const
+        {
+            return scene;
+        }
+        double frameDeltaTime() const
+        {
+            return deltaTime;
+        }
+        bool isRecording() const
+        {
+            return warmupLeft == 0;
+        }
+        bool isFinished() const
+        {
+            return (int)frames.size() >= frameCount;
+        }
+        // Moves the camera to where the path says it should be this frame.
+        void applyCamera(Camera& cam) const;
+        void endFrame(const BenchmarkFrameTimes& times);
+        bool writeReport(bool headless) const;
+
+      private:
+        bool loadCameraPath(const char* path);
+
+        std::string scene;
+        std::string outputName;
+        int frameCount;
+        int warmupLeft;
+        double deltaTime;
+        bool loopPath = false;
+        std::vector<CameraKeyframe> keyframes;
+        std::vector<BenchmarkFrameTimes> frames;
+    };
+}
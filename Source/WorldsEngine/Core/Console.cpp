@@ -13,10 +13,12 @@
 #include <windows.h>
 #include "Fatal.hpp"
 #include "Log.hpp"
+#include "LogQueue.hpp"
 #include <deque>
 #include <mutex>
 #include <queue>
 #include <thread>
+#include <Tracy.hpp>
 
 namespace worlds
 {
@@ -165,10 +167,16 @@ namespace worlds
     bool enableVT100 = true;
 
     Console::Console(bool openConsoleWindow, bool asyncStdinConsole)
-        : show(false), setKeyboardFocus(false), asyncConsoleThread(nullptr), asyncCommandReady(false)
+        : show(false), setKeyboardFocus(false), jsonLogFile(nullptr), asyncConsoleThread(nullptr),
+          asyncCommandReady(false)
     {
         g_console = this;
         logFile = fopen("worldsengine.log", "w");
+
+        if (EngineArguments::hasArgument("log-json"))
+            jsonLogFile = fopen("worldsengine.log.jsonl", "w");
+
+        logQueue = new LogQueue([this](const LogEntry* entries, size_t count) { writeLogBatch(entries, count); });
         SDL_LogSetOutputFunction(logCallback, this);
         registerCommand(std::bind(&Console::cmdHelp, this, std::placeholders::_1), "help", "Displays help about all commands.");
         registerCommand(std::bind(&Console::cmdExec, this, std::placeholders::_1), "exec", "Executes a command file.");
@@ -442,14 +450,21 @@ namespace worlds
 
     std::deque<PopupMessage> popupMessages;
 
-    void Console::drawWindow()
+    void Console::processAsyncCommands()
     {
         if (asyncCommandReady)
         {
             executeCommandStr(asyncCommand);
             asyncCommandReady = false;
         }
+    }
 
+    void Console::drawWindow()
+    {
+        processAsyncCommands();
+
+        // Popups are added from the log writer thread
+        consoleMutex.lock();
         float popupMessageY = ImGui::GetTextLineHeight();
         ImDrawList* popupDrawlist = ImGui::GetForegroundDrawList();
         for (PopupMessage& pm : popupMessages)
@@ -462,6 +477,7 @@ namespace worlds
         popupMessages.erase(std::remove_if(popupMessages.begin(), popupMessages.end(),
                                            [](PopupMessage& pm) { return pm.shownFor > 5.0f; }),
                             popupMessages.end());
+        consoleMutex.unlock();
 
         if (ImGui::GetIO().KeysDownDuration[SDL_SCANCODE_GRAVE] == 0.0f)
         {
@@ -762,68 +778,178 @@ namespace worlds
         }
     }
 
-    std::string getDateTimeString()
+    std::string formatTime(std::chrono::system_clock::time_point time)
     {
-        auto dt = std::chrono::system_clock::now();
-        std::time_t dt2 = std::chrono::system_clock::to_time_t(dt);
+        std::time_t dt2 = std::chrono::system_clock::to_time_t(time);
         char ts[64];
         strftime(ts, 64, "%H:%M:%S", localtime(&dt2));
         return std::string(ts);
     }
 
+    std::string getDateTimeString()
+    {
+        return formatTime(std::chrono::system_clock::now());
+    }
+
+    void appendJsonString(std::string& out, const char* str)
+    {
+        out += '"';
+        for (const char* c = str; *c; c++)
+        {
+            switch (*c)
+            {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if ((unsigned char)*c < 0x20)
+                {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", *c);
+                    out += escaped;
+                }
+                else
+                {
+                    out += *c;
+                }
+            }
+        }
+        out += '"';
+    }
+
+    // Called from whichever thread logged the message, so all this does is queue it up.
     void Console::logCallback(void* conVP, int category, SDL_LogPriority priority, const char* msg)
     {
         Console* con = (Console*)conVP;
-        std::string outStr = "[" + getDateTimeString() + "]" + "[" + categories.at(category) + "]" + "[" +
-                             priorities.at(priority) + "] " + msg;
 
-        auto col = priorityColors.at(priority);
-        int r = (int)(col.Value.x * 255);
-        int g = (int)(col.Value.y * 255);
-        int b = (int)(col.Value.z * 255);
+        // Only happens while the console is being torn down
+        if (con->logQueue == nullptr)
+        {
+            fprintf(stderr, "%s\n", msg);
+            return;
+        }
+
+        con->logQueue->push(category, priority, msg);
+    }
 
-        if (1)
+    // Called on the log writer thread, or on the thread flushing the logs.
+    void Console::writeLogBatch(const LogEntry* entries, size_t count)
+    {
+        ZoneScoped;
+        std::string fileOut;
+        std::string stdOut;
+        std::string jsonOut;
+
+        for (size_t i = 0; i < count; i++)
         {
-            if (enableVT100)
+            const LogEntry& entry = entries[i];
+            std::string outStr = "[" + formatTime(entry.time) + "]" + "[" + categories.at(entry.category) + "]" + "[" +
+                                 priorities.at(entry.priority) + "] " + entry.msg;
+
+            fileOut += outStr;
+            fileOut += '\n';
+
+            if (logToStdout.getInt())
             {
-                const char* clearLineCode = "\033[2K";
+                if (enableVT100)
+                {
+                    auto col = priorityColors.at(entry.priority);
+                    int r = (int)(col.Value.x * 255);
+                    int g = (int)(col.Value.y * 255);
+                    int b = (int)(col.Value.z * 255);
+
+                    stdOut += "\r\033[2K\033[38;2;" + std::to_string(r) + ";" + std::to_string(g) + ";" +
+                              std::to_string(b) + "m" + outStr + "\n";
+                }
+                else
+                {
+                    stdOut += outStr + "\n";
+                }
+            }
 
-                std::cout << "\r" << clearLineCode << "\033[38;2;" << r << ";" << g << ";" << b << "m" << outStr
-                          << "\n";
+            if (jsonLogFile)
+            {
+                auto micros =
+                    std::chrono::duration_cast<std::chrono::microseconds>(entry.time.time_since_epoch()).count();
+                jsonOut += "{\"time\":" + std::to_string(micros) + ",\"thread\":" + std::to_string(entry.threadId) +
+                           ",\"category\":";
+                appendJsonString(jsonOut, categories.at(entry.category));
+                jsonOut += ",\"priority\":";
+                appendJsonString(jsonOut, priorities.at(entry.priority));
+                jsonOut += ",\"msg\":";
+                appendJsonString(jsonOut, entry.msg);
+                jsonOut += "}\n";
+            }
+        }
 
-                if (g_console->asyncConsoleThread)
+        if (!stdOut.empty())
+        {
+            std::cout << stdOut;
+            if (enableVT100)
+            {
+                if (asyncConsoleThread)
                     std::cout << "\033[32mworlds> \033[0m";
                 else
                     std::cout << "\033[0m";
-                std::cout.flush();
-            }
-            else
-            {
-                std::cout << outStr << "\n";
             }
+            std::cout.flush();
+        }
+
+        if (logFile)
+        {
+            fwrite(fileOut.data(), 1, fileOut.size(), logFile);
+            fflush(logFile);
         }
 
-        // Use std::endl for the file to force a flush
-        if (con->logFile)
+        if (jsonLogFile)
         {
-            fprintf(con->logFile, "%s\n", outStr.c_str());
-            fflush(con->logFile);
+            fwrite(jsonOut.data(), 1, jsonOut.size(), jsonLogFile);
+            fflush(jsonLogFile);
         }
 
         consoleMutex.lock();
-        con->msgs.push_back(ConsoleMsg{priority, msg, category, getDateTimeString()});
-        if (popupConsoleMessages.getInt())
-            popupMessages.push_front(PopupMessage{msg, priority, 0.0f});
+        for (size_t i = 0; i < count; i++)
+        {
+            const LogEntry& entry = entries[i];
+            msgs.push_back(ConsoleMsg{entry.priority, entry.msg, entry.category, formatTime(entry.time)});
+            if (popupConsoleMessages.getInt())
+                popupMessages.push_front(PopupMessage{entry.msg, entry.priority, 0.0f});
+        }
         consoleMutex.unlock();
     }
 
+    void flushLogs()
+    {
+        if (g_console && g_console->logQueue)
+            g_console->logQueue->flush();
+    }
+
     Console::~Console()
     {
+        // Writes out anything still queued
+        delete logQueue;
+        logQueue = nullptr;
+
         if (logFile)
         {
             fprintf(logFile, "[%s] Closing log file. \n", getDateTimeString().c_str());
             fclose(logFile);
         }
+
+        if (jsonLogFile)
+            fclose(jsonLogFile);
         g_console = nullptr;
         returnToPrimary();
 
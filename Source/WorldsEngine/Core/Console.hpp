@@ -15,6 +15,8 @@ struct ImGuiInputTextCallbackData;
 namespace worlds
 {
     class Console;
+    class LogQueue;
+    struct LogEntry;
     extern Console* g_console;
 
     typedef std::function<void(const char* argString)> CommandFuncPtr;
@@ -25,6 +27,8 @@ namespace worlds
         Console(bool openConsoleWindow, bool asyncStdinConsole = false);
         void registerCommand(CommandFuncPtr funcPtr, const char* name, const char* help);
         void drawWindow();
+        // Runs commands typed into the console window. drawWindow does this too.
+        void processAsyncCommands();
         void setShowState(bool show);
         void executeCommandStr(std::string cmdStr, bool log = true);
         ConVar* getConVar(const char* name)
@@ -59,6 +63,8 @@ namespace worlds
         std::unordered_map<std::string, ConVar*> conVars;
         std::unordered_map<std::string, Command> commands;
         FILE* logFile;
+        FILE* jsonLogFile;
+        LogQueue* logQueue;
         std::thread* asyncConsoleThread;
         bool asyncCommandReady;
         std::string asyncCommand;
@@ -67,9 +73,11 @@ namespace worlds
 
         static int inputTextCallback(ImGuiInputTextCallbackData* data);
         static void logCallback(void* con, int category, SDL_LogPriority priority, const char* msg);
+        void writeLogBatch(const LogEntry* entries, size_t count);
         void cmdHelp(const char* argString);
         void cmdExec(const char* argString);
         friend class ConVar;
         friend void asyncConsole();
+        friend void flushLogs();
     };
 }
@@ -1,6 +1,10 @@
+#include <Core/AllocTracking.hpp>
 #include <Core/EngineInternal.hpp>
 #include <Core/Console.hpp>
+#include <Core/Profiler.hpp>
+#include <Audio/Audio.hpp>
 #include <Util/CircularBuffer.hpp>
+#include <Util/FrameArena.hpp>
 #include <Libs/IconsFontAwesome5.h>
 #include <Render/Render.hpp>
 #include <Physics/Physics.hpp>
@@ -10,6 +14,69 @@ namespace worlds
 {
     ConVar showDebugInfo{"showDebugInfo", "0", "Shows the debug info window"};
 
+    ImU32 profileScopeColor(const char* name)
+    {
+        // Scope names are string literals, so the pointer keeps each scope's colour stable
+        uint32_t hash = (uint32_t)(((uintptr_t)name * 2654435761u) >> 4);
+        float r, g, b;
+        ImGui::ColorConvertHSVtoRGB((hash % 360) / 360.0f, 0.5f, 0.85f, r, g, b);
+        return ImColor(r, g, b);
+    }
+
+    void drawProfilerTimeline(const ProfiledFrame& frame, float zoom)
+    {
+        const float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+
+        ImGui::BeginChild("profilerTimeline", ImVec2(0.0f, 300.0f), true, ImGuiWindowFlags_HorizontalScrollbar);
+        float width = ImGui::GetContentRegionAvail().x * zoom;
+        double pixelsPerNs = width / (double)(frame.end - frame.start);
+        ImDrawList* drawList = ImGui::GetWindowDrawList();
+
+        for (size_t i = 0; i < frame.threads.size(); i++)
+        {
+            const ProfiledThread& thread = frame.threads[i];
+            if (thread.events.empty())
+                continue;
+
+            ImGui::TextUnformatted(Profiler::threadName((uint32_t)i));
+            if (thread.droppedEvents > 0)
+            {
+                ImGui::SameLine();
+                ImGui::TextColored(ImVec4(1.0f, 0.5f, 0.0f, 1.0f), "(%u dropped)", thread.droppedEvents);
+            }
+
+            ImVec2 origin = ImGui::GetCursorScreenPos();
+            uint32_t maxDepth = 0;
+
+            for (const ProfileEvent& evt : thread.events)
+            {
+                maxDepth = glm::max(maxDepth, evt.depth);
+
+                // Scopes on worker threads can start before the frame did
+                uint64_t start = glm::max(evt.start, frame.start);
+                uint64_t end = glm::min(evt.end, frame.end);
+
+                float x0 = origin.x + (float)((start - frame.start) * pixelsPerNs);
+                float x1 = glm::max(origin.x + (float)((end - frame.start) * pixelsPerNs), x0 + 1.0f);
+                float y0 = origin.y + evt.depth * rowHeight;
+                ImVec2 min{x0, y0};
+                ImVec2 max{x1, y0 + rowHeight - 1.0f};
+
+                drawList->AddRectFilled(min, max, profileScopeColor(evt.name));
+
+                if (x1 - x0 > ImGui::CalcTextSize(evt.name).x + 4.0f)
+                    drawList->AddText(ImVec2(x0 + 2.0f, y0 + 2.0f), ImColor(0.0f, 0.0f, 0.0f), evt.name);
+
+                if (ImGui::IsMouseHoveringRect(min, max))
+                    ImGui::SetTooltip("%s: %.3fms", evt.name, (evt.end - evt.start) / 1000000.0);
+            }
+
+            ImGui::Dummy(ImVec2(width, (maxDepth + 1) * rowHeight));
+        }
+
+        ImGui::EndChild();
+    }
+
     void drawDebugInfoWindow(const EngineInterfaces& engineInterfaces, DebugTimeInfo timeInfo)
     {
         Renderer* renderer = engineInterfaces.renderer;
@@ -87,6 +154,53 @@ namespace worlds
                     ImGui::Text("Framerate: %.1ffps", 1.0 / timeInfo.deltaTime);
                 }
 
+                if (ImGui::CollapsingHeader(ICON_FA_STOPWATCH u8" Profiler"))
+                {
+                    static int selectedAge = 0;
+                    static float zoom = 1.0f;
+                    int frameCount = Profiler::frameCount();
+
+                    bool paused = Profiler::isPaused();
+                    if (ImGui::Checkbox("Pause", &paused))
+                        Profiler::setPaused(paused);
+
+                    ImGui::SameLine();
+                    if (ImGui::Button("Slowest frame"))
+                    {
+                        selectedAge = 0;
+                        for (int i = 0; i < frameCount; i++)
+                        {
+                            if (Profiler::frame(i).durationMs() > Profiler::frame(selectedAge).durationMs())
+                                selectedAge = i;
+                        }
+                        Profiler::setPaused(true);
+                    }
+
+                    ImGui::SameLine();
+                    if (ImGui::Button("Dump"))
+                        Profiler::dumpFrames("profile.json", Profiler::HistoryLength);
+
+                    if (frameCount > 0)
+                    {
+                        static float durations[Profiler::HistoryLength];
+                        for (int i = 0; i < frameCount; i++)
+                        {
+                            durations[i] = (float)Profiler::frame(frameCount - 1 - i).durationMs();
+                        }
+
+                        ImGui::PlotHistogram("##frameTimes", durations, frameCount, 0, nullptr, 0.0f, FLT_MAX,
+                                             ImVec2(0.0f, 60.0f));
+
+                        selectedAge = glm::clamp(selectedAge, 0, frameCount - 1);
+                        ImGui::SliderInt("Frames ago", &selectedAge, 0, frameCount - 1);
+                        ImGui::SliderFloat("Zoom", &zoom, 1.0f, 50.0f, "%.1fx", ImGuiSliderFlags_Logarithmic);
+
+                        const ProfiledFrame& frame = Profiler::frame(selectedAge);
+                        ImGui::Text("Frame %llu: %.3fms", (unsigned long long)frame.frameIndex, frame.durationMs());
+                        drawProfilerTimeline(frame, zoom);
+                    }
+                }
+
                 if (ImGui::CollapsingHeader(ICON_FA_BARS u8" Misc"))
                 {
                     Camera& cam = *engineInterfaces.mainCamera;
@@ -119,6 +233,7 @@ namespace worlds
                     );
 
                     ImGui::Text("Draw calls: %i", dbgStats.numDrawCalls);
+                    ImGui::Text("Shadow draw calls: %i", dbgStats.numShadowDrawCalls);
                     ImGui::Text("%i pipeline switches", dbgStats.numPipelineSwitches);
                     ImGui::Text("Frustum culled objects: %i", dbgStats.numCulledObjs);
                     ImGui::Text("Active RTT passes: %i/%i", dbgStats.numActiveRTTPasses, dbgStats.numRTTPasses);
@@ -153,14 +268,63 @@ namespace worlds
                     ImGui::Text("%i materials loaded", dbgStats.numMaterialsLoaded);
                 }
 
+                AudioSystem* audioSystem = AudioSystem::getInstance();
+                if (audioSystem && ImGui::CollapsingHeader(ICON_FA_VOLUME_UP u8" Audio Stats"))
+                {
+                    const AudioDebugStats& audioStats = audioSystem->getDebugStats();
+                    ImGui::Text("3D attribute updates: %i", audioStats.attributeUpdates);
+                    ImGui::Text("Playing sources: %i", audioStats.playingSources);
+                    ImGui::Text("Culled by distance: %i", audioStats.virtualSources);
+                    ImGui::Text("Stopped by distance: %i", audioStats.distanceStops);
+                    ImGui::Text("Voices active: %i (%i real)", audioStats.activeVoices, audioStats.realVoices);
+                }
+
                 if (ImGui::CollapsingHeader(ICON_FA_MEMORY u8" Memory Stats"))
                 {
 #ifdef CHECK_NEW_DELETE
                     ImGui::Text("CPU:");
-                    ImGui::Text("Live allocations: %lu", liveAllocations);
-                    ImGui::Text("Allocated bytes: %lu", allocatedMem);
+
+                    static float allocHistory[AllocTracker::HistoryLength];
+                    AllocTracker::allocationHistory(allocHistory);
+                    ImGui::PlotLines("Allocations/frame", allocHistory, AllocTracker::HistoryLength);
+
+                    if (ImGui::BeginTable("allocTags", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+                    {
+                        ImGui::TableSetupColumn("Tag");
+                        ImGui::TableSetupColumn("Live");
+                        ImGui::TableSetupColumn("Live KiB");
+                        ImGui::TableSetupColumn("Frame");
+                        ImGui::TableSetupColumn("Frame KiB");
+                        ImGui::TableHeadersRow();
+
+                        for (int i = 0; i < (int)AllocTag::Count; i++)
+                        {
+                            AllocTagStats live = AllocTracker::live((AllocTag)i);
+                            AllocTagStats frame = AllocTracker::lastFrame((AllocTag)i);
+
+                            ImGui::TableNextRow();
+                            ImGui::TableNextColumn();
+                            ImGui::TextUnformatted(AllocTracker::tagName((AllocTag)i));
+                            ImGui::TableNextColumn();
+                            ImGui::Text("%llu", (unsigned long long)live.allocations);
+                            ImGui::TableNextColumn();
+                            ImGui::Text("%.1f", live.bytes / 1024.0);
+                            ImGui::TableNextColumn();
+                            ImGui::Text("%llu", (unsigned long long)frame.allocations);
+                            ImGui::TableNextColumn();
+                            ImGui::Text("%.1f", frame.bytes / 1024.0);
+                        }
+
+                        ImGui::EndTable();
+                    }
+
+                    if (ImGui::Button("Export"))
+                        AllocTracker::exportStats("allocstats.json");
+
                     ImGui::Separator();
 #endif
+                    ImGui::Text("Frame arena (main thread): %.1f KiB", FrameArena::usedThisFrame() / 1024.0);
+                    ImGui::Separator();
                     ImGui::Text("GPU:");
                 }
 
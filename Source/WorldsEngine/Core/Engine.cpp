@@ -1,5 +1,8 @@
 ﻿#include "Engine.hpp"
+#include <Animation/AnimationSystem.hpp>
 #include <Audio/Audio.hpp>
+#include <Core/AllocTracking.hpp>
+#include <Core/Benchmark.hpp>
 #include <Core/Console.hpp>
 #include <Core/EarlySDLUtil.hpp>
 #include <Core/Fatal.hpp>
@@ -8,16 +11,19 @@
 #include <Core/Log.hpp>
 #include <Core/MaterialManager.hpp>
 #include <Core/NameComponent.hpp>
+#include <Core/Profiler.hpp>
 #ifdef __linux__
 #include <Core/SplashScreenImpls/SplashScreenX11.hpp>
 #else
 #include <Core/SplashScreenImpls/SplashScreenWin32.hpp>
 #endif
+#include <Core/TaskGraph.hpp>
 #include <Core/TaskScheduler.hpp>
 #include <Core/Transform.hpp>
 #include <Core/Window.hpp>
 #include <ComponentMeta/ComponentMetadata.hpp>
 #include <Editor/Editor.hpp>
+#include <algorithm>
 #include <entt/entt.hpp>
 #include <ImGui/imgui.h>
 #include <ImGui/imgui_freetype.h>
@@ -27,9 +33,11 @@
 #include <Input/Input.hpp>
 #include <Libs/IconsFontAwesome5.h>
 #include <Libs/IconsFontaudio.h>
+#include <Navigation/Navigation.hpp>
 #include <physfs.h>
 #include <Physics/Physics.hpp>
 #include <Physics/PhysicsActor.hpp>
+#include <Render/LightClusters.hpp>
 #include <Render/Render.hpp>
 #include <Render/RenderInternal.hpp>
 #include <SDL.h>
@@ -37,6 +45,7 @@
 #include <Serialization/SceneSerialization.hpp>
 #include <Tracy.hpp>
 #include <Util/CreateModelObject.hpp>
+#include <Util/FrameArena.hpp>
 #include <Util/TimingUtil.hpp>
 #include <VR/OpenXRInterface.hpp>
 #include <filesystem>
@@ -49,41 +58,6 @@
 #define EDITORONLY(expr)
 #endif
 
-#ifdef CHECK_NEW_DELETE
-robin_hood::unordered_map<void*, size_t> allocatedPtrs;
-size_t allocatedMem = 0;
-size_t liveAllocations = 0;
-
-void* operator new(size_t count)
-{
-    void* ptr = malloc(count);
-#ifdef TRACY_ENABLE
-    TracyAlloc(ptr, count);
-#endif
-    allocatedPtrs.insert({ptr, count});
-    allocatedMem += count;
-    liveAllocations++;
-    return ptr;
-}
-
-void operator delete(void* ptr) noexcept
-{
-    if (ptr == nullptr)
-        return;
-    if (!allocatedPtrs.contains(ptr))
-    {
-        fatalErr("Deleted non-existent pointer!");
-    }
-#ifdef TRACY_ENABLE
-    TracyFree(ptr);
-#endif
-    free(ptr);
-    allocatedMem -= allocatedPtrs[ptr];
-    allocatedPtrs.erase(ptr);
-    liveAllocations--;
-}
-#endif
-
 namespace worlds
 {
     glm::ivec2 windowSize;
@@ -214,6 +188,14 @@ namespace worlds
         enki::TaskSchedulerConfig tsc{};
         tsc.numTaskThreadsToCreate =
             workerThreadOverride == -1 ? enki::GetNumHardwareThreads() - 1 : workerThreadOverride;
+        tsc.profilerCallbacks.threadStart = [](uint32_t threadNum)
+        {
+            char name[32];
+            snprintf(name, sizeof(name), "Worker %u", threadNum);
+            Profiler::setThreadName(name);
+        };
+
+        Profiler::setThreadName("Main");
 
         g_taskSched.Initialize(tsc);
 
@@ -364,8 +346,9 @@ namespace worlds
         cam.position = glm::vec3(0.0f, 0.0f, -1.0f);
         interfaces.mainCamera = &cam;
 
-        inputManager = new InputManager(window->getWrappedHandle());
-        window->bindInputManager(inputManager.Get());
+        inputManager = new InputManager(window ? window->getWrappedHandle() : nullptr);
+        if (window)
+            window->bindInputManager(inputManager.Get());
         interfaces.inputManager = inputManager.Get();
 
         scriptEngine = new DotNetScriptEngine(registry, interfaces);
@@ -374,6 +357,10 @@ namespace worlds
         physicsSystem = new PhysicsSystem(interfaces, registry);
         interfaces.physics = physicsSystem.Get();
 
+        NavigationSystem::initialize(registry);
+        AnimationSystem::initialize();
+        registerLightClusterCommands();
+
         simLoop = new SimulationLoop(interfaces, evtHandler, registry);
 
         ComponentMetadataManager::setupLookup(&interfaces);
@@ -419,6 +406,20 @@ namespace worlds
             "Loads a scene."
         );
 
+        console->registerCommand(
+            [&](const char* arg)
+            {
+                if (!PHYSFS_exists(arg))
+                {
+                    logErr(WELogCategoryEngine, "Couldn't find scene %s.", arg);
+                    return;
+                }
+                loadSceneAsync(AssetDB::pathToId(arg));
+            },
+            "scene_async",
+            "Loads a scene in the background."
+        );
+
         console->registerCommand(
             [&](const char* arg)
             {
@@ -432,6 +433,16 @@ namespace worlds
             "Looks up an asset ID."
         );
 
+        console->registerCommand(
+            [&](const char* arg)
+            {
+                int iterations = arg[0] ? std::atoi(arg) : 10;
+                SceneLoader::benchmarkFormats(registry, iterations);
+            },
+            "scene_benchmarkFormats",
+            "Times saving and loading the current scene in each scene format. Argument is the iteration count."
+        );
+
         console->registerCommand(
             [&](const char* arg) { timeScale = atof(arg); }, "setTimeScale", "Sets the current time scale."
         );
@@ -466,6 +477,19 @@ namespace worlds
             );
         }
 
+        console->registerCommand(
+            [&](const char* arg) { AllocTracker::exportStats(arg[0] ? arg : "allocstats.json"); },
+            "mem_exportAllocStats",
+            "Writes allocation stats and sampled call sites to a JSON file. Argument is the path."
+        );
+
+        console->registerCommand(
+            [&](const char* arg)
+            { Profiler::dumpFrames(arg[0] ? arg : "profile.json", Profiler::HistoryLength); },
+            "profiler_dump",
+            "Writes the profiler's frame history as a Chrome trace. Argument is the path."
+        );
+
         console->registerCommand([&](const char*) { running = false; }, "exit", "Shuts down the engine.");
 
         console->registerCommand(
@@ -537,22 +561,131 @@ namespace worlds
             io.IniFilename = nullptr;
         }
 
+        if (EngineArguments::hasArgument("benchmark"))
+        {
+            benchmark = new BenchmarkRunner();
+
+            if (!PHYSFS_exists(benchmark->scenePath().c_str()))
+            {
+                logErr(WELogCategoryEngine, "Couldn't find benchmark scene %s", benchmark->scenePath().c_str());
+                running = false;
+            }
+            else
+            {
+                loadScene(AssetDB::pathToId(benchmark->scenePath()));
+            }
+        }
+
+        buildFrameGraph();
+
         SDL_EventState(SDL_DROPFILE, SDL_ENABLE);
         logMsg("Engine startup took about %.3fms", startupTimer.stopGetMs());
     }
 
+    // Tick times on a dedicated server, logged as percentiles every server_statsInterval seconds
+    struct ServerTickStats
+    {
+        std::vector<float> tickTimes;
+        std::vector<float> lateness;
+        int overruns = 0;
+
+        void addTick(double tickMs, double lateMs)
+        {
+            tickTimes.push_back((float)tickMs);
+            lateness.push_back((float)glm::max(lateMs, 0.0));
+        }
+
+        static float percentile(const std::vector<float>& sorted, float p)
+        {
+            return sorted[(size_t)(p * (sorted.size() - 1) + 0.5f)];
+        }
+
+        void report()
+        {
+            if (tickTimes.empty())
+                return;
+
+            std::sort(tickTimes.begin(), tickTimes.end());
+            std::sort(lateness.begin(), lateness.end());
+
+            logMsg("%zu server ticks: p50 %.3fms, p95 %.3fms, p99 %.3fms, max %.3fms. Wake up lateness p99 %.3fms. "
+                   "%i overruns",
+                   tickTimes.size(), percentile(tickTimes, 0.5f), percentile(tickTimes, 0.95f),
+                   percentile(tickTimes, 0.99f), tickTimes.back(), percentile(lateness, 0.99f), overruns);
+
+            tickTimes.clear();
+            lateness.clear();
+            overruns = 0;
+        }
+    };
+
     void WorldsEngine::run()
     {
         interFrameInfo.frameCounter = 0;
         interFrameInfo.lastPerfCounter = SDL_GetPerformanceCounter();
         interFrameInfo.lastUpdateTime = 0.0;
 
+        if (headless && !benchmark)
+        {
+            runServer();
+            return;
+        }
+
         while (running)
         {
             runSingleFrame(true);
         }
     }
 
+    void WorldsEngine::runServer()
+    {
+        static ConVar spinTime{
+            "server_spinMs", "1.5", "How long before each tick to stop sleeping and spin, to absorb OS sleep jitter."
+        };
+        static ConVar statsInterval{
+            "server_statsInterval", "30", "Seconds between tick time reports on a dedicated server. 0 disables them."
+        };
+
+        ConVar* stepTime = g_console->getConVar("sim_stepTime");
+        ServerTickStats stats;
+
+        auto nextTick = TimingUtil::now();
+        auto lastReport = nextTick;
+
+        while (running)
+        {
+            auto tickStart = TimingUtil::now();
+            runSingleFrame(false);
+            auto tickEnd = TimingUtil::now();
+
+            stats.addTick(TimingUtil::toMs(tickEnd - tickStart), TimingUtil::toMs(tickStart - nextTick));
+
+            nextTick += std::chrono::nanoseconds((int64_t)(stepTime->getFloat() * 1e9));
+
+            // Don't try to catch up after a slow tick with a burst of back to back ones,
+            // the simulation accumulator already makes up for the lost time.
+            if (tickEnd > nextTick)
+            {
+                nextTick = tickEnd;
+                stats.overruns++;
+            }
+            else
+            {
+                auto spin = std::chrono::nanoseconds((int64_t)(spinTime.getFloat() * 1e6));
+                TimingUtil::waitUntil(nextTick, spin);
+            }
+
+            float interval = statsInterval.getFloat();
+            if (interval > 0.0f && TimingUtil::toMs(tickEnd - lastReport) > interval * 1000.0f)
+            {
+                stats.report();
+                lastReport = tickEnd;
+            }
+        }
+
+        stats.report();
+    }
+
     void drawFPSCounter(float deltaTime)
     {
         auto drawList = ImGui::GetForegroundDrawList();
@@ -584,14 +717,24 @@ namespace worlds
         uint64_t deltaTicks = now - interFrameInfo.lastPerfCounter;
         interFrameInfo.lastPerfCounter = now;
         interFrameInfo.deltaTime = deltaTicks / (double)SDL_GetPerformanceFrequency();
+
+        // Benchmarks advance by a fixed amount every frame so runs are comparable between machines.
+        // Frames are only recorded once the scene has finished loading.
+        bool benchmarkFrame = benchmark && !sceneLoadQueued && !asyncSceneLoad;
+        if (benchmark)
+            interFrameInfo.deltaTime = benchmark->frameDeltaTime();
+
         gameTime += interFrameInfo.deltaTime;
 
         uint64_t updateStart = SDL_GetPerformanceCounter();
 
-        if (processEvents)
-            window->processEvents();
-        if (window->shouldQuit())
-            running = false;
+        if (!headless)
+        {
+            if (processEvents)
+                window->processEvents();
+            if (window->shouldQuit())
+                running = false;
+        }
 
         if (vrInterface)
         {
@@ -599,17 +742,16 @@ namespace worlds
             vrInterface->beginFrame();
         }
 
+        inFrame = true;
+
+        // Dedicated servers have no UI or input to deal with
         if (!headless)
         {
             ImGui_ImplSDL2_NewFrame(window->getWrappedHandle());
+            ImGui::NewFrame();
+            inputManager->update();
         }
 
-        inFrame = true;
-
-        ImGui::NewFrame();
-
-        inputManager->update();
-
         if (vrInterface)
             vrInterface->updateEvents();
 
@@ -618,15 +760,21 @@ namespace worlds
 
         float interpAlpha = 1.0f;
 
-        if (!runAsEditor EDITORONLY(|| editor->isPlaying()))
+        // Don't run the game on a half-loaded scene
+        bool sceneMerging = asyncSceneLoad && asyncSceneLoad->isMerging();
+
+        NavigationSystem::collectPathResults();
+
+        if (!runAsEditor EDITORONLY(|| editor->isPlaying()) && !sceneMerging)
         {
             evtHandler->preSimUpdate(registry, interFrameInfo.deltaTime);
         }
 
         double simTime = 0.0;
         bool didSimRun = false;
-        if (!pauseSim)
+        if (!pauseSim && !sceneMerging)
         {
+            ProfileScopedN("Simulation");
             PerfTimer perfTimer;
             bool physicsOnly = false EDITORONLY(|| (editor && !editor->isPlaying()));
             didSimRun = simLoop->updateSimulation(interpAlpha, timeScale, interFrameInfo.deltaTime,
@@ -634,10 +782,14 @@ namespace worlds
             simTime = perfTimer.stopGetMs();
         }
 
-        if (!runAsEditor EDITORONLY(|| editor->isPlaying()))
+        double scriptTime = 0.0;
+        if (!runAsEditor EDITORONLY(|| editor->isPlaying()) && !sceneMerging)
         {
+            ProfileScopedN("Game update");
+            PerfTimer scriptTimer;
             evtHandler->update(registry, interFrameInfo.deltaTime * timeScale, interpAlpha);
             scriptEngine->onUpdate(interFrameInfo.deltaTime * timeScale, interpAlpha);
+            scriptTime = scriptTimer.stopGetMs();
         }
 
         if (!headless)
@@ -649,21 +801,21 @@ namespace worlds
             {
                 EDITORONLY(editor->update((float)interFrameInfo.deltaTime));
             }
-        }
 
-        if (inputManager->keyPressed(SDL_SCANCODE_RCTRL, true))
-        {
-            inputManager->lockMouse(!inputManager->mouseLockState());
-        }
+            if (inputManager->keyPressed(SDL_SCANCODE_RCTRL, true))
+            {
+                inputManager->lockMouse(!inputManager->mouseLockState());
+            }
 
-        if (inputManager->keyPressed(SDL_SCANCODE_F3, true))
-        {
-            renderer->reloadShaders();
-        }
+            if (inputManager->keyPressed(SDL_SCANCODE_F3, true))
+            {
+                renderer->reloadShaders();
+            }
 
-        if (inputManager->keyPressed(SDL_SCANCODE_F11, true))
-        {
-            window->setFullscreen(!window->isFullscreen());
+            if (inputManager->keyPressed(SDL_SCANCODE_F11, true))
+            {
+                window->setFullscreen(!window->isFullscreen());
+            }
         }
 
         uint64_t updateEnd = SDL_GetPerformanceCounter();
@@ -681,12 +833,15 @@ namespace worlds
             .frameCounter = interFrameInfo.frameCounter,
         };
 
-        drawDebugInfoWindow(interfaces, dti);
-
-        static ConVar drawFPS{"drawFPS", "0", "Draws a simple FPS counter in the corner of the screen."};
-        if (drawFPS.getInt())
+        if (!headless)
         {
-            drawFPSCounter(dti.deltaTime);
+            drawDebugInfoWindow(interfaces, dti);
+
+            static ConVar drawFPS{"drawFPS", "0", "Draws a simple FPS counter in the corner of the screen."};
+            if (drawFPS.getInt())
+            {
+                drawFPSCounter(dti.deltaTime);
+            }
         }
 
         if (glm::any(glm::isnan(cam.position)))
@@ -695,46 +850,65 @@ namespace worlds
             logWarn("cam.position was NaN!");
         }
 
-        if (!headless)
-        {
-            glm::vec3 alPos = cam.position;
-            glm::quat alRot = cam.rotation;
+        if (benchmark)
+            benchmark->applyCamera(cam);
 
-            auto view = registry.view<AudioListenerOverride>();
-            if (!view.empty())
-            {
-                auto overrideEnt = view.front();
-                auto overrideT = registry.get<Transform>(overrideEnt);
-                alPos = overrideT.position;
-                alRot = overrideT.rotation;
-            }
-            audioSystem->update(registry, alPos, alRot, interFrameInfo.deltaTime);
+        if (headless)
+            console->processAsyncCommands();
+        else
+            console->drawWindow();
+
+        bool gameRunning = !pauseSim && (!runAsEditor EDITORONLY(|| editor->isPlaying()));
+        frameSteps.updateWorld = !sceneMerging;
+        frameSteps.worldDeltaTime = gameRunning ? interFrameInfo.deltaTime * timeScale : 0.0f;
+        frameSteps.deltaTime = interFrameInfo.deltaTime;
+        frameSteps.listenerPos = cam.position;
+        frameSteps.listenerRot = cam.rotation;
+        frameSteps.animationTime = 0.0;
+        frameSteps.audioTime = 0.0;
+
+        auto listenerView = registry.view<AudioListenerOverride>();
+        if (!listenerView.empty())
+        {
+            const Transform& overrideT = registry.get<Transform>(listenerView.front());
+            frameSteps.listenerPos = overrideT.position;
+            frameSteps.listenerRot = overrideT.rotation;
         }
 
-        console->drawWindow();
+        {
+            ProfileScopedN("Frame graph");
+            // entt creates pools the first time a type is used, which resizes the registry's pool list.
+            // Make sure every pool the nodes touch exists before they start.
+            registry.prepare<Transform>();
+            registry.prepare<WorldObject>();
+            registry.prepare<NavAgent>();
+            registry.prepare<SkinnedWorldObject>();
+            registry.prepare<Animator>();
+            registry.prepare<ChildComponent>();
+            registry.prepare<AudioSource>();
+            registry.prepare<AudioTrigger>();
+            frameGraph->run();
+        }
 
-        registry.view<ChildComponent, Transform>().each(
-            [&](ChildComponent& c, Transform& t)
-            {
-                if (!registry.valid(c.parent))
-                    return;
-                t = c.offset.transformBy(registry.get<Transform>(c.parent));
-                t.scale = c.offset.scale * registry.get<Transform>(c.parent).scale;
-            }
-        );
+        double animationTime = frameSteps.animationTime;
+        double audioTime = frameSteps.audioTime;
 
+        double renderPrepTime = 0.0;
         if (!headless)
         {
+            audioSystem->drawDebugWindow();
             PerfTimer rpt{};
             tickRenderer(interFrameInfo.deltaTime, true);
-            interFrameInfo.lastTickRendererTime = rpt.stopGetMs();
+            renderPrepTime = rpt.stopGetMs();
+            interFrameInfo.lastTickRendererTime = renderPrepTime;
             if (vrInterface)
                 vrInterface->endFrame();
         }
 
         interFrameInfo.frameCounter++;
 
-        inputManager->endFrame();
+        if (!headless)
+            inputManager->endFrame();
 
         for (auto& e : nextFrameKillList)
         {
@@ -746,7 +920,18 @@ namespace worlds
 
         if (sceneLoadQueued)
         {
+            ProfileScopedN("Scene load");
             sceneLoadQueued = false;
+
+            // The synchronous load clears the registry out from under the async one, which would
+            // otherwise keep adding components to the entities it had already created
+            if (asyncSceneLoad)
+            {
+                logWarn("Cancelling async load of %s to load %s", AssetDB::idToPath(asyncSceneLoad->sceneId()).c_str(),
+                        AssetDB::idToPath(queuedSceneID).c_str());
+                asyncSceneLoad.Reset();
+            }
+
             SceneInfo& si = registry.ctx<SceneInfo>();
             si.name = std::filesystem::path(AssetDB::idToPath(queuedSceneID)).stem().string();
             si.id = queuedSceneID;
@@ -755,39 +940,115 @@ namespace worlds
 
             // TODO: Load content here
 
-            if (!runAsEditor EDITORONLY(|| editor->isPlaying()))
-            {
-                evtHandler->onSceneStart(registry);
-
-                scriptEngine->onSceneStart();
-            }
-
-            registry.view<AudioSource>().each(
-                [](AudioSource& as)
-                {
-                    if (as.playOnSceneStart)
-                        as.eventInstance->start();
-                }
-            );
+            startLoadedScene();
         }
 
+        updateAsyncSceneLoad();
+
         uint64_t postUpdate = SDL_GetPerformanceCounter();
         double completeUpdateTime = (postUpdate - now) / (double)SDL_GetPerformanceFrequency();
 
-        if (headless)
+        if (benchmarkFrame)
         {
-            double waitTime = g_console->getConVar("sim_stepTime")->getFloat() - completeUpdateTime;
-            if (waitTime > 0.0)
-                SDL_Delay(waitTime * 1000);
+            benchmark->endFrame({
+                .frame = completeUpdateTime * 1000.0,
+                .update = updateTime * 1000.0,
+                .sim = simTime,
+                .script = scriptTime,
+                .animation = animationTime,
+                .audio = audioTime,
+                .renderPrep = renderPrepTime,
+            });
+
+            if (benchmark->isFinished())
+            {
+                benchmark->writeReport(headless);
+                running = false;
+            }
         }
 
         interFrameInfo.lastUpdateTime = updateTime;
         inFrame = false;
+
+        // Done here rather than after rendering so headless frames get counted too
+        AllocTracker::endFrame();
+        FrameArena::nextFrame();
+        Profiler::endFrame();
+
+        // who is mark and why are we framing him?
+        FrameMark;
+    }
+
+    void WorldsEngine::buildFrameGraph()
+    {
+        // Navigation moves agents, so it goes before anything that reads transforms. Animation doesn't
+        // read them but both load meshes through MeshManager, which isn't thread safe. Audio has to
+        // see children in their final place, so it waits for the hierarchy.
+        //
+        // The rest of the frame stays on the main thread. The simulation and game update run script
+        // callbacks between physics steps and PhysX results are fetched inside SimulationLoop, the
+        // editor, console and debug windows use ImGui, and rendering submits to Vulkan and OpenXR.
+        // Rendering also creates pools with view(), so it can't overlap any of these nodes.
+        frameGraph = new TaskGraph();
+
+        TaskGraph::NodeId navNode = frameGraph->addNode(
+            "Navigation",
+            [this](enki::TaskSetPartition, uint32_t)
+            {
+                if (frameSteps.updateWorld)
+                    NavigationSystem::update(registry, frameSteps.worldDeltaTime);
+            }
+        );
+
+        frameGraph->addNode(
+            "Animation",
+            [this](enki::TaskSetPartition, uint32_t)
+            {
+                if (!frameSteps.updateWorld)
+                    return;
+
+                PerfTimer animationTimer;
+                AnimationSystem::update(registry, frameSteps.worldDeltaTime);
+                frameSteps.animationTime = animationTimer.stopGetMs();
+            },
+            {navNode}
+        );
+
+        TaskGraph::NodeId hierarchyNode = frameGraph->addNode(
+            "Hierarchy",
+            [this](enki::TaskSetPartition, uint32_t)
+            {
+                registry.view<ChildComponent, Transform>().each(
+                    [&](ChildComponent& c, Transform& t)
+                    {
+                        if (!registry.valid(c.parent))
+                            return;
+                        t = c.offset.transformBy(registry.get<Transform>(c.parent));
+                        t.scale = c.offset.scale * registry.get<Transform>(c.parent).scale;
+                    }
+                );
+            },
+            {navNode}
+        );
+
+        frameGraph->addNode(
+            "Audio",
+            [this](enki::TaskSetPartition, uint32_t)
+            {
+                if (headless)
+                    return;
+
+                PerfTimer audioTimer;
+                audioSystem->update(registry, frameSteps.listenerPos, frameSteps.listenerRot, frameSteps.deltaTime);
+                frameSteps.audioTime = audioTimer.stopGetMs();
+            },
+            {hierarchyNode}
+        );
     }
 
     void WorldsEngine::tickRenderer(float deltaTime, bool renderImGui)
     {
-        ZoneScoped;
+        ProfileScoped;
         const physx::PxRenderBuffer& pxRenderBuffer = physicsSystem->scene()->getRenderBuffer();
 
         for (uint32_t i = 0; i < pxRenderBuffer.getNbLines(); i++)
@@ -814,9 +1075,72 @@ namespace worlds
         }
 
         renderer->frame(registry, deltaTime);
+    }
 
-        // who is mark and why are we framing him?
-        FrameMark;
+    void WorldsEngine::startLoadedScene()
+    {
+        if (!runAsEditor EDITORONLY(|| editor->isPlaying()))
+        {
+            evtHandler->onSceneStart(registry);
+
+            scriptEngine->onSceneStart();
+        }
+
+        registry.view<AudioSource>().each(
+            [](AudioSource& as)
+            {
+                if (as.playOnSceneStart)
+                    as.eventInstance->start();
+            }
+        );
+    }
+
+    void WorldsEngine::updateAsyncSceneLoad()
+    {
+        static ConVar asyncLoadBudget{
+            "scene_asyncBudgetMs", "4", "Time per frame to spend adding an asynchronously loaded scene to the world."
+        };
+
+        if (!asyncSceneLoad || !asyncSceneLoad->update(asyncLoadBudget.getFloat()))
+            return;
+
+        AssetID sceneId = asyncSceneLoad->sceneId();
+        bool failed = asyncSceneLoad->failed();
+        asyncSceneLoad.Reset();
+
+        if (failed)
+        {
+            logErr("Failed to load scene %s", AssetDB::idToPath(sceneId).c_str());
+            return;
+        }
+
+        startLoadedScene();
+    }
+
+    void WorldsEngine::loadSceneAsync(AssetID scene)
+    {
+        if (!AssetDB::exists(scene))
+        {
+            logErr("Tried to load scene that doesn't exist!");
+            return;
+        }
+
+        if (asyncSceneLoad)
+        {
+            logWarn("Already loading scene %s, ignoring request to load %s",
+                    AssetDB::idToPath(asyncSceneLoad->sceneId()).c_str(), AssetDB::idToPath(scene).c_str());
+            return;
+        }
+
+        asyncSceneLoad = new AsyncSceneLoad(scene, registry, physicsSystem.Get());
+    }
+
+    float WorldsEngine::getSceneLoadProgress()
+    {
+        if (!asyncSceneLoad)
+            return -1.0f;
+
+        return asyncSceneLoad->progress();
     }
 
     void WorldsEngine::loadScene(AssetID scene)
@@ -833,6 +1157,8 @@ namespace worlds
 
     WorldsEngine::~WorldsEngine()
     {
+        asyncSceneLoad.Reset();
+        NavigationSystem::shutdown();
         audioSystem->shutdown(registry);
         if (evtHandler != nullptr && !runAsEditor)
             evtHandler->shutdown(registry);
@@ -1,5 +1,6 @@
 #pragma once
 #include <stdint.h>
+#include <stdio.h>
 #include <string>
 #include <vector>
 
@@ -33,6 +34,8 @@ namespace worlds
     class Window;
     class PhysicsSystem;
     class ViewController;
+    class AsyncSceneLoad;
+    class TaskGraph;
 
     struct SceneInfo
     {
@@ -97,9 +100,26 @@ namespace worlds
         // returns true if the simulation actually ran
         bool updateSimulation(float& interpAlpha, double timeScale, double deltaTime,
                               bool physicsOnly);
+        ~SimulationLoop();
+        [[nodiscard]] bool isDeterministic() const
+        {
+            return deterministic;
+        }
     private:
+        // Defined in SimulationLoop.cpp so this header doesn't need PhysX.
+        struct PoseChecksumEntry;
+
         void doSimStep(float deltaTime, bool physicsOnly);
+        void writeStateChecksum();
         double simAccumulator;
+        // Deterministic mode runs a fixed step that never drops time and
+        // logs a checksum of every rigidbody pose after each step.
+        bool deterministic;
+        float fixedStepTime;
+        uint64_t stepCounter;
+        FILE* checksumLog;
+        // Reused between steps to avoid reallocating.
+        std::vector<PoseChecksumEntry> checksumEntries;
         PhysicsSystem* physics;
         DotNetScriptEngine* scriptEngine;
         entt::registry& registry;
@@ -121,6 +141,8 @@ namespace worlds
         std::vector<SceneInfo> loadedScenes;
     };
 
+    class BenchmarkRunner;
+
     class WorldsEngine
     {
     public:
@@ -128,7 +150,17 @@ namespace worlds
         ~WorldsEngine();
 
         void run();
+        // Loads a scene at the end of the frame. Cancels any async load that's still in progress.
         void loadScene(AssetID scene);
+        // Loads a scene in the background, replacing the current one once it's ready.
+        // The simulation and game updates are paused while the new scene is added to the registry.
+        void loadSceneAsync(AssetID scene);
+        [[nodiscard]] bool isLoadingScene()
+        {
+            return asyncSceneLoad.Get() != nullptr;
+        }
+        // Progress of the current async scene load from 0 to 1, or -1 if there isn't one.
+        float getSceneLoadProgress();
         Window& getMainWindow() const
         {
             return *window;
@@ -158,6 +190,18 @@ namespace worlds
             double lastTickRendererTime;
         };
 
+        // Inputs and timings for the frame graph's nodes, written by the main thread before it starts
+        struct FrameStepInfo
+        {
+            bool updateWorld;
+            float worldDeltaTime;
+            float deltaTime;
+            glm::vec3 listenerPos;
+            glm::quat listenerRot;
+            double animationTime;
+            double audioTime;
+        };
+
         static int eventFilter(void* enginePtr, SDL_Event* evt);
         static int windowThread(void* data);
         void setupSDL();
@@ -165,8 +209,15 @@ namespace worlds
         void setupPhysfs(char* argv0, bool mountGameData);
         void tickRenderer(float deltaTime, bool renderImgui = false);
         void runSingleFrame(bool processEvents);
+        // Per-frame systems that can run on the workers. They're started once the main thread is done
+        // with the registry and finish before rendering.
+        void buildFrameGraph();
+        // Fixed rate tick loop for dedicated servers
+        void runServer();
+        void startLoadedScene();
+        void updateAsyncSceneLoad();
 
-        Window* window;
+        Window* window = nullptr;
         int windowWidth, windowHeight;
 
         bool running;
@@ -181,6 +232,7 @@ namespace worlds
 
         bool sceneLoadQueued = false;
         AssetID queuedSceneID;
+        UniquePtr<AsyncSceneLoad> asyncSceneLoad;
 
         double timeScale = 1.0;
         double gameTime = 0.0;
@@ -197,9 +249,12 @@ namespace worlds
         UniquePtr<OpenXRInterface> vrInterface;
         UniquePtr<PhysicsSystem> physicsSystem;
         UniquePtr<SimulationLoop> simLoop;
+        UniquePtr<BenchmarkRunner> benchmark;
 
         std::vector<entt::entity> nextFrameKillList;
 
         InterFrameInfo interFrameInfo;
+        UniquePtr<TaskGraph> frameGraph;
+        FrameStepInfo frameSteps{};
     };
 }
@@ -18,6 +18,7 @@ namespace worlds
     {
         const char *formatted = format("%s\n(file: %s, line %i)", msg, file, line);
         logErr("%s", formatted);
+        flushLogs();
         SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Worlds Engine", formatted, nullptr);
         abort();
     }
@@ -26,6 +27,7 @@ namespace worlds
     {
         const char* formatted = format("Assertion failed!\n%s\nFile %s, line %i", condition, file, line);
         logErr("%s", formatted);
+        flushLogs();
         SDL_MessageBoxButtonData buttonData[] = {
             { 0, 0, "Abort" },
             { 0, 1, "Ignore" }
@@ -42,6 +44,7 @@ namespace worlds
         if (buttonId == 0)
         {
             logErr("Aborting...");
+            flushLogs();
             abort();
         }
         else
@@ -13,6 +13,10 @@ namespace worlds
         WELogCategoryScripting,
         WELogCategoryPhysics
     };
+
+    // Log messages are written out on a background thread. This blocks until everything
+    // logged so far has been written, for when the process is about to go down.
+    void flushLogs();
 }
 
 #if defined(__clang__) || defined(__GNUC__)
@@ -0,0 +1,114 @@
+#include "LogQueue.hpp"
+#include <Tracy.hpp>
+#include <algorithm>
+#include <string.h>
+
+namespace worlds
+{
+    const auto WriteInterval = std::chrono::milliseconds(5);
+
+    LogQueue::LogQueue(BatchWriter writer) : writer(writer)
+    {
+        writerThread = std::thread([this] { writerLoop(); });
+    }
+
+    LogQueue::~LogQueue()
+    {
+        {
+            std::unique_lock lock{wakeMutex};
+            stopping = true;
+        }
+        wakeCV.notify_one();
+        writerThread.join();
+
+        flush();
+    }
+
+    LogQueue::ThreadRing* LogQueue::getThreadRing()
+    {
+        thread_local LogQueue* owner = nullptr;
+        thread_local ThreadRing* threadRing = nullptr;
+
+        if (owner == this)
+            return threadRing;
+
+        std::unique_lock lock{ringsMutex};
+        auto ring = std::make_unique<ThreadRing>();
+        ring->threadId = (uint32_t)rings.size() + 1;
+        threadRing = ring.get();
+        rings.push_back(std::move(ring));
+        owner = this;
+
+        return threadRing;
+    }
+
+    void LogQueue::push(int category, SDL_LogPriority priority, const char* msg)
+    {
+        ThreadRing* ring = getThreadRing();
+
+        LogEntry entry;
+        entry.sequence = nextSequence.fetch_add(1, std::memory_order_relaxed);
+        entry.time = std::chrono::system_clock::now();
+        entry.threadId = ring->threadId;
+        entry.category = category;
+        entry.priority = priority;
+        entry.msg = strdup(msg);
+
+        if (!ring->ring.tryPush(entry))
+        {
+            std::unique_lock lock{overflowMutex};
+            overflow.push_back(entry);
+        }
+    }
+
+    void LogQueue::flush()
+    {
+        ZoneScoped;
+        std::unique_lock drainLock{drainMutex};
+
+        {
+            std::unique_lock lock{ringsMutex};
+            for (auto& ring : rings)
+            {
+                LogEntry entry;
+                while (ring->ring.tryPop(entry))
+                {
+                    batch.push_back(entry);
+                }
+            }
+        }
+
+        {
+            std::unique_lock lock{overflowMutex};
+            batch.insert(batch.end(), overflow.begin(), overflow.end());
+            overflow.clear();
+        }
+
+        if (batch.empty())
+            return;
+
+        std::sort(batch.begin(), batch.end(),
+                  [](const LogEntry& a, const LogEntry& b) { return a.sequence < b.sequence; });
+
+        writer(batch.data(), batch.size());
+
+        for (LogEntry& entry : batch)
+        {
+            free(entry.msg);
+        }
+        batch.clear();
+    }
+
+    void LogQueue::writerLoop()
+    {
+        std::unique_lock lock{wakeMutex};
+        while (!stopping)
+        {
+            wakeCV.wait_for(lock, WriteInterval);
+
+            lock.unlock();
+            flush();
+            lock.lock();
+        }
+    }
+}
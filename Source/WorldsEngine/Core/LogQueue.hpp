@@ -0,0 +1,69 @@
+#pragma once
+#include <SDL_log.h>
+#include <Util/SpscRing.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+namespace worlds
+{
+    struct LogEntry
+    {
+        uint64_t sequence;
+        std::chrono::system_clock::time_point time;
+        uint32_t threadId;
+        int category;
+        SDL_LogPriority priority;
+        // malloc'd, freed once the batch has been written
+        char* msg;
+    };
+
+    // Collects log messages from any thread without taking a lock and hands them to a
+    // background thread in batches, in the order they were logged.
+    class LogQueue
+    {
+      public:
+        typedef std::function<void(const LogEntry* entries, size_t count)> BatchWriter;
+
+        LogQueue(BatchWriter writer);
+        ~LogQueue();
+        void push(int category, SDL_LogPriority priority, const char* msg);
+        // Writes out everything queued so far on the calling thread.
+        void flush();
+
+      private:
+        struct ThreadRing
+        {
+            SpscRing<LogEntry, 512> ring;
+            uint32_t threadId;
+        };
+
+        ThreadRing* getThreadRing();
+        void writerLoop();
+
+        BatchWriter writer;
+        std::atomic<uint64_t> nextSequence = 0;
+
+        std::mutex ringsMutex;
+        std::vector<std::unique_ptr<ThreadRing>> rings;
+
+        // Only used when a thread's ring is full
+        std::mutex overflowMutex;
+        std::vector<LogEntry> overflow;
+
+        // Held while draining, so flush() and the writer thread don't both consume at once
+        std::mutex drainMutex;
+        std::vector<LogEntry> batch;
+
+        std::mutex wakeMutex;
+        std::condition_variable wakeCV;
+        bool stopping = false;
+        std::thread writerThread;
+    };
+}
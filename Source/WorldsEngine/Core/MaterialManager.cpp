@@ -1,4 +1,5 @@
 #include <Core/MaterialManager.hpp>
+#include <Core/AllocTracking.hpp>
 #include <Core/AssetDB.hpp>
 #include <Core/Log.hpp>
 #include <mutex>
@@ -10,6 +11,7 @@ namespace worlds
 
     nlohmann::json& MaterialManager::loadOrGet(AssetID id)
     {
+        AllocTagScope allocTag{AllocTag::Assets};
         std::lock_guard lock{matMutex};
         if (mats.contains(id))
         {
@@ -1,16 +1,80 @@
 #include "MeshManager.hpp"
+#include <Core/AllocTracking.hpp>
 #include "Util/MathsUtil.hpp"
 #include "Fatal.hpp"
 #include <Core/Log.hpp>
 #include <Render/Loaders/WMDLLoader.hpp>
 #include <Render/RenderInternal.hpp>
 #include <Tracy.hpp>
+#include <algorithm>
 
 namespace worlds
 {
     robin_hood::unordered_node_map<AssetID, LoadedMesh> MeshManager::loadedMeshes;
+    uint32_t MeshManager::reloadCount = 0;
     LoadedMesh errorMesh{.numSubmeshes = 0};
 
+    void sortBones(LoadedMesh& lm)
+    {
+        std::vector<uint32_t> depths(lm.bones.size());
+        lm.boneOrder.resize(lm.bones.size());
+
+        for (size_t i = 0; i < lm.bones.size(); i++)
+        {
+            uint32_t depth = 0;
+            uint32_t parent = lm.bones[i].parentId;
+
+            // The depth check stops broken files with parent loops from hanging
+            while (parent != ~0u && depth < lm.bones.size())
+            {
+                if (parent >= lm.bones.size())
+                {
+                    logWarn("Bone %s has an invalid parent", lm.bones[i].name.cStr());
+                    lm.bones[i].parentId = ~0u;
+                    break;
+                }
+
+                parent = lm.bones[parent].parentId;
+                depth++;
+            }
+
+            depths[i] = depth;
+            lm.boneOrder[i] = (uint32_t)i;
+        }
+
+        std::stable_sort(lm.boneOrder.begin(), lm.boneOrder.end(),
+                         [&](uint32_t a, uint32_t b) { return depths[a] < depths[b]; });
+    }
+
+    void calculateBoneRadii(LoadedMesh& lm, const std::vector<VertexSkinInfo>& skinningInfos)
+    {
+        lm.boneRadii.assign(lm.bones.size(), -1.0f);
+
+        if (skinningInfos.size() != lm.vertices.size())
+            return;
+
+        std::vector<glm::vec3> bindPositions(lm.bones.size());
+        for (size_t i = 0; i < lm.bones.size(); i++)
+        {
+            bindPositions[i] = glm::inverse(lm.bones[i].inverseBindPose)[3];
+        }
+
+        for (size_t i = 0; i < lm.vertices.size(); i++)
+        {
+            const VertexSkinInfo& vsi = skinningInfos[i];
+
+            for (int j = 0; j < 4; j++)
+            {
+                int boneId = vsi.boneIds[j];
+                if (vsi.weights[j] <= 0.0f || boneId < 0 || boneId >= (int)lm.bones.size())
+                    continue;
+
+                float dist = glm::distance(lm.vertices[i].position, bindPositions[boneId]);
+                lm.boneRadii[boneId] = glm::max(lm.boneRadii[boneId], dist);
+            }
+        }
+    }
+
     bool loadToLM(LoadedMesh& lm, AssetID id)
     {
         ZoneScoped;
@@ -47,9 +111,13 @@ namespace worlds
             b.name = lmd.bones[i].name.c_str();
             b.parentId = lmd.bones[i].parentIdx;
             b.restPose = lmd.bones[i].transform;
+            b.restTransform.fromMatrix(b.restPose);
             b.inverseBindPose = lmd.bones[i].inverseBindPose;
         }
 
+        sortBones(lm);
+        calculateBoneRadii(lm, lmd.skinningInfos);
+
         for (int i = 0; i < lmd.submeshes.size(); i++)
         {
             const LoadedSubmesh& ls = lmd.submeshes[i];
@@ -87,6 +155,7 @@ namespace worlds
     const LoadedMesh& MeshManager::loadOrGet(AssetID id)
     {
         ZoneScoped;
+        AllocTagScope allocTag{AllocTag::Assets};
         if (loadedMeshes.contains(id))
             return loadedMeshes.at(id);
 
@@ -120,6 +189,8 @@ namespace worlds
         {
             loadToLM(pair.second, pair.first);
         }
+
+        reloadCount++;
     }
 
     void MeshManager::reloadMesh(AssetID mesh)
@@ -128,5 +199,36 @@ namespace worlds
             return;
         
         loadToLM(loadedMeshes.at(mesh), mesh);
+        reloadCount++;
+    }
+
+    uint32_t MeshManager::getReloadCount()
+    {
+        return reloadCount;
+    }
+
+    bool MeshManager::isLoaded(AssetID id)
+    {
+        return loadedMeshes.contains(id);
+    }
+
+    bool MeshManager::preload(AssetID id, LoadedMesh& lm)
+    {
+        if (!AssetDB::exists(id))
+        {
+            logErr("Mesh ID %u doesn't exist!", id);
+            return false;
+        }
+
+        return loadToLM(lm, id);
+    }
+
+    void MeshManager::insertPreloaded(AssetID id, LoadedMesh&& lm)
+    {
+        // References to loaded meshes have to stay valid, so don't replace one that's already there
+        if (loadedMeshes.contains(id))
+            return;
+
+        loadedMeshes.insert({id, std::move(lm)});
     }
 }
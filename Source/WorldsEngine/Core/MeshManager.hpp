@@ -11,6 +11,8 @@ namespace worlds
         uint32_t id;
         uint32_t parentId;
         glm::mat4 restPose;
+        // restPose split into position, rotation and scale
+        Transform restTransform;
         glm::mat4 inverseBindPose;
         slib::String name;
     };
@@ -34,6 +36,11 @@ namespace worlds
 
         bool skinned;
         std::vector<Bone> bones;
+        // Bone indices sorted so that parents always come before their children
+        std::vector<uint32_t> boneOrder;
+        // Distance from each bone to the furthest vertex it influences in the bind pose, or -1
+        // for bones that don't move any vertices. Used to bound posed meshes.
+        std::vector<float> boneRadii;
         float sphereBoundRadius;
         glm::vec3 aabbMin;
         glm::vec3 aabbMax;
@@ -48,8 +55,17 @@ namespace worlds
         static void unload(AssetID id);
         static void reloadMeshes();
         static void reloadMesh(AssetID id);
+        static bool isLoaded(AssetID id);
+        // Loads a mesh without adding it to the cache, so it's safe to call from any thread.
+        // Hand the result to insertPreloaded on the main thread.
+        static bool preload(AssetID id, LoadedMesh& lm);
+        static void insertPreloaded(AssetID id, LoadedMesh&& lm);
+        // Goes up every time meshes are reloaded, so anything cached from mesh data can tell
+        // when it's stale
+        static uint32_t getReloadCount();
 
     private:
         static robin_hood::unordered_node_map<AssetID, LoadedMesh> loadedMeshes;
+        static uint32_t reloadCount;
     };
 }
@@ -0,0 +1,237 @@
+#include "Profiler.hpp"
+#include <Core/ConVar.hpp>
+#include <Core/Log.hpp>
+#include <Util/SpscRing.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <stdio.h>
+
+namespace worlds
+{
+    ConVar profilerEnable{"profiler_enable", "1", "Records CPU scope timings for the profiler in the debug window."};
+    ConVar spikeThreshold{"profiler_spikeThresholdMs", "50",
+                          "Frames taking longer than this are written to the profiler folder. 0 disables."};
+
+    const uint64_t SpikeDumpCooldown = 1000000000ull;
+    const int SpikeContextFrames = 3;
+
+    struct ThreadProfile
+    {
+        SpscRing<ProfileEvent, 8192> ring;
+        std::atomic<uint32_t> dropped{0};
+        uint32_t depth = 0;
+        char name[32];
+    };
+
+    // Thread profiles are never freed since the main thread may still be draining one after
+    // its thread has exited.
+    std::mutex threadsMutex;
+    std::vector<ThreadProfile*> threads;
+    thread_local ThreadProfile* currentThread = nullptr;
+    std::atomic<bool> enabled{true};
+
+    ProfiledFrame history[Profiler::HistoryLength];
+    int historyHead = 0;
+    int historyCount = 0;
+    uint64_t frameIndex = 0;
+    uint64_t lastFrameEnd = 0;
+    uint64_t lastSpikeDump = 0;
+    bool paused = false;
+
+    ThreadProfile* getThreadProfile()
+    {
+        if (currentThread != nullptr)
+            return currentThread;
+
+        std::unique_lock lock{threadsMutex};
+        currentThread = new ThreadProfile;
+        snprintf(currentThread->name, sizeof(currentThread->name), "Thread %zu", threads.size());
+        threads.push_back(currentThread);
+
+        return currentThread;
+    }
+
+    ProfileScope::ProfileScope(const char* name) : name(name), active(enabled.load(std::memory_order_relaxed))
+    {
+        if (!active)
+            return;
+
+        getThreadProfile()->depth++;
+        start = Profiler::now();
+    }
+
+    ProfileScope::~ProfileScope()
+    {
+        if (!active)
+            return;
+
+        uint64_t end = Profiler::now();
+        ThreadProfile* tp = currentThread;
+        tp->depth--;
+
+        if (!tp->ring.tryPush(ProfileEvent{name, start, end, tp->depth}))
+            tp->dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t Profiler::now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()
+        ).count();
+    }
+
+    void Profiler::setThreadName(const char* name)
+    {
+        ThreadProfile* tp = getThreadProfile();
+        std::unique_lock lock{threadsMutex};
+        snprintf(tp->name, sizeof(tp->name), "%s", name);
+    }
+
+    const char* Profiler::threadName(uint32_t threadIndex)
+    {
+        std::unique_lock lock{threadsMutex};
+        return threads[threadIndex]->name;
+    }
+
+    void Profiler::endFrame()
+    {
+        uint64_t end = now();
+        enabled.store(profilerEnable.getInt(), std::memory_order_relaxed);
+
+        if (lastFrameEnd == 0 || paused)
+        {
+            lastFrameEnd = end;
+
+            std::unique_lock lock{threadsMutex};
+            ProfileEvent evt;
+            for (ThreadProfile* tp : threads)
+            {
+                while (tp->ring.tryPop(evt))
+                {
+                }
+            }
+            return;
+        }
+
+        ProfiledFrame& frame = history[historyHead];
+        frame.frameIndex = frameIndex++;
+        frame.start = lastFrameEnd;
+        frame.end = end;
+
+        {
+            std::unique_lock lock{threadsMutex};
+            frame.threads.resize(threads.size());
+
+            for (size_t i = 0; i < threads.size(); i++)
+            {
+                ProfiledThread& pt = frame.threads[i];
+                pt.events.clear();
+                pt.droppedEvents = threads[i]->dropped.exchange(0, std::memory_order_relaxed);
+
+                ProfileEvent evt;
+                while (threads[i]->ring.tryPop(evt))
+                {
+                    pt.events.push_back(evt);
+                }
+            }
+        }
+
+        historyHead = (historyHead + 1) % HistoryLength;
+        historyCount = std::min(historyCount + 1, HistoryLength);
+        lastFrameEnd = end;
+
+        float threshold = spikeThreshold.getFloat();
+        if (threshold > 0.0f && frame.durationMs() > threshold && end - lastSpikeDump > SpikeDumpCooldown)
+        {
+            lastSpikeDump = end;
+
+            std::error_code ec;
+            std::filesystem::create_directories("profiler", ec);
+
+            char path[64];
+            snprintf(path, sizeof(path), "profiler/spike_%llu.json", (unsigned long long)frame.frameIndex);
+
+            if (dumpFrames(path, SpikeContextFrames))
+                logWarn("Frame %llu took %.2fms, wrote profile to %s", (unsigned long long)frame.frameIndex,
+                        frame.durationMs(), path);
+        }
+    }
+
+    void Profiler::setPaused(bool paused)
+    {
+        worlds::paused = paused;
+    }
+
+    bool Profiler::isPaused()
+    {
+        return paused;
+    }
+
+    int Profiler::frameCount()
+    {
+        return historyCount;
+    }
+
+    const ProfiledFrame& Profiler::frame(int age)
+    {
+        return history[(historyHead - 1 - age + HistoryLength * 2) % HistoryLength];
+    }
+
+    bool Profiler::dumpFrames(const char* path, int count)
+    {
+        count = std::min(count, historyCount);
+        if (count == 0)
+            return false;
+
+        FILE* f = fopen(path, "w");
+        if (f == nullptr)
+        {
+            logErr("Failed to open %s for writing profiler data", path);
+            return false;
+        }
+
+        uint64_t base = frame(count - 1).start;
+        size_t threadCount = frame(0).threads.size();
+
+        fputs("{\"traceEvents\":[\n", f);
+
+        for (size_t i = 0; i < threadCount; i++)
+        {
+            fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%zu,\"args\":{\"name\":\"%s\"}},\n", i,
+                    threadName((uint32_t)i));
+        }
+
+        // Frames go on their own row below the threads
+        fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%zu,\"args\":{\"name\":\"Frames\"}}",
+                threadCount);
+
+        for (int age = count - 1; age >= 0; age--)
+        {
+            const ProfiledFrame& pf = frame(age);
+            fprintf(f, ",\n{\"name\":\"Frame %llu\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%zu}",
+                    (unsigned long long)pf.frameIndex, (pf.start - base) / 1000.0, (pf.end - pf.start) / 1000.0,
+                    threadCount);
+
+            for (size_t i = 0; i < pf.threads.size(); i++)
+            {
+                for (const ProfileEvent& evt : pf.threads[i].events)
+                {
+                    // Events recorded before the oldest dumped frame started would have negative times
+                    if (evt.start < base)
+                        continue;
+
+                    fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%zu}",
+                            evt.name, (evt.start - base) / 1000.0, (evt.end - evt.start) / 1000.0, i);
+                }
+            }
+        }
+
+        fputs("\n]}\n", f);
+        fclose(f);
+
+        return true;
+    }
+}
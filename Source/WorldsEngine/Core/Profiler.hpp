@@ -0,0 +1,78 @@
+#pragma once
+#include <Tracy.hpp>
+#include <stdint.h>
+#include <vector>
+
+namespace worlds
+{
+    struct ProfileEvent
+    {
+        // Must be a string literal or otherwise live forever
+        const char* name;
+        uint64_t start;
+        uint64_t end;
+        uint32_t depth;
+    };
+
+    struct ProfiledThread
+    {
+        std::vector<ProfileEvent> events;
+        uint32_t droppedEvents;
+    };
+
+    struct ProfiledFrame
+    {
+        uint64_t frameIndex;
+        uint64_t start;
+        uint64_t end;
+        // Indexed by profiler thread index, see Profiler::threadName
+        std::vector<ProfiledThread> threads;
+
+        double durationMs() const
+        {
+            return (end - start) / 1000000.0;
+        }
+    };
+
+    class ProfileScope
+    {
+      public:
+        ProfileScope(const char* name);
+        ~ProfileScope();
+
+      private:
+        const char* name;
+        uint64_t start;
+        bool active;
+    };
+
+    // Built in hierarchical CPU profiler. Scopes are pushed into a lock-free ring per thread and
+    // gathered into frames by the main thread, which keeps the last HistoryLength frames around.
+    // Frames slower than profiler_spikeThresholdMs are written out automatically as Chrome trace
+    // JSON, which can be opened in chrome://tracing or Perfetto.
+    class Profiler
+    {
+      public:
+        static constexpr int HistoryLength = 256;
+
+        // Nanoseconds since an arbitrary point
+        static uint64_t now();
+        static void setThreadName(const char* name);
+        static const char* threadName(uint32_t threadIndex);
+        // Call once per frame from the main thread.
+        static void endFrame();
+        // While paused, new frames are thrown away so the history can be inspected.
+        static void setPaused(bool paused);
+        static bool isPaused();
+        // Number of frames currently held in the history.
+        static int frameCount();
+        // 0 is the most recent frame. Must be below frameCount().
+        static const ProfiledFrame& frame(int age);
+        // Writes the newest count frames as a Chrome trace.
+        static bool dumpFrames(const char* path, int count);
+    };
+}
+
+// Profiles the enclosing scope with both Tracy and the built in profiler
+#define ProfileScopedN(name) ZoneScopedN(name); ::worlds::ProfileScope __profileScope{name}
+#define ProfileScoped ZoneScoped; ::worlds::ProfileScope __profileScope{__func__}
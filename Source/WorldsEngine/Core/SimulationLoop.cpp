@@ -1,7 +1,9 @@
 #include "Engine.hpp"
 #include <Core/Console.hpp>
+#include <Core/Profiler.hpp>
 #include <Physics/Physics.hpp>
 #include <Scripting/NetVM.hpp>
+#include <algorithm>
 #include <robin_hood.h>
 #include <Tracy.hpp>
 #include <Util/TimingUtil.hpp>
@@ -23,18 +25,88 @@ namespace worlds
                               "Time between each simulation step in seconds (as long as "
                               "sim_lockToRefresh is 0)." };
 
+    struct SimulationLoop::PoseChecksumEntry
+    {
+        uint32_t entity;
+        physx::PxTransform pose;
+    };
+
     SimulationLoop::SimulationLoop(const EngineInterfaces& interfaces, IGameEventHandler* evtHandler,
                                    entt::registry& registry)
-        : physics(interfaces.physics)
+        : simAccumulator(0.0)
+        , deterministic(EngineArguments::hasArgument("deterministic-sim"))
+        , fixedStepTime(0.0f)
+        , stepCounter(0)
+        , checksumLog(nullptr)
+        , physics(interfaces.physics)
         , scriptEngine(interfaces.scriptEngine)
         , registry(registry)
         , evtHandler(evtHandler)
     {
+        if (deterministic)
+        {
+            std::string logPath{EngineArguments::argumentValue("deterministic-sim")};
+            if (logPath.empty())
+                logPath = "simchecksums.log";
+
+            checksumLog = fopen(logPath.c_str(), "w");
+            if (checksumLog == nullptr)
+                logErr("Failed to open simulation checksum log %s", logPath.c_str());
+
+            logMsg("Running deterministic simulation, checksums will be written to %s", logPath.c_str());
+        }
     }
 
-    void SimulationLoop::doSimStep(float deltaTime, bool physicsOnly)
+    SimulationLoop::~SimulationLoop()
+    {
+        if (checksumLog)
+            fclose(checksumLog);
+    }
+
+    void SimulationLoop::writeStateChecksum()
     {
         ZoneScoped;
+        checksumEntries.clear();
+
+        registry.view<RigidBody>().each(
+                [&](entt::entity ent, RigidBody& dpa)
+                {
+                    checksumEntries.push_back({(uint32_t)ent, dpa.actor->getGlobalPose()});
+                }
+        );
+
+        // Storage order depends on the history of the registry rather than the
+        // current state, so sort to make the checksum comparable between runs.
+        std::sort(checksumEntries.begin(), checksumEntries.end(),
+                  [](const PoseChecksumEntry& a, const PoseChecksumEntry& b) { return a.entity < b.entity; });
+
+        // 64-bit FNV-1a over the raw pose bits
+        uint64_t hash = 14695981039346656037ull;
+        auto hashBytes = [&](const void* data, size_t size)
+        {
+            const uint8_t* bytes = (const uint8_t*)data;
+            for (size_t i = 0; i < size; i++)
+            {
+                hash ^= bytes[i];
+                hash *= 1099511628211ull;
+            }
+        };
+
+        for (const PoseChecksumEntry& entry : checksumEntries)
+        {
+            hashBytes(&entry.entity, sizeof(entry.entity));
+            hashBytes(&entry.pose.p, sizeof(entry.pose.p));
+            hashBytes(&entry.pose.q, sizeof(entry.pose.q));
+        }
+
+        if (checksumLog)
+            fprintf(checksumLog, "%llu %zu %016llx\n", (unsigned long long)stepCounter, checksumEntries.size(),
+                    (unsigned long long)hash);
+    }
+
+    void SimulationLoop::doSimStep(float deltaTime, bool physicsOnly)
+    {
+        ProfileScoped;
 
         if (!physicsOnly)
         {
@@ -44,6 +116,10 @@ namespace worlds
         }
 
         physics->stepSimulation(deltaTime);
+        stepCounter++;
+
+        if (deterministic)
+            writeStateChecksum();
     }
 
 
@@ -55,7 +131,14 @@ namespace worlds
 
         if (pauseSimulation) return false;
 
-        if (lockSimToRefresh.getInt() || disableSimInterp.getInt())
+        // Latch the step time on the first update so that startup scripts
+        // still get a chance to change it.
+        if (deterministic && fixedStepTime == 0.0f)
+            fixedStepTime = simStepTime.getFloat();
+
+        bool lockToRefresh = lockSimToRefresh.getInt() && !deterministic;
+
+        if (lockToRefresh || disableSimInterp.getInt())
         {
             registry.view<RigidBody, Transform>().each(
                     [](RigidBody& dpa, Transform& transform)
@@ -83,9 +166,12 @@ namespace worlds
                 }
         );
 
-        if (!lockSimToRefresh.getInt())
+        if (!lockToRefresh)
         {
-            simAccumulator += deltaTime;
+            // In deterministic mode the time scale changes how quickly simulation
+            // time accumulates rather than the size of each step.
+            float stepTime = deterministic ? fixedStepTime : simStepTime.getFloat();
+            simAccumulator += deterministic ? deltaTime * timeScale : deltaTime;
 
             if (registry.view<RigidBody>().size() != currentState.size())
             {
@@ -105,30 +191,34 @@ namespace worlds
                 );
             }
 
-            while (simAccumulator >= simStepTime.getFloat())
+            while (simAccumulator >= stepTime)
             {
+                ProfileScopedN("Simulation step");
+                // currentState is only refreshed after the loop, so every step would copy the
+                // same poses. Swapping once avoids copying the whole map each step.
+                if (!ran)
+                    previousState.swap(currentState);
                 ran = true;
-                ZoneScopedN("Simulation step");
-                previousState = currentState;
-                simAccumulator -= simStepTime.getFloat();
+                simAccumulator -= stepTime;
 
                 PerfTimer timer;
 
-                doSimStep(simStepTime.getFloat() * timeScale, physicsOnly);
+                doSimStep(deterministic ? stepTime : stepTime * timeScale, physicsOnly);
 
                 double realTime = timer.stopGetMs() / 1000.0;
 
                 // avoid spiral of death if simulation is taking too long
-                if (realTime > simStepTime.getFloat())
+                // (deterministic runs must never drop time, so they just catch up)
+                if (realTime > stepTime && !deterministic)
                     simAccumulator = 0.0;
             }
 
             registry.view<RigidBody>().each([&](auto ent, RigidBody& dpa)
                                             { currentState[ent] = dpa.actor->getGlobalPose(); });
 
-            float alpha = simAccumulator / simStepTime.getFloat();
+            float alpha = simAccumulator / stepTime;
 
-            if (disableSimInterp.getInt() || simStepTime.getFloat() < deltaTime)
+            if (disableSimInterp.getInt() || stepTime < deltaTime)
                 alpha = 1.0f;
 
             registry.view<RigidBody, Transform>().each(
@@ -0,0 +1,132 @@
+#include "TaskGraph.hpp"
+#include <Core/Fatal.hpp>
+#include <Core/Profiler.hpp>
+#include <string.h>
+
+namespace worlds
+{
+    struct TaskGraph::Node : public enki::ITaskSet
+    {
+        const char* name;
+        NodeFunc func;
+        enki::ITaskSet* boundTask = nullptr;
+        std::vector<enki::Dependency> dependencies;
+        bool hasDependents = false;
+
+        void ExecuteRange(enki::TaskSetPartition range, uint32_t threadnum) override
+        {
+            ZoneScopedN("Task Graph Node");
+            ZoneName(name, strlen(name));
+            ProfileScope profileScope{name};
+
+            if (boundTask)
+                boundTask->ExecuteRange(range, threadnum);
+            else
+                func(range, threadnum);
+        }
+    };
+
+    TaskGraph::TaskGraph()
+    {
+    }
+
+    TaskGraph::~TaskGraph()
+    {
+    }
+
+    TaskGraph::NodeId TaskGraph::addNode(const char* name, NodeFunc func, std::initializer_list<NodeId> dependencies)
+    {
+        releaseAssert(!finalized);
+
+        auto node = std::make_unique<Node>();
+        node->name = name;
+        node->func = std::move(func);
+        node->m_SetSize = 1;
+
+        node->dependencies.resize(dependencies.size());
+        size_t i = 0;
+        for (NodeId dependency : dependencies)
+        {
+            releaseAssert(dependency < nodes.size());
+            Node* dependencyNode = nodes[dependency].get();
+            node->SetDependency(node->dependencies[i++], dependencyNode);
+            dependencyNode->hasDependents = true;
+        }
+
+        if (dependencies.size() == 0)
+            roots.push_back(node.get());
+
+        nodes.push_back(std::move(node));
+        return (NodeId)(nodes.size() - 1);
+    }
+
+    TaskGraph::NodeId TaskGraph::addNode(const char* name, std::initializer_list<NodeId> dependencies)
+    {
+        return addNode(name, NodeFunc{}, dependencies);
+    }
+
+    void TaskGraph::bind(NodeId node, enki::ITaskSet* task)
+    {
+        nodes[node]->boundTask = task;
+    }
+
+    void TaskGraph::setSize(NodeId node, uint32_t setSize, uint32_t minRange)
+    {
+        nodes[node]->m_SetSize = setSize;
+        nodes[node]->m_MinRange = minRange;
+    }
+
+    void TaskGraph::finalize()
+    {
+        size_t leafCount = 0;
+        for (auto& node : nodes)
+        {
+            if (!node->hasDependents)
+                leafCount++;
+        }
+
+        completion.dependencies.resize(leafCount);
+        size_t i = 0;
+        for (auto& node : nodes)
+        {
+            if (!node->hasDependents)
+                completion.SetDependency(completion.dependencies[i++], node.get());
+        }
+
+        finalized = true;
+    }
+
+    void TaskGraph::start()
+    {
+        if (!finalized)
+            finalize();
+
+        for (auto& node : nodes)
+        {
+            if (node->boundTask)
+            {
+                node->m_SetSize = node->boundTask->m_SetSize;
+                node->m_MinRange = node->boundTask->m_MinRange;
+            }
+            else if (!node->func)
+            {
+                fatalErr("Task graph node has no function and no bound task");
+            }
+        }
+
+        for (Node* root : roots)
+        {
+            g_taskSched.AddTaskSetToPipe(root);
+        }
+    }
+
+    void TaskGraph::wait(NodeId node)
+    {
+        g_taskSched.WaitforTask(nodes[node].get());
+    }
+
+    void TaskGraph::waitAll()
+    {
+        g_taskSched.WaitforTask(&completion);
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <Core/TaskScheduler.hpp>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+namespace worlds
+{
+    // A set of tasks and the dependencies between them, built once and then run as often as needed
+    // (usually every frame). All the enki dependencies are set up when nodes are added, so running
+    // the graph doesn't allocate. Every node shows up in the profiler under its name.
+    //
+    // A node either runs a function or forwards to a task set bound with bind(). Binding is for
+    // per-frame task objects: the node picks up the bound task's m_SetSize and m_MinRange when the
+    // graph starts.
+    class TaskGraph
+    {
+      public:
+        typedef uint32_t NodeId;
+        typedef std::function<void(enki::TaskSetPartition range, uint32_t threadnum)> NodeFunc;
+
+        TaskGraph();
+        ~TaskGraph();
+        TaskGraph(const TaskGraph&) = delete;
+        TaskGraph& operator=(const TaskGraph&) = delete;
+
+        // name has to be a string literal or otherwise outlive the graph.
+        NodeId addNode(const char* name, NodeFunc func, std::initializer_list<NodeId> dependencies = {});
+        NodeId addNode(const char* name, std::initializer_list<NodeId> dependencies = {});
+
+        void bind(NodeId node, enki::ITaskSet* task);
+        // Only for function nodes, which default to a set size of 1.
+        void setSize(NodeId node, uint32_t setSize, uint32_t minRange = 1);
+
+        // Kicks off every node with no dependencies. Everything else starts as soon as the
+        // nodes it depends on finish.
+        void start();
+        // Waits for one node while helping out with other tasks.
+        void wait(NodeId node);
+        void waitAll();
+
+        void run()
+        {
+            start();
+            waitAll();
+        }
+
+      private:
+        struct Node;
+        struct Completion : public enki::ICompletable
+        {
+            std::vector<enki::Dependency> dependencies;
+        };
+
+        void finalize();
+
+        std::vector<std::unique_ptr<Node>> nodes;
+        std::vector<Node*> roots;
+        Completion completion;
+        bool finalized = false;
+    };
+}
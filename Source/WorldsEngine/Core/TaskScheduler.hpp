@@ -1,13 +1,15 @@
 #pragma once
 #include "TaskScheduler.h"
+#include <Util/FrameArena.hpp>
 
 namespace worlds
 {
     extern enki::TaskScheduler g_taskSched;
 
+    // Dependencies come from the frame arena, so don't keep one of these waiting across frames
     struct TasksFinished : public enki::ICompletable
     {
-        std::vector<enki::Dependency> dependencies;
+        FrameVector<enki::Dependency> dependencies;
     };
 
     struct TaskDeleter : public enki::ICompletable
@@ -13,6 +13,7 @@ namespace worlds
     {
         const LoadedMesh& lm = MeshManager::loadOrGet(mesh);
         currentPose.boneTransforms.clear();
+        currentPose.hasBounds = false;
 
         for (const Bone& b : lm.bones)
         {
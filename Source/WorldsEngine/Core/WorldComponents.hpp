@@ -54,7 +54,16 @@ namespace worlds
     class Pose
     {
       public:
+        // Local transform of each bone relative to its parent
         std::vector<glm::mat4> boneTransforms;
+        // Model space bone transforms multiplied by the inverse bind pose, ready for skinning.
+        // Updated from boneTransforms by the animation system every frame.
+        std::vector<glm::mat4> skinningMatrices;
+        // Model space bounds of the posed mesh, worked out along with the skinning matrices. Until
+        // hasBounds is set the mesh's own bounds are used instead.
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        bool hasBounds = false;
     };
 
     struct SkinnedWorldObject : public WorldObject
@@ -63,6 +72,16 @@ namespace worlds
         void resetPose();
         Pose currentPose;
         uint32_t skinnedVertexOffset;
+        // Mesh whose skinned vertices are at skinnedVertexOffset, or ~0u if nothing has been
+        // skinned there since the offset last changed
+        AssetID skinnedMesh = ~0u;
+        // Where this object's skinning matrices go in the pose buffer this frame, or ~0u if it isn't
+        // being skinned. Set by the renderer before anything is drawn.
+        uint32_t poseOffset = ~0u;
+        // Set by the renderer every frame. Objects that aren't visible to any view or shadow map
+        // don't get skinned.
+        bool visible = true;
+        bool visibleInShadows = false;
     };
 
     struct UseWireframe
@@ -45,6 +45,9 @@ namespace worlds
 {
     slib::Subprocess* dotnetWatchProcess = nullptr;
     static ConVar ed_saveAsJson{"ed_saveAsJson", "0", "Save scene files as JSON rather than MessagePack."};
+    static ConVar ed_saveAsBinary{"ed_saveAsBinary", "0",
+                                  "Save scene files in the binary format rather than MessagePack. Overridden by "
+                                  "ed_saveAsJson."};
 
     const char* toolStr(Tool tool)
     {
@@ -214,6 +217,8 @@ namespace worlds
                     AssetID sceneId = reg.ctx<SceneInfo>().id;
                     if (ed_saveAsJson.getInt())
                         JsonSceneSerializer::saveScene(sceneId, reg);
+                    else if (ed_saveAsBinary.getInt())
+                        BinarySceneSerializer::saveScene(sceneId, reg);
                     else
                         MessagePackSceneSerializer::saveScene(sceneId, reg);
 
@@ -344,13 +349,11 @@ namespace worlds
             {
                 if (!reg.valid(ed->currentSelectedEntity))
                     return;
-                Transform& t = reg.get<Transform>(ed->currentSelectedEntity);
-                t.scale = glm::round(t.scale);
+                reg.patch<Transform>(ed->currentSelectedEntity, [](Transform& t) { t.scale = glm::round(t.scale); });
 
                 for (entt::entity e : ed->selectedEntities)
                 {
-                    Transform& t = reg.get<Transform>(e);
-                    t.scale = glm::round(t.scale);
+                    reg.patch<Transform>(e, [](Transform& t) { t.scale = glm::round(t.scale); });
                 }
             },
             "Round selection scale"
@@ -362,13 +365,11 @@ namespace worlds
             {
                 if (!reg.valid(ed->currentSelectedEntity))
                     return;
-                Transform& t = reg.get<Transform>(ed->currentSelectedEntity);
-                t.scale = glm::vec3(1.0f);
+                reg.patch<Transform>(ed->currentSelectedEntity, [](Transform& t) { t.scale = glm::vec3(1.0f); });
 
                 for (entt::entity e : ed->selectedEntities)
                 {
-                    Transform& t = reg.get<Transform>(e);
-                    t.scale = glm::vec3(1.0f);
+                    reg.patch<Transform>(e, [](Transform& t) { t.scale = glm::vec3(1.0f); });
                 }
             },
             "Clear selection scale"
@@ -386,10 +387,10 @@ namespace worlds
                     StaticFlags::Rendering |
                     StaticFlags::Navigation;
 
-                reg.get<WorldObject>(ed->currentSelectedEntity).staticFlags = allFlags;
+                reg.patch<WorldObject>(ed->currentSelectedEntity, [&](WorldObject& wo) { wo.staticFlags = allFlags; });
                 for (entt::entity e : ed->getSelectedEntities())
                 {
-                    reg.get<WorldObject>(e).staticFlags = allFlags;
+                    reg.patch<WorldObject>(e, [&](WorldObject& wo) { wo.staticFlags = allFlags; });
                 }
             },
             "Set selected object as static"
@@ -820,6 +821,8 @@ namespace worlds
                 {
                     auto& msTransform = reg.get<Transform>(ent);
                     msTransform.fromMatrix(deltaMatrix * msTransform.getMatrix());
+                    if (usingLast)
+                        reg.patch<Transform>(ent);
                 }
                 else
                 {
@@ -104,12 +104,16 @@ namespace worlds
                 {
                     auto& t = reg.get<Transform>(ed->handleOverrideEntity);
                     ed->handleTools(t, wPos, contentRegion, cam);
+                    if (ImGuizmo::IsUsing())
+                        reg.patch<Transform>(ed->handleOverrideEntity);
                 }
             }
             else if (reg.valid(ed->currentSelectedEntity))
             {
                 auto& selectedTransform = reg.get<Transform>(ed->currentSelectedEntity);
                 ed->handleTools(selectedTransform, wPos, contentRegion, cam);
+                if (ImGuizmo::IsUsing())
+                    reg.patch<Transform>(ed->currentSelectedEntity);
 
                 ChildComponent* childComponent = reg.try_get<ChildComponent>(ed->currentSelectedEntity);
                 if (childComponent)
@@ -0,0 +1,166 @@
+#include "NavCrowd.hpp"
+#include <Core/Log.hpp>
+#include <Core/Transform.hpp>
+
+#include <DetourCrowd.h>
+#include <entt/entity/registry.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <string.h>
+#include <Tracy.hpp>
+
+namespace worlds
+{
+    const float MaxAgentRadius = 2.0f;
+
+    dtCrowdAgentParams getCrowdParams(const NavAgent& agent, entt::entity ent)
+    {
+        dtCrowdAgentParams params{};
+        params.radius = agent.radius;
+        params.height = agent.height;
+        params.maxAcceleration = agent.maxAcceleration;
+        params.maxSpeed = agent.maxSpeed;
+        params.collisionQueryRange = agent.radius * 12.0f;
+        params.pathOptimizationRange = agent.radius * 30.0f;
+        params.separationWeight = 2.0f;
+        params.updateFlags = DT_CROWD_ANTICIPATE_TURNS | DT_CROWD_OBSTACLE_AVOIDANCE | DT_CROWD_SEPARATION |
+                             DT_CROWD_OPTIMIZE_VIS | DT_CROWD_OPTIMIZE_TOPO;
+        params.obstacleAvoidanceType = 3;
+        params.queryFilterType = 0;
+        params.userData = (void*)(uintptr_t)entt::to_integral(ent);
+        return params;
+    }
+
+    NavCrowd::NavCrowd(int maxAgents) : crowd(dtAllocCrowd()), maxAgents(maxAgents)
+    {
+    }
+
+    NavCrowd::~NavCrowd()
+    {
+        dtFreeCrowd(crowd);
+    }
+
+    void NavCrowd::reset(entt::registry& registry, const std::shared_ptr<dtNavMesh>& newNavMesh)
+    {
+        // Rebuilds swap in a new navmesh every time tiles change, so agents are carried over with their
+        // current motion rather than being dropped and starting again from rest
+        carriedAgents.clear();
+        if (navMesh)
+        {
+            registry.view<NavAgent>().each([&](entt::entity ent, NavAgent& agent) {
+                if (agent.crowdIndex < 0)
+                    return;
+
+                const dtCrowdAgent* crowdAgent = crowd->getAgent(agent.crowdIndex);
+                if (!crowdAgent->active)
+                    return;
+
+                carriedAgents.push_back({ent, glm::make_vec3(crowdAgent->npos), glm::make_vec3(crowdAgent->vel),
+                                         glm::make_vec3(crowdAgent->dvel), glm::make_vec3(crowdAgent->nvel)});
+            });
+        }
+
+        navMesh = newNavMesh;
+        activeAgents = 0;
+
+        // Agents get added again on the new navmesh, heading for the same target
+        registry.view<NavAgent>().each([](NavAgent& agent) {
+            agent.crowdIndex = -1;
+            agent.targetChanged = agent.hasTarget;
+        });
+
+        if (navMesh && !crowd->init(maxAgents, MaxAgentRadius, navMesh.get()))
+        {
+            logErr("Failed to initialise crowd");
+            navMesh.reset();
+        }
+
+        if (!navMesh)
+            return;
+
+        for (const CarriedAgent& carried : carriedAgents)
+        {
+            NavAgent& agent = registry.get<NavAgent>(carried.ent);
+            dtCrowdAgentParams params = getCrowdParams(agent, carried.ent);
+            agent.crowdIndex = crowd->addAgent(glm::value_ptr(carried.position), &params);
+
+            if (agent.crowdIndex < 0)
+                continue;
+
+            // The corridor is replanned on the new navmesh when update requests the target again
+            dtCrowdAgent* crowdAgent = crowd->getEditableAgent(agent.crowdIndex);
+            memcpy(crowdAgent->vel, glm::value_ptr(carried.velocity), sizeof(float) * 3);
+            memcpy(crowdAgent->dvel, glm::value_ptr(carried.desiredVelocity), sizeof(float) * 3);
+            memcpy(crowdAgent->nvel, glm::value_ptr(carried.avoidanceVelocity), sizeof(float) * 3);
+        }
+    }
+
+    void NavCrowd::update(entt::registry& registry, const std::shared_ptr<dtNavMesh>& currentNavMesh,
+                          float deltaTime)
+    {
+        ZoneScoped;
+        if (currentNavMesh != navMesh)
+            reset(registry, currentNavMesh);
+
+        if (!navMesh)
+            return;
+
+        // Remove agents whose entity has been destroyed or isn't an agent anymore
+        for (int i = 0; i < maxAgents; i++)
+        {
+            const dtCrowdAgent* crowdAgent = crowd->getAgent(i);
+            if (!crowdAgent->active)
+                continue;
+
+            entt::entity ent = (entt::entity)(uintptr_t)crowdAgent->params.userData;
+            if (!registry.valid(ent) || !registry.has<NavAgent>(ent) || registry.get<NavAgent>(ent).crowdIndex != i)
+                crowd->removeAgent(i);
+        }
+
+        const dtNavMeshQuery* query = crowd->getNavMeshQuery();
+        activeAgents = 0;
+
+        registry.view<Transform, NavAgent>().each([&](entt::entity ent, Transform& t, NavAgent& agent) {
+            if (agent.crowdIndex < 0)
+            {
+                dtCrowdAgentParams params = getCrowdParams(agent, ent);
+                agent.crowdIndex = crowd->addAgent(glm::value_ptr(t.position), &params);
+
+                if (agent.crowdIndex < 0)
+                    return;
+            }
+
+            activeAgents++;
+
+            if (!agent.targetChanged)
+                return;
+
+            agent.targetChanged = false;
+            dtPolyRef targetPoly;
+            glm::vec3 targetOnPoly;
+            dtStatus status = query->findNearestPoly(glm::value_ptr(agent.target), crowd->getQueryHalfExtents(),
+                                                     crowd->getFilter(0), &targetPoly, glm::value_ptr(targetOnPoly));
+
+            if (dtStatusFailed(status) || targetPoly == 0)
+            {
+                crowd->resetMoveTarget(agent.crowdIndex);
+                return;
+            }
+
+            crowd->requestMoveTarget(agent.crowdIndex, targetPoly, glm::value_ptr(targetOnPoly));
+        });
+
+        crowd->update(deltaTime, nullptr);
+
+        registry.view<Transform, NavAgent>().each([&](Transform& t, NavAgent& agent) {
+            if (agent.crowdIndex < 0)
+                return;
+
+            t.position = glm::make_vec3(crowd->getAgent(agent.crowdIndex)->npos);
+        });
+    }
+
+    int NavCrowd::activeAgentCount() const
+    {
+        return activeAgents;
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <DetourNavMesh.h>
+#include <entt/entity/fwd.hpp>
+#include <glm/vec3.hpp>
+#include <memory>
+#include <vector>
+
+class dtCrowd;
+
+namespace worlds
+{
+    // Moves an entity across the navmesh with local avoidance of other agents.
+    struct NavAgent
+    {
+        float radius = 0.5f;
+        float height = 2.0f;
+        float maxSpeed = 3.5f;
+        float maxAcceleration = 8.0f;
+
+        void setTarget(glm::vec3 newTarget)
+        {
+            target = newTarget;
+            hasTarget = true;
+            targetChanged = true;
+        }
+
+        glm::vec3 getTarget() const
+        {
+            return target;
+        }
+
+        int getCrowdIndex() const
+        {
+            return crowdIndex;
+        }
+
+      private:
+        friend class NavCrowd;
+        glm::vec3 target{0.0f};
+        bool hasTarget = false;
+        bool targetChanged = false;
+        int crowdIndex = -1;
+    };
+
+    // Simulates every NavAgent in a registry with a dtCrowd and writes their positions back to their transforms.
+    class NavCrowd
+    {
+      public:
+        NavCrowd(int maxAgents);
+        ~NavCrowd();
+        void update(entt::registry& registry, const std::shared_ptr<dtNavMesh>& navMesh, float deltaTime);
+        int activeAgentCount() const;
+
+      private:
+        void reset(entt::registry& registry, const std::shared_ptr<dtNavMesh>& navMesh);
+
+        struct CarriedAgent
+        {
+            entt::entity ent;
+            glm::vec3 position;
+            glm::vec3 velocity;
+            glm::vec3 desiredVelocity;
+            glm::vec3 avoidanceVelocity;
+        };
+
+        dtCrowd* crowd;
+        // Agents being moved over to a new navmesh by reset
+        std::vector<CarriedAgent> carriedAgents;
+        std::shared_ptr<dtNavMesh> navMesh;
+        int maxAgents;
+        int activeAgents = 0;
+    };
+}
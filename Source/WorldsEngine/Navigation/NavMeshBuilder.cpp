@@ -0,0 +1,845 @@
+#include "NavMeshBuilder.hpp"
+#include <Core/Engine.hpp>
+#include <Core/Log.hpp>
+#include <Core/MeshManager.hpp>
+#include <Core/TaskScheduler.hpp>
+#include <Core/WorldComponents.hpp>
+#include <Util/EnumUtil.hpp>
+
+#include <DetourAlloc.h>
+#include <DetourCommon.h>
+#include <DetourNavMeshBuilder.h>
+#include <Recast.h>
+#include <entt/entity/registry.hpp>
+
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <random>
+#include <robin_hood.h>
+#include <string.h>
+#include <Tracy.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define NAV_USE_SSE
+#include <emmintrin.h>
+#endif
+
+namespace worlds
+{
+    const float CellSize = 0.125f;
+    const float CellHeight = 0.4f;
+    // Width and depth of a tile in cells
+    const int TileSize = 128;
+
+    const rcConfig recastConfig
+    {
+        .width = 0,
+        .height = 0,
+        .tileSize = TileSize,
+        .borderSize = (int)ceilf(0.5f / CellSize) + 3,
+        .cs = CellSize,
+        .ch = CellHeight,
+        .walkableSlopeAngle = 30.0f,
+        .walkableHeight = (int)ceilf(2.0f / CellHeight),
+        .walkableClimb = (int)floorf(0.2f / CellHeight),
+        .walkableRadius = (int)ceilf(0.5f / CellSize),
+        .maxEdgeLen = 40,
+        .maxSimplificationError = 0.25f,
+        .minRegionArea = 64,
+        .mergeRegionArea = 400,
+        .maxVertsPerPoly = 6,
+        .detailSampleDist = 1.0f,
+        .detailSampleMaxError = 0.1f
+    };
+
+    class CustomRCContext : public rcContext
+    {
+      public:
+        CustomRCContext() : rcContext(true)
+        {
+        }
+        virtual ~CustomRCContext()
+        {
+        }
+
+      protected:
+        void doLog(const rcLogCategory category, const char* msg, const int len) override
+        {
+            switch (category)
+            {
+            case RC_LOG_PROGRESS:
+                logVrb("Recast: %s", msg);
+                break;
+            case RC_LOG_WARNING:
+                logWarn("Recast: %s", msg);
+                break;
+            case RC_LOG_ERROR:
+                logErr("Recast: %s", msg);
+                break;
+            }
+        }
+
+      private:
+    };
+
+    static uint64_t tileKey(int x, int y)
+    {
+        return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y;
+    }
+
+    // Intermediate Recast data for a single tile, freed when the tile is done
+    struct TileBuildData
+    {
+        rcHeightfield* heightfield = nullptr;
+        rcCompactHeightfield* compactHeightfield = nullptr;
+        rcContourSet* contourSet = nullptr;
+        rcPolyMesh* polyMesh = nullptr;
+        rcPolyMeshDetail* polyMeshDetail = nullptr;
+
+        ~TileBuildData()
+        {
+            rcFreeHeightField(heightfield);
+            rcFreeCompactHeightfield(compactHeightfield);
+            rcFreeContourSet(contourSet);
+            rcFreePolyMesh(polyMesh);
+            rcFreePolyMeshDetail(polyMeshDetail);
+        }
+    };
+
+    static robin_hood::unordered_node_map<AssetID, NavSourceMesh> sourceMeshCache;
+
+    // Transforms positions by a matrix, expanding bbMin and bbMax to fit them
+    void transformPositions(const glm::vec3* src, size_t count, const glm::mat4& m, glm::vec3* dst,
+                            glm::vec3& bbMin, glm::vec3& bbMax)
+    {
+#ifdef NAV_USE_SSE
+        __m128 c0 = _mm_loadu_ps(&m[0][0]);
+        __m128 c1 = _mm_loadu_ps(&m[1][0]);
+        __m128 c2 = _mm_loadu_ps(&m[2][0]);
+        __m128 c3 = _mm_loadu_ps(&m[3][0]);
+        __m128 vMin = _mm_set1_ps(FLT_MAX);
+        __m128 vMax = _mm_set1_ps(-FLT_MAX);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            __m128 xy = _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(src[i].x)), _mm_mul_ps(c1, _mm_set1_ps(src[i].y)));
+            __m128 zw = _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(src[i].z)), c3);
+            __m128 r = _mm_add_ps(xy, zw);
+            vMin = _mm_min_ps(vMin, r);
+            vMax = _mm_max_ps(vMax, r);
+
+            float out[4];
+            _mm_storeu_ps(out, r);
+            dst[i] = glm::vec3{out[0], out[1], out[2]};
+        }
+
+        float outMin[4];
+        float outMax[4];
+        _mm_storeu_ps(outMin, vMin);
+        _mm_storeu_ps(outMax, vMax);
+        bbMin = glm::min(bbMin, glm::vec3{outMin[0], outMin[1], outMin[2]});
+        bbMax = glm::max(bbMax, glm::vec3{outMax[0], outMax[1], outMax[2]});
+#else
+        for (size_t i = 0; i < count; i++)
+        {
+            dst[i] = m * glm::vec4(src[i], 1.0f);
+            bbMin = glm::min(bbMin, dst[i]);
+            bbMax = glm::max(bbMax, dst[i]);
+        }
+#endif
+    }
+
+    void offsetIndices(const int* src, size_t count, int offset, int* dst)
+    {
+        size_t i = 0;
+#ifdef NAV_USE_SSE
+        __m128i vOffset = _mm_set1_epi32(offset);
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i idx = _mm_loadu_si128((const __m128i*)(src + i));
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_add_epi32(idx, vOffset));
+        }
+#endif
+        for (; i < count; i++)
+        {
+            dst[i] = src[i] + offset;
+        }
+    }
+
+    const NavSourceMesh& NavMeshBuilder::getSourceMesh(AssetID id)
+    {
+        auto it = sourceMeshCache.find(id);
+        if (it != sourceMeshCache.end())
+            return it->second;
+
+        const LoadedMesh& mesh = MeshManager::loadOrGet(id);
+        NavSourceMesh& sourceMesh = sourceMeshCache[id];
+
+        sourceMesh.positions.resize(mesh.vertices.size());
+        for (size_t i = 0; i < mesh.vertices.size(); i++)
+        {
+            sourceMesh.positions[i] = mesh.vertices[i].position;
+            sourceMesh.aabbMin = glm::min(sourceMesh.aabbMin, sourceMesh.positions[i]);
+            sourceMesh.aabbMax = glm::max(sourceMesh.aabbMax, sourceMesh.positions[i]);
+        }
+
+        sourceMesh.triangles.assign(mesh.indices.begin(), mesh.indices.end());
+
+        return sourceMesh;
+    }
+
+    void NavMeshBuilder::clearSourceMeshCache()
+    {
+        sourceMeshCache.clear();
+    }
+
+    bool NavMeshBuilder::gatherGeometry(entt::registry& registry, NavInputGeometry& geometry)
+    {
+        ZoneScoped;
+        geometry = NavInputGeometry{};
+
+        struct Instance
+        {
+            const NavSourceMesh* mesh;
+            glm::mat4 transform;
+            size_t vertexOffset;
+            size_t indexOffset;
+            glm::vec3 bbMin;
+            glm::vec3 bbMax;
+        };
+
+        std::vector<Instance> instances;
+        size_t numIndices = 0;
+        size_t numVertices = 0;
+
+        registry.view<Transform, WorldObject>().each([&](Transform& t, WorldObject& o) {
+            if (!enumHasFlag(o.staticFlags, StaticFlags::Navigation))
+                return;
+
+            const NavSourceMesh& mesh = getSourceMesh(o.mesh);
+            instances.push_back(Instance{&mesh, t.getMatrix(), numVertices, numIndices, glm::vec3{FLT_MAX},
+                                         glm::vec3{-FLT_MAX}});
+            numIndices += mesh.triangles.size();
+            numVertices += mesh.positions.size();
+        });
+
+        if (numVertices == 0)
+            return false;
+
+        geometry.vertices.resize(numVertices);
+        geometry.triangles.resize(numIndices);
+
+        // Instances write to their own part of the arrays, so they can all be transformed at once
+        enki::TaskSet transformTask{(uint32_t)instances.size(), [&](enki::TaskSetPartition range, uint32_t) {
+            ZoneScopedN("Transform Nav Geometry");
+            for (uint32_t i = range.start; i < range.end; i++)
+            {
+                Instance& instance = instances[i];
+                transformPositions(instance.mesh->positions.data(), instance.mesh->positions.size(),
+                                   instance.transform, &geometry.vertices[instance.vertexOffset], instance.bbMin,
+                                   instance.bbMax);
+                offsetIndices(instance.mesh->triangles.data(), instance.mesh->triangles.size(),
+                              (int)instance.vertexOffset, &geometry.triangles[instance.indexOffset]);
+            }
+        }};
+        transformTask.m_MinRange = 16;
+
+        g_taskSched.AddTaskSetToPipe(&transformTask);
+        g_taskSched.WaitforTask(&transformTask);
+
+        for (const Instance& instance : instances)
+        {
+            geometry.bbMin = glm::min(geometry.bbMin, instance.bbMin);
+            geometry.bbMax = glm::max(geometry.bbMax, instance.bbMax);
+        }
+
+        return true;
+    }
+
+    void NavMeshBuilder::appendMesh(NavInputGeometry& geometry, const NavSourceMesh& mesh, const glm::mat4& transform)
+    {
+        size_t baseVertex = geometry.vertices.size();
+        size_t baseIndex = geometry.triangles.size();
+        geometry.vertices.resize(baseVertex + mesh.positions.size());
+        geometry.triangles.resize(baseIndex + mesh.triangles.size());
+
+        transformPositions(mesh.positions.data(), mesh.positions.size(), transform, &geometry.vertices[baseVertex],
+                           geometry.bbMin, geometry.bbMax);
+        offsetIndices(mesh.triangles.data(), mesh.triangles.size(), (int)baseVertex, &geometry.triangles[baseIndex]);
+    }
+
+    void NavMeshBuilder::markWalkableTriangles(NavInputGeometry& geometry)
+    {
+        ZoneScoped;
+        geometry.triangleAreas.assign(geometry.triangleCount(), 0);
+        if (geometry.triangleCount() == 0)
+            return;
+
+        enki::TaskSet markTask{(uint32_t)geometry.triangleCount(), [&](enki::TaskSetPartition range, uint32_t) {
+            CustomRCContext ctx;
+            rcMarkWalkableTriangles(&ctx, recastConfig.walkableSlopeAngle, (const float*)geometry.vertices.data(),
+                                    (int)geometry.vertices.size(), &geometry.triangles[range.start * 3],
+                                    range.end - range.start, &geometry.triangleAreas[range.start]);
+        }};
+        markTask.m_MinRange = 4096;
+
+        g_taskSched.AddTaskSetToPipe(&markTask);
+        g_taskSched.WaitforTask(&markTask);
+    }
+
+    struct ChunkBoundsItem
+    {
+        glm::vec2 bmin;
+        glm::vec2 bmax;
+        int triangle;
+    };
+
+    void calcChunkExtents(const std::vector<ChunkBoundsItem>& items, int imin, int imax, glm::vec2& bmin,
+                          glm::vec2& bmax)
+    {
+        bmin = items[imin].bmin;
+        bmax = items[imin].bmax;
+
+        for (int i = imin + 1; i < imax; i++)
+        {
+            bmin = glm::min(bmin, items[i].bmin);
+            bmax = glm::max(bmax, items[i].bmax);
+        }
+    }
+
+    void subdivideChunks(std::vector<ChunkBoundsItem>& items, int imin, int imax, int trisPerChunk, int& curNode,
+                         int& curTri, const NavInputGeometry& geometry, NavChunkyTriMesh& chunks)
+    {
+        int inum = imax - imin;
+        int icur = curNode;
+        NavChunkyTriMesh::Node& node = chunks.nodes[curNode++];
+        calcChunkExtents(items, imin, imax, node.bmin, node.bmax);
+
+        if (inum <= trisPerChunk)
+        {
+            node.i = curTri;
+            node.n = inum;
+
+            for (int i = imin; i < imax; i++)
+            {
+                int tri = items[i].triangle;
+                memcpy(&chunks.triangles[curTri * 3], &geometry.triangles[tri * 3], sizeof(int) * 3);
+                chunks.triangleAreas[curTri] = geometry.triangleAreas[tri];
+                curTri++;
+            }
+            return;
+        }
+
+        // Split along the longer axis
+        glm::vec2 extent = node.bmax - node.bmin;
+        int axis = extent.x >= extent.y ? 0 : 1;
+        std::sort(items.begin() + imin, items.begin() + imax,
+                  [axis](const ChunkBoundsItem& a, const ChunkBoundsItem& b) { return a.bmin[axis] < b.bmin[axis]; });
+
+        int isplit = imin + inum / 2;
+        subdivideChunks(items, imin, isplit, trisPerChunk, curNode, curTri, geometry, chunks);
+        subdivideChunks(items, isplit, imax, trisPerChunk, curNode, curTri, geometry, chunks);
+
+        chunks.nodes[icur].i = -(curNode - icur);
+    }
+
+    void NavMeshBuilder::partitionTriangles(NavInputGeometry& geometry)
+    {
+        ZoneScoped;
+        const int trisPerChunk = 256;
+        NavChunkyTriMesh& chunks = geometry.chunks;
+        int triangleCount = geometry.triangleCount();
+
+        chunks = NavChunkyTriMesh{};
+        if (triangleCount == 0)
+            return;
+
+        std::vector<ChunkBoundsItem> items(triangleCount);
+        for (int i = 0; i < triangleCount; i++)
+        {
+            ChunkBoundsItem& item = items[i];
+            item.triangle = i;
+
+            const glm::vec3& v0 = geometry.vertices[geometry.triangles[i * 3 + 0]];
+            const glm::vec3& v1 = geometry.vertices[geometry.triangles[i * 3 + 1]];
+            const glm::vec3& v2 = geometry.vertices[geometry.triangles[i * 3 + 2]];
+            item.bmin = glm::min(glm::vec2{v0.x, v0.z}, glm::min(glm::vec2{v1.x, v1.z}, glm::vec2{v2.x, v2.z}));
+            item.bmax = glm::max(glm::vec2{v0.x, v0.z}, glm::max(glm::vec2{v1.x, v1.z}, glm::vec2{v2.x, v2.z}));
+        }
+
+        int numChunks = (triangleCount + trisPerChunk - 1) / trisPerChunk;
+        chunks.nodes.resize(numChunks * 4);
+        chunks.triangles.resize(geometry.triangles.size());
+        chunks.triangleAreas.resize(triangleCount);
+
+        int curNode = 0;
+        int curTri = 0;
+        subdivideChunks(items, 0, triangleCount, trisPerChunk, curNode, curTri, geometry, chunks);
+        chunks.nodes.resize(curNode);
+    }
+
+    void NavMeshBuilder::prepareGeometry(NavInputGeometry& geometry)
+    {
+        markWalkableTriangles(geometry);
+        partitionTriangles(geometry);
+    }
+
+    void NavChunkyTriMesh::queryOverlapping(glm::vec2 qmin, glm::vec2 qmax, std::vector<int>& leaves) const
+    {
+        size_t i = 0;
+        while (i < nodes.size())
+        {
+            const Node& node = nodes[i];
+            bool overlap = qmin.x <= node.bmax.x && qmax.x >= node.bmin.x && qmin.y <= node.bmax.y &&
+                           qmax.y >= node.bmin.y;
+            bool isLeaf = node.i >= 0;
+
+            if (isLeaf && overlap)
+                leaves.push_back((int)i);
+
+            if (overlap || isLeaf)
+                i++;
+            else
+                i += -node.i;
+        }
+    }
+
+    NavMeshLayout NavMeshBuilder::calculateLayout(const NavInputGeometry& geometry)
+    {
+        NavMeshLayout layout{};
+
+        int gridWidth, gridHeight;
+        rcCalcGridSize(&geometry.bbMin.x, &geometry.bbMax.x, recastConfig.cs, &gridWidth, &gridHeight);
+        layout.tilesX = (gridWidth + TileSize - 1) / TileSize;
+        layout.tilesY = (gridHeight + TileSize - 1) / TileSize;
+
+        // Polygon references only have 22 bits to split between the tile and polygon index
+        int tileBits = rcMin((int)dtIlog2(dtNextPow2(layout.tilesX * layout.tilesY)), 14);
+        int polyBits = 22 - tileBits;
+
+        if (layout.tilesX * layout.tilesY > (1 << tileBits))
+        {
+            logWarn("Navmesh needs %i tiles but only %i fit, some of the level won't be navigable",
+                    layout.tilesX * layout.tilesY, 1 << tileBits);
+        }
+
+        dtVcopy(layout.params.orig, &geometry.bbMin.x);
+        layout.params.tileWidth = TileSize * recastConfig.cs;
+        layout.params.tileHeight = TileSize * recastConfig.cs;
+        layout.params.maxTiles = 1 << tileBits;
+        layout.params.maxPolys = 1 << polyBits;
+
+        return layout;
+    }
+
+    bool NavMeshBuilder::buildTile(const NavInputGeometry& geometry, const NavMeshLayout& layout, int x, int y,
+                                   NavMeshTile& tile)
+    {
+        ZoneScoped;
+        tile = NavMeshTile{x, y};
+
+        rcConfig cfg = recastConfig;
+        cfg.width = cfg.tileSize + cfg.borderSize * 2;
+        cfg.height = cfg.tileSize + cfg.borderSize * 2;
+
+        // Tiles are expanded by the border so that neighbouring tiles' edges line up
+        const float tileWorldSize = cfg.tileSize * cfg.cs;
+        const float borderWorldSize = cfg.borderSize * cfg.cs;
+        cfg.bmin[0] = layout.params.orig[0] + x * tileWorldSize - borderWorldSize;
+        cfg.bmin[1] = geometry.bbMin.y;
+        cfg.bmin[2] = layout.params.orig[2] + y * tileWorldSize - borderWorldSize;
+        cfg.bmax[0] = layout.params.orig[0] + (x + 1) * tileWorldSize + borderWorldSize;
+        cfg.bmax[1] = geometry.bbMax.y;
+        cfg.bmax[2] = layout.params.orig[2] + (y + 1) * tileWorldSize + borderWorldSize;
+
+        // rcContext isn't thread-safe, so each tile gets its own
+        CustomRCContext ctx;
+        TileBuildData tbd;
+
+        tbd.heightfield = rcAllocHeightfield();
+        if (!rcCreateHeightfield(&ctx, *tbd.heightfield, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch))
+        {
+            logErr("Failed to create heightfield for navmesh tile %i, %i", x, y);
+            return false;
+        }
+
+        const float* vertices = (const float*)geometry.vertices.data();
+        const int vertexCount = (int)geometry.vertices.size();
+
+        if (geometry.chunks.empty())
+        {
+            if (!rcRasterizeTriangles(&ctx, vertices, vertexCount, geometry.triangles.data(),
+                                      geometry.triangleAreas.data(), geometry.triangleCount(), *tbd.heightfield,
+                                      cfg.walkableClimb))
+            {
+                logErr("Failed to rasterize triangles for navmesh tile %i, %i", x, y);
+                return false;
+            }
+        }
+        else
+        {
+            // Only rasterize the chunks of triangles that overlap the tile
+            std::vector<int> leaves;
+            geometry.chunks.queryOverlapping(glm::vec2{cfg.bmin[0], cfg.bmin[2]}, glm::vec2{cfg.bmax[0], cfg.bmax[2]},
+                                             leaves);
+
+            if (leaves.empty())
+                return false;
+
+            for (int leaf : leaves)
+            {
+                const NavChunkyTriMesh::Node& node = geometry.chunks.nodes[leaf];
+                if (!rcRasterizeTriangles(&ctx, vertices, vertexCount, &geometry.chunks.triangles[node.i * 3],
+                                          &geometry.chunks.triangleAreas[node.i], node.n, *tbd.heightfield,
+                                          cfg.walkableClimb))
+                {
+                    logErr("Failed to rasterize triangles for navmesh tile %i, %i", x, y);
+                    return false;
+                }
+            }
+        }
+
+        rcFilterLowHangingWalkableObstacles(&ctx, cfg.walkableClimb, *tbd.heightfield);
+        rcFilterLedgeSpans(&ctx, cfg.walkableHeight, cfg.walkableClimb, *tbd.heightfield);
+        rcFilterWalkableLowHeightSpans(&ctx, cfg.walkableHeight, *tbd.heightfield);
+
+        tbd.compactHeightfield = rcAllocCompactHeightfield();
+        if (!rcBuildCompactHeightfield(&ctx, cfg.walkableHeight, cfg.walkableClimb, *tbd.heightfield,
+                                       *tbd.compactHeightfield))
+        {
+            logErr("Failed to build compact heightfield for navmesh tile %i, %i", x, y);
+            return false;
+        }
+
+        rcFreeHeightField(tbd.heightfield);
+        tbd.heightfield = nullptr;
+
+        rcErodeWalkableArea(&ctx, cfg.walkableRadius, *tbd.compactHeightfield);
+        rcBuildDistanceField(&ctx, *tbd.compactHeightfield);
+        rcBuildRegions(&ctx, *tbd.compactHeightfield, cfg.borderSize, cfg.minRegionArea, cfg.mergeRegionArea);
+
+        tbd.contourSet = rcAllocContourSet();
+        rcBuildContours(&ctx, *tbd.compactHeightfield, cfg.maxSimplificationError, cfg.maxEdgeLen, *tbd.contourSet);
+
+        // Nothing walkable in this tile
+        if (tbd.contourSet->nconts == 0)
+            return false;
+
+        tbd.polyMesh = rcAllocPolyMesh();
+        if (!rcBuildPolyMesh(&ctx, *tbd.contourSet, cfg.maxVertsPerPoly, *tbd.polyMesh))
+        {
+            logErr("Failed to build poly mesh for navmesh tile %i, %i", x, y);
+            return false;
+        }
+
+        tbd.polyMeshDetail = rcAllocPolyMeshDetail();
+        if (!rcBuildPolyMeshDetail(&ctx, *tbd.polyMesh, *tbd.compactHeightfield, cfg.detailSampleDist,
+                                   cfg.detailSampleMaxError, *tbd.polyMeshDetail))
+        {
+            logErr("Failed to build detail mesh for navmesh tile %i, %i", x, y);
+            return false;
+        }
+
+        rcPolyMesh* polyMesh = tbd.polyMesh;
+        rcPolyMeshDetail* polyMeshDetail = tbd.polyMeshDetail;
+
+        if (polyMesh->nverts == 0 || polyMesh->npolys == 0)
+            return false;
+
+        for (int i = 0; i < polyMesh->npolys; i++)
+        {
+            polyMesh->flags[i] = 1;
+        }
+
+        dtNavMeshCreateParams params{};
+        params.verts = polyMesh->verts;
+        params.vertCount = polyMesh->nverts;
+        params.polys = polyMesh->polys;
+        params.polyAreas = polyMesh->areas;
+        params.polyFlags = polyMesh->flags;
+        params.polyCount = polyMesh->npolys;
+        params.nvp = polyMesh->nvp;
+
+        params.detailMeshes = polyMeshDetail->meshes;
+        params.detailVerts = polyMeshDetail->verts;
+        params.detailVertsCount = polyMeshDetail->nverts;
+        params.detailTris = polyMeshDetail->tris;
+        params.detailTriCount = polyMeshDetail->ntris;
+
+        params.walkableHeight = cfg.walkableHeight * cfg.ch;
+        params.walkableRadius = cfg.walkableRadius * cfg.cs;
+        params.walkableClimb = cfg.walkableClimb * cfg.ch;
+        params.tileX = x;
+        params.tileY = y;
+        params.tileLayer = 0;
+        dtVcopy(params.bmin, polyMesh->bmin);
+        dtVcopy(params.bmax, polyMesh->bmax);
+
+        params.cs = cfg.cs;
+        params.ch = cfg.ch;
+        params.buildBvTree = true;
+
+        if (!dtCreateNavMeshData(&params, &tile.data, &tile.dataSize))
+        {
+            logErr("Failed to create nav mesh data for tile %i, %i", x, y);
+            return false;
+        }
+
+        return true;
+    }
+
+    void NavMeshBuilder::buildTiles(const NavInputGeometry& geometry, const NavMeshLayout& layout,
+                                    std::vector<NavMeshTile>& tiles, bool parallel)
+    {
+        ZoneScoped;
+        uint32_t tileCount = layout.tilesX * layout.tilesY;
+        std::vector<NavMeshTile> builtTiles;
+        std::vector<uint8_t> tileBuilt;
+        builtTiles.resize(tileCount);
+        tileBuilt.resize(tileCount);
+
+        auto buildRange = [&](uint32_t start, uint32_t end) {
+            for (uint32_t i = start; i < end; i++)
+            {
+                tileBuilt[i] = buildTile(geometry, layout, i % layout.tilesX, i / layout.tilesX, builtTiles[i]);
+            }
+        };
+
+        if (parallel && tileCount > 0)
+        {
+            enki::TaskSet buildTask{tileCount, [&](enki::TaskSetPartition range, uint32_t) {
+                buildRange(range.start, range.end);
+            }};
+            buildTask.m_MinRange = 1;
+
+            g_taskSched.AddTaskSetToPipe(&buildTask);
+            g_taskSched.WaitforTask(&buildTask);
+        }
+        else
+        {
+            buildRange(0, tileCount);
+        }
+
+        tiles.clear();
+        for (uint32_t i = 0; i < tileCount; i++)
+        {
+            if (tileBuilt[i])
+                tiles.push_back(builtTiles[i]);
+        }
+    }
+
+    dtNavMesh* NavMeshBuilder::createNavMesh(const NavMeshLayout& layout, std::vector<NavMeshTile>& tiles)
+    {
+        dtNavMesh* navMesh = dtAllocNavMesh();
+
+        if (dtStatusFailed(navMesh->init(&layout.params)))
+        {
+            logErr("Failed to initialise nav mesh");
+            dtFreeNavMesh(navMesh);
+            freeTiles(tiles);
+            return nullptr;
+        }
+
+        for (NavMeshTile& tile : tiles)
+        {
+            if (dtStatusFailed(navMesh->addTile(tile.data, tile.dataSize, DT_TILE_FREE_DATA, 0, nullptr)))
+            {
+                logErr("Failed to add navmesh tile %i, %i", tile.x, tile.y);
+                dtFree(tile.data);
+            }
+
+            tile.data = nullptr;
+        }
+
+        tiles.clear();
+        return navMesh;
+    }
+
+    void NavMeshBuilder::freeTiles(std::vector<NavMeshTile>& tiles)
+    {
+        for (NavMeshTile& tile : tiles)
+        {
+            dtFree(tile.data);
+        }
+
+        tiles.clear();
+    }
+
+    dtNavMesh* NavMeshBuilder::createUpdatedNavMesh(const dtNavMesh* base, std::vector<NavMeshTile>& newTiles,
+                                                    const std::vector<std::pair<int, int>>& rebuiltCoords)
+    {
+        ZoneScoped;
+        dtNavMesh* navMesh = dtAllocNavMesh();
+
+        if (dtStatusFailed(navMesh->init(base->getParams())))
+        {
+            logErr("Failed to initialise nav mesh");
+            dtFreeNavMesh(navMesh);
+            freeTiles(newTiles);
+            return nullptr;
+        }
+
+        auto isRebuilt = [&](int x, int y) {
+            for (const std::pair<int, int>& coord : rebuiltCoords)
+            {
+                if (coord.first == x && coord.second == y)
+                    return true;
+            }
+            return false;
+        };
+
+        // Unchanged tiles keep their refs so polygon refs from the old navmesh stay valid.
+        // Rebuilt tiles take over their old slot with the salt bumped, which invalidates refs into them.
+        robin_hood::unordered_flat_map<uint64_t, dtTileRef> rebuiltRefs;
+        for (int i = 0; i < base->getMaxTiles(); i++)
+        {
+            const dtMeshTile* tile = base->getTile(i);
+            if (!tile->header || tile->dataSize == 0)
+                continue;
+
+            dtTileRef ref = base->getTileRef(tile);
+
+            if (isRebuilt(tile->header->x, tile->header->y))
+            {
+                unsigned int salt = base->decodePolyIdSalt(ref) + 1;
+                dtTileRef newRef = base->encodePolyId(salt, base->decodePolyIdTile(ref), 0);
+                if (base->decodePolyIdSalt(newRef) == 0)
+                    newRef = base->encodePolyId(1, base->decodePolyIdTile(ref), 0);
+
+                rebuiltRefs[tileKey(tile->header->x, tile->header->y)] = newRef;
+                continue;
+            }
+
+            uint8_t* data = (uint8_t*)dtAlloc(tile->dataSize, DT_ALLOC_PERM);
+            memcpy(data, tile->data, tile->dataSize);
+
+            if (dtStatusFailed(navMesh->addTile(data, tile->dataSize, DT_TILE_FREE_DATA, ref, nullptr)))
+            {
+                logErr("Failed to copy navmesh tile %i, %i", tile->header->x, tile->header->y);
+                dtFree(data);
+            }
+        }
+
+        // Tiles replacing an old one have to go in first so their slots aren't taken by brand new tiles
+        std::stable_partition(newTiles.begin(), newTiles.end(), [&](const NavMeshTile& tile) {
+            return rebuiltRefs.contains(tileKey(tile.x, tile.y));
+        });
+
+        for (NavMeshTile& tile : newTiles)
+        {
+            auto refIt = rebuiltRefs.find(tileKey(tile.x, tile.y));
+            dtTileRef lastRef = refIt == rebuiltRefs.end() ? 0 : refIt->second;
+
+            if (dtStatusFailed(navMesh->addTile(tile.data, tile.dataSize, DT_TILE_FREE_DATA, lastRef, nullptr)))
+            {
+                logErr("Failed to add navmesh tile %i, %i", tile.x, tile.y);
+                dtFree(tile.data);
+            }
+
+            tile.data = nullptr;
+        }
+
+        newTiles.clear();
+        return navMesh;
+    }
+
+    bool NavMeshBuilder::isTiled(const dtNavMeshParams& params)
+    {
+        return params.tileWidth == TileSize * recastConfig.cs && params.tileHeight == TileSize * recastConfig.cs;
+    }
+
+    NavTileRange NavMeshBuilder::calculateTileRange(const dtNavMeshParams& params, glm::vec3 bbMin, glm::vec3 bbMax)
+    {
+        // Tiles rasterize geometry within their border too, so anything that close has an effect
+        const float border = recastConfig.borderSize * recastConfig.cs;
+
+        NavTileRange range;
+        range.minX = (int)floorf((bbMin.x - border - params.orig[0]) / params.tileWidth);
+        range.minY = (int)floorf((bbMin.z - border - params.orig[2]) / params.tileHeight);
+        range.maxX = (int)floorf((bbMax.x + border - params.orig[0]) / params.tileWidth);
+        range.maxY = (int)floorf((bbMax.z + border - params.orig[2]) / params.tileHeight);
+        return range;
+    }
+
+    void addTestBox(NavInputGeometry& geometry, glm::vec3 min, glm::vec3 max)
+    {
+        int base = (int)geometry.vertices.size();
+
+        for (int i = 0; i < 8; i++)
+        {
+            geometry.vertices.emplace_back(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z);
+        }
+
+        // Top face is wound so its normal points up, the sides are never walkable so their winding doesn't matter
+        const int boxTriangles[] = {
+            2, 6, 3, 3, 6, 7, // top
+            0, 1, 2, 2, 1, 3, // -z
+            4, 6, 5, 5, 6, 7, // +z
+            0, 2, 4, 4, 2, 6, // -x
+            1, 5, 3, 3, 5, 7, // +x
+        };
+
+        for (int idx : boxTriangles)
+        {
+            geometry.triangles.push_back(base + idx);
+        }
+    }
+
+    void NavMeshBuilder::generateTestLevel(NavInputGeometry& geometry, float size, uint32_t seed)
+    {
+        geometry = NavInputGeometry{};
+        std::mt19937 rng{seed};
+        std::uniform_real_distribution<float> posDist{0.0f, size};
+        std::uniform_real_distribution<float> extentDist{0.5f, 4.0f};
+        std::uniform_real_distribution<float> heightDist{0.3f, 6.0f};
+
+        // Rolling terrain made of 2m quads
+        const float spacing = 2.0f;
+        const int resolution = (int)(size / spacing);
+        auto terrainHeight = [](float x, float z) { return sinf(x * 0.05f) * cosf(z * 0.065f) * 3.0f; };
+
+        geometry.vertices.reserve((resolution + 1) * (resolution + 1));
+        geometry.triangles.reserve(resolution * resolution * 6);
+
+        for (int z = 0; z <= resolution; z++)
+        {
+            for (int x = 0; x <= resolution; x++)
+            {
+                geometry.vertices.emplace_back(x * spacing, terrainHeight(x * spacing, z * spacing), z * spacing);
+            }
+        }
+
+        for (int z = 0; z < resolution; z++)
+        {
+            for (int x = 0; x < resolution; x++)
+            {
+                int v00 = z * (resolution + 1) + x;
+                int v10 = v00 + 1;
+                int v01 = v00 + resolution + 1;
+                int v11 = v01 + 1;
+
+                const int quad[] = {v00, v01, v10, v10, v01, v11};
+                geometry.triangles.insert(geometry.triangles.end(), std::begin(quad), std::end(quad));
+            }
+        }
+
+        // Scatter obstacles and raised platforms, about one per 100 square metres
+        int boxCount = (int)(size * size / 100.0f);
+        for (int i = 0; i < boxCount; i++)
+        {
+            glm::vec3 centre{posDist(rng), 0.0f, posDist(rng)};
+            centre.y = terrainHeight(centre.x, centre.z);
+            glm::vec3 halfExtents{extentDist(rng), 0.0f, extentDist(rng)};
+            float height = heightDist(rng);
+
+            addTestBox(geometry, centre - glm::vec3{halfExtents.x, 1.0f, halfExtents.z},
+                       centre + glm::vec3{halfExtents.x, height, halfExtents.z});
+        }
+
+        for (const glm::vec3& v : geometry.vertices)
+        {
+            geometry.bbMin = glm::min(v, geometry.bbMin);
+            geometry.bbMax = glm::max(v, geometry.bbMax);
+        }
+    }
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include <DetourNavMesh.h>
+#include <entt/entity/fwd.hpp>
+#include <float.h>
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+namespace worlds
+{
+    typedef uint32_t AssetID;
+
+    // Local space positions and triangles of a mesh, cached so instances don't have to go through the full mesh.
+    struct NavSourceMesh
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<int> triangles;
+        glm::vec3 aabbMin{FLT_MAX};
+        glm::vec3 aabbMax{-FLT_MAX};
+    };
+
+    // Bounding volume hierarchy over triangles on the XZ plane, so a tile only has to rasterize the
+    // triangles near it. Based on rcChunkyTriMesh from the Recast demo.
+    struct NavChunkyTriMesh
+    {
+        struct Node
+        {
+            glm::vec2 bmin;
+            glm::vec2 bmax;
+            // For leaves, the first triangle in the chunk. For other nodes, minus the index of the next
+            // node that isn't a child.
+            int i;
+            int n;
+        };
+
+        std::vector<Node> nodes;
+        // Triangles and areas reordered so each leaf's triangles are contiguous
+        std::vector<int> triangles;
+        std::vector<uint8_t> triangleAreas;
+
+        bool empty() const
+        {
+            return nodes.empty();
+        }
+
+        // Adds the indices of the leaves overlapping the XZ rectangle to leaves.
+        void queryOverlapping(glm::vec2 bmin, glm::vec2 bmax, std::vector<int>& leaves) const;
+    };
+
+    // World space triangle soup that the navmesh is built from.
+    struct NavInputGeometry
+    {
+        std::vector<glm::vec3> vertices;
+        std::vector<int> triangles;
+        // Walkable area of each triangle, filled in by NavMeshBuilder::markWalkableTriangles
+        std::vector<uint8_t> triangleAreas;
+        glm::vec3 bbMin{FLT_MAX};
+        glm::vec3 bbMax{-FLT_MAX};
+        // Filled in by NavMeshBuilder::partitionTriangles. Tiles rasterize everything if it's empty.
+        NavChunkyTriMesh chunks;
+
+        int triangleCount() const
+        {
+            return (int)(triangles.size() / 3);
+        }
+    };
+
+    struct NavMeshTile
+    {
+        int x = 0;
+        int y = 0;
+        // Allocated with dtAlloc. Ownership passes to the dtNavMesh once the tile is added.
+        uint8_t* data = nullptr;
+        int dataSize = 0;
+    };
+
+    // Inclusive range of tile coordinates
+    struct NavTileRange
+    {
+        int minX = 0;
+        int minY = 0;
+        int maxX = -1;
+        int maxY = -1;
+
+        bool contains(int x, int y) const
+        {
+            return x >= minX && x <= maxX && y >= minY && y <= maxY;
+        }
+    };
+
+    struct NavMeshLayout
+    {
+        dtNavMeshParams params;
+        int tilesX = 0;
+        int tilesY = 0;
+    };
+
+    // Builds tiled navmeshes. Each tile runs through the full Recast pipeline on its own,
+    // so tiles can be built in parallel and rebuilt independently.
+    class NavMeshBuilder
+    {
+      public:
+        // Collects the world space triangles of every navigation static object in the registry.
+        // Returns false if there aren't any.
+        static bool gatherGeometry(entt::registry& registry, NavInputGeometry& geometry);
+        static void appendMesh(NavInputGeometry& geometry, const NavSourceMesh& mesh, const glm::mat4& transform);
+        // Gets the cached local space data for a mesh, loading it if needed. Main thread only, but the
+        // returned reference stays valid until the cache is cleared.
+        static const NavSourceMesh& getSourceMesh(AssetID id);
+        static void clearSourceMeshCache();
+        static void markWalkableTriangles(NavInputGeometry& geometry);
+        static void partitionTriangles(NavInputGeometry& geometry);
+        // Marks walkable triangles and partitions them, ready for tiles to be built
+        static void prepareGeometry(NavInputGeometry& geometry);
+        static NavMeshLayout calculateLayout(const NavInputGeometry& geometry);
+
+        // Builds a single tile. Returns false if the tile is empty or failed to build.
+        // Safe to call from several threads at once.
+        static bool buildTile(const NavInputGeometry& geometry, const NavMeshLayout& layout, int x, int y,
+                              NavMeshTile& tile);
+        // Builds every non-empty tile, one task per tile on g_taskSched unless parallel is false.
+        static void buildTiles(const NavInputGeometry& geometry, const NavMeshLayout& layout,
+                               std::vector<NavMeshTile>& tiles, bool parallel = true);
+        // Creates a navmesh from built tiles, taking ownership of their data.
+        static dtNavMesh* createNavMesh(const NavMeshLayout& layout, std::vector<NavMeshTile>& tiles);
+        static void freeTiles(std::vector<NavMeshTile>& tiles);
+        // Creates a copy of base with the tiles at rebuiltCoords replaced by newTiles. Rebuilt coordinates
+        // without a new tile are left empty. Takes ownership of the new tiles' data and doesn't modify base,
+        // so queries can keep using it while this runs.
+        static dtNavMesh* createUpdatedNavMesh(const dtNavMesh* base, std::vector<NavMeshTile>& newTiles,
+                                               const std::vector<std::pair<int, int>>& rebuiltCoords);
+
+        // Whether params describe a navmesh with this builder's tile size, so its tiles can be rebuilt.
+        static bool isTiled(const dtNavMeshParams& params);
+        // The tiles whose geometry is affected by anything within the given bounds.
+        static NavTileRange calculateTileRange(const dtNavMeshParams& params, glm::vec3 bbMin, glm::vec3 bbMax);
+
+        // Generates a test level of roughly size x size metres, for benchmarking.
+        static void generateTestLevel(NavInputGeometry& geometry, float size, uint32_t seed);
+    };
+}
@@ -0,0 +1,414 @@
+#include "Navigation.hpp"
+#include "NavMeshBuilder.hpp"
+#include <Core/Console.hpp>
+#include <Core/Log.hpp>
+#include <Core/TaskScheduler.hpp>
+#include <Core/WorldComponents.hpp>
+#include <Util/AABB.hpp>
+#include <Util/EnumUtil.hpp>
+#include <Util/TimingUtil.hpp>
+#include <Util/UniquePtr.hpp>
+
+#include <DetourNavMesh.h>
+#include <entt/entity/registry.hpp>
+#include <robin_hood.h>
+#include <Tracy.hpp>
+
+namespace worlds
+{
+    static ConVar autoRebuild{"nav_autoRebuild", "1",
+                              "Rebuild navmesh tiles when navigation static objects move or change."};
+    static ConVar rebuildBudget{"nav_rebuildBudgetMs", "1",
+                                "Time per frame navigation can spend gathering geometry for navmesh rebuilds."};
+    static ConVar maxRebuildTiles{"nav_maxRebuildTiles", "16", "Maximum number of navmesh tiles rebuilt at once."};
+
+    struct TrackedNavObject
+    {
+        Transform transform;
+        AssetID mesh;
+        AABB bounds;
+    };
+
+    // Builds a batch of tiles off the main thread and creates the navmesh that replaces the current one.
+    class NavTileRebuildTask : public enki::ITaskSet
+    {
+      public:
+        std::shared_ptr<dtNavMesh> base;
+        NavInputGeometry geometry;
+        std::vector<std::pair<int, int>> coords;
+        // Rebuilds everything with a new layout instead of replacing tiles in base
+        bool fullRebuild = false;
+        dtNavMesh* result = nullptr;
+        double buildMs = 0.0;
+
+        void ExecuteRange(enki::TaskSetPartition, uint32_t) override
+        {
+            ZoneScopedN("Navmesh Tile Rebuild");
+            PerfTimer pt;
+
+            if (geometry.triangleCount() == 0)
+            {
+                // Everything in these tiles is gone
+                std::vector<NavMeshTile> noTiles;
+                if (!fullRebuild)
+                    result = NavMeshBuilder::createUpdatedNavMesh(base.get(), noTiles, coords);
+                return;
+            }
+
+            NavMeshBuilder::prepareGeometry(geometry);
+
+            if (fullRebuild)
+            {
+                NavMeshLayout layout = NavMeshBuilder::calculateLayout(geometry);
+                std::vector<NavMeshTile> tiles;
+                NavMeshBuilder::buildTiles(geometry, layout, tiles);
+                result = NavMeshBuilder::createNavMesh(layout, tiles);
+            }
+            else
+            {
+                std::vector<NavMeshTile> builtTiles;
+                std::vector<uint8_t> tileBuilt;
+                builtTiles.resize(coords.size());
+                tileBuilt.resize(coords.size());
+
+                NavMeshLayout layout{};
+                layout.params = *base->getParams();
+
+                enki::TaskSet buildTask{(uint32_t)coords.size(), [&](enki::TaskSetPartition range, uint32_t) {
+                    for (uint32_t i = range.start; i < range.end; i++)
+                    {
+                        tileBuilt[i] = NavMeshBuilder::buildTile(geometry, layout, coords[i].first, coords[i].second,
+                                                                 builtTiles[i]);
+                    }
+                }};
+                buildTask.m_MinRange = 1;
+
+                g_taskSched.AddTaskSetToPipe(&buildTask);
+                g_taskSched.WaitforTask(&buildTask);
+
+                std::vector<NavMeshTile> tiles;
+                for (size_t i = 0; i < coords.size(); i++)
+                {
+                    if (tileBuilt[i])
+                        tiles.push_back(builtTiles[i]);
+                }
+
+                result = NavMeshBuilder::createUpdatedNavMesh(base.get(), tiles, coords);
+            }
+
+            buildMs = pt.stopGetMs();
+        }
+    };
+
+    struct NavRebuildJob
+    {
+        enum class Stage
+        {
+            Gathering,
+            Building
+        };
+
+        Stage stage = Stage::Gathering;
+        // Objects whose geometry still has to be added to the task's input
+        std::vector<entt::entity> pendingObjects;
+        size_t cursor = 0;
+        NavTileRebuildTask task;
+    };
+
+    static robin_hood::unordered_flat_map<entt::entity, TrackedNavObject> trackedObjects;
+    // Entities that had a WorldObject or Transform added, removed or patched since the last update
+    static robin_hood::unordered_flat_set<entt::entity> changedObjects;
+    static entt::registry* trackedRegistry = nullptr;
+    static robin_hood::unordered_flat_set<uint64_t> dirtyTiles;
+    static UniquePtr<NavRebuildJob> rebuildJob;
+    // Set when there's no rebuildable navmesh, so the next rebuild has to build everything
+    static bool fullRebuildNeeded = false;
+
+    static uint64_t packTile(int x, int y)
+    {
+        return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y;
+    }
+
+    static std::pair<int, int> unpackTile(uint64_t key)
+    {
+        return {(int)(uint32_t)(key >> 32), (int)(uint32_t)key};
+    }
+
+    static bool transformsEqual(const Transform& a, const Transform& b)
+    {
+        return a.position == b.position && a.rotation == b.rotation && a.scale == b.scale;
+    }
+
+    static void markBoundsDirty(const dtNavMeshParams& params, const AABB& bounds)
+    {
+        NavTileRange range = NavMeshBuilder::calculateTileRange(params, bounds.min, bounds.max);
+
+        for (int y = range.minY; y <= range.maxY; y++)
+        {
+            for (int x = range.minX; x <= range.maxX; x++)
+            {
+                dirtyTiles.insert(packTile(x, y));
+            }
+        }
+    }
+
+    static void waitForRebuild()
+    {
+        if (!rebuildJob)
+            return;
+
+        if (rebuildJob->stage == NavRebuildJob::Stage::Building)
+        {
+            g_taskSched.WaitforTask(&rebuildJob->task);
+            if (rebuildJob->task.result)
+                dtFreeNavMesh(rebuildJob->task.result);
+        }
+
+        rebuildJob.Reset();
+    }
+
+    static void onNavObjectChanged(entt::registry&, entt::entity ent)
+    {
+        changedObjects.insert(ent);
+    }
+
+    // Starts tracking the object, or marks the tiles it was in and is now in as dirty if it's changed
+    static void updateTrackedObject(entt::entity ent, const Transform& t, const WorldObject& wo,
+                                    const dtNavMeshParams* params)
+    {
+        auto it = trackedObjects.find(ent);
+        if (it != trackedObjects.end() && transformsEqual(it->second.transform, t) && it->second.mesh == wo.mesh)
+            return;
+
+        const NavSourceMesh& mesh = NavMeshBuilder::getSourceMesh(wo.mesh);
+        AABB bounds = AABB{mesh.aabbMin, mesh.aabbMax}.transform(t);
+
+        if (params)
+        {
+            if (it != trackedObjects.end())
+                markBoundsDirty(*params, it->second.bounds);
+            markBoundsDirty(*params, bounds);
+        }
+        else
+        {
+            fullRebuildNeeded = true;
+        }
+
+        trackedObjects[ent] = TrackedNavObject{t, wo.mesh, bounds};
+    }
+
+    static void untrackObject(entt::entity ent, const dtNavMeshParams* params)
+    {
+        auto it = trackedObjects.find(ent);
+        if (it == trackedObjects.end())
+            return;
+
+        if (params)
+            markBoundsDirty(*params, it->second.bounds);
+        else
+            fullRebuildNeeded = true;
+
+        trackedObjects.erase(it);
+    }
+
+    // Marks the tiles touched by objects that changed since the last update
+    static void processChangedObjects(entt::registry& registry, const dtNavMeshParams* params)
+    {
+        ZoneScoped;
+        for (entt::entity ent : changedObjects)
+        {
+            // Destroy signals fire while the component is still there, so check what's left now
+            const WorldObject* wo = registry.valid(ent) ? registry.try_get<WorldObject>(ent) : nullptr;
+            const Transform* t = wo ? registry.try_get<Transform>(ent) : nullptr;
+
+            if (t && enumHasFlag(wo->staticFlags, StaticFlags::Navigation))
+                updateTrackedObject(ent, *t, *wo, params);
+            else
+                untrackObject(ent, params);
+        }
+
+        changedObjects.clear();
+    }
+
+    static void startRebuild(const std::shared_ptr<dtNavMesh>& navMesh)
+    {
+        rebuildJob = new NavRebuildJob;
+        NavTileRebuildTask& task = rebuildJob->task;
+
+        if (fullRebuildNeeded)
+        {
+            task.fullRebuild = true;
+            for (auto& pair : trackedObjects)
+            {
+                rebuildJob->pendingObjects.push_back(pair.first);
+            }
+
+            fullRebuildNeeded = false;
+            dirtyTiles.clear();
+            return;
+        }
+
+        task.base = navMesh;
+        const dtNavMeshParams& params = *navMesh->getParams();
+        size_t maxTiles = std::max(maxRebuildTiles.getInt(), 1);
+
+        for (auto it = dirtyTiles.begin(); it != dirtyTiles.end() && task.coords.size() < maxTiles;)
+        {
+            task.coords.push_back(unpackTile(*it));
+            it = dirtyTiles.erase(it);
+        }
+
+        for (auto& pair : trackedObjects)
+        {
+            NavTileRange range = NavMeshBuilder::calculateTileRange(params, pair.second.bounds.min,
+                                                                    pair.second.bounds.max);
+
+            for (const std::pair<int, int>& coord : task.coords)
+            {
+                if (range.contains(coord.first, coord.second))
+                {
+                    rebuildJob->pendingObjects.push_back(pair.first);
+                    break;
+                }
+            }
+        }
+    }
+
+    // Adds the geometry of pending objects to the rebuild until the budget runs out.
+    // Returns true once everything has been added.
+    static bool gatherRebuildGeometry(entt::registry& registry, double budgetMs)
+    {
+        ZoneScoped;
+        auto start = TimingUtil::now();
+        NavRebuildJob& job = *rebuildJob.Get();
+
+        while (job.cursor < job.pendingObjects.size())
+        {
+            entt::entity ent = job.pendingObjects[job.cursor++];
+
+            // Anything that changed since the rebuild started gets picked up by the next scan
+            if (!registry.valid(ent) || !registry.has<WorldObject>(ent))
+                continue;
+
+            auto it = trackedObjects.find(ent);
+            if (it == trackedObjects.end())
+                continue;
+
+            NavMeshBuilder::appendMesh(job.task.geometry, NavMeshBuilder::getSourceMesh(it->second.mesh),
+                                       it->second.transform.getMatrix());
+
+            if (TimingUtil::toMs(TimingUtil::now() - start) > budgetMs)
+                break;
+        }
+
+        return job.cursor == job.pendingObjects.size();
+    }
+
+    void NavigationSystem::startTracking(entt::registry& registry)
+    {
+        trackedRegistry = &registry;
+        registry.on_construct<WorldObject>().connect<&onNavObjectChanged>();
+        registry.on_update<WorldObject>().connect<&onNavObjectChanged>();
+        registry.on_destroy<WorldObject>().connect<&onNavObjectChanged>();
+        registry.on_update<Transform>().connect<&onNavObjectChanged>();
+        registry.on_destroy<Transform>().connect<&onNavObjectChanged>();
+    }
+
+    void NavigationSystem::resetTracking(entt::registry& registry)
+    {
+        waitForRebuild();
+        trackedObjects.clear();
+        changedObjects.clear();
+        dirtyTiles.clear();
+
+        // The navmesh is about to be loaded or built for the current state, so don't mark anything dirty
+        registry.view<Transform, WorldObject>().each([&](entt::entity ent, Transform& t, WorldObject& wo) {
+            if (enumHasFlag(wo.staticFlags, StaticFlags::Navigation))
+                updateTrackedObject(ent, t, wo, nullptr);
+        });
+        fullRebuildNeeded = false;
+    }
+
+    void NavigationSystem::shutdownTileRebuilds()
+    {
+        waitForRebuild();
+        trackedObjects.clear();
+        changedObjects.clear();
+        dirtyTiles.clear();
+
+        if (trackedRegistry)
+        {
+            trackedRegistry->on_construct<WorldObject>().disconnect<&onNavObjectChanged>();
+            trackedRegistry->on_update<WorldObject>().disconnect<&onNavObjectChanged>();
+            trackedRegistry->on_destroy<WorldObject>().disconnect<&onNavObjectChanged>();
+            trackedRegistry->on_update<Transform>().disconnect<&onNavObjectChanged>();
+            trackedRegistry->on_destroy<Transform>().disconnect<&onNavObjectChanged>();
+            trackedRegistry = nullptr;
+        }
+    }
+
+    void NavigationSystem::requestFullRebuild()
+    {
+        fullRebuildNeeded = true;
+    }
+
+    bool NavigationSystem::collectTileRebuild()
+    {
+        if (!rebuildJob || rebuildJob->stage != NavRebuildJob::Stage::Building)
+            return true;
+
+        if (!rebuildJob->task.GetIsComplete())
+            return false;
+
+        NavTileRebuildTask& task = rebuildJob->task;
+        if (task.result)
+        {
+            if (task.fullRebuild)
+                logMsg("rebuilt navmesh in %.3fms", task.buildMs);
+            else
+                logVrb("rebuilt %zu navmesh tiles in %.3fms", task.coords.size(), task.buildMs);
+
+            setupFromNavMesh(task.result);
+        }
+        else if (task.fullRebuild)
+        {
+            setupFromNavMesh(nullptr);
+        }
+
+        rebuildJob.Reset();
+        return true;
+    }
+
+    bool NavigationSystem::continueTileRebuild(entt::registry& registry, double budgetMs)
+    {
+        if (!rebuildJob)
+        {
+            if (!fullRebuildNeeded && dirtyTiles.empty())
+                return false;
+
+            startRebuild(navMesh);
+        }
+
+        if (rebuildJob->stage == NavRebuildJob::Stage::Gathering && gatherRebuildGeometry(registry, budgetMs))
+        {
+            rebuildJob->stage = NavRebuildJob::Stage::Building;
+            g_taskSched.AddTaskSetToPipe(&rebuildJob->task);
+        }
+
+        return true;
+    }
+
+    void NavigationSystem::updateTileRebuilds(entt::registry& registry)
+    {
+        ZoneScoped;
+        if (!collectTileRebuild())
+            return;
+
+        // Changes are still tracked while rebuilding is off so turning it back on catches up
+        bool canRebuildTiles = navMesh && NavMeshBuilder::isTiled(*navMesh->getParams());
+        processChangedObjects(registry, canRebuildTiles ? navMesh->getParams() : nullptr);
+
+        if (autoRebuild.getInt())
+            continueTileRebuild(registry, rebuildBudget.getFloat());
+    }
+}
@@ -1,362 +1,548 @@
 #include "Navigation.hpp"
 #include "Core/Engine.hpp"
 #include "Core/NameComponent.hpp"
+#include "NavMeshBuilder.hpp"
 #include "Util/TimingUtil.hpp"
 
+#include <DetourAlloc.h>
 #include <DetourNavMesh.h>
-#include <DetourNavMeshBuilder.h>
 #include <DetourNavMeshQuery.h>
-#include <Recast.h>
 #include <entt/entity/registry.hpp>
 
+#include <Core/Console.hpp>
 #include <Core/Log.hpp>
-#include <Core/MeshManager.hpp>
+#include <Core/Profiler.hpp>
+#include <Core/TaskScheduler.hpp>
+#include <Core/Transform.hpp>
 #include <Render/DebugLines.hpp>
-#include <Util/EnumUtil.hpp>
+#include <Util/UniquePtr.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
 #include <physfs.h>
+#include <random>
+#include <string.h>
 #include <sys/types.h>
+#include <Tracy.hpp>
 
 namespace worlds
 {
-    const float CellSize = 0.125f;
-    const float CellHeight = 0.4f;
+    const uint32_t NavMeshFileMagic = ('W' << 24) | ('N' << 16) | ('A' << 8) | 'V';
+    const uint32_t NavMeshFileVersion = 1;
 
-    rcConfig recastConfig
+    struct NavMeshFileHeader
     {
-        .width = 0,
-        .height = 0,
-        .tileSize = 0,
-        .borderSize = 0,
-        .cs = CellSize,
-        .ch = CellHeight,
-        .walkableSlopeAngle = 30.0f,
-        .walkableHeight = (int)ceilf(2.0f / CellHeight),
-        .walkableClimb = (int)floorf(0.2f / CellHeight),
-        .walkableRadius = (int)ceilf(0.5f / CellSize),
-        .maxEdgeLen = 40,
-        .maxSimplificationError = 0.25f,
-        .minRegionArea = 64,
-        .mergeRegionArea = 400,
-        .maxVertsPerPoly = 6,
-        .detailSampleDist = 1.0f,
-        .detailSampleMaxError = 0.1f
+        uint32_t magic;
+        uint32_t version;
+        int32_t numTiles;
+        dtNavMeshParams params;
     };
 
-    class CustomRCContext : public rcContext
+    struct NavMeshFileTileHeader
     {
-      public:
-        CustomRCContext() : rcContext(true)
+        dtTileRef tileRef;
+        int32_t dataSize;
+    };
+
+    std::shared_ptr<dtNavMesh> NavigationSystem::navMesh;
+    dtNavMeshQuery* NavigationSystem::navMeshQuery = nullptr;
+    PathQueryQueue* NavigationSystem::pathQueue = nullptr;
+    NavCrowd* NavigationSystem::crowd = nullptr;
+
+    static ConVar pathIterations{"nav_pathIterations", "512",
+                                 "Pathfinding iterations each worker can spend on path requests per frame."};
+    static ConVar maxAgents{"nav_maxAgents", "1024", "Maximum number of nav agents. Takes effect on restart."};
+
+    static std::mt19937 benchmarkRng{1337};
+
+    float benchmarkRandom()
+    {
+        return std::uniform_real_distribution<float>{0.0f, 1.0f}(benchmarkRng);
+    }
+
+    // Returns nullptr if the file couldn't be read. Doesn't touch the current navmesh, so it's safe to use
+    // from any thread.
+    static dtNavMesh* readNavMeshFile(const char* path)
+    {
+        PHYSFS_File* file = PHYSFS_openRead(path);
+        if (file == nullptr)
         {
+            logErr("Failed to open navmesh %s", path);
+            return nullptr;
         }
-        virtual ~CustomRCContext()
+
+        size_t navmeshSize = PHYSFS_fileLength(file);
+        std::vector<uint8_t> fileData(navmeshSize);
+
+        if (navmeshSize != PHYSFS_readBytes(file, fileData.data(), navmeshSize))
         {
+            logErr("Failed to load navmesh");
+            PHYSFS_close(file);
+            return nullptr;
         }
+        PHYSFS_close(file);
 
-      protected:
-        void doLog(const rcLogCategory category, const char* msg, const int len) override
+        NavMeshFileHeader header;
+        if (navmeshSize < sizeof(header) || memcmp(fileData.data(), &NavMeshFileMagic, sizeof(uint32_t)) != 0)
         {
-            switch (category)
+            // Navmeshes baked before tiling are a single tile without a header
+            uint8_t* soloData = (uint8_t*)dtAlloc(navmeshSize, DT_ALLOC_PERM);
+            memcpy(soloData, fileData.data(), navmeshSize);
+
+            dtNavMesh* soloNavMesh = dtAllocNavMesh();
+            if (dtStatusFailed(soloNavMesh->init(soloData, navmeshSize, DT_TILE_FREE_DATA)))
             {
-            case RC_LOG_PROGRESS:
-                logVrb("Recast: %s", msg);
-                break;
-            case RC_LOG_WARNING:
-                logWarn("Recast: %s", msg);
-                break;
-            case RC_LOG_ERROR:
-                logErr("Recast: %s", msg);
-                break;
+                logErr("Failed to initialise nav mesh");
+                dtFreeNavMesh(soloNavMesh);
+                dtFree(soloData);
+                return nullptr;
             }
-        }
 
-      private:
-    };
+            return soloNavMesh;
+        }
 
-    dtNavMesh* NavigationSystem::navMesh = nullptr;
-    dtNavMeshQuery* NavigationSystem::navMeshQuery = nullptr;
+        memcpy(&header, fileData.data(), sizeof(header));
 
-    void NavigationSystem::setupFromNavMeshData(uint8_t* data, size_t dataSize)
-    {
-        if (data == nullptr || dataSize == 0)
-            return;
-        if (navMesh)
+        if (header.version != NavMeshFileVersion)
         {
-            dtFreeNavMesh(navMesh);
-            navMesh = nullptr;
+            logErr("Navmesh %s has unsupported version %u", path, header.version);
+            return nullptr;
         }
 
-        navMesh = dtAllocNavMesh();
-
-        dtStatus status = navMesh->init(data, dataSize, DT_TILE_FREE_DATA);
-
-        if (dtStatusFailed(status))
+        dtNavMesh* newNavMesh = dtAllocNavMesh();
+        if (dtStatusFailed(newNavMesh->init(&header.params)))
         {
             logErr("Failed to initialise nav mesh");
-            return;
+            dtFreeNavMesh(newNavMesh);
+            return nullptr;
         }
 
-        if (navMeshQuery)
+        size_t offset = sizeof(header);
+        for (int i = 0; i < header.numTiles; i++)
         {
-            dtFreeNavMeshQuery(navMeshQuery);
-            navMeshQuery = nullptr;
-        }
+            NavMeshFileTileHeader tileHeader;
+            if (offset + sizeof(tileHeader) > navmeshSize)
+                break;
 
-        navMeshQuery = dtAllocNavMeshQuery();
+            memcpy(&tileHeader, fileData.data() + offset, sizeof(tileHeader));
+            offset += sizeof(tileHeader);
 
-        status = navMeshQuery->init(navMesh, 2048);
+            if (tileHeader.dataSize <= 0 || offset + tileHeader.dataSize > navmeshSize)
+            {
+                logErr("Navmesh %s is truncated", path);
+                break;
+            }
 
-        if (dtStatusFailed(status))
-        {
-            logErr("Failed to initialise nav mesh query");
-            return;
+            uint8_t* tileData = (uint8_t*)dtAlloc(tileHeader.dataSize, DT_ALLOC_PERM);
+            memcpy(tileData, fileData.data() + offset, tileHeader.dataSize);
+            offset += tileHeader.dataSize;
+
+            if (dtStatusFailed(
+                    newNavMesh->addTile(tileData, tileHeader.dataSize, DT_TILE_FREE_DATA, tileHeader.tileRef, nullptr)))
+            {
+                logErr("Failed to add navmesh tile");
+                dtFree(tileData);
+            }
         }
+
+        return newNavMesh;
     }
 
-    void NavigationSystem::loadNavMeshFromFile(const char* path)
+    // Reads a baked navmesh for startNavMeshLoad
+    struct NavMeshLoadTask : public enki::ITaskSet
     {
-        PHYSFS_File* file = PHYSFS_openRead(path);
-        size_t navmeshSize = PHYSFS_fileLength(file);
-        uint8_t* navmeshData = new uint8_t[navmeshSize];
+        std::string path;
+        dtNavMesh* result = nullptr;
 
-        if (navmeshSize != PHYSFS_readBytes(file, navmeshData, navmeshSize))
+        void ExecuteRange(enki::TaskSetPartition, uint32_t) override
         {
-            logErr("Failed to load navmesh");
+            ZoneScopedN("Load navmesh");
+            result = readNavMeshFile(path.c_str());
         }
-        PHYSFS_close(file);
-        setupFromNavMeshData(navmeshData, navmeshSize);
+    };
+
+    static UniquePtr<NavMeshLoadTask> navMeshLoad;
+
+    static void cancelNavMeshLoad()
+    {
+        if (!navMeshLoad)
+            return;
+
+        g_taskSched.WaitforTask(navMeshLoad.Get());
+        if (navMeshLoad->result)
+            dtFreeNavMesh(navMeshLoad->result);
+
+        navMeshLoad.Reset();
     }
 
-    void NavigationSystem::buildNavMesh(entt::registry& registry, uint8_t*& dataOut, size_t& dataSizeOut)
+    void NavigationSystem::initialize(entt::registry& registry)
     {
-        dataOut = nullptr;
-        dataSizeOut = 0;
-        // Find the bounding boxes and poly/vert counts of all the navigation static objects in the scene
-        glm::vec3 bbMin{FLT_MAX};
-        glm::vec3 bbMax{-FLT_MAX};
-        uint32_t numTriangles = 0;
-        uint32_t numVertices = 0;
+        pathQueue = new PathQueryQueue((int)g_taskSched.GetNumTaskThreads());
+        crowd = new NavCrowd(maxAgents.getInt());
+        startTracking(registry);
+
+        g_console->registerCommand(
+            [](const char* arg) {
+                float size = 256.0f;
+                if (arg[0] != 0)
+                    size = std::max((float)atof(arg), 16.0f);
+
+                NavInputGeometry geometry;
+                NavMeshBuilder::generateTestLevel(geometry, size, 1337);
+                NavMeshBuilder::prepareGeometry(geometry);
+                NavMeshLayout layout = NavMeshBuilder::calculateLayout(geometry);
+
+                std::vector<NavMeshTile> tiles;
+                PerfTimer serialTimer;
+                NavMeshBuilder::buildTiles(geometry, layout, tiles, false);
+                double serialMs = serialTimer.stopGetMs();
+                NavMeshBuilder::freeTiles(tiles);
+
+                PerfTimer parallelTimer;
+                NavMeshBuilder::buildTiles(geometry, layout, tiles, true);
+                double parallelMs = parallelTimer.stopGetMs();
+
+                size_t builtTiles = tiles.size();
+                dtNavMesh* benchMesh = NavMeshBuilder::createNavMesh(layout, tiles);
+                int polyCount = 0;
+
+                if (benchMesh)
+                {
+                    const dtNavMesh* constMesh = benchMesh;
+                    for (int i = 0; i < constMesh->getMaxTiles(); i++)
+                    {
+                        const dtMeshTile* tile = constMesh->getTile(i);
+                        if (tile->header)
+                            polyCount += tile->header->polyCount;
+                    }
+                    dtFreeNavMesh(benchMesh);
+                }
 
-        PerfTimer pt;
-        registry.view<Transform, WorldObject>().each([&](Transform& t, WorldObject& o) {
-            if (!enumHasFlag(o.staticFlags, StaticFlags::Navigation))
-                return;
+                logMsg("navmesh bake benchmark: %.0fm level, %i triangles, %zu/%i tiles, %i polys", size,
+                       geometry.triangleCount(), builtTiles, layout.tilesX * layout.tilesY, polyCount);
+                logMsg("serial: %.3fms, parallel: %.3fms (%.2fx on %u threads)", serialMs, parallelMs,
+                       serialMs / parallelMs, g_taskSched.GetNumTaskThreads());
+            },
+            "nav_benchmarkBake", "Bakes a navmesh for a generated test level serially and in parallel. Args: [size]");
 
-            glm::mat4 tMat = t.getMatrix();
-            auto& mesh = MeshManager::loadOrGet(o.mesh);
-            numTriangles += mesh.indices.size() / 3;
-            numVertices += mesh.vertices.size();
+        g_console->registerCommand(
+            [](const char* arg) {
+                int agentCount = 1000;
+                if (arg[0] != 0)
+                    agentCount = std::max(atoi(arg), 1);
 
-            for (const Vertex& v : mesh.vertices)
-            {
-                glm::vec3 transformedPosition = tMat * glm::vec4(v.position, 1.0f);
-                bbMin = glm::min(transformedPosition, bbMin);
-                bbMax = glm::max(transformedPosition, bbMax);
-            }
-        });
+                NavInputGeometry geometry;
+                NavMeshBuilder::generateTestLevel(geometry, 256.0f, 1337);
+                NavMeshBuilder::prepareGeometry(geometry);
+                NavMeshLayout layout = NavMeshBuilder::calculateLayout(geometry);
 
-        if (numVertices == 0)
-        {
-            logErr("Nothing marked as navigation static!");
-            return;
-        }
+                std::vector<NavMeshTile> tiles;
+                NavMeshBuilder::buildTiles(geometry, layout, tiles);
+                std::shared_ptr<dtNavMesh> benchMesh{NavMeshBuilder::createNavMesh(layout, tiles), dtFreeNavMesh};
 
-        // Now convert those to a data format Recast understands
-        std::vector<int> recastTriangles;
-        std::vector<glm::vec3> recastTriNormals;
-        recastTriangles.reserve(numTriangles * 3);
-        recastTriNormals.reserve(numTriangles);
+                if (!benchMesh)
+                    return;
 
-        std::vector<glm::vec3> recastVertices;
-        recastVertices.reserve(numVertices);
+                dtNavMeshQuery* query = dtAllocNavMeshQuery();
+                query->init(benchMesh.get(), 2048);
 
-        registry.view<Transform, WorldObject>().each([&](Transform& t, WorldObject& o) {
-            if (!enumHasFlag(o.staticFlags, StaticFlags::Navigation))
-                return;
-            auto& mesh = MeshManager::loadOrGet(o.mesh);
-            glm::mat4 mat = t.getMatrix();
+                std::vector<glm::vec3> starts(agentCount);
+                std::vector<glm::vec3> ends(agentCount);
+                dtQueryFilter filter;
+                benchmarkRng.seed(1337);
 
-            for (uint32_t idx : mesh.indices)
-            {
-                recastTriangles.push_back(idx + recastVertices.size());
-            }
+                for (int i = 0; i < agentCount; i++)
+                {
+                    dtPolyRef ref;
+                    query->findRandomPoint(&filter, benchmarkRandom, &ref, glm::value_ptr(starts[i]));
+                    query->findRandomPoint(&filter, benchmarkRandom, &ref, glm::value_ptr(ends[i]));
+                }
 
-            for (uint32_t i = 0; i < mesh.indices.size() / 3; i++)
-            {
-                glm::vec3 faceNormal = mesh.vertices[mesh.indices[i * 3 + 0]].normal +
-                                       mesh.vertices[mesh.indices[i * 3 + 0]].normal +
-                                       mesh.vertices[mesh.indices[i * 3 + 0]].normal;
-                faceNormal /= 3.0f;
-                recastTriNormals.push_back(faceNormal);
-            }
+                std::vector<glm::vec3> points;
+                int serialFound = 0;
+                PerfTimer serialTimer;
+                for (int i = 0; i < agentCount; i++)
+                {
+                    if (PathQueryQueue::findPathImmediate(query, starts[i], ends[i], points))
+                        serialFound++;
+                }
+                double serialMs = serialTimer.stopGetMs();
+                dtFreeNavMeshQuery(query);
 
-            for (const Vertex& v : mesh.vertices)
-            {
-                glm::vec3 transformedPosition = mat * glm::vec4(v.position, 1.0f);
-                recastVertices.push_back(transformedPosition);
-            }
-        });
+                PathQueryQueue benchQueue{(int)g_taskSched.GetNumTaskThreads()};
+                std::vector<PathRequestID> requests;
+                for (int i = 0; i < agentCount; i++)
+                {
+                    requests.push_back(benchQueue.request(starts[i], ends[i]));
+                }
 
-        for (int i = 0; i < 3; i++)
-        {
-            recastConfig.bmin[i] = bbMin[i];
-            recastConfig.bmax[i] = bbMax[i];
-        }
+                int frames = 0;
+                PerfTimer queueTimer;
+                while (benchQueue.pendingCount() > 0)
+                {
+                    benchQueue.dispatch(benchMesh, pathIterations.getInt());
+                    benchQueue.collect();
+                    frames++;
+                }
+                double queueMs = queueTimer.stopGetMs();
 
-        CustomRCContext* ctx = new CustomRCContext();
+                int queueFound = 0;
+                for (PathRequestID id : requests)
+                {
+                    if (benchQueue.getStatus(id) == PathRequestStatus::Ready)
+                        queueFound++;
+                    benchQueue.release(id);
+                }
 
-        ctx->resetTimers();
-        ctx->startTimer(RC_TIMER_TOTAL);
+                entt::registry benchRegistry;
+                for (int i = 0; i < agentCount; i++)
+                {
+                    entt::entity ent = benchRegistry.create();
+                    benchRegistry.emplace<Transform>(ent, starts[i], glm::quat{1.0f, 0.0f, 0.0f, 0.0f});
+                    benchRegistry.emplace<NavAgent>(ent).setTarget(ends[i]);
+                }
 
-        rcCalcGridSize(recastConfig.bmin, recastConfig.bmax, recastConfig.cs, &recastConfig.width,
-                       &recastConfig.height);
+                const int crowdFrames = 300;
+                NavCrowd benchCrowd{agentCount};
+                PerfTimer crowdTimer;
+                for (int i = 0; i < crowdFrames; i++)
+                {
+                    benchCrowd.update(benchRegistry, benchMesh, 1.0f / 60.0f);
+                }
+                double crowdMs = crowdTimer.stopGetMs();
+
+                logMsg("path benchmark: %i paths, serial %.3fms (%i found), queued %.3fms over %i frames (%i found)",
+                       agentCount, serialMs, serialFound, queueMs, frames, queueFound);
+                logMsg("crowd benchmark: %i agents, %.3fms per update over %i updates", benchCrowd.activeAgentCount(),
+                       crowdMs / crowdFrames, crowdFrames);
+            },
+            "nav_benchmarkAgents", "Benchmarks path queries and crowd simulation on a test level. Args: [agent count]");
+    }
 
-        rcHeightfield* heightfield = rcAllocHeightfield();
+    void NavigationSystem::shutdown()
+    {
+        cancelNavMeshLoad();
+        shutdownTileRebuilds();
+        delete pathQueue;
+        pathQueue = nullptr;
+        delete crowd;
+        crowd = nullptr;
+        setupFromNavMesh(nullptr);
+    }
 
-        bool lastResult = rcCreateHeightfield(ctx, *heightfield, recastConfig.width, recastConfig.height,
-                                              recastConfig.bmin, recastConfig.bmax, recastConfig.cs, recastConfig.ch);
+    void NavigationSystem::update(entt::registry& registry, float deltaTime)
+    {
+        ProfileScoped;
+        updateTileRebuilds(registry);
 
-        if (!lastResult)
-        {
-            logErr("Failed to create heightfield");
-            return;
-        }
+        if (deltaTime > 0.0f)
+            crowd->update(registry, navMesh, deltaTime);
+
+        pathQueue->dispatch(navMesh, pathIterations.getInt());
+    }
 
-        uint8_t* triareas = new uint8_t[numTriangles];
-        memset(triareas, 0, numTriangles);
+    void NavigationSystem::collectPathResults()
+    {
+        pathQueue->collect();
+    }
+
+    PathRequestID NavigationSystem::requestPath(glm::vec3 startPos, glm::vec3 endPos)
+    {
+        return pathQueue->request(startPos, endPos);
+    }
+
+    PathRequestStatus NavigationSystem::getPathStatus(PathRequestID id)
+    {
+        return pathQueue->getStatus(id);
+    }
+
+    const std::vector<glm::vec3>* NavigationSystem::getPathResult(PathRequestID id)
+    {
+        return pathQueue->getPath(id);
+    }
+
+    void NavigationSystem::releasePath(PathRequestID id)
+    {
+        pathQueue->release(id);
+    }
 
-        rcMarkWalkableTriangles(ctx, recastConfig.walkableSlopeAngle, (float*)recastVertices.data(), numVertices,
-                                recastTriangles.data(), numTriangles, triareas);
-        lastResult = rcRasterizeTriangles(ctx, (float*)recastVertices.data(), numVertices, recastTriangles.data(),
-                                          triareas, numTriangles, *heightfield, recastConfig.walkableClimb);
+    std::shared_ptr<dtNavMesh> NavigationSystem::getNavMesh()
+    {
+        return navMesh;
+    }
 
-        if (!lastResult)
+    void NavigationSystem::setupFromNavMesh(dtNavMesh* newNavMesh)
+    {
+        if (navMeshQuery)
         {
-            logErr("Failed to rasterize triangles");
-            return;
+            dtFreeNavMeshQuery(navMeshQuery);
+            navMeshQuery = nullptr;
         }
 
-        delete[] triareas;
+        // Anything still using the old navmesh keeps it alive until it's done
+        navMesh.reset();
+
+        if (newNavMesh == nullptr)
+            return;
 
-        rcFilterLowHangingWalkableObstacles(ctx, recastConfig.walkableClimb, *heightfield);
-        rcFilterLedgeSpans(ctx, recastConfig.walkableHeight, recastConfig.walkableClimb, *heightfield);
-        rcFilterWalkableLowHeightSpans(ctx, recastConfig.walkableHeight, *heightfield);
+        navMesh = std::shared_ptr<dtNavMesh>(newNavMesh, dtFreeNavMesh);
+        navMeshQuery = dtAllocNavMeshQuery();
 
-        rcCompactHeightfield* compactHeightfield = rcAllocCompactHeightfield();
-        lastResult = rcBuildCompactHeightfield(ctx, recastConfig.walkableHeight, recastConfig.walkableClimb,
-                                               *heightfield, *compactHeightfield);
+        dtStatus status = navMeshQuery->init(navMesh.get(), 2048);
 
-        if (!lastResult)
+        if (dtStatusFailed(status))
         {
-            logErr("Failed to build compact heightfield");
-            return;
+            logErr("Failed to initialise nav mesh query");
+            dtFreeNavMeshQuery(navMeshQuery);
+            navMeshQuery = nullptr;
         }
+    }
 
-        rcFreeHeightField(heightfield);
-
-        rcErodeWalkableArea(ctx, recastConfig.walkableRadius, *compactHeightfield);
-        rcBuildDistanceField(ctx, *compactHeightfield);
-        rcBuildRegions(ctx, *compactHeightfield, recastConfig.borderSize, recastConfig.minRegionArea,
-                       recastConfig.mergeRegionArea);
+    void NavigationSystem::loadNavMeshFromFile(const char* path)
+    {
+        dtNavMesh* loadedNavMesh = readNavMeshFile(path);
 
-        rcContourSet* contourSet = rcAllocContourSet();
-        rcBuildContours(ctx, *compactHeightfield, recastConfig.maxSimplificationError, recastConfig.maxEdgeLen,
-                        *contourSet);
+        if (loadedNavMesh)
+            setupFromNavMesh(loadedNavMesh);
+    }
 
-        rcPolyMesh* polyMesh = rcAllocPolyMesh();
-        rcBuildPolyMesh(ctx, *contourSet, recastConfig.maxVertsPerPoly, *polyMesh);
+    bool NavigationSystem::saveNavMesh(const dtNavMesh* mesh, const char* path)
+    {
+        PHYSFS_File* file = PHYSFS_openWrite(path);
 
-        rcPolyMeshDetail* polyMeshDetail = rcAllocPolyMeshDetail();
-        rcBuildPolyMeshDetail(ctx, *polyMesh, *compactHeightfield, recastConfig.detailSampleDist,
-                              recastConfig.detailSampleMaxError, *polyMeshDetail);
+        if (file == nullptr)
+        {
+            logErr("Failed to open writing location for navmesh %s", path);
+            return false;
+        }
 
-        rcFreeCompactHeightfield(compactHeightfield);
-        rcFreeContourSet(contourSet);
-        ctx->stopTimer(RC_TIMER_TOTAL);
+        NavMeshFileHeader header{};
+        header.magic = NavMeshFileMagic;
+        header.version = NavMeshFileVersion;
+        header.params = *mesh->getParams();
 
-        for (int i = 0; i < polyMesh->npolys; i++)
+        for (int i = 0; i < mesh->getMaxTiles(); i++)
         {
-            polyMesh->flags[i] = 1;
+            const dtMeshTile* tile = mesh->getTile(i);
+            if (tile->header && tile->dataSize > 0)
+                header.numTiles++;
         }
 
-        dtNavMeshCreateParams params{};
-        params.verts = polyMesh->verts;
-        params.vertCount = polyMesh->nverts;
-        params.polys = polyMesh->polys;
-        params.polyAreas = polyMesh->areas;
-        params.polyFlags = polyMesh->flags;
-        params.polyCount = polyMesh->npolys;
-        params.nvp = polyMesh->nvp;
-
-        params.detailMeshes = polyMeshDetail->meshes;
-        params.detailVerts = polyMeshDetail->verts;
-        params.detailVertsCount = polyMeshDetail->nverts;
-        params.detailTris = polyMeshDetail->tris;
-        params.detailTriCount = polyMeshDetail->ntris;
-
-        params.walkableHeight = recastConfig.walkableHeight * recastConfig.ch;
-        params.walkableRadius = recastConfig.walkableRadius * recastConfig.cs;
-        params.walkableClimb = recastConfig.walkableClimb * recastConfig.ch;
-
-        for (int i = 0; i < 3; i++)
+        PHYSFS_writeBytes(file, &header, sizeof(header));
+
+        for (int i = 0; i < mesh->getMaxTiles(); i++)
         {
-            params.bmin[i] = recastConfig.bmin[i];
-            params.bmax[i] = recastConfig.bmax[i];
+            const dtMeshTile* tile = mesh->getTile(i);
+            if (!tile->header || tile->dataSize == 0)
+                continue;
+
+            NavMeshFileTileHeader tileHeader{};
+            tileHeader.tileRef = mesh->getTileRef(tile);
+            tileHeader.dataSize = tile->dataSize;
+            PHYSFS_writeBytes(file, &tileHeader, sizeof(tileHeader));
+            PHYSFS_writeBytes(file, tile->data, tile->dataSize);
         }
 
-        params.cs = recastConfig.cs;
-        params.ch = recastConfig.ch;
-        params.buildBvTree = true;
+        PHYSFS_close(file);
+        return true;
+    }
+
+    dtNavMesh* NavigationSystem::buildNavMesh(entt::registry& registry)
+    {
+        PerfTimer pt;
+        NavInputGeometry geometry;
 
-        uint8_t* navMeshData;
-        int navMeshDataSize;
-        if (!dtCreateNavMeshData(&params, &navMeshData, &navMeshDataSize))
+        if (!NavMeshBuilder::gatherGeometry(registry, geometry))
         {
-            logErr("Failed to create nav mesh data");
-            return;
+            logErr("Nothing marked as navigation static!");
+            return nullptr;
         }
 
-        rcFreePolyMesh(polyMesh);
-        rcFreePolyMeshDetail(polyMeshDetail);
-        logMsg("navmesh generation took %.3fms", pt.stopGetMs());
-        dataOut = navMeshData;
-        dataSizeOut = static_cast<size_t>(navMeshDataSize);
+        NavMeshBuilder::prepareGeometry(geometry);
+        NavMeshLayout layout = NavMeshBuilder::calculateLayout(geometry);
+
+        std::vector<NavMeshTile> tiles;
+        NavMeshBuilder::buildTiles(geometry, layout, tiles);
+        size_t builtTiles = tiles.size();
+
+        dtNavMesh* mesh = NavMeshBuilder::createNavMesh(layout, tiles);
+        logMsg("navmesh generation took %.3fms (%zu/%i tiles)", pt.stopGetMs(), builtTiles,
+               layout.tilesX * layout.tilesY);
+        return mesh;
     }
 
     void NavigationSystem::buildAndSave(entt::registry& registry, const char* path)
     {
-        uint8_t* data;
-        size_t dataSize;
-        buildNavMesh(registry, data, dataSize);
+        // Meshes might have been reimported since they were cached
+        NavMeshBuilder::clearSourceMeshCache();
+        dtNavMesh* mesh = buildNavMesh(registry);
 
-        PHYSFS_File* file = PHYSFS_openWrite(path);
+        if (mesh == nullptr)
+            return;
 
-        if (file == nullptr)
+        saveNavMesh(mesh, path);
+        setupFromNavMesh(mesh);
+        resetTracking(registry);
+    }
+
+    void NavigationSystem::updateNavMesh(entt::registry& reg)
+    {
+        std::string savedPath = "LevelData/Navmeshes/" + reg.ctx<SceneInfo>().name + ".bin";
+
+        cancelNavMeshLoad();
+        NavMeshBuilder::clearSourceMeshCache();
+        resetTracking(reg);
+
+        if (PHYSFS_exists(savedPath.c_str()))
         {
-            logErr("Failed to open writing location for navmesh %s", path);
+            loadNavMeshFromFile(savedPath.c_str());
             return;
         }
+        logWarn("Scene %s doesn't have baked navmesh data", reg.ctx<SceneInfo>().name.c_str());
 
-        PHYSFS_writeBytes(file, data, dataSize);
-        PHYSFS_close(file);
-        free(data);
+        setupFromNavMesh(buildNavMesh(reg));
     }
 
-    void NavigationSystem::updateNavMesh(entt::registry& reg)
+    void NavigationSystem::startNavMeshLoad(entt::registry& reg)
     {
         std::string savedPath = "LevelData/Navmeshes/" + reg.ctx<SceneInfo>().name + ".bin";
 
+        cancelNavMeshLoad();
+        NavMeshBuilder::clearSourceMeshCache();
+        resetTracking(reg);
+
+        // The previous scene's navmesh is no use to the new one
+        setupFromNavMesh(nullptr);
+
         if (PHYSFS_exists(savedPath.c_str()))
         {
-            loadNavMeshFromFile(savedPath.c_str());
+            navMeshLoad = new NavMeshLoadTask;
+            navMeshLoad->path = savedPath;
+            g_taskSched.AddTaskSetToPipe(navMeshLoad.Get());
             return;
         }
         logWarn("Scene %s doesn't have baked navmesh data", reg.ctx<SceneInfo>().name.c_str());
 
-        uint8_t* navMeshData;
-        size_t navMeshDataSize;
-        buildNavMesh(reg, navMeshData, navMeshDataSize);
-        setupFromNavMeshData(navMeshData, navMeshDataSize);
+        // Built by the tile rebuilder, which gathers the geometry a slice at a time
+        requestFullRebuild();
+    }
+
+    bool NavigationSystem::updateNavMeshLoad(entt::registry& reg, double budgetMs)
+    {
+        ZoneScoped;
+        if (navMeshLoad)
+        {
+            if (!navMeshLoad->GetIsComplete())
+                return false;
+
+            setupFromNavMesh(navMeshLoad->result);
+            navMeshLoad.Reset();
+            return true;
+        }
+
+        if (!collectTileRebuild())
+            return false;
+
+        return !continueTileRebuild(reg, budgetMs);
     }
 
     void NavigationSystem::drawNavMesh()
@@ -368,7 +554,10 @@ namespace worlds
             // bluh
             // only the const version of getTile is public, but the private non-const version has
             // the same name so we have to cast to const to get to it
-            const dtMeshTile* tile = ((const dtNavMesh*)navMesh)->getTile(i);
+            const dtMeshTile* tile = ((const dtNavMesh*)navMesh.get())->getTile(i);
+            if (!tile->header)
+                continue;
+
             for (int j = 0; j < tile->header->polyCount; j++)
             {
                 const dtPoly& poly = tile->polys[j];
@@ -1,8 +1,11 @@
 #pragma once
 #include "DetourNavMeshQuery.h"
+#include "NavCrowd.hpp"
+#include "PathQueryQueue.hpp"
 #include <DetourNavMesh.h>
 #include <entt/entity/fwd.hpp>
 #include <glm/vec3.hpp>
+#include <memory>
 
 namespace worlds
 {
@@ -16,17 +19,56 @@ namespace worlds
     class NavigationSystem
     {
       private:
-        static dtNavMesh* navMesh;
+        static std::shared_ptr<dtNavMesh> navMesh;
         static dtNavMeshQuery* navMeshQuery;
-        static void setupFromNavMeshData(uint8_t* data, size_t dataSize);
+        // Takes ownership of newNavMesh, replacing the current navmesh
+        static void setupFromNavMesh(dtNavMesh* newNavMesh);
         static void loadNavMeshFromFile(const char* path);
-        static void buildNavMesh(entt::registry& registry, uint8_t*& dataOut, size_t& dataSizeOut);
+        static bool saveNavMesh(const dtNavMesh* mesh, const char* path);
+        static dtNavMesh* buildNavMesh(entt::registry& registry);
+        // Listens for navigation static objects being added, removed or patched. Code that changes their
+        // Transform or WorldObject in place has to call patch for the change to be picked up.
+        static void startTracking(entt::registry& registry);
+        // Forgets about any pending tile rebuilds and starts tracking the registry's objects again
+        static void resetTracking(entt::registry& registry);
+        static void updateTileRebuilds(entt::registry& registry);
+        // Swaps in the navmesh from a finished rebuild. Returns false if one is still running.
+        static bool collectTileRebuild();
+        // Starts any pending rebuild and gathers its geometry, handing it to a worker once that's done.
+        // Returns false if there's nothing to rebuild.
+        static bool continueTileRebuild(entt::registry& registry, double budgetMs);
+        static void requestFullRebuild();
+        static void shutdownTileRebuilds();
+        static PathQueryQueue* pathQueue;
+        static NavCrowd* crowd;
 
       public:
+        static void initialize(entt::registry& registry);
+        static void shutdown();
+        // Rebuilds the tiles affected by navigation static objects that have been patched, added or removed.
+        // Tiles are built in the background and swapped in once they're all done.
+        // Also moves nav agents and starts work on path requests made since the last update.
+        static void update(entt::registry& registry, float deltaTime);
+        // Waits for the path requests started by the last update and makes their results available
+        static void collectPathResults();
+        // Holding on to the returned navmesh keeps it alive after a rebuild replaces it.
+        static std::shared_ptr<dtNavMesh> getNavMesh();
         static void buildAndSave(entt::registry& registry, const char* path);
         static void updateNavMesh(entt::registry& registry);
+        // Like updateNavMesh, but the navmesh is loaded or built on worker threads. updateNavMeshLoad has to be
+        // called until it returns true to put it in place.
+        static void startNavMeshLoad(entt::registry& registry);
+        // Does up to budgetMs of main thread work on the navmesh started by startNavMeshLoad.
+        // Returns true once it's ready.
+        static bool updateNavMeshLoad(entt::registry& registry, double budgetMs);
         static void drawNavMesh();
         static void findPath(glm::vec3 startPos, glm::vec3 endPos, NavigationPath& path);
+        // Queues a path query to run on a worker thread. The result is available from the next frame.
+        static PathRequestID requestPath(glm::vec3 startPos, glm::vec3 endPos);
+        static PathRequestStatus getPathStatus(PathRequestID id);
+        // Returns nullptr unless the request's status is Ready
+        static const std::vector<glm::vec3>* getPathResult(PathRequestID id);
+        static void releasePath(PathRequestID id);
         static bool getClosestPointOnMesh(glm::vec3 point, glm::vec3& outPoint,
                                           glm::vec3 searchExtent = glm::vec3{0.0f});
     };
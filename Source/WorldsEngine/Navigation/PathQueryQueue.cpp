@@ -0,0 +1,341 @@
+#include "PathQueryQueue.hpp"
+#include <Core/Log.hpp>
+#include <Core/TaskScheduler.hpp>
+
+#include <DetourNavMeshQuery.h>
+#include <algorithm>
+#include <glm/gtc/type_ptr.hpp>
+#include <Tracy.hpp>
+
+namespace worlds
+{
+    const int MaxPathPolys = 256;
+    const int MaxPathPoints = 256;
+    const int QueryMaxNodes = 2048;
+    const glm::vec3 PolySearchExtent{1.0f, 3.0f, 1.0f};
+
+    // Only ever read, so it's safe to share between workers
+    static const dtQueryFilter defaultFilter;
+
+    class PathQueryQueue::QueryTask : public enki::ITaskSet
+    {
+      public:
+        QueryTask(PathQueryQueue& queue) : queue(queue)
+        {
+        }
+
+        void ExecuteRange(enki::TaskSetPartition range, uint32_t) override
+        {
+            ZoneScopedN("Path Queries");
+            for (uint32_t i = range.start; i < range.end; i++)
+            {
+                queue.processSlot(queue.slots[i], queue.iterationBudget);
+            }
+        }
+
+      private:
+        PathQueryQueue& queue;
+    };
+
+    PathQueryQueue::PathQueryQueue(int numSlots) : dispatchCursor(0)
+    {
+        slots.resize(std::max(numSlots, 1));
+        for (QuerySlot& slot : slots)
+        {
+            slot.query = dtAllocNavMeshQuery();
+        }
+
+        task = new QueryTask(*this);
+        task->m_MinRange = 1;
+    }
+
+    PathQueryQueue::~PathQueryQueue()
+    {
+        collect();
+        delete task;
+
+        for (QuerySlot& slot : slots)
+        {
+            dtFreeNavMeshQuery(slot.query);
+        }
+    }
+
+    PathRequestID PathQueryQueue::request(glm::vec3 start, glm::vec3 end)
+    {
+        PathRequestID id = nextId++;
+        if (nextId == InvalidPathRequest)
+            nextId++;
+
+        PathRequest& request = requests[id];
+        request.id = id;
+        request.start = start;
+        request.end = end;
+        pending.push_back(&request);
+
+        return id;
+    }
+
+    PathRequestStatus PathQueryQueue::getStatus(PathRequestID id) const
+    {
+        auto it = requests.find(id);
+        if (it == requests.end() || it->second.released)
+            return PathRequestStatus::Unknown;
+
+        return it->second.status;
+    }
+
+    const std::vector<glm::vec3>* PathQueryQueue::getPath(PathRequestID id) const
+    {
+        auto it = requests.find(id);
+        if (it == requests.end() || it->second.released || it->second.status != PathRequestStatus::Ready)
+            return nullptr;
+
+        return &it->second.points;
+    }
+
+    void PathQueryQueue::release(PathRequestID id)
+    {
+        auto it = requests.find(id);
+        if (it == requests.end())
+            return;
+
+        // Workers might still have a pointer to it, so it gets removed once it's finished
+        if (it->second.status == PathRequestStatus::Pending)
+        {
+            it->second.released = true;
+            return;
+        }
+
+        requests.erase(it);
+    }
+
+    size_t PathQueryQueue::pendingCount() const
+    {
+        return pending.size() + processing.size();
+    }
+
+    void PathQueryQueue::collect()
+    {
+        if (!inFlight)
+            return;
+
+        ZoneScoped;
+        g_taskSched.WaitforTask(task);
+        inFlight = false;
+
+        size_t taken = std::min(dispatchCursor.load(), dispatched.size());
+        processing.insert(processing.end(), dispatched.begin(), dispatched.begin() + taken);
+
+        // Anything the workers didn't get to goes back to the front of the queue
+        pending.insert(pending.begin(), dispatched.begin() + taken, dispatched.end());
+        dispatched.clear();
+
+        for (size_t i = 0; i < processing.size();)
+        {
+            PathRequest* request = processing[i];
+
+            if (request->workerStatus == PathRequestStatus::Pending)
+            {
+                i++;
+                continue;
+            }
+
+            request->status = request->workerStatus;
+            processing[i] = processing.back();
+            processing.pop_back();
+
+            if (request->released)
+                requests.erase(request->id);
+        }
+    }
+
+    void PathQueryQueue::dispatch(const std::shared_ptr<dtNavMesh>& navMesh, int iterationsPerSlot)
+    {
+        collect();
+
+        if (navMesh != activeNavMesh)
+        {
+            // Queries can't carry on across navmeshes, so start anything in progress again
+            for (QuerySlot& slot : slots)
+            {
+                if (slot.current)
+                {
+                    slot.current->workerStatus = PathRequestStatus::Pending;
+                    pending.insert(pending.begin(), slot.current);
+                    processing.erase(std::find(processing.begin(), processing.end(), slot.current));
+                    slot.current = nullptr;
+                }
+
+                if (navMesh && dtStatusFailed(slot.query->init(navMesh.get(), QueryMaxNodes)))
+                    logErr("Failed to initialise path query");
+
+                slot.navMesh = navMesh.get();
+            }
+
+            activeNavMesh = navMesh;
+        }
+
+        if (!activeNavMesh)
+        {
+            for (PathRequest* request : pending)
+            {
+                request->status = PathRequestStatus::Failed;
+                if (request->released)
+                    requests.erase(request->id);
+            }
+
+            pending.clear();
+            return;
+        }
+
+        if (pending.empty() && processing.empty())
+            return;
+
+        dispatched.swap(pending);
+        pending.clear();
+        dispatchCursor = 0;
+        iterationBudget = std::max(iterationsPerSlot, 1);
+
+        task->m_SetSize = (uint32_t)slots.size();
+        g_taskSched.AddTaskSetToPipe(task);
+        inFlight = true;
+    }
+
+    void PathQueryQueue::processSlot(QuerySlot& slot, int iterations)
+    {
+        int budget = iterations;
+
+        while (budget > 0)
+        {
+            if (!slot.current)
+            {
+                size_t idx = dispatchCursor.fetch_add(1);
+                if (idx >= dispatched.size())
+                    break;
+
+                slot.current = dispatched[idx];
+
+                if (!beginRequest(slot))
+                {
+                    slot.current->workerStatus = PathRequestStatus::Failed;
+                    slot.current = nullptr;
+                    continue;
+                }
+            }
+
+            int doneIterations = 0;
+            dtStatus status = slot.query->updateSlicedFindPath(budget, &doneIterations);
+            budget -= std::max(doneIterations, 1);
+
+            if (dtStatusInProgress(status))
+                continue;
+
+            if (dtStatusFailed(status))
+            {
+                slot.current->workerStatus = PathRequestStatus::Failed;
+                slot.current = nullptr;
+                continue;
+            }
+
+            finishRequest(slot);
+        }
+    }
+
+    bool PathQueryQueue::beginRequest(QuerySlot& slot)
+    {
+        PathRequest* request = slot.current;
+        dtPolyRef startPolygon;
+        dtPolyRef endPolygon;
+
+        dtStatus status = slot.query->findNearestPoly(glm::value_ptr(request->start), glm::value_ptr(PolySearchExtent),
+                                                      &defaultFilter, &startPolygon, glm::value_ptr(slot.startPos));
+        if (dtStatusFailed(status) || startPolygon == 0)
+            return false;
+
+        status = slot.query->findNearestPoly(glm::value_ptr(request->end), glm::value_ptr(PolySearchExtent),
+                                             &defaultFilter, &endPolygon, glm::value_ptr(slot.endPos));
+        if (dtStatusFailed(status) || endPolygon == 0)
+            return false;
+
+        status = slot.query->initSlicedFindPath(startPolygon, endPolygon, glm::value_ptr(slot.startPos),
+                                                glm::value_ptr(slot.endPos), &defaultFilter);
+        return !dtStatusFailed(status);
+    }
+
+    void PathQueryQueue::finishRequest(QuerySlot& slot)
+    {
+        PathRequest* request = slot.current;
+        slot.current = nullptr;
+
+        dtPolyRef pathPolys[MaxPathPolys];
+        int numPathPolys = 0;
+        dtStatus status = slot.query->finalizeSlicedFindPath(pathPolys, &numPathPolys, MaxPathPolys);
+
+        if (dtStatusFailed(status) || numPathPolys == 0)
+        {
+            request->workerStatus = PathRequestStatus::Failed;
+            return;
+        }
+
+        glm::vec3 pathPoints[MaxPathPoints];
+        uint8_t pathFlags[MaxPathPoints];
+        dtPolyRef straightPathPolys[MaxPathPoints];
+        int numPathPoints = 0;
+
+        status = slot.query->findStraightPath(glm::value_ptr(slot.startPos), glm::value_ptr(slot.endPos), pathPolys,
+                                              numPathPolys, glm::value_ptr(pathPoints[0]), pathFlags,
+                                              straightPathPolys, &numPathPoints, MaxPathPoints);
+
+        if (dtStatusFailed(status))
+        {
+            request->workerStatus = PathRequestStatus::Failed;
+            return;
+        }
+
+        request->points.assign(pathPoints, pathPoints + numPathPoints);
+        request->workerStatus = PathRequestStatus::Ready;
+    }
+
+    bool PathQueryQueue::findPathImmediate(dtNavMeshQuery* query, glm::vec3 start, glm::vec3 end,
+                                           std::vector<glm::vec3>& points)
+    {
+        points.clear();
+        dtPolyRef startPolygon;
+        dtPolyRef endPolygon;
+        glm::vec3 startPos;
+        glm::vec3 endPos;
+
+        dtStatus status = query->findNearestPoly(glm::value_ptr(start), glm::value_ptr(PolySearchExtent),
+                                                 &defaultFilter, &startPolygon, glm::value_ptr(startPos));
+        if (dtStatusFailed(status) || startPolygon == 0)
+            return false;
+
+        status = query->findNearestPoly(glm::value_ptr(end), glm::value_ptr(PolySearchExtent), &defaultFilter,
+                                        &endPolygon, glm::value_ptr(endPos));
+        if (dtStatusFailed(status) || endPolygon == 0)
+            return false;
+
+        dtPolyRef pathPolys[MaxPathPolys];
+        int numPathPolys = 0;
+        status = query->findPath(startPolygon, endPolygon, glm::value_ptr(startPos), glm::value_ptr(endPos),
+                                 &defaultFilter, pathPolys, &numPathPolys, MaxPathPolys);
+
+        if (dtStatusFailed(status) || numPathPolys == 0)
+            return false;
+
+        glm::vec3 pathPoints[MaxPathPoints];
+        uint8_t pathFlags[MaxPathPoints];
+        dtPolyRef straightPathPolys[MaxPathPoints];
+        int numPathPoints = 0;
+
+        status = query->findStraightPath(glm::value_ptr(startPos), glm::value_ptr(endPos), pathPolys, numPathPolys,
+                                         glm::value_ptr(pathPoints[0]), pathFlags, straightPathPolys, &numPathPoints,
+                                         MaxPathPoints);
+
+        if (dtStatusFailed(status))
+            return false;
+
+        points.assign(pathPoints, pathPoints + numPathPoints);
+        return true;
+    }
+}
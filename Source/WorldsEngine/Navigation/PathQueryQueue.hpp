@@ -0,0 +1,92 @@
+#pragma once
+#include <DetourNavMesh.h>
+#include <atomic>
+#include <glm/vec3.hpp>
+#include <memory>
+#include <robin_hood.h>
+#include <stdint.h>
+#include <vector>
+
+class dtNavMeshQuery;
+
+namespace worlds
+{
+    typedef uint32_t PathRequestID;
+    const PathRequestID InvalidPathRequest = 0;
+
+    enum class PathRequestStatus : int32_t
+    {
+        Unknown,
+        Pending,
+        Ready,
+        Failed
+    };
+
+    struct PathRequest
+    {
+        PathRequestID id;
+        glm::vec3 start;
+        glm::vec3 end;
+        PathRequestStatus status = PathRequestStatus::Pending;
+        // Only touched by a worker while the request is being processed
+        PathRequestStatus workerStatus = PathRequestStatus::Pending;
+        bool released = false;
+        std::vector<glm::vec3> points;
+    };
+
+    // Runs path queries on the task scheduler. Each query slot has its own dtNavMeshQuery and works
+    // through requests a limited number of A* iterations at a time, so long paths are spread over
+    // several frames. Results of work started in one update are visible after the next collect().
+    class PathQueryQueue
+    {
+      public:
+        PathQueryQueue(int numSlots);
+        ~PathQueryQueue();
+
+        PathRequestID request(glm::vec3 start, glm::vec3 end);
+        PathRequestStatus getStatus(PathRequestID id) const;
+        // Returns nullptr unless the request is ready
+        const std::vector<glm::vec3>* getPath(PathRequestID id) const;
+        // Frees the request. Must be called once the result isn't needed anymore.
+        void release(PathRequestID id);
+
+        // Waits for work started by the last dispatch and publishes its results
+        void collect();
+        // Starts working on pending requests in the background against navMesh
+        void dispatch(const std::shared_ptr<dtNavMesh>& navMesh, int iterationsPerSlot);
+        size_t pendingCount() const;
+
+        // Finds a path on the calling thread using the given query
+        static bool findPathImmediate(dtNavMeshQuery* query, glm::vec3 start, glm::vec3 end,
+                                      std::vector<glm::vec3>& points);
+
+      private:
+        struct QuerySlot
+        {
+            dtNavMeshQuery* query = nullptr;
+            const dtNavMesh* navMesh = nullptr;
+            PathRequest* current = nullptr;
+            glm::vec3 startPos;
+            glm::vec3 endPos;
+        };
+
+        class QueryTask;
+
+        void processSlot(QuerySlot& slot, int iterations);
+        bool beginRequest(QuerySlot& slot);
+        void finishRequest(QuerySlot& slot);
+
+        robin_hood::unordered_node_map<PathRequestID, PathRequest> requests;
+        std::vector<PathRequest*> pending;
+        std::vector<PathRequest*> dispatched;
+        // Requests a worker has started on that haven't been published yet
+        std::vector<PathRequest*> processing;
+        std::atomic<size_t> dispatchCursor;
+        std::vector<QuerySlot> slots;
+        std::shared_ptr<dtNavMesh> activeNavMesh;
+        QueryTask* task;
+        bool inFlight = false;
+        PathRequestID nextId = 1;
+        int iterationBudget = 0;
+    };
+}
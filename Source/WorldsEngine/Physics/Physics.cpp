@@ -1,4 +1,5 @@
 #include "Physics.hpp"
+#include <Core/AllocTracking.hpp>
 #include "Core/IGameEventHandler.hpp"
 #include "D6Joint.hpp"
 #include "FixedJoint.hpp"
@@ -6,6 +7,7 @@
 #include "Scripting/NetVM.hpp"
 #include <Core/Console.hpp>
 #include <Core/Fatal.hpp>
+#include <Core/Profiler.hpp>
 #include <ImGui/imgui.h>
 #include <SDL_cpuinfo.h>
 #include <Util/MathsUtil.hpp>
@@ -182,28 +184,7 @@ namespace worlds
                 if (!physicsTriMesh.contains(ps.mesh.mesh))
                 {
                     const LoadedMesh& lm = MeshManager::loadOrGet(ps.mesh.mesh);
-
-                    std::vector<physx::PxVec3> points;
-                    points.resize(lm.vertices.size());
-
-                    for (size_t i = 0; i < lm.vertices.size(); i++)
-                    {
-                        points[i] = glm2px(lm.vertices[i].position);
-                    }
-
-                    physx::PxTriangleMeshDesc meshDesc;
-
-                    meshDesc.points.count = points.size();
-                    meshDesc.points.stride = sizeof(physx::PxVec3);
-                    meshDesc.points.data = points.data();
-
-                    meshDesc.triangles.count = lm.indices.size() / 3;
-                    meshDesc.triangles.data = lm.indices.data();
-                    meshDesc.triangles.stride = sizeof(uint32_t) * 3;
-
-                    physx::PxTriangleMesh* triMesh =
-                        _cooking->createTriangleMesh(meshDesc, _physics->getPhysicsInsertionCallback());
-                    physicsTriMesh.insert({ps.mesh.mesh, triMesh});
+                    physicsTriMesh.insert({ps.mesh.mesh, cookTriangleMesh(lm)});
                 }
 
                 PxMeshScale meshScale{PxVec3{scale.x, scale.y, scale.z}, PxQuat{PxIdentity}};
@@ -295,10 +276,15 @@ namespace worlds
 
     DotNetScriptEngine* physScriptEngine;
 
+    // Contacts are only recorded while PhysX is inside fetchResults. They get
+    // dispatched in one go once the step has finished, which keeps user callbacks
+    // (which may well modify the scene) out of the simulation callback.
+    const size_t INITIAL_CONTACT_EVENT_CAPACITY = 1024;
+
     class SimulationCallback : public PxSimulationEventCallback
     {
       public:
-        SimulationCallback(entt::registry& reg) : reg{reg}
+        SimulationCallback(std::vector<PhysicsContactEvent>& contactEvents) : contactEvents{contactEvents}
         {
         }
 
@@ -316,12 +302,14 @@ namespace worlds
 
         void onContact(const PxContactPairHeader& pairHeader, const PxContactPair* pairs, uint32_t nbPairs) override
         {
+            const auto removedFlags =
+                PxContactPairHeaderFlag::eREMOVED_ACTOR_0 | PxContactPairHeaderFlag::eREMOVED_ACTOR_1;
+            if (pairHeader.flags & removedFlags)
+                return;
+
             entt::entity a = ptrToEnt(pairHeader.actors[0]->userData);
             entt::entity b = ptrToEnt(pairHeader.actors[1]->userData);
 
-            auto evtA = reg.try_get<PhysicsEvents>(a);
-            auto evtB = reg.try_get<PhysicsEvents>(b);
-
             glm::vec3 velA{0.0f};
             glm::vec3 velB{0.0f};
 
@@ -357,39 +345,17 @@ namespace worlds
                 }
             }
 
-            info.averageContactPoint /= totalContacts;
-            info.normal /= totalContacts;
-
-            info.otherEntity = b;
-            physScriptEngine->handleCollision(a, &info);
-
-            info.otherEntity = a;
-            physScriptEngine->handleCollision(b, &info);
-
-            if (evtA == nullptr && evtB == nullptr)
-                return;
-
-            if (evtA)
+            if (totalContacts > 0)
             {
-                info.otherEntity = b;
-
-                for (int i = 0; i < 4; i++)
-                {
-                    if (evtA->onContact[i])
-                        evtA->onContact[i](a, info);
-                }
+                info.averageContactPoint /= totalContacts;
+                info.normal /= totalContacts;
             }
 
-            if (evtB)
-            {
-                info.otherEntity = a;
+            info.otherEntity = b;
+            contactEvents.push_back(PhysicsContactEvent{a, info});
 
-                for (int i = 0; i < 4; i++)
-                {
-                    if (evtB->onContact[i])
-                        evtB->onContact[i](b, info);
-                }
-            }
+            info.otherEntity = a;
+            contactEvents.push_back(PhysicsContactEvent{b, info});
         }
 
         void onTrigger(PxTriggerPair* pairs, uint32_t count) override
@@ -401,7 +367,7 @@ namespace worlds
         }
 
       private:
-        entt::registry& reg;
+        std::vector<PhysicsContactEvent>& contactEvents;
     };
 
     class ContactModificationCallback : public PxContactModifyCallback
@@ -469,10 +435,18 @@ namespace worlds
         desc.filterShader = filterShader;
         desc.solverType = physx::PxSolverType::eTGS;
         desc.flags = PxSceneFlag::eENABLE_CCD | PxSceneFlag::eENABLE_PCM;
+
+        if (EngineArguments::hasArgument("deterministic-sim"))
+        {
+            logMsg(WELogCategoryPhysics, "Enabling enhanced determinism.");
+            desc.flags |= PxSceneFlag::eENABLE_ENHANCED_DETERMINISM;
+        }
+
         desc.bounceThresholdVelocity = 2.0f;
         _scene = _physics->createScene(desc);
 
-        simCallback = new SimulationCallback(reg);
+        contactEvents.reserve(INITIAL_CONTACT_EVENT_CAPACITY);
+        simCallback = new SimulationCallback(contactEvents);
         contactModCallback = new ContactModificationCallback();
         _scene->setSimulationEventCallback(simCallback);
         _scene->setContactModifyCallback(contactModCallback);
@@ -512,8 +486,79 @@ namespace worlds
 
     void PhysicsSystem::stepSimulation(float deltaTime)
     {
+        ProfileScoped;
+        AllocTagScope allocTag{AllocTag::Physics};
+        contactEvents.clear();
         _scene->simulate(deltaTime);
         _scene->fetchResults(true);
+        dispatchContactEvents();
+    }
+
+    void PhysicsSystem::dispatchContactEvents()
+    {
+        ZoneScoped;
+        if (contactEvents.empty())
+            return;
+
+        physScriptEngine->handleCollisions(contactEvents.data(), (uint32_t)contactEvents.size());
+
+        // Callbacks are allowed to destroy entities, so everything gets revalidated
+        // here rather than being looked up ahead of time.
+        for (const PhysicsContactEvent& evt : contactEvents)
+        {
+            if (!reg.valid(evt.entity))
+                continue;
+
+            auto* physEvents = reg.try_get<PhysicsEvents>(evt.entity);
+            if (physEvents == nullptr)
+                continue;
+
+            for (uint32_t i = 0; i < PhysicsEvents::MAX_CONTACT_EVENTS; i++)
+            {
+                if (physEvents->onContact[i])
+                    physEvents->onContact[i](evt.entity, evt.info);
+            }
+        }
+    }
+
+    physx::PxTriangleMesh* PhysicsSystem::cookTriangleMesh(const LoadedMesh& lm)
+    {
+        ZoneScoped;
+        std::vector<physx::PxVec3> points;
+        points.resize(lm.vertices.size());
+
+        for (size_t i = 0; i < lm.vertices.size(); i++)
+        {
+            points[i] = glm2px(lm.vertices[i].position);
+        }
+
+        physx::PxTriangleMeshDesc meshDesc;
+
+        meshDesc.points.count = points.size();
+        meshDesc.points.stride = sizeof(physx::PxVec3);
+        meshDesc.points.data = points.data();
+
+        meshDesc.triangles.count = lm.indices.size() / 3;
+        meshDesc.triangles.data = lm.indices.data();
+        meshDesc.triangles.stride = sizeof(uint32_t) * 3;
+
+        return _cooking->createTriangleMesh(meshDesc, _physics->getPhysicsInsertionCallback());
+    }
+
+    void PhysicsSystem::addTriangleMesh(AssetID id, physx::PxTriangleMesh* mesh)
+    {
+        if (physicsTriMesh.contains(id))
+        {
+            mesh->release();
+            return;
+        }
+
+        physicsTriMesh.insert({id, mesh});
+    }
+
+    bool PhysicsSystem::hasTriangleMesh(AssetID id)
+    {
+        return physicsTriMesh.contains(id);
     }
 
     void PhysicsSystem::resetMeshCache()
@@ -10,6 +10,7 @@
 #include <physx/PxPhysics.h>
 #include <physx/PxPhysicsAPI.h>
 #include <physx/extensions/PxD6Joint.h>
+#include <vector>
 
 namespace worlds
 {
@@ -65,6 +66,21 @@ namespace worlds
 
     typedef void (*ContactModCallback)(void* ctx, physx::PxContactModifyPair* pairs, uint32_t count);
 
+    struct PhysicsContactInfo
+    {
+        float relativeSpeed;
+        entt::entity otherEntity;
+        glm::vec3 averageContactPoint;
+        glm::vec3 normal;
+    };
+
+    // Layout is shared with the Collision struct in Physics.Internal.cs.
+    struct PhysicsContactEvent
+    {
+        entt::entity entity;
+        PhysicsContactInfo info;
+    };
+
     class PhysicsSystem
     {
       public:
@@ -81,6 +97,11 @@ namespace worlds
         template <typename T> void updatePhysicsShapes(T& pa, glm::vec3 scale = glm::vec3{1.0f});
 
         void resetMeshCache();
+        // Cooks a triangle mesh collider. Unlike the rest of the physics system this is safe to call
+        // from worker threads; the result should be passed to addTriangleMesh on the main thread.
+        physx::PxTriangleMesh* cookTriangleMesh(const LoadedMesh& lm);
+        void addTriangleMesh(AssetID id, physx::PxTriangleMesh* mesh);
+        bool hasTriangleMesh(AssetID id);
 
         physx::PxScene* scene()
         {
@@ -93,6 +114,7 @@ namespace worlds
         ~PhysicsSystem();
 
       private:
+        void dispatchContactEvents();
         void setupD6Joint(entt::registry& reg, entt::entity ent);
         void destroyD6Joint(entt::registry& reg, entt::entity ent);
         void setupFixedJoint(entt::registry& reg, entt::entity ent);
@@ -106,14 +128,7 @@ namespace worlds
         physx::PxDefaultAllocator allocator;
         physx::PxErrorCallback* errorCallback;
         physx::PxRigidBody* dummyBody;
-    };
-
-    struct PhysicsContactInfo
-    {
-        float relativeSpeed;
-        entt::entity otherEntity;
-        glm::vec3 averageContactPoint;
-        glm::vec3 normal;
+        std::vector<PhysicsContactEvent> contactEvents;
     };
 
     struct PhysicsEvents
@@ -1,4 +1,5 @@
 #pragma once
+#include <Core/WorldComponents.hpp>
 #include <Render/Frustum.hpp>
 #include <Render/RenderInternal.hpp>
 
@@ -30,4 +31,22 @@ namespace worlds
 
         return true;
     }
-}
\ No newline at end of file
+
+    // Skinned meshes can move well outside their bind pose bounds, so they're culled with the
+    // bounds of their current pose once the animation system has worked them out.
+    inline bool cullSkinnedMesh(const RenderMeshInfo& rmi, const Pose& pose, const Transform& t, Frustum* frustums,
+                                int numViews)
+    {
+        if (!pose.hasBounds)
+            return cullMesh(rmi, t, frustums, numViews);
+
+        AABB aabb = AABB{pose.boundsMin, pose.boundsMax}.transform(t);
+        for (int i = 0; i < numViews; i++)
+        {
+            if (frustums[i].containsAABB(aabb.min, aabb.max))
+                return true;
+        }
+
+        return false;
+    }
+}
@@ -0,0 +1,531 @@
+#include "LightClusters.hpp"
+#include <Core/Console.hpp>
+#include <Core/Log.hpp>
+#include <Core/TaskScheduler.hpp>
+#include <Core/WorldComponents.hpp>
+#include <Render/Camera.hpp>
+#include <Util/FrameArena.hpp>
+#include <Util/TimingUtil.hpp>
+#include <Tracy.hpp>
+#include <algorithm>
+#include <float.h>
+#include <glm/glm.hpp>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+
+namespace worlds
+{
+    // Slices overlap a little so a fragment right on a boundary finds its lights whichever side the
+    // GPU's log() rounds it to
+    const float SLICE_PADDING = 0.001f;
+    // Effectively infinite, but still finite so the cluster bounds don't turn into NaNs
+    const float LAST_SLICE_DEPTH = 1.0e7f;
+    const uint32_t NO_SLICES = ~0u;
+
+    inline float axisDistanceSq(float v, const glm::vec2& bounds)
+    {
+        float d = glm::max(glm::max(bounds.x - v, v - bounds.y), 0.0f);
+        return d * d;
+    }
+
+    inline bool withinRadius(float dxSq, float dySq, float dzSq, float radius)
+    {
+        return dxSq + dySq + dzSq <= radius * radius;
+    }
+
+    // Bounds along one axis of the part of a tile column/row between two depths, given the slopes
+    // of its edges
+    inline glm::vec2 tileAxisBounds(float slopeA, float slopeB, float nearDepth, float farDepth)
+    {
+        float lo = glm::min(slopeA, slopeB);
+        float hi = glm::max(slopeA, slopeB);
+        return glm::vec2{glm::min(lo * nearDepth, lo * farDepth), glm::max(hi * nearDepth, hi * farDepth)};
+    }
+
+    void LightClusterBuilder::setup(int width, int height, int numViews, const glm::mat4* projections, float zNear,
+                                    float zFar)
+    {
+        uint32_t numX = (width + TileSize - 1) / TileSize;
+        uint32_t numY = (height + TileSize - 1) / TileSize;
+
+        gridInfo.tileSize = TileSize;
+        gridInfo.numClustersX = numX;
+        gridInfo.numClustersY = numY;
+        gridInfo.numClustersZ = NumSlices;
+        gridInfo.zScale = NumSlices / logf(zFar / zNear);
+        gridInfo.zBias = -logf(zNear) * gridInfo.zScale;
+        gridInfo.clustersPerView = numX * numY * NumSlices;
+        this->numViews = numViews;
+
+        for (uint32_t i = 0; i < NumSlices; i++)
+        {
+            float sliceStart = i == 0 ? 0.0f : zNear * powf(zFar / zNear, (float)i / NumSlices);
+            float sliceEnd =
+                i == NumSlices - 1 ? LAST_SLICE_DEPTH : zNear * powf(zFar / zNear, (float)(i + 1) / NumSlices);
+            sliceBounds[i] = glm::vec2{sliceStart * (1.0f - SLICE_PADDING), sliceEnd * (1.0f + SLICE_PADDING)};
+        }
+
+        columnBounds.resize((size_t)numViews * NumSlices * numX);
+        rowBounds.resize((size_t)numViews * NumSlices * numY);
+
+        FrameVector<float> slopesX(numX + 1);
+        FrameVector<float> slopesY(numY + 1);
+
+        for (int v = 0; v < numViews; v++)
+        {
+            glm::mat4 invProj = glm::inverse(projections[v]);
+
+            // Unproject points along the middle of the screen to find how far each tile edge is
+            // from the centre at a depth of 1. The top row of tiles is at +Y, same as light_cull.
+            auto slopeAt = [&](float ndcX, float ndcY, int axis) {
+                glm::vec4 p = invProj * glm::vec4{ndcX, ndcY, 0.5f, 1.0f};
+                return p[axis] / -p.z;
+            };
+
+            for (uint32_t x = 0; x <= numX; x++)
+            {
+                float px = (float)std::min(x * TileSize, (uint32_t)width);
+                slopesX[x] = slopeAt(2.0f * px / width - 1.0f, 0.0f, 0);
+            }
+
+            for (uint32_t y = 0; y <= numY; y++)
+            {
+                float py = (float)std::min(y * TileSize, (uint32_t)height);
+                slopesY[y] = slopeAt(0.0f, 1.0f - 2.0f * py / height, 1);
+            }
+
+            for (uint32_t s = 0; s < NumSlices; s++)
+            {
+                glm::vec2 depths = sliceBounds[s];
+                size_t sliceIdx = (size_t)v * NumSlices + s;
+
+                for (uint32_t x = 0; x < numX; x++)
+                    columnBounds[sliceIdx * numX + x] = tileAxisBounds(slopesX[x], slopesX[x + 1], depths.x, depths.y);
+
+                for (uint32_t y = 0; y < numY; y++)
+                    rowBounds[sliceIdx * numY + y] = tileAxisBounds(slopesY[y], slopesY[y + 1], depths.x, depths.y);
+            }
+        }
+    }
+
+    // x and y are view space, z is the distance in front of the viewer
+    glm::vec3 LightClusterBuilder::toClusterSpace(const glm::mat4& view, const glm::vec3& position) const
+    {
+        glm::vec4 p = view * glm::vec4{position, 1.0f};
+        return glm::vec3{p.x, p.y, -p.z};
+    }
+
+    bool LightClusterBuilder::sphereTouchesCluster(const glm::vec3& center, float radius, uint32_t view, uint32_t x,
+                                                   uint32_t y, uint32_t slice) const
+    {
+        size_t sliceIdx = (size_t)view * NumSlices + slice;
+        float dxSq = axisDistanceSq(center.x, columnBounds[sliceIdx * gridInfo.numClustersX + x]);
+        float dySq = axisDistanceSq(center.y, rowBounds[sliceIdx * gridInfo.numClustersY + y]);
+        float dzSq = axisDistanceSq(center.z, sliceBounds[slice]);
+        return withinRadius(dxSq, dySq, dzSq, radius);
+    }
+
+    // The range searches below are widened by this much (relative to the coordinates involved) so
+    // they never skip a cluster the exact test would accept after rounding differently
+    const float RANGE_PADDING = 1.0e-4f;
+
+    inline float rangePadding(float center, float radius)
+    {
+        return (glm::abs(center) + radius) * RANGE_PADDING + 1.0e-6f;
+    }
+
+    // Finds the range of monotonically increasing bounds within radius of center
+    bool overlappingRange(const glm::vec2* bounds, uint32_t count, float center, float radius, uint32_t& first,
+                          uint32_t& last)
+    {
+        float padding = rangePadding(center, radius);
+        float lo = center - radius - padding;
+        float hi = center + radius + padding;
+        const glm::vec2* begin =
+            std::partition_point(bounds, bounds + count, [&](const glm::vec2& b) { return b.y < lo; });
+        const glm::vec2* end =
+            std::partition_point(begin, bounds + count, [&](const glm::vec2& b) { return b.x <= hi; });
+        first = (uint32_t)(begin - bounds);
+        last = (uint32_t)(end - bounds);
+        return first < last;
+    }
+
+    // Same as overlappingRange, for bounds that decrease like the rows of tiles do
+    bool overlappingRangeReversed(const glm::vec2* bounds, uint32_t count, float center, float radius,
+                                  uint32_t& first, uint32_t& last)
+    {
+        float padding = rangePadding(center, radius);
+        float lo = center - radius - padding;
+        float hi = center + radius + padding;
+        const glm::vec2* begin =
+            std::partition_point(bounds, bounds + count, [&](const glm::vec2& b) { return b.x > hi; });
+        const glm::vec2* end =
+            std::partition_point(begin, bounds + count, [&](const glm::vec2& b) { return b.y >= lo; });
+        first = (uint32_t)(begin - bounds);
+        last = (uint32_t)(end - bounds);
+        return first < last;
+    }
+
+    // Moves lights into view space and finds the depth slices each one could touch
+    struct LightClusterBuilder::LightTask : public enki::ITaskSet
+    {
+        LightClusterBuilder* builder;
+        const glm::mat4* views;
+        const ClusterLightBounds* lights;
+        uint32_t numLights;
+
+        void ExecuteRange(enki::TaskSetPartition range, uint32_t threadnum) override
+        {
+            ZoneScoped;
+
+            for (uint32_t i = range.start; i < range.end; i++)
+            {
+                uint32_t view = i / numLights;
+                const ClusterLightBounds& light = lights[i % numLights];
+                glm::vec3 center = builder->toClusterSpace(views[view], light.position);
+                builder->viewLightPositions[i] = center;
+
+                uint32_t first, last;
+                if (overlappingRange(builder->sliceBounds, NumSlices, center.z, light.radius, first, last))
+                    builder->lightSliceRanges[i] = first | (last << 16);
+                else
+                    builder->lightSliceRanges[i] = NO_SLICES;
+            }
+        }
+    };
+
+    // Assigns the lights overlapping one depth slice of one view to that slice's clusters. Each
+    // slice gets its own index list, which are merged once every slice is done.
+    struct LightClusterBuilder::SliceTask : public enki::ITaskSet
+    {
+        LightClusterBuilder* builder;
+        const ClusterLightBounds* lights;
+        uint32_t numLights;
+
+        void ExecuteRange(enki::TaskSetPartition range, uint32_t threadnum) override
+        {
+            ZoneScoped;
+            const ClusterGridInfo& grid = builder->gridInfo;
+            uint32_t numX = grid.numClustersX;
+            uint32_t numY = grid.numClustersY;
+            uint32_t tilesPerSlice = numX * numY;
+
+            for (uint32_t task = range.start; task < range.end; task++)
+            {
+                uint32_t view = task / NumSlices;
+                uint32_t slice = task % NumSlices;
+                const glm::vec2* columns = &builder->columnBounds[(size_t)task * numX];
+                const glm::vec2* rows = &builder->rowBounds[(size_t)task * numY];
+                LightCluster* clusters = &builder->clusters[(size_t)task * tilesPerSlice];
+
+                for (uint32_t i = 0; i < tilesPerSlice; i++)
+                    clusters[i] = LightCluster{0, 0};
+
+                // (tile, light) pairs in light order
+                std::vector<uint32_t>& pairs = builder->sliceScratch[task];
+                pairs.clear();
+
+                for (uint32_t j = builder->sliceLightOffsets[task]; j < builder->sliceLightOffsets[task + 1]; j++)
+                {
+                    uint32_t lightIdx = builder->sliceLights[j];
+                    glm::vec3 center = builder->viewLightPositions[(size_t)view * numLights + lightIdx];
+                    float radius = lights[lightIdx].radius;
+
+                    uint32_t firstX, lastX, firstY, lastY;
+                    if (!overlappingRange(columns, numX, center.x, radius, firstX, lastX))
+                        continue;
+
+                    if (!overlappingRangeReversed(rows, numY, center.y, radius, firstY, lastY))
+                        continue;
+
+                    float dzSq = axisDistanceSq(center.z, builder->sliceBounds[slice]);
+
+                    for (uint32_t y = firstY; y < lastY; y++)
+                    {
+                        float dySq = axisDistanceSq(center.y, rows[y]);
+
+                        for (uint32_t x = firstX; x < lastX; x++)
+                        {
+                            float dxSq = axisDistanceSq(center.x, columns[x]);
+                            if (!withinRadius(dxSq, dySq, dzSq, radius))
+                                continue;
+
+                            uint32_t tile = y * numX + x;
+                            clusters[tile].count++;
+                            pairs.push_back(tile);
+                            pairs.push_back(lightIdx);
+                        }
+                    }
+                }
+
+                uint32_t offset = 0;
+                for (uint32_t i = 0; i < tilesPerSlice; i++)
+                {
+                    clusters[i].offset = offset;
+                    offset += clusters[i].count;
+                    clusters[i].count = 0;
+                }
+
+                std::vector<uint32_t>& indices = builder->sliceIndices[task];
+                indices.resize(offset);
+
+                for (size_t i = 0; i < pairs.size(); i += 2)
+                {
+                    LightCluster& cluster = clusters[pairs[i]];
+                    indices[cluster.offset + cluster.count] = pairs[i + 1];
+                    cluster.count++;
+                }
+            }
+        }
+    };
+
+    // Copies every slice's indices into the final list and offsets their clusters to match
+    struct LightClusterBuilder::MergeTask : public enki::ITaskSet
+    {
+        LightClusterBuilder* builder;
+        const uint32_t* sliceBases;
+
+        void ExecuteRange(enki::TaskSetPartition range, uint32_t threadnum) override
+        {
+            ZoneScoped;
+            uint32_t tilesPerSlice = builder->gridInfo.numClustersX * builder->gridInfo.numClustersY;
+
+            for (uint32_t task = range.start; task < range.end; task++)
+            {
+                const std::vector<uint32_t>& indices = builder->sliceIndices[task];
+                if (!indices.empty())
+                    memcpy(&builder->lightIndices[sliceBases[task]], indices.data(),
+                           indices.size() * sizeof(uint32_t));
+
+                LightCluster* clusters = &builder->clusters[(size_t)task * tilesPerSlice];
+                for (uint32_t i = 0; i < tilesPerSlice; i++)
+                    clusters[i].offset += sliceBases[task];
+            }
+        }
+    };
+
+    void LightClusterBuilder::build(const glm::mat4* views, const ClusterLightBounds* lights, uint32_t numLights)
+    {
+        ZoneScoped;
+        uint32_t numTasks = numViews * NumSlices;
+        size_t numViewLights = (size_t)numViews * numLights;
+
+        clusters.resize((size_t)numViews * gridInfo.clustersPerView);
+        viewLightPositions.resize(numViewLights);
+        lightSliceRanges.resize(numViewLights);
+        sliceIndices.resize(numTasks);
+        sliceScratch.resize(numTasks);
+
+        if (numLights > 0)
+        {
+            LightTask lightTask;
+            lightTask.builder = this;
+            lightTask.views = views;
+            lightTask.lights = lights;
+            lightTask.numLights = numLights;
+            lightTask.m_SetSize = (uint32_t)numViewLights;
+            lightTask.m_MinRange = 256;
+
+            g_taskSched.AddTaskSetToPipe(&lightTask);
+            g_taskSched.WaitforTask(&lightTask);
+        }
+
+        // Bucket the lights by slice. Going through them in order keeps every bucket sorted.
+        sliceLightOffsets.assign(numTasks + 1, 0);
+        for (size_t i = 0; i < numViewLights; i++)
+        {
+            uint32_t sliceRange = lightSliceRanges[i];
+            if (sliceRange == NO_SLICES)
+                continue;
+
+            uint32_t base = (uint32_t)(i / numLights) * NumSlices;
+            for (uint32_t s = sliceRange & 0xFFFF; s < (sliceRange >> 16); s++)
+                sliceLightOffsets[base + s + 1]++;
+        }
+
+        for (uint32_t i = 0; i < numTasks; i++)
+            sliceLightOffsets[i + 1] += sliceLightOffsets[i];
+
+        sliceLights.resize(sliceLightOffsets[numTasks]);
+        FrameVector<uint32_t> fillPositions{sliceLightOffsets.begin(), sliceLightOffsets.end() - 1};
+
+        for (size_t i = 0; i < numViewLights; i++)
+        {
+            uint32_t sliceRange = lightSliceRanges[i];
+            if (sliceRange == NO_SLICES)
+                continue;
+
+            uint32_t base = (uint32_t)(i / numLights) * NumSlices;
+            for (uint32_t s = sliceRange & 0xFFFF; s < (sliceRange >> 16); s++)
+                sliceLights[fillPositions[base + s]++] = (uint32_t)(i % numLights);
+        }
+
+        SliceTask sliceTask;
+        sliceTask.builder = this;
+        sliceTask.lights = lights;
+        sliceTask.numLights = numLights;
+        sliceTask.m_SetSize = numTasks;
+        sliceTask.m_MinRange = 1;
+
+        g_taskSched.AddTaskSetToPipe(&sliceTask);
+        g_taskSched.WaitforTask(&sliceTask);
+
+        FrameVector<uint32_t> sliceBases(numTasks);
+        uint32_t totalIndices = 0;
+        for (uint32_t i = 0; i < numTasks; i++)
+        {
+            sliceBases[i] = totalIndices;
+            totalIndices += (uint32_t)sliceIndices[i].size();
+        }
+
+        lightIndices.resize(totalIndices);
+
+        MergeTask mergeTask;
+        mergeTask.builder = this;
+        mergeTask.sliceBases = sliceBases.data();
+        mergeTask.m_SetSize = numTasks;
+        mergeTask.m_MinRange = 4;
+
+        g_taskSched.AddTaskSetToPipe(&mergeTask);
+        g_taskSched.WaitforTask(&mergeTask);
+    }
+
+    void LightClusterBuilder::buildBruteForce(const glm::mat4* views, const ClusterLightBounds* lights,
+                                              uint32_t numLights)
+    {
+        ZoneScoped;
+        clusters.resize((size_t)numViews * gridInfo.clustersPerView);
+        lightIndices.clear();
+
+        std::vector<glm::vec3> centers(numLights);
+        size_t clusterIdx = 0;
+
+        for (int v = 0; v < numViews; v++)
+        {
+            for (uint32_t i = 0; i < numLights; i++)
+                centers[i] = toClusterSpace(views[v], lights[i].position);
+
+            for (uint32_t s = 0; s < NumSlices; s++)
+            {
+                for (uint32_t y = 0; y < gridInfo.numClustersY; y++)
+                {
+                    for (uint32_t x = 0; x < gridInfo.numClustersX; x++)
+                    {
+                        LightCluster& cluster = clusters[clusterIdx++];
+                        cluster.offset = (uint32_t)lightIndices.size();
+
+                        for (uint32_t i = 0; i < numLights; i++)
+                        {
+                            if (sphereTouchesCluster(centers[i], lights[i].radius, v, x, y, s))
+                                lightIndices.push_back(i);
+                        }
+
+                        cluster.count = (uint32_t)lightIndices.size() - cluster.offset;
+                    }
+                }
+            }
+        }
+    }
+
+    float lightImportance(const WorldLight& light, const Transform& transform, glm::vec3 viewerPos)
+    {
+        // The sun and friends light everything
+        if (light.type == LightType::Directional)
+            return FLT_MAX;
+
+        float luminance = glm::dot(light.color * light.intensity, glm::vec3{0.2126f, 0.7152f, 0.0722f});
+        float relativeDistance = glm::distance(transform.position, viewerPos) / glm::max(light.maxDistance, 0.01f);
+        return luminance / (1.0f + relativeDistance * relativeDistance);
+    }
+
+    double sortedPercentile(const std::vector<double>& sorted, double p)
+    {
+        return sorted[std::min((size_t)(p * (sorted.size() - 1) + 0.5), sorted.size() - 1)];
+    }
+
+    // Generates a city block's worth of lights around a viewer and times cluster building, checking
+    // the result against the brute force version
+    void runClusterBenchmark(uint32_t numLights, int frames)
+    {
+        std::mt19937 rng{1337};
+        std::uniform_real_distribution<float> horizontal{-100.0f, 100.0f};
+        std::uniform_real_distribution<float> vertical{-5.0f, 30.0f};
+        std::uniform_real_distribution<float> radius{1.0f, 12.0f};
+
+        std::vector<ClusterLightBounds> lights(numLights);
+        for (ClusterLightBounds& light : lights)
+        {
+            light.position = glm::vec3{horizontal(rng), vertical(rng), horizontal(rng)};
+            light.radius = radius(rng);
+        }
+
+        Camera camera{};
+        camera.position = glm::vec3{0.0f, 1.7f, 0.0f};
+        glm::mat4 projection = camera.getProjectionMatrix(1920.0f / 1080.0f);
+
+        LightClusterBuilder builder;
+        builder.setup(1920, 1080, 1, &projection, camera.near, camera.far);
+
+        std::vector<double> times;
+        for (int frame = 0; frame < frames; frame++)
+        {
+            camera.rotation = glm::angleAxis(frame * 0.02f, glm::vec3{0.0f, 1.0f, 0.0f});
+            glm::mat4 view = camera.getViewMatrix();
+
+            PerfTimer timer;
+            builder.build(&view, lights.data(), numLights);
+            times.push_back(timer.stopGetMs());
+        }
+
+        std::sort(times.begin(), times.end());
+        double mean = 0.0;
+        for (double t : times)
+            mean += t / frames;
+
+        std::vector<LightCluster> clusters = builder.getClusters();
+        std::vector<uint32_t> indices = builder.getLightIndices();
+
+        glm::mat4 view = camera.getViewMatrix();
+        PerfTimer bruteForceTimer;
+        builder.buildBruteForce(&view, lights.data(), numLights);
+        double bruteForceTime = bruteForceTimer.stopGetMs();
+
+        bool matches = clusters.size() == builder.getClusters().size() && indices == builder.getLightIndices();
+        for (size_t i = 0; matches && i < clusters.size(); i++)
+        {
+            matches = clusters[i].offset == builder.getClusters()[i].offset &&
+                      clusters[i].count == builder.getClusters()[i].count;
+        }
+
+        uint32_t maxPerCluster = 0;
+        for (const LightCluster& cluster : clusters)
+            maxPerCluster = std::max(maxPerCluster, cluster.count);
+
+        logMsg("%u lights: mean %.3fms, p50 %.3fms, p99 %.3fms, brute force %.1fms, %zu indices (max %u per "
+               "cluster), %s",
+               numLights, mean, sortedPercentile(times, 0.5), sortedPercentile(times, 0.99), bruteForceTime,
+               indices.size(), maxPerCluster, matches ? "matches brute force" : "DOESN'T MATCH BRUTE FORCE");
+    }
+
+    void registerLightClusterCommands()
+    {
+        g_console->registerCommand(
+            [](const char* arg) {
+                int frames = 100;
+                sscanf(arg, "%i", &frames);
+                frames = std::max(frames, 1);
+
+                logMsg("light cluster benchmark: 1920x1080, %ux%u tiles, %u slices, %i frames on %u threads",
+                       (1920 + LightClusterBuilder::TileSize - 1) / LightClusterBuilder::TileSize,
+                       (1080 + LightClusterBuilder::TileSize - 1) / LightClusterBuilder::TileSize,
+                       LightClusterBuilder::NumSlices, frames, g_taskSched.GetNumTaskThreads());
+
+                for (uint32_t numLights : {1000u, 4000u, 16000u})
+                    runClusterBenchmark(numLights, frames);
+            },
+            "r_lightClusterBenchmark",
+            "Times light cluster assignment for 1k, 4k and 16k generated lights. Args: [frames]");
+    }
+}
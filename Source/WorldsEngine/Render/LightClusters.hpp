@@ -0,0 +1,99 @@
+#pragma once
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <stdint.h>
+#include <vector>
+
+struct Transform;
+
+namespace worlds
+{
+    struct WorldLight;
+
+    // World space sphere containing everything a light can touch
+    struct ClusterLightBounds
+    {
+        glm::vec3 position;
+        float radius;
+    };
+
+    // Mirrored by ClusterGridInfo in LightClusters.slang
+    struct ClusterGridInfo
+    {
+        uint32_t tileSize;
+        uint32_t numClustersX;
+        uint32_t numClustersY;
+        uint32_t numClustersZ;
+        // slice = floor(log(viewDepth) * zScale + zBias)
+        float zScale;
+        float zBias;
+        uint32_t clustersPerView;
+        uint32_t pad;
+    };
+
+    // Range of a cluster's lights in the light index list
+    struct LightCluster
+    {
+        uint32_t offset;
+        uint32_t count;
+    };
+
+    // Splits each view into screen tiles and logarithmic depth slices and works out which lights
+    // touch each of the resulting clusters. Clusters are ordered x, then y, then slice, then view.
+    class LightClusterBuilder
+    {
+      public:
+        static const uint32_t TileSize = 64;
+        static const uint32_t NumSlices = 24;
+
+        // Depths past zFar all fall into the last slice. The projections can be asymmetric (as they
+        // are in VR) but can't be skewed.
+        void setup(int width, int height, int numViews, const glm::mat4* projections, float zNear, float zFar);
+        // Assigns lights to clusters in parallel. Index lists come out sorted by light index.
+        void build(const glm::mat4* views, const ClusterLightBounds* lights, uint32_t numLights);
+        // Tests every light against every cluster on the calling thread. Produces exactly what
+        // build() does, so it's there to check it against.
+        void buildBruteForce(const glm::mat4* views, const ClusterLightBounds* lights, uint32_t numLights);
+
+        const ClusterGridInfo& getGridInfo() const { return gridInfo; }
+        const std::vector<LightCluster>& getClusters() const { return clusters; }
+        const std::vector<uint32_t>& getLightIndices() const { return lightIndices; }
+
+      private:
+        struct LightTask;
+        struct SliceTask;
+        struct MergeTask;
+
+        glm::vec3 toClusterSpace(const glm::mat4& view, const glm::vec3& position) const;
+        bool sphereTouchesCluster(const glm::vec3& center, float radius, uint32_t view, uint32_t x, uint32_t y,
+                                  uint32_t slice) const;
+
+        ClusterGridInfo gridInfo{};
+        int numViews = 0;
+        // A cluster's bounds are the product of its slice's depth range and the x/y ranges of its
+        // column and row within that slice, which are kept per view and slice
+        glm::vec2 sliceBounds[NumSlices];
+        std::vector<glm::vec2> columnBounds;
+        std::vector<glm::vec2> rowBounds;
+
+        std::vector<LightCluster> clusters;
+        std::vector<uint32_t> lightIndices;
+
+        // Per view light positions and the range of slices each one touches
+        std::vector<glm::vec3> viewLightPositions;
+        std::vector<uint32_t> lightSliceRanges;
+        // The lights touching each slice of each view
+        std::vector<uint32_t> sliceLightOffsets;
+        std::vector<uint32_t> sliceLights;
+        // Each slice's index list is built separately and merged into lightIndices afterwards
+        std::vector<std::vector<uint32_t>> sliceIndices;
+        std::vector<std::vector<uint32_t>> sliceScratch;
+    };
+
+    // Rough measure of how much a light contributes at the viewer, used to pick which lights get
+    // shadows and which to drop when there are too many
+    float lightImportance(const WorldLight& light, const Transform& transform, glm::vec3 viewerPos);
+
+    void registerLightClusterCommands();
+}
@@ -1,5 +1,6 @@
 #define CRND_HEADER_FILE_ONLY
 #include "TextureLoader.hpp"
+#include <Core/AllocTracking.hpp>
 #include "crn_decomp.h"
 #include "stb_image.h"
 #include "Tracy.hpp"
@@ -261,6 +262,7 @@ namespace worlds
     TextureData loadTexData(AssetID id)
     {
         ZoneScoped;
+        AllocTagScope allocTag{AllocTag::Assets};
 
         if (!AssetDB::exists(id))
         {
@@ -14,7 +14,8 @@ typedef void* ImTextureID;
 namespace worlds
 {
     struct EngineInterfaces;
-    const int NUM_SHADOW_LIGHTS = 16;
+    // Upper bound on shadowed lights, r_maxShadowLights picks how many are actually used
+    const int NUM_SHADOW_LIGHTS = 64;
 #pragma pack(push, 1)
     struct Vertex
     {
@@ -45,11 +46,12 @@ namespace worlds
         glm::vec3 color;
         /*
                               light type
-                      shadowmap index  |
-            spotlight outer cutoff  |  |
-         currently unused       |   |  |
-                        |       |   |  |
-         /---------------\/------\/--\/-\
+                              unused   |
+        spotlight outer cutoff     |   |
+       shadowmap index       |     |   |
+        unused       |       |     |   |
+             |       |       |     |   |
+         /-------\/------\/------\/--\/-\
          00000000000000000000000000000000 */
         uint32_t packedFlags;
 
@@ -67,10 +69,11 @@ namespace worlds
             packedFlags |= (uint32_t)type;
         }
 
+        // 0xFF means no shadowmap
         void setShadowmapIndex(uint32_t shadowmapIdx)
         {
-            packedFlags &= ~(0b1111 << 3);
-            packedFlags |= (shadowmapIdx & 0b1111) << 3;
+            packedFlags &= ~(0xFF << 15);
+            packedFlags |= (shadowmapIdx & 0xFF) << 15;
         }
 
         void setOuterCutoff(float outerCutoff)
@@ -84,6 +87,7 @@ namespace worlds
     struct RenderDebugStats
     {
         int numDrawCalls;
+        int numShadowDrawCalls;
         int numCulledObjs;
         uint64_t vramUsage;
         int numRTTPasses;
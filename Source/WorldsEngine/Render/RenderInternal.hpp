@@ -1,6 +1,7 @@
 #pragma once
 #include <R2/R2.hpp>
 #include <Render/DebugLines.hpp>
+#include <Render/LightClusters.hpp>
 #include <Render/Render.hpp>
 #include <robin_hood.h>
 #include <Util/UniquePtr.hpp>
@@ -93,16 +94,21 @@ namespace worlds
         float blendDistance;
     };
 
+    // The lights themselves live in the light cluster buffer, since there can be any number of them
     struct LightUB
     {
-        static const int MAX_LIGHTS = 64;
         static int LIGHT_TILE_SIZE;
         glm::mat4 additionalShadowMatrices[NUM_SHADOW_LIGHTS];
         uint32_t lightCount;
         uint32_t cubemapCount;
+        // Directional lights come first in the light array and aren't in any cluster
+        uint32_t directionalLightCount;
+        // Byte offsets of the clusters and light indices in the light cluster buffer
+        uint32_t clusterOffset;
+        uint32_t lightIndexOffset;
+        ClusterGridInfo clusterGrid;
         uint32_t shadowmapIds[NUM_SHADOW_LIGHTS];
         glm::mat4 cascadeMatrices[4];
-        PackedLight lights[MAX_LIGHTS];
         GPUCubemap cubemaps[64];
     };
 
@@ -158,6 +164,7 @@ namespace worlds
         uint32_t skinInfoOffset;
 
         uint32_t numVertices;
+        uint32_t numBones;
 
         uint8_t numSubmeshes;
         RenderSubmeshInfo submeshInfo[NUM_SUBMESH_MATS];
@@ -289,8 +296,16 @@ namespace worlds
     {
         struct ShadowmapInfo
         {
+            // Created the first time a light is given this shadowmap
             UniquePtr<R2::VK::Texture> texture;
-            uint32_t bindlessID;
+            uint32_t bindlessID = ~0u;
+            // Depth of only the static casters, copied into texture every frame before dynamic
+            // casters are drawn over it. Only spot lights get one.
+            UniquePtr<R2::VK::Texture> staticTexture;
+            bool staticValid = false;
+            glm::mat4 staticVP;
+            uint64_t staticCasterHash = 0;
+            std::vector<entt::entity> staticCasters;
         };
 
         VKRenderer* renderer;
@@ -298,9 +313,18 @@ namespace worlds
         UniquePtr<R2::VK::Pipeline> pipeline;
         UniquePtr<R2::VK::PipelineLayout> pipelineLayout;
         std::vector<glm::mat4> shadowmapMatrices;
+        // Changes whenever any static renderable is added, removed, moved or has its mesh swapped
+        uint64_t staticSceneHash = 0;
+
+        void drawCaster(R2::VK::CommandBuffer& cb, const glm::mat4& vp, const RenderMeshInfo& rmi,
+                        const WorldObject& wo, const Transform& t, uint32_t vertexOffset);
+        void updateStaticCache(R2::VK::CommandBuffer& cb, entt::registry& registry, ShadowmapInfo& info,
+                               const glm::mat4& vp, bool sceneChanged);
+        void createShadowmap(ShadowmapInfo& info, int resolution);
     public:
         ShadowmapManager(VKRenderer* renderer);
-        void AllocateShadowmaps(entt::registry& registry);
+        // Hands out shadowmaps to the most important shadowed lights as seen from viewerPos
+        void AllocateShadowmaps(entt::registry& registry, glm::vec3 viewerPos);
         void RenderShadowmaps(R2::VK::CommandBuffer& cb, entt::registry& registry, glm::mat4& viewMatrix);
         glm::mat4& GetShadowVPMatrix(uint32_t idx);
         uint32_t GetShadowmapId(uint32_t idx);
@@ -154,6 +154,7 @@ namespace worlds
         }
 
         meshInfo.numVertices = lmd.vertices.size();
+        meshInfo.numBones = lmd.bones.size();
 
         core->QueueBufferUpload(indexBuffer->GetBuffer(), lmd.indices32.data(), indicesSize, meshInfo.indexOffset);
 
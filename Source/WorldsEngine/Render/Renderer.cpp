@@ -1,8 +1,10 @@
+#include <Core/AllocTracking.hpp>
 #include <Core/AssetDB.hpp>
 #include <Core/ConVar.hpp>
 #include <Core/Engine.hpp>
 #include <Core/Log.hpp>
 #include <Core/MaterialManager.hpp>
+#include <Core/Profiler.hpp>
 #include <R2/BindlessTextureManager.hpp>
 #include <R2/VK.hpp>
 #include <R2/VKSwapchain.hpp>
@@ -280,12 +282,14 @@ namespace worlds
 
     void VKRenderer::frame(entt::registry& registry, float deltaTime)
     {
-        ZoneScoped;
+        ProfileScoped;
+        AllocTagScope allocTag{AllocTag::Render};
 
         timeAccumulator += (double)deltaTime;
 
         // Reset debug stats
         debugStats.numDrawCalls = 0;
+        debugStats.numShadowDrawCalls = 0;
         debugStats.numRTTPasses = (int)rttPasses.size();
         debugStats.numActiveRTTPasses = 0;
         debugStats.numTriangles = 0;
@@ -372,7 +376,7 @@ namespace worlds
                 cubemapsTask.m_SetSize = regOverride->view<WorldCubemap>().size();
 
                 TasksFinished finisher;
-                finisher.SetDependenciesVec<std::vector<enki::Dependency>, enki::ITaskSet>(
+                finisher.SetDependenciesVec<decltype(finisher.dependencies), enki::ITaskSet>(
                     finisher.dependencies, {&woLoadTask, &swoLoadTask, &cubemapsTask});
                 g_taskSched.AddTaskSetToPipe(&woLoadTask);
 
@@ -410,7 +414,7 @@ namespace worlds
         cubemapsTask.m_SetSize = registry.view<WorldCubemap>().size();
 
         TasksFinished finisher;
-        finisher.SetDependenciesVec<std::vector<enki::Dependency>, enki::ITaskSet>(
+        finisher.SetDependenciesVec<decltype(finisher.dependencies), enki::ITaskSet>(
             finisher.dependencies, {&woLoadTask, &swoLoadTask, &cubemapsTask});
 
 
@@ -419,7 +423,7 @@ namespace worlds
         g_taskSched.AddTaskSetToPipe(&cubemapsTask);
         g_taskSched.WaitforTask(&finisher);
 
-        shadowmapManager->AllocateShadowmaps(registry);
+        shadowmapManager->AllocateShadowmaps(registry, glm::inverse(shadowViewMatrix)[3]);
         shadowmapManager->RenderShadowmaps(cb, registry, shadowViewMatrix);
 
         particleSimulator->execute(registry, cb, deltaTime);
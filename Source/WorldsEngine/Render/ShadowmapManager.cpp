@@ -1,12 +1,18 @@
 #include <Render/RenderInternal.hpp>
+#include "../../R2/PrivateInclude/volk.h"
 #include <Core/AssetDB.hpp>
 #include <Core/ConVar.hpp>
+#include <Core/MeshManager.hpp>
 #include <entt/entity/registry.hpp>
 #include <Render/CullMesh.hpp>
 #include <Render/Frustum.hpp>
+#include <Render/LightClusters.hpp>
 #include <Render/ShaderCache.hpp>
 #include <R2/BindlessTextureManager.hpp>
 #include <R2/VK.hpp>
+#include <Util/EnumUtil.hpp>
+#include <algorithm>
+#include <string.h>
 
 using namespace R2;
 
@@ -14,6 +20,13 @@ namespace worlds
 {
     ConVar r_skipShadows {"r_skipShadows", "0"};
     ConVar r_shadowmapRes {"r_shadowmapRes", "512"};
+    ConVar r_shadowCaching {"r_shadowCaching", "1",
+                            "Keeps the depth of static casters for each spot light and only redraws it when the light "
+                            "or the static objects it sees change."};
+    ConVar r_maxShadowLights {"r_maxShadowLights", "16",
+                              "How many lights can have shadows at once (up to 64). When more want them, the most "
+                              "important lights to the viewer win."};
+
     ShadowmapManager::ShadowmapManager(VKRenderer* renderer) : renderer(renderer)
     {
         VK::PipelineLayoutBuilder plb{renderer->getCore()->GetHandles()};
@@ -40,33 +53,86 @@ namespace worlds
 
         pipeline = pb.Build();
 
-        for (int i = 0; i < NUM_SHADOW_LIGHTS; i++)
-        {
-            VK::TextureCreateInfo tci = VK::TextureCreateInfo::RenderTarget2D(
-                VK::TextureFormat::D32_SFLOAT,
-                r_shadowmapRes.getInt(), r_shadowmapRes.getInt()
-            );
-            ShadowmapInfo si{};
-            si.texture = renderer->getCore()->CreateTexture(tci);
-            si.bindlessID = renderer->getBindlessTextureManager()->AllocateTextureHandle(si.texture.Get());
-            shadowmapInfo.push_back(std::move(si));
-        }
+        shadowmapInfo.resize(NUM_SHADOW_LIGHTS);
         shadowmapMatrices.resize(NUM_SHADOW_LIGHTS);
     }
 
-    void ShadowmapManager::AllocateShadowmaps(entt::registry& registry)
+    void ShadowmapManager::createShadowmap(ShadowmapInfo& info, int resolution)
+    {
+        VK::TextureCreateInfo tci =
+            VK::TextureCreateInfo::RenderTarget2D(VK::TextureFormat::D32_SFLOAT, resolution, resolution);
+        info.texture = renderer->getCore()->CreateTexture(tci);
+
+        BindlessTextureManager* btm = renderer->getBindlessTextureManager();
+        if (info.bindlessID == ~0u)
+            info.bindlessID = btm->AllocateTextureHandle(info.texture.Get());
+        else
+            btm->SetTextureAt(info.bindlessID, info.texture.Get());
+    }
+
+    struct ShadowCandidate
     {
-        uint32_t count = 0;
-        registry.view<WorldLight>().each([&](WorldLight& worldLight) {
+        WorldLight* light;
+        float importance;
+    };
+
+    void ShadowmapManager::AllocateShadowmaps(entt::registry& registry, glm::vec3 viewerPos)
+    {
+        int maxShadowLights = glm::clamp(r_maxShadowLights.getInt(), 0, NUM_SHADOW_LIGHTS);
+        std::vector<ShadowCandidate> candidates;
+
+        registry.view<WorldLight, Transform>().each([&](WorldLight& worldLight, Transform& t) {
             bool isShadowable = worldLight.type == LightType::Spot || worldLight.type == LightType::Directional;
-            if (!worldLight.enableShadows || !isShadowable || count == NUM_SHADOW_LIGHTS)
+            if (!worldLight.enabled || !worldLight.enableShadows || !isShadowable)
             {
                 worldLight.shadowmapIdx = ~0u;
                 return;
             }
 
-            worldLight.shadowmapIdx = count++;
+            // shadowmapIdx is still last frame's index here, which lets lights hold on to their
+            // shadowmap (and its cached static depth) below
+            candidates.push_back(ShadowCandidate{&worldLight, lightImportance(worldLight, t, viewerPos)});
         });
+
+        size_t numShadowed = std::min(candidates.size(), (size_t)maxShadowLights);
+        std::partial_sort(candidates.begin(), candidates.begin() + numShadowed, candidates.end(),
+                          [](const ShadowCandidate& a, const ShadowCandidate& b) {
+                              return a.importance > b.importance;
+                          });
+
+        bool taken[NUM_SHADOW_LIGHTS] = {};
+        for (size_t i = 0; i < candidates.size(); i++)
+        {
+            uint32_t& idx = candidates[i].light->shadowmapIdx;
+            bool keep = i < numShadowed && idx < (uint32_t)maxShadowLights && !taken[idx];
+
+            if (keep)
+                taken[idx] = true;
+            else
+                idx = ~0u;
+        }
+
+        uint32_t nextFree = 0;
+        for (size_t i = 0; i < numShadowed; i++)
+        {
+            uint32_t& idx = candidates[i].light->shadowmapIdx;
+            if (idx != ~0u)
+                continue;
+
+            while (taken[nextFree])
+                nextFree++;
+
+            idx = nextFree;
+            taken[nextFree] = true;
+        }
+
+        int shadowRes = r_shadowmapRes.getInt();
+        for (int i = 0; i < maxShadowLights; i++)
+        {
+            ShadowmapInfo& info = shadowmapInfo[i];
+            if (taken[i] && (!info.texture || info.texture->GetWidth() != shadowRes))
+                createShadowmap(info, shadowRes);
+        }
     }
 
     glm::mat4 getCascadeMatrix(glm::mat4 camVP, glm::vec3 lightDir, float& texelsPerUnit)
@@ -129,10 +195,144 @@ namespace worlds
         return projMat * viewMat;
     }
 
+    // 64-bit FNV-1a, a word at a time
+    void hashWord(uint64_t& hash, uint32_t word)
+    {
+        hash ^= word;
+        hash *= 1099511628211ull;
+    }
+
+    void hashFloats(uint64_t& hash, const float* values, int count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            uint32_t word;
+            memcpy(&word, &values[i], sizeof(word));
+            hashWord(hash, word);
+        }
+    }
+
+    void hashCaster(uint64_t& hash, entt::entity entity, const WorldObject& wo, const Transform& t)
+    {
+        hashWord(hash, (uint32_t)entity);
+        hashWord(hash, wo.mesh);
+        // Reloading a mesh keeps its ID, so count reloads too
+        hashWord(hash, MeshManager::getReloadCount());
+        hashFloats(hash, &t.position.x, 3);
+        hashFloats(hash, &t.rotation.x, 4);
+        hashFloats(hash, &t.scale.x, 3);
+    }
+
+    // Depth formats don't have to support blitting, but every format can be copied
+    void copyDepth(VK::CommandBuffer& cb, VK::Texture* src, VK::Texture* dst)
+    {
+        src->Acquire(cb, VK::ImageLayout::TransferSrcOptimal, VK::AccessFlags::TransferRead,
+                     VK::PipelineStageFlags::Transfer);
+        dst->Acquire(cb, VK::ImageLayout::TransferDstOptimal, VK::AccessFlags::TransferWrite,
+                     VK::PipelineStageFlags::Transfer);
+
+        VkImageCopy imageCopy{};
+        imageCopy.srcSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1};
+        imageCopy.dstSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1};
+        imageCopy.extent = {(uint32_t)src->GetWidth(), (uint32_t)src->GetHeight(), 1};
+
+        vkCmdCopyImage(cb.GetNativeHandle(), src->GetNativeHandle(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       dst->GetNativeHandle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageCopy);
+    }
+
+    bool isStaticCaster(const WorldObject& wo)
+    {
+        return enumHasFlag(wo.staticFlags, StaticFlags::Rendering);
+    }
+
+    void ShadowmapManager::drawCaster(R2::VK::CommandBuffer& cb, const glm::mat4& vp, const RenderMeshInfo& rmi,
+                                      const WorldObject& wo, const Transform& t, uint32_t vertexOffset)
+    {
+        glm::mat4 mvp = vp * t.getMatrix();
+        cb.PushConstants(mvp, VK::ShaderStage::Vertex, pipelineLayout.Get());
+
+        for (int i = 0; i < rmi.numSubmeshes; i++)
+        {
+            if (!wo.drawSubmeshes[i]) continue;
+            const RenderSubmeshInfo& rsi = rmi.submeshInfo[i];
+            cb.DrawIndexed(rsi.indexCount, 1, rsi.indexOffset + (rmi.indexOffset / sizeof(uint32_t)), vertexOffset, 0);
+            renderer->getDebugStats().numShadowDrawCalls++;
+        }
+    }
+
+    // Redraws the light's static caster depth if the light moved or the static casters in its frustum
+    // changed
+    void ShadowmapManager::updateStaticCache(R2::VK::CommandBuffer& cb, entt::registry& registry, ShadowmapInfo& info,
+                                             const glm::mat4& vp, bool sceneChanged)
+    {
+        RenderMeshManager* meshManager = renderer->getMeshManager();
+        int shadowRes = r_shadowmapRes.getInt();
+
+        if (!info.staticTexture || info.staticTexture->GetWidth() != shadowRes)
+        {
+            VK::TextureCreateInfo tci =
+                VK::TextureCreateInfo::RenderTarget2D(VK::TextureFormat::D32_SFLOAT, shadowRes, shadowRes);
+            info.staticTexture = renderer->getCore()->CreateTexture(tci);
+            info.staticValid = false;
+        }
+
+        bool lightChanged = !info.staticValid || info.staticVP != vp;
+
+        // Nothing static changed anywhere and the light is where it was, so the cache is still good
+        if (!lightChanged && !sceneChanged)
+            return;
+
+        Frustum f{};
+        f.fromVPMatrix(vp);
+
+        uint64_t casterHash = 14695981039346656037ull;
+        info.staticCasters.clear();
+        registry.view<WorldObject, Transform>().each([&](entt::entity ent, WorldObject& wo, Transform& woT) {
+            if (!isStaticCaster(wo))
+                return;
+
+            RenderMeshInfo* rmi;
+            if (!meshManager->get(wo.mesh, &rmi))
+                return;
+
+            if (!cullMesh(*rmi, woT, &f, 1))
+                return;
+
+            hashCaster(casterHash, ent, wo, woT);
+            info.staticCasters.push_back(ent);
+        });
+
+        // Whatever changed was outside this light's frustum
+        if (!lightChanged && casterHash == info.staticCasterHash)
+            return;
+
+        info.staticVP = vp;
+        info.staticCasterHash = casterHash;
+        info.staticValid = true;
+
+        VK::RenderPass rp{};
+        rp.RenderArea(shadowRes, shadowRes);
+        rp.DepthAttachment(info.staticTexture.Get(), VK::LoadOp::Clear, VK::StoreOp::Store);
+        rp.DepthAttachmentClearValue(VK::ClearValue::DepthClear(0.0f));
+
+        rp.Begin(cb);
+
+        for (entt::entity ent : info.staticCasters)
+        {
+            WorldObject& wo = registry.get<WorldObject>(ent);
+            RenderMeshInfo* rmi;
+            meshManager->get(wo.mesh, &rmi);
+            drawCaster(cb, vp, *rmi, wo, registry.get<Transform>(ent), rmi->vertsOffset / sizeof(Vertex));
+        }
+
+        rp.End(cb);
+    }
+
     void ShadowmapManager::RenderShadowmaps(R2::VK::CommandBuffer& cb, entt::registry& registry, glm::mat4& viewMatrix)
     {
         RenderMeshManager* meshManager = renderer->getMeshManager();
-        BindlessTextureManager* btm = renderer->getBindlessTextureManager();
+
+        registry.view<SkinnedWorldObject>().each([](SkinnedWorldObject& wo) { wo.visibleInShadows = false; });
 
         if (r_skipShadows) return;
 
@@ -143,15 +343,26 @@ namespace worlds
         {
             ShadowmapInfo& info = shadowmapInfo[i];
 
-            if (info.texture->GetWidth() != shadowRes)
+            if (!r_shadowCaching && info.staticTexture)
             {
-                VK::TextureCreateInfo tci =
-                    VK::TextureCreateInfo::RenderTarget2D(VK::TextureFormat::D32_SFLOAT, shadowRes, shadowRes);
-                info.texture = renderer->getCore()->CreateTexture(tci);
-                btm->SetTextureAt(info.bindlessID, info.texture.Get());
+                info.staticTexture.Reset();
+                info.staticValid = false;
             }
         }
 
+        bool staticSceneChanged = false;
+        if (r_shadowCaching)
+        {
+            uint64_t hash = 14695981039346656037ull;
+            registry.view<WorldObject, Transform>().each([&](entt::entity ent, WorldObject& wo, Transform& t) {
+                if (isStaticCaster(wo))
+                    hashCaster(hash, ent, wo, t);
+            });
+
+            staticSceneChanged = hash != staticSceneHash;
+            staticSceneHash = hash;
+        }
+
         cb.BindPipeline(pipeline.Get());
         cb.SetScissor(VK::ScissorRect::Simple(shadowRes, shadowRes));
         cb.SetViewport(VK::Viewport::Simple(shadowRes, shadowRes));
@@ -189,19 +400,32 @@ namespace worlds
             }
 
             shadowmapMatrices[worldLight.shadowmapIdx] = vp;
+            ShadowmapInfo& info = shadowmapInfo[worldLight.shadowmapIdx];
+
+            // Directional shadows follow the camera around, so caching them wouldn't buy anything
+            bool useCache = r_shadowCaching && worldLight.type == LightType::Spot;
+
+            if (useCache)
+            {
+                updateStaticCache(cb, registry, info, vp, staticSceneChanged);
+                copyDepth(cb, info.staticTexture.Get(), info.texture.Get());
+            }
 
             Frustum f{};
             f.fromVPMatrix(vp);
 
             VK::RenderPass rp{};
             rp.RenderArea(shadowRes, shadowRes);
-            rp.DepthAttachment(
-                shadowmapInfo[worldLight.shadowmapIdx].texture.Get(), VK::LoadOp::Clear, VK::StoreOp::Store);
+            rp.DepthAttachment(info.texture.Get(), useCache ? VK::LoadOp::Load : VK::LoadOp::Clear, VK::StoreOp::Store);
             rp.DepthAttachmentClearValue(VK::ClearValue::DepthClear(0.0f));
 
             rp.Begin(cb);
 
             registry.view<WorldObject, Transform>().each([&](WorldObject& wo, Transform& woT) {
+                // Already in the cached depth
+                if (useCache && isStaticCaster(wo))
+                    return;
+
                 RenderMeshInfo* rmi;
                 if (!meshManager->get(wo.mesh, &rmi))
                     return;
@@ -209,20 +433,7 @@ namespace worlds
                 if (!cullMesh(*rmi, woT, &f, 1))
                     return;
 
-                glm::mat4 mvp = vp * woT.getMatrix();
-                cb.PushConstants(mvp, VK::ShaderStage::Vertex, pipelineLayout.Get());
-
-                for (int i = 0; i < rmi->numSubmeshes; i++)
-                {
-                    if (!wo.drawSubmeshes[i]) continue;
-                    const RenderSubmeshInfo& rsi = rmi->submeshInfo[i];
-                    cb.DrawIndexed(
-                        rsi.indexCount,
-                        1,
-                        rsi.indexOffset + (rmi->indexOffset / sizeof(uint32_t)),
-                        rmi->vertsOffset / sizeof(Vertex),
-                        0);
-                }
+                drawCaster(cb, vp, *rmi, wo, woT, rmi->vertsOffset / sizeof(Vertex));
             });
 
             registry.view<SkinnedWorldObject, Transform>().each([&](SkinnedWorldObject& wo, Transform& woT) {
@@ -230,24 +441,22 @@ namespace worlds
                 if (!meshManager->get(wo.mesh, &rmi))
                     return;
 
-                glm::mat4 mvp = vp * woT.getMatrix();
-                cb.PushConstants(mvp, VK::ShaderStage::Vertex, pipelineLayout.Get());
-
-                for (int i = 0; i < rmi->numSubmeshes; i++)
-                {
-                    if (!wo.drawSubmeshes[i]) continue;
-                    const RenderSubmeshInfo& rsi = rmi->submeshInfo[i];
-                    cb.DrawIndexed(
-                        rsi.indexCount,
-                        1,
-                        rsi.indexOffset + (rmi->indexOffset / sizeof(uint32_t)),
-                        wo.skinnedVertexOffset + (meshManager->getSkinnedVertsOffset() / sizeof(Vertex)),
-                        0);
-                }
+                if (!cullSkinnedMesh(*rmi, wo.currentPose, woT, &f, 1))
+                    return;
+
+                // This draws what was skinned last frame. Objects that were culled everywhere then
+                // don't have anything to draw yet, so they only start casting once they've been
+                // skinned this frame.
+                wo.visibleInShadows = true;
+                if (wo.skinnedMesh != wo.mesh)
+                    return;
+
+                drawCaster(cb, vp, *rmi, wo, woT,
+                           wo.skinnedVertexOffset + (meshManager->getSkinnedVertsOffset() / sizeof(Vertex)));
             });
 
             rp.End(cb);
-            shadowmapInfo[worldLight.shadowmapIdx].texture->Acquire(
+            info.texture->Acquire(
                 cb,
                 VK::ImageLayout::ShaderReadOnlyOptimal,
                 VK::AccessFlags::ShaderSampledRead,
@@ -1,10 +1,13 @@
 #include "ComputeSkinner.hpp"
+#include <Animation/PoseEvaluation.hpp>
 #include <Core/AssetDB.hpp>
 #include <Core/MeshManager.hpp>
 #include <entt/entity/registry.hpp>
 #include <Render/RenderInternal.hpp>
 #include <Render/SimpleCompute.hpp>
 #include <R2/VK.hpp>
+#include <Util/FrameArena.hpp>
+#include <string.h>
 
 using namespace R2;
 
@@ -21,7 +24,7 @@ namespace worlds
 
     ComputeSkinner::ComputeSkinner(VKRenderer* renderer) : renderer(renderer)
     {
-        VK::BufferCreateInfo bci{VK::BufferUsage::Storage, sizeof(glm::mat4) * 512, true};
+        VK::BufferCreateInfo bci{VK::BufferUsage::Storage, sizeof(glm::mat4) * MaxSkinningMatrices, true};
         poseBuffer = renderer->getCore()->CreateBuffer(bci);
 
         cs = new SimpleCompute(renderer->getCore(), AssetDB::pathToId("Shaders/skinning.comp.spv"));
@@ -32,52 +35,48 @@ namespace worlds
         cs->Build();
     }
 
-    glm::mat4 getBoneTransform(const LoadedMesh& meshData, Pose& pose, int boneIdx)
-    {
-        glm::mat4 transform = pose.boneTransforms[boneIdx];
-
-        uint32_t parentId = meshData.bones[boneIdx].parentId;
-
-        while (parentId != ~0u)
-        {
-            transform = pose.boneTransforms[parentId] * transform;
-            parentId = meshData.bones[parentId].parentId;
-        }
-
-        return transform;
-    }
-
     void ComputeSkinner::Execute(R2::VK::CommandBuffer& cb, entt::registry& reg)
     {
         cb.BeginDebugLabel("Compute Skinning", 0.561f, 0.192f, 0.004f);
         RenderMeshManager* rmm = renderer->getMeshManager();
         rmm->getVertexBuffer()->Acquire(cb, VK::AccessFlags::ShaderReadWrite, VK::PipelineStageFlags::ComputeShader);
 
-        uint32_t matrixOffset = 0;
         glm::mat4* mappedPoses = (glm::mat4*)poseBuffer->Map();
 
         reg.view<SkinnedWorldObject, Transform>().each(
             [&](SkinnedWorldObject& swo, Transform& t)
             {
-                const LoadedMesh& lm = MeshManager::loadOrGet(swo.mesh);
+                // Either nothing will draw the skinned vertices this frame, so they're left stale, or
+                // the object was hidden when its storage was allocated because it can't be skinned.
+                if (swo.poseOffset == ~0u)
+                    return;
+
                 const RenderMeshInfo& rmi = renderer->getMeshManager()->loadOrGet(swo.mesh);
+                const Pose& pose = swo.currentPose;
 
-                for (int i = 0; i < lm.bones.size(); i++)
+                if (pose.skinningMatrices.size() == rmi.numBones)
                 {
-                    mappedPoses[matrixOffset + i] =
-                        getBoneTransform(lm, swo.currentPose, i) * lm.bones[i].inverseBindPose;
+                    memcpy(mappedPoses + swo.poseOffset, pose.skinningMatrices.data(),
+                           sizeof(glm::mat4) * rmi.numBones);
+                }
+                else
+                {
+                    // The animation system hasn't seen this object yet
+                    const LoadedMesh& lm = MeshManager::loadOrGet(swo.mesh);
+                    glm::mat4* modelSpace = FrameArena::allocArray<glm::mat4>(lm.bones.size());
+                    computeSkinningMatrices(lm.bones, lm.boneOrder, pose.boneTransforms.data(), modelSpace,
+                                            mappedPoses + swo.poseOffset);
                 }
 
                 ComputeSkinnerPushConstants pcs{};
                 pcs.NumVertices = rmi.numVertices;
-                pcs.PoseOffset = matrixOffset;
+                pcs.PoseOffset = swo.poseOffset;
                 pcs.InputOffset = rmi.vertsOffset / sizeof(Vertex);
                 pcs.OutputOffset =
                     swo.skinnedVertexOffset + (renderer->getMeshManager()->getSkinnedVertsOffset() / sizeof(Vertex));
                 pcs.SkinInfoOffset = rmi.skinInfoOffset / sizeof(VertexSkinInfo);
                 cs->Dispatch(cb, pcs, (rmi.numVertices + 255) / 256, 1, 1);
-
-                matrixOffset += lm.bones.size();
+                swo.skinnedMesh = swo.mesh;
             }
         );
 
@@ -1,4 +1,5 @@
 #pragma once
+#include <stdint.h>
 #include <Util/UniquePtr.hpp>
 #include <entt/entity/lw_fwd.hpp>
 
@@ -19,6 +20,9 @@ namespace worlds
     class SimpleCompute;
     class VKRenderer;
 
+    // Enough for 500 characters with 128 bones each
+    const uint32_t MaxSkinningMatrices = 65536;
+
     class ComputeSkinner
     {
         VKRenderer* renderer;
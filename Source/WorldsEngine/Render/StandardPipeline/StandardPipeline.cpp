@@ -1,8 +1,10 @@
 #include "StandardPipeline.hpp"
 #include <Core/AssetDB.hpp>
 #include <Core/Engine.hpp>
+#include <Core/Log.hpp>
 #include <Core/ConVar.hpp>
 #include <Core/MaterialManager.hpp>
+#include <Core/TaskGraph.hpp>
 #include <Core/TaskScheduler.hpp>
 #include <R2/BindlessTextureManager.hpp>
 #include <R2/SubAllocatedBuffer.hpp>
@@ -26,10 +28,12 @@
 #include <Util/AABB.hpp>
 #include <Util/AtomicBufferWrapper.hpp>
 #include <Util/EnumUtil.hpp>
+#include <Util/FrameArena.hpp>
 #include <Util/JsonUtil.hpp>
 #include <Tracy.hpp>
 
 #include <readerwriterqueue.h>
+#include <algorithm>
 #include <new>
 #include <Core/Fatal.hpp>
 #include "PoissonDisk.hpp"
@@ -61,9 +65,9 @@ namespace worlds
         glm::vec2 textureOffset;
     };
 
+    // Lights go through the light clusters, so tiles only cull cubemaps and AO volumes
     struct LightTile
     {
-        uint32_t lightIdMasks[8];
         uint32_t cubemapIdMasks[2];
         uint32_t aoBoxIdMasks[2];
         uint32_t aoSphereIdMasks[2];
@@ -109,6 +113,14 @@ namespace worlds
         : engineInterfaces(engineInterfaces)
     {
         drawCmds.resize(MAX_DRAWS);
+
+        // Skinned objects need their vertex storage allocated before their draws can be filled
+        // in. Everything else is independent.
+        fillGraph = new TaskGraph();
+        lightFillNode = fillGraph->addNode("Fill Light Buffer");
+        skinnedAllocNode = fillGraph->addNode("Allocate Skinned Storage");
+        drawFillNode = fillGraph->addNode("Fill Draw Buffer");
+        skinnedDrawFillNode = fillGraph->addNode("Fill Skinned Draw Buffer", {skinnedAllocNode});
     }
 
     StandardPipeline::~StandardPipeline()
@@ -173,6 +185,19 @@ namespace worlds
             new SkyboxRenderer(core, pipelineLayout.Get(), settings.msaaLevel, getViewMask(settings.numViews));
     }
 
+    void StandardPipeline::createLightClusterBuffer(int frameIdx, size_t size)
+    {
+        VK::Core* core = ((VKRenderer*)engineInterfaces.renderer)->getCore();
+
+        VK::BufferCreateInfo bci{VK::BufferUsage::Storage, size, true};
+        lightClusterBuffers[frameIdx] = core->CreateBuffer(bci);
+        lightClusterBuffers[frameIdx]->SetDebugName("Light Cluster Buffer");
+
+        VK::DescriptorSetUpdater dsu{core, descriptorSets[frameIdx].Get()};
+        dsu.AddBuffer(7, 0, VK::DescriptorType::StorageBuffer, lightClusterBuffers[frameIdx].Get());
+        dsu.Update();
+    }
+
     void StandardPipeline::setupMainPassPipeline(VK::PipelineBuilder& pb, VK::VertexBinding& vb)
     {
         pb.PrimitiveTopology(VK::Topology::TriangleList)
@@ -254,6 +279,7 @@ namespace worlds
         dslb.UpdateAfterBind();
         dslb.Binding(5, VK::DescriptorType::StorageBuffer, 1, VK::ShaderStage::AllRaster);
         dslb.Binding(6, VK::DescriptorType::UniformBuffer, 1, VK::ShaderStage::AllRaster);
+        dslb.Binding(7, VK::DescriptorType::StorageBuffer, 1, VK::ShaderStage::AllRaster);
         descriptorSetLayout = dslb.Build();
 
         for (int i = 0; i < 2; i++)
@@ -268,6 +294,8 @@ namespace worlds
             dsu.AddBuffer(5, 0, VK::DescriptorType::StorageBuffer, drawInfoBuffers->GetBuffer(i));
             dsu.AddBuffer(6, 0, VK::DescriptorType::UniformBuffer, sceneGlobals.Get());
             dsu.Update();
+
+            createLightClusterBuffer(i, 64 * 1024);
         }
 
         VK::PipelineLayoutBuilder plb{core->GetHandles()};
@@ -347,15 +375,41 @@ namespace worlds
         return mix(higher, lower, cutoff);
     }
 
+    ConVar r_maxLights{"r_maxLights", "0",
+                       "Maximum number of non-directional lights to render, keeping the most important ones. "
+                       "0 means no limit."};
+
+    // Bounds the cone of a spot light with a sphere. cosAngle is the cosine of the outer cutoff.
+    ClusterLightBounds spotBoundingSphere(glm::vec3 origin, glm::vec3 forward, float size, float cosAngle)
+    {
+        if (cosAngle < 0.70710678118f)
+            return ClusterLightBounds{origin + cosAngle * size * forward, glm::sqrt(1.0f - cosAngle * cosAngle) * size};
+
+        float radius = size / (2.0f * cosAngle);
+        return ClusterLightBounds{origin + radius * forward, radius};
+    }
+
+    struct ClusteredLight
+    {
+        PackedLight packed;
+        ClusterLightBounds bounds;
+        float importance;
+    };
+
     struct FillLightBufferTask : public enki::ITaskSet
     {
         LightUB* lightUB;
         entt::registry& registry;
         VKTextureManager* textureManager;
         ShadowmapManager* shadowmapManager;
+        LightClusterBuilder* clusterBuilder;
         int numViews;
         Frustum* frustums;
+        const glm::mat4* views;
+        glm::vec3 viewerPos;
         RenderDebugStats* dbgStats;
+        // Directional lights come first, then the lights that go through the clusters
+        FrameVector<PackedLight> lights;
 
         FillLightBufferTask(LightUB* lightUB, entt::registry& registry, VKTextureManager* textureManager)
             : lightUB(lightUB), registry(registry), textureManager(textureManager)
@@ -366,17 +420,25 @@ namespace worlds
         {
             ZoneScoped;
 
-            uint32_t lightCount = 0;
+            FrameVector<ClusteredLight> clusteredLights;
+            uint32_t directionalCount = 0;
+
             registry.view<WorldLight, Transform>().each([&](WorldLight& wl, const Transform& t)
             {
-                if (!wl.enabled || lightCount >= LightUB::MAX_LIGHTS)
+                if (!wl.enabled)
                     return;
 
-                for (int i = 0; i < numViews; i++)
+                // In VR a light only needs to be seen by one eye
+                bool isDirectional = wl.type == LightType::Directional;
+                bool inView = isDirectional;
+                for (int i = 0; i < numViews && !inView; i++)
                 {
-                    if (!frustums[i].containsSphere(t.position, wl.maxDistance)) return;
+                    inView = frustums[i].containsSphere(t.position, wl.maxDistance);
                 }
 
+                if (!inView)
+                    return;
+
                 if (wl.shadowmapIdx != ~0u)
                 {
                     lightUB->additionalShadowMatrices[wl.shadowmapIdx] = shadowmapManager->GetShadowVPMatrix(
@@ -412,12 +474,53 @@ namespace worlds
                 pl.setShadowmapIndex(wl.shadowmapIdx);
                 pl.shadowBias = wl.shadowBias;
 
-                lightUB->lights[lightCount] = pl;
-                lightCount++;
+                if (isDirectional)
+                {
+                    lights.push_back(pl);
+                    directionalCount++;
+                    return;
+                }
+
+                ClusterLightBounds bounds{t.position, wl.maxDistance};
+                if (wl.type == LightType::Spot)
+                {
+                    // Spot lights point down -direction
+                    float cosAngle = glm::clamp(glm::cos(wl.spotOuterCutoff), 0.0f, 1.0f);
+                    bounds = spotBoundingSphere(t.position, -lightForward, wl.maxDistance, cosAngle);
+                }
+                else if (wl.type == LightType::Tube)
+                {
+                    bounds.radius += wl.tubeLength;
+                }
+
+                clusteredLights.push_back(ClusteredLight{pl, bounds, lightImportance(wl, t, viewerPos)});
             });
 
-            lightUB->lightCount = lightCount;
-            dbgStats->numLightsInView = lightCount;
+            uint32_t maxLights = r_maxLights.getInt() > 0 ? (uint32_t)r_maxLights.getInt() : UINT32_MAX;
+            if (clusteredLights.size() > maxLights)
+            {
+                std::nth_element(clusteredLights.begin(), clusteredLights.begin() + maxLights, clusteredLights.end(),
+                                 [](const ClusteredLight& a, const ClusteredLight& b)
+                                 {
+                                     return a.importance > b.importance;
+                                 });
+                clusteredLights.erase(clusteredLights.begin() + maxLights, clusteredLights.end());
+            }
+
+            FrameVector<ClusterLightBounds> bounds;
+            bounds.reserve(clusteredLights.size());
+            for (const ClusteredLight& cl : clusteredLights)
+            {
+                lights.push_back(cl.packed);
+                bounds.push_back(cl.bounds);
+            }
+
+            clusterBuilder->build(views, bounds.data(), (uint32_t)bounds.size());
+
+            lightUB->lightCount = (uint32_t)lights.size();
+            lightUB->directionalLightCount = directionalCount;
+            lightUB->clusterGrid = clusterBuilder->getGridInfo();
+            dbgStats->numLightsInView = (int)lights.size();
 
             AssetID skybox = registry.ctx<SkySettings>().skybox;
 
@@ -554,14 +657,14 @@ namespace worlds
         }
     };
 
-    struct AllocatedSkinnedStorageTask : public enki::ITaskSet
+    struct CullSkinnedTask : public enki::ITaskSet
     {
         VKRenderer* renderer;
         entt::registry& reg;
-        std::atomic<uint32_t> vertCounter;
+        int numViews;
+        Frustum* frustums;
 
-        AllocatedSkinnedStorageTask(VKRenderer* renderer, entt::registry& reg)
-            : renderer(renderer), reg(reg), vertCounter(0)
+        CullSkinnedTask(VKRenderer* renderer, entt::registry& reg) : renderer(renderer), reg(reg)
         {
         }
 
@@ -579,8 +682,79 @@ namespace worlds
                 SkinnedWorldObject& wo = reg.get<SkinnedWorldObject>(*it);
                 const Transform& t = reg.get<Transform>(*it);
                 const RenderMeshInfo& rmi = renderer->getMeshManager()->loadOrGet(wo.mesh);
+                wo.visible = cullSkinnedMesh(rmi, wo.currentPose, t, frustums, numViews);
+            }
+        }
+    };
 
-                wo.skinnedVertexOffset = vertCounter.fetch_add(rmi.numVertices);
+    struct AllocatedSkinnedStorageTask : public enki::ITaskSet
+    {
+        VKRenderer* renderer;
+        entt::registry& reg;
+        CullSkinnedTask cullTask;
+
+        AllocatedSkinnedStorageTask(VKRenderer* renderer, entt::registry& reg)
+            : renderer(renderer), reg(reg), cullTask(renderer, reg)
+        {
+        }
+
+        void ExecuteRange(enki::TaskSetPartition range, uint32_t threadnum) override
+        {
+            // Offsets are handed out in view order, including to culled objects, so they only move
+            // when skinned objects are added, removed or change mesh. Culled objects keep whatever
+            // was last skinned into their storage for the shadow pass.
+            uint32_t vertCounter = 0;
+            for (entt::entity ent : reg.view<SkinnedWorldObject>())
+            {
+                SkinnedWorldObject& wo = reg.get<SkinnedWorldObject>(ent);
+                const RenderMeshInfo& rmi = renderer->getMeshManager()->loadOrGet(wo.mesh);
+
+                if (wo.skinnedVertexOffset != vertCounter)
+                    wo.skinnedMesh = ~0u;
+
+                wo.skinnedVertexOffset = vertCounter;
+                vertCounter += rmi.numVertices;
+            }
+
+            cullTask.m_SetSize = reg.view<SkinnedWorldObject>().size();
+            cullTask.m_MinRange = 10;
+            g_taskSched.AddTaskSetToPipe(&cullTask);
+            g_taskSched.WaitforTask(&cullTask);
+
+            // Space in the pose buffer is handed out here rather than while skinning, so objects that
+            // can't be skinned are hidden before the draw buffer is filled.
+            uint32_t matrixCounter = 0;
+            for (entt::entity ent : reg.view<SkinnedWorldObject>())
+            {
+                SkinnedWorldObject& wo = reg.get<SkinnedWorldObject>(ent);
+                wo.poseOffset = ~0u;
+
+                if (!wo.visible && !wo.visibleInShadows)
+                    continue;
+
+                const RenderMeshInfo& rmi = renderer->getMeshManager()->loadOrGet(wo.mesh);
+                const Pose& pose = wo.currentPose;
+                bool hasPose =
+                    pose.skinningMatrices.size() == rmi.numBones || pose.boneTransforms.size() == rmi.numBones;
+
+                if (matrixCounter + rmi.numBones > MaxSkinningMatrices)
+                {
+                    static bool warned = false;
+                    if (!warned)
+                        logWarn("Too many bones to skin, some skinned objects won't be drawn");
+                    warned = true;
+                    hasPose = false;
+                }
+
+                if (!hasPose)
+                {
+                    wo.visible = false;
+                    wo.skinnedMesh = ~0u;
+                    continue;
+                }
+
+                wo.poseOffset = matrixCounter;
+                matrixCounter += rmi.numBones;
             }
         }
     };
@@ -619,6 +793,10 @@ namespace worlds
                 if (onlyStatics && !enumHasFlag(wo.staticFlags, StaticFlags::Rendering))
                     continue;
 
+                // Culled against the pose bounds while allocating skinned storage
+                if (!wo.visible)
+                    continue;
+
                 const Transform& t = reg.get<Transform>(*it);
                 const RenderMeshInfo& rmi = renderer->getMeshManager()->loadOrGet(wo.mesh);
 
@@ -861,7 +1039,7 @@ namespace worlds
 
         // Set up culling frustums and fill the VP buffer
         Camera* camera = rttPass->getCamera();
-        Frustum* frustums = (Frustum*)alloca(sizeof(Frustum) * rttPass->getSettings().numViews);
+        Frustum* frustums = FrameArena::allocArray<Frustum>(rttPass->getSettings().numViews);
 
         MultiVP multiVPs{};
         multiVPs.screenWidth = rttPass->width;
@@ -893,36 +1071,28 @@ namespace worlds
 
         core->QueueBufferUpload(multiVPBuffer.Get(), &multiVPs, sizeof(multiVPs), 0);
 
-        TasksFinished finisher;
+        lightClusterBuilder.setup(rttPass->width, rttPass->height, rttPass->getSettings().numViews,
+                                  multiVPs.projections, camera->near, camera->far);
 
         LightUB* lightUB = (LightUB*)lightBuffers->MapCurrent();
 
         FillLightBufferTask fillTask{lightUB, reg, textureManager};
         fillTask.shadowmapManager = renderer->getShadowmapManager();
+        fillTask.clusterBuilder = &lightClusterBuilder;
         fillTask.numViews = rttPass->getSettings().numViews;
         fillTask.frustums = frustums;
+        fillTask.views = multiVPs.views;
+        fillTask.viewerPos = multiVPs.viewPos[0];
         fillTask.dbgStats = &renderer->getDebugStats();
 
         AllocatedSkinnedStorageTask allocSkinnedStorageTask{renderer, reg};
-        allocSkinnedStorageTask.m_SetSize = reg.view<SkinnedWorldObject>().size();
-        allocSkinnedStorageTask.m_MinRange = 10;
-
-        finisher.SetDependenciesVec<std::vector<enki::Dependency>, enki::ITaskSet>(
-            finisher.dependencies, {&fillTask, &allocSkinnedStorageTask});
-
-        g_taskSched.AddTaskSetToPipe(&fillTask);
-        g_taskSched.AddTaskSetToPipe(&allocSkinnedStorageTask);
-        g_taskSched.WaitforTask(&finisher);
+        allocSkinnedStorageTask.cullTask.numViews = rttPass->getSettings().numViews;
+        allocSkinnedStorageTask.cullTask.frustums = frustums;
 
         lightTileBuffer->Acquire(cb, VK::AccessFlags::ShaderStorageRead, VK::PipelineStageFlags::FragmentShader);
         modelMatrixBuffers->GetCurrentBuffer()->Acquire(
             cb, VK::AccessFlags::ShaderRead, VK::PipelineStageFlags::VertexShader);
 
-
-        GPU_BEGIN(TS_Skinning);
-        computeSkinner->Execute(cb, reg);
-        GPU_END(TS_Skinning);
-
         glm::mat4* modelMatricesMapped = (glm::mat4*)modelMatrixBuffers->MapCurrent();
         GPUDrawInfo* drawInfosMapped = (GPUDrawInfo*)drawInfoBuffers->MapCurrent();
 
@@ -950,13 +1120,46 @@ namespace worlds
 
         fdbsTask.m_SetSize = reg.view<SkinnedWorldObject>().size();
 
-        TasksFinished finisher2;
-        finisher2.SetDependenciesVec<std::vector<enki::Dependency>, enki::ITaskSet>(
-            finisher2.dependencies, {&fdbTask, &fdbsTask});
+        // Views used by the tasks are created here on the main thread, since entt creates
+        // component pools lazily and that isn't safe to do from several threads at once.
+        reg.view<WorldLight, Transform>();
+        reg.view<WorldCubemap, Transform>();
+
+        fillGraph->bind(lightFillNode, &fillTask);
+        fillGraph->bind(skinnedAllocNode, &allocSkinnedStorageTask);
+        fillGraph->bind(drawFillNode, &fdbTask);
+        fillGraph->bind(skinnedDrawFillNode, &fdbsTask);
+        fillGraph->start();
+
+        // Skinning only needs the skinned storage, so record it while the rest is still filling
+        fillGraph->wait(skinnedAllocNode);
+        GPU_BEGIN(TS_Skinning);
+        computeSkinner->Execute(cb, reg);
+        GPU_END(TS_Skinning);
 
-        g_taskSched.AddTaskSetToPipe(&fdbTask);
-        g_taskSched.AddTaskSetToPipe(&fdbsTask);
-        g_taskSched.WaitforTask(&finisher2);
+        fillGraph->waitAll();
+
+        // Lights, then clusters, then light indices
+        const std::vector<LightCluster>& clusters = lightClusterBuilder.getClusters();
+        const std::vector<uint32_t>& lightIndices = lightClusterBuilder.getLightIndices();
+        size_t lightsSize = fillTask.lights.size() * sizeof(PackedLight);
+        size_t clustersSize = clusters.size() * sizeof(LightCluster);
+        size_t indicesSize = lightIndices.size() * sizeof(uint32_t);
+        size_t clusterBufferSize = lightsSize + clustersSize + indicesSize;
+
+        if (clusterBufferSize > lightClusterBuffers[frameIdx]->GetSize())
+            createLightClusterBuffer(frameIdx, clusterBufferSize + clusterBufferSize / 2);
+
+        char* clusterData = (char*)lightClusterBuffers[frameIdx]->Map();
+        memcpy(clusterData, fillTask.lights.data(), lightsSize);
+        memcpy(clusterData + lightsSize, clusters.data(), clustersSize);
+        memcpy(clusterData + lightsSize + clustersSize, lightIndices.data(), indicesSize);
+        lightClusterBuffers[frameIdx]->Unmap();
+
+        lightUB->clusterOffset = (uint32_t)lightsSize;
+        lightUB->lightIndexOffset = (uint32_t)(lightsSize + clustersSize);
+        lightClusterBuffers[frameIdx]->Acquire(
+            cb, VK::AccessFlags::ShaderStorageRead, VK::PipelineStageFlags::FragmentShader);
 
         modelMatrixBuffers->UnmapCurrent();
         drawInfoBuffers->UnmapCurrent();
@@ -1,5 +1,6 @@
 #pragma once
 #include <Render/IRenderPipeline.hpp>
+#include <Render/LightClusters.hpp>
 #include <Util/UniquePtr.hpp>
 #include <vector>
 #include <glm/mat4x4.hpp>
@@ -39,6 +40,7 @@ namespace worlds
     class HiddenMeshRenderer;
     class ComputeSkinner;
     class ParticleRenderer;
+    class TaskGraph;
     struct EngineInterfaces;
     typedef uint32_t AssetID;
 
@@ -89,6 +91,8 @@ namespace worlds
         UniquePtr<R2::VK::FrameSeparatedBuffer> modelMatrixBuffers;
         UniquePtr<R2::VK::FrameSeparatedBuffer> lightBuffers;
         UniquePtr<R2::VK::Buffer> lightTileBuffer;
+        // Lights followed by the cluster list and light indices. Grows with the number of lights.
+        UniquePtr<R2::VK::Buffer> lightClusterBuffers[2];
         UniquePtr<R2::VK::Buffer> sceneGlobals;
         UniquePtr<R2::VK::FrameSeparatedBuffer> drawInfoBuffers;
         UniquePtr<R2::VK::Texture> depthBuffer;
@@ -106,6 +110,15 @@ namespace worlds
         UniquePtr<ParticleRenderer> particleRenderer;
         UniquePtr<TechniqueManager> techniqueManager;
 
+        // Light and draw buffer filling. The task objects are bound to the nodes every frame.
+        UniquePtr<TaskGraph> fillGraph;
+        uint32_t lightFillNode;
+        uint32_t skinnedAllocNode;
+        uint32_t drawFillNode;
+        uint32_t skinnedDrawFillNode;
+
+        LightClusterBuilder lightClusterBuilder;
+
         const EngineInterfaces& engineInterfaces;
         VKRTTPass* rttPass;
 
@@ -117,6 +130,7 @@ namespace worlds
         uint16_t standardTechnique;
 
         void createSizeDependants();
+        void createLightClusterBuffer(int frameIdx, size_t size);
         void setupMainPassPipeline(R2::VK::PipelineBuilder& pb, R2::VK::VertexBinding& vb);
         void setupDepthPassPipeline(R2::VK::PipelineBuilder& pb, R2::VK::VertexBinding& vb);
         void setupTechnique(AssetID fragShaderId, AssetID vertShaderId);
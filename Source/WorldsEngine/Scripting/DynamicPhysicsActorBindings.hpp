@@ -211,4 +211,32 @@ extern "C"
         reg->get<RigidBody>(entity).enableCCD = value;
         updateMass(reg->get<RigidBody>(entity));
     }
+
+    // Packed list of every entity with a RigidBody. Valid until one is added or removed.
+    EXPORT const entt::entity* dynamicpa_getEntities(entt::registry* reg, uint32_t* count)
+    {
+        auto view = reg->view<RigidBody>();
+        *count = (uint32_t)view.size();
+        return view.data();
+    }
+
+    EXPORT void dynamicpa_getPoses(entt::registry* reg, const entt::entity* entities, uint32_t count,
+                                   Transform* poses)
+    {
+        auto view = reg->view<RigidBody>();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            poses[i] = view.get<RigidBody>(entities[i]).pose();
+        }
+    }
+
+    EXPORT void dynamicpa_setPoses(entt::registry* reg, const entt::entity* entities, uint32_t count,
+                                   const Transform* poses)
+    {
+        auto view = reg->view<RigidBody>();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            view.get<RigidBody>(entities[i]).setPose(poses[i]);
+        }
+    }
 }
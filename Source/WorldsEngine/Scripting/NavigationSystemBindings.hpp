@@ -1,6 +1,9 @@
 #pragma once
 #include "Export.hpp"
 #include <Navigation/Navigation.hpp>
+#include <algorithm>
+#include <entt/entity/registry.hpp>
+#include <string.h>
 
 using namespace worlds;
 
@@ -18,6 +21,58 @@ extern "C"
         delete path;
     }
 
+    EXPORT uint32_t navigation_requestPath(glm::vec3 startPos, glm::vec3 endPos)
+    {
+        return NavigationSystem::requestPath(startPos, endPos);
+    }
+
+    EXPORT int32_t navigation_getPathStatus(uint32_t id)
+    {
+        return (int32_t)NavigationSystem::getPathStatus(id);
+    }
+
+    EXPORT int32_t navigation_getPathPointCount(uint32_t id)
+    {
+        const std::vector<glm::vec3>* points = NavigationSystem::getPathResult(id);
+        return points ? (int32_t)points->size() : 0;
+    }
+
+    EXPORT int32_t navigation_copyPathPoints(uint32_t id, glm::vec3* outPoints, int32_t maxPoints)
+    {
+        const std::vector<glm::vec3>* points = NavigationSystem::getPathResult(id);
+        if (points == nullptr)
+            return 0;
+
+        int32_t count = std::min((int32_t)points->size(), maxPoints);
+        memcpy(outPoints, points->data(), count * sizeof(glm::vec3));
+        return count;
+    }
+
+    EXPORT void navigation_releasePath(uint32_t id)
+    {
+        NavigationSystem::releasePath(id);
+    }
+
+    EXPORT void navAgent_setTarget(entt::registry* registry, entt::entity entity, glm::vec3 target)
+    {
+        registry->get<NavAgent>(entity).setTarget(target);
+    }
+
+    EXPORT void navAgent_getTarget(entt::registry* registry, entt::entity entity, glm::vec3* target)
+    {
+        *target = registry->get<NavAgent>(entity).getTarget();
+    }
+
+    EXPORT float navAgent_getMaxSpeed(entt::registry* registry, entt::entity entity)
+    {
+        return registry->get<NavAgent>(entity).maxSpeed;
+    }
+
+    EXPORT void navAgent_setMaxSpeed(entt::registry* registry, entt::entity entity, float maxSpeed)
+    {
+        registry->get<NavAgent>(entity).maxSpeed = maxSpeed;
+    }
+
     EXPORT bool navigation_getClosestPointOnMesh(glm::vec3 point, glm::vec3* outPoint, glm::vec3 searchExtent)
     {
         return NavigationSystem::getClosestPointOnMesh(point, *outPoint, searchExtent);
@@ -2,9 +2,11 @@
 #include "NetVM.hpp"
 #include "Core/Fatal.hpp"
 #include "Export.hpp"
+#include <Core/AllocTracking.hpp>
 #include <Core/Engine.hpp>
 #include <Core/Log.hpp>
 #include <Core/NameComponent.hpp>
+#include <Core/Profiler.hpp>
 #include <Core/Transform.hpp>
 #include <Core/WorldComponents.hpp>
 #include <ImGui/imgui.h>
@@ -71,6 +73,7 @@ EngineInterfaces const* csharpInterfaces;
 #include "PhysicsBindings.hpp"
 #include "RegistryBindings.hpp"
 #include "SkinnedWorldObjectBindings.hpp"
+#include "SystemSchedulerBindings.hpp"
 #include "VRBindings.hpp"
 #include "WorldLightBindings.hpp"
 #include "WorldObjectBindings.hpp"
@@ -195,7 +198,7 @@ namespace worlds
         createManagedDelegate("WorldsEngine.ECS.Registry", "DeserializeManagedComponent",
                               (void**)&deserializeComponentFunc);
         createManagedDelegate("WorldsEngine.ECS.Registry", "CopyManagedComponents", (void**)&copyManagedComponentsFunc);
-        createManagedDelegate("WorldsEngine.Physics", "HandleCollisionFromNative", (void**)&physicsContactFunc);
+        createManagedDelegate("WorldsEngine.Physics", "HandleCollisionsFromNative", (void**)&physicsContactFunc);
 
         reg.on_destroy<Transform>().connect<&DotNetScriptEngine::onTransformDestroy>(*this);
 
@@ -217,14 +220,16 @@ namespace worlds
 
     void DotNetScriptEngine::onSceneStart()
     {
-        ZoneScoped;
+        ProfileScoped;
+        AllocTagScope allocTag{AllocTag::Scripting};
 
         sceneStartFunc();
     }
 
     void DotNetScriptEngine::onUpdate(float deltaTime, float interpAlpha)
     {
-        ZoneScoped;
+        ProfileScoped;
+        AllocTagScope allocTag{AllocTag::Scripting};
 
         updateFunc(deltaTime, interpAlpha);
     }
@@ -238,14 +243,16 @@ namespace worlds
 
     void DotNetScriptEngine::onSimulate(float deltaTime)
     {
-        ZoneScoped;
+        ProfileScoped;
+        AllocTagScope allocTag{AllocTag::Scripting};
 
         simulateFunc(deltaTime);
     }
 
-    void DotNetScriptEngine::handleCollision(entt::entity entity, PhysicsContactInfo* contactInfo)
+    void DotNetScriptEngine::handleCollisions(const PhysicsContactEvent* events, uint32_t count)
     {
-        physicsContactFunc((uint32_t)entity, contactInfo);
+        ZoneScoped;
+        physicsContactFunc(events, count);
     }
 
     void DotNetScriptEngine::serializeManagedComponents(nlohmann::json& entityJson, entt::entity entity)
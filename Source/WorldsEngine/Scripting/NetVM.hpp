@@ -24,7 +24,7 @@ namespace worlds
 #endif
     };
 
-    struct PhysicsContactInfo;
+    struct PhysicsContactEvent;
 
     class DotNetScriptEngine
     {
@@ -36,7 +36,7 @@ namespace worlds
         void onUpdate(float deltaTime, float interpAlpha);
         void onEditorUpdate(float deltaTime);
         void onSimulate(float deltaTime);
-        void handleCollision(entt::entity entity, PhysicsContactInfo* contactInfo);
+        void handleCollisions(const PhysicsContactEvent* events, uint32_t count);
         void serializeManagedComponents(nlohmann::json& entityJson, entt::entity entity);
         void deserializeManagedComponent(const char* id, const nlohmann::json& componentJson, entt::entity entity);
         void copyManagedComponents(entt::entity from, entt::entity to);
@@ -55,7 +55,7 @@ namespace worlds
         void (*nativeEntityDestroyFunc)(uint32_t id);
         void (*serializeComponentsFunc)(void* serializationContext, uint32_t entity);
         void (*deserializeComponentFunc)(const char* id, const nlohmann::json* componentJson, uint32_t entity);
-        void (*physicsContactFunc)(uint32_t id, PhysicsContactInfo* contactInfo);
+        void (*physicsContactFunc)(const PhysicsContactEvent* events, uint32_t count);
         void (*copyManagedComponentsFunc)(entt::entity from, entt::entity to);
         void (*sceneStartFunc)();
         slib::DynamicLibrary* coreclrLib;
@@ -1,6 +1,7 @@
 #include "Core/NameComponent.hpp"
 #include "Core/Transform.hpp"
 #include "Export.hpp"
+#include "Util/TimingUtil.hpp"
 #include <entt/entity/entity.hpp>
 #include <entt/entity/registry.hpp>
 #include <nlohmann/json.hpp>
@@ -29,6 +30,67 @@ extern "C"
         }
     }
 
+    // Exposes the Transform storage directly. Both arrays are packed and in the same order, and stay valid
+    // until a Transform is added or removed. Writing through the pointer skips the ChildComponent handling
+    // registry_setTransform does, so child transforms written this way get overwritten by their parent.
+    EXPORT const entt::entity* registry_getTransformStorage(entt::registry* registry, uint32_t* count,
+                                                            Transform** transforms)
+    {
+        auto view = registry->view<Transform>();
+        *count = (uint32_t)view.size();
+        *transforms = view.raw();
+        return view.data();
+    }
+
+    EXPORT void registry_getTransforms(entt::registry* registry, const entt::entity* entities, uint32_t count,
+                                       Transform* output)
+    {
+        auto view = registry->view<Transform>();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            output[i] = view.get<Transform>(entities[i]);
+        }
+    }
+
+    EXPORT void registry_setTransforms(entt::registry* registry, const entt::entity* entities, uint32_t count,
+                                       const Transform* input)
+    {
+        auto view = registry->view<Transform>();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (registry->has<ChildComponent>(entities[i]))
+            {
+                ChildComponent& cc = registry->get<ChildComponent>(entities[i]);
+                cc.offset = input[i].transformByInverse(view.get<Transform>(cc.parent));
+            }
+            else
+            {
+                view.get<Transform>(entities[i]) = input[i];
+            }
+        }
+    }
+
+    // Native reference point for the managed bulk access benchmark. Does the same work as the managed
+    // versions: nudges every transform up on even iterations and back down on odd ones.
+    // Returns the time taken in milliseconds.
+    EXPORT double registry_benchmarkTransformLoop(entt::registry* registry, uint32_t iterations, glm::vec3* checksum)
+    {
+        PerfTimer timer;
+        glm::vec3 sum{0.0f};
+
+        for (uint32_t i = 0; i < iterations; i++)
+        {
+            float offset = (i % 2 == 0) ? 1.0f : -1.0f;
+            registry->view<Transform>().each([&](Transform& t) {
+                t.position.y += offset;
+                sum += t.position;
+            });
+        }
+
+        *checksum = sum;
+        return timer.stopGetMs();
+    }
+
     EXPORT void registry_eachTransform(entt::registry* registry, void (*callback)(uint32_t))
     {
         registry->each([&](entt::entity ent) { callback((uint32_t)ent); });
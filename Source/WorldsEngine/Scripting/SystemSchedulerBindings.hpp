@@ -0,0 +1,39 @@
+#include "Core/TaskScheduler.hpp"
+#include "Export.hpp"
+#include <string.h>
+#include <Tracy.hpp>
+
+using namespace worlds;
+
+extern "C"
+{
+    // Runs a group of managed systems that don't touch the same components, spread across the workers.
+    // Each system gets its own profiler zone, so a group of one is still worth running through here.
+    EXPORT void systemScheduler_runGroup(uint32_t count, const char* const* names, void (*runSystem)(uint32_t))
+    {
+        ZoneScoped;
+
+        auto run = [&](uint32_t idx) {
+            ZoneScopedN("Managed System");
+            ZoneName(names[idx], strlen(names[idx]));
+            runSystem(idx);
+        };
+
+        if (count == 1)
+        {
+            run(0);
+            return;
+        }
+
+        enki::TaskSet task{count, [&](enki::TaskSetPartition range, uint32_t) {
+            for (uint32_t i = range.start; i < range.end; i++)
+            {
+                run(i);
+            }
+        }};
+        task.m_MinRange = 1;
+
+        g_taskSched.AddTaskSetToPipe(&task);
+        g_taskSched.WaitforTask(&task);
+    }
+}
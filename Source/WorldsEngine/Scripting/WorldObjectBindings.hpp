@@ -3,6 +3,16 @@
 
 using namespace worlds;
 
+// Blittable subset of WorldObject for batched access from C#. Mirrors WorldObjectData on the managed side.
+struct WorldObjectBulkData
+{
+    AssetID mesh;
+    AssetID material;
+    glm::vec4 texScaleOffset;
+    uint8_t staticFlags;
+    uint8_t castShadows;
+};
+
 extern "C"
 {
     EXPORT uint32_t worldObject_getMesh(entt::registry* registry, entt::entity entity)
@@ -75,4 +85,44 @@ extern "C"
         tso.x = scale.x;
         tso.y = scale.y;
     }
+
+    // Packed list of every entity with a WorldObject. Valid until one is added or removed.
+    EXPORT const entt::entity* worldObject_getEntities(entt::registry* registry, uint32_t* count)
+    {
+        auto view = registry->view<WorldObject>();
+        *count = (uint32_t)view.size();
+        return view.data();
+    }
+
+    EXPORT void worldObject_getBulk(entt::registry* registry, const entt::entity* entities, uint32_t count,
+                                    WorldObjectBulkData* output)
+    {
+        auto view = registry->view<WorldObject>();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const WorldObject& wo = view.get<WorldObject>(entities[i]);
+            WorldObjectBulkData& data = output[i];
+            data.mesh = wo.mesh;
+            data.material = wo.materials[0];
+            data.texScaleOffset = wo.texScaleOffset;
+            data.staticFlags = (uint8_t)wo.staticFlags;
+            data.castShadows = wo.castShadows;
+        }
+    }
+
+    EXPORT void worldObject_setBulk(entt::registry* registry, const entt::entity* entities, uint32_t count,
+                                    const WorldObjectBulkData* input)
+    {
+        auto view = registry->view<WorldObject>();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            WorldObject& wo = view.get<WorldObject>(entities[i]);
+            const WorldObjectBulkData& data = input[i];
+            wo.mesh = data.mesh;
+            wo.materials[0] = data.material;
+            wo.texScaleOffset = data.texScaleOffset;
+            wo.staticFlags = (StaticFlags)data.staticFlags;
+            wo.castShadows = data.castShadows;
+        }
+    }
 }
@@ -0,0 +1,510 @@
+#include "SceneSerialization.hpp"
+#include "BinarySceneMerger.hpp"
+#include "PreparedScene.hpp"
+#include <Audio/Audio.hpp>
+#include <ComponentMeta/ComponentMetadata.hpp>
+#include <Core/AssetDB.hpp>
+#include <Core/Engine.hpp>
+#include <Core/Log.hpp>
+#include <Core/MeshManager.hpp>
+#include <Core/TaskScheduler.hpp>
+#include <Core/WorldComponents.hpp>
+#include <Navigation/Navigation.hpp>
+#include <Physics/Physics.hpp>
+#include <Util/TimingUtil.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <string.h>
+#include <Tracy.hpp>
+
+namespace worlds
+{
+    enum class AsyncLoadStage
+    {
+        Preparing,
+        LoadingAssets,
+        Clearing,
+        Merging,
+        AudioScene,
+        NavMesh,
+        Finished,
+        Failed
+    };
+
+    struct AsyncSceneLoadState;
+
+    struct PrepareSceneTask : public enki::ITaskSet
+    {
+        AsyncSceneLoadState* state;
+        void ExecuteRange(enki::TaskSetPartition range, uint32_t threadnum) override;
+    };
+
+    struct LoadSceneAssetsTask : public enki::ITaskSet
+    {
+        AsyncSceneLoadState* state;
+        void ExecuteRange(enki::TaskSetPartition range, uint32_t threadnum) override;
+    };
+
+    struct CollisionMeshToCook
+    {
+        AssetID id;
+        // Either a mesh that was already loaded, or an index into the meshes loaded by the task
+        const LoadedMesh* residentMesh;
+        size_t loadedIndex;
+        physx::PxTriangleMesh* cooked = nullptr;
+    };
+
+    struct AsyncSceneLoadState
+    {
+        AssetID sceneId;
+        entt::registry& reg;
+        PhysicsSystem* physics;
+        bool additive;
+        AsyncLoadStage stage = AsyncLoadStage::Preparing;
+
+        // Written by the worker tasks, only read on the main thread once they've finished
+        bool workerFailed = false;
+        bool isBinary = false;
+        std::vector<uint8_t> binaryData;
+        BinarySceneMerger* binaryMerger = nullptr;
+        nlohmann::json sceneJson;
+        bool hasSettings = false;
+        SkySettings settings{};
+        PrefabCache prefabs;
+        PreparedScene prepared;
+        SceneAssetReferences assetRefs;
+        std::vector<AssetID> meshesToLoad;
+        std::vector<LoadedMesh> loadedMeshes;
+        // Not a vector<bool>, since the flags are written from several threads at once
+        std::vector<uint8_t> meshLoadSucceeded;
+        std::vector<CollisionMeshToCook> collisionMeshes;
+
+        PrepareSceneTask prepareTask;
+        LoadSceneAssetsTask assetsTask;
+
+        // Main thread state
+        std::vector<entt::entity> entitiesToClear;
+        size_t clearCursor = 0;
+        EntityIDMap idRemap;
+        PreparedSceneMerger* merger = nullptr;
+        PerfTimer totalTimer;
+        int mainThreadFrames = 0;
+        double longestSliceMs = 0.0;
+
+        AsyncSceneLoadState(AssetID sceneId, entt::registry& reg, PhysicsSystem* physics, bool additive)
+            : sceneId(sceneId), reg(reg), physics(physics), additive(additive)
+        {
+        }
+
+        ~AsyncSceneLoadState()
+        {
+            delete merger;
+            delete binaryMerger;
+
+            // If the load was abandoned partway through, the cooked meshes never made it into the cache
+            for (CollisionMeshToCook& cmtc : collisionMeshes)
+            {
+                if (cmtc.cooked)
+                    cmtc.cooked->release();
+            }
+        }
+    };
+
+    void PrepareSceneTask::ExecuteRange(enki::TaskSetPartition, uint32_t)
+    {
+        ZoneScopedN("Prepare async scene");
+        PHYSFS_File* file = AssetDB::openAssetFileRead(state->sceneId);
+
+        if (file == nullptr)
+        {
+            logErr("Failed to open scene %s", AssetDB::idToPath(state->sceneId).c_str());
+            state->workerFailed = true;
+            return;
+        }
+
+        std::vector<uint8_t> data;
+        data.resize(PHYSFS_fileLength(file));
+        PHYSFS_readBytes(file, data.data(), data.size());
+        PHYSFS_close(file);
+
+        if (data.size() <= 4)
+        {
+            logErr(WELogCategoryEngine, "Scene file was too short.");
+            state->workerFailed = true;
+            return;
+        }
+
+        // Exceptions can't escape a task, so catch everything here and fail the load instead
+        try
+        {
+            if (memcmp(data.data(), "WBSC", 4) == 0)
+            {
+                // Binary scenes are already close to registry layout, so they only need checking here
+                state->isBinary = true;
+                state->binaryData = std::move(data);
+                state->binaryMerger = new BinarySceneMerger(state->binaryData.data(), state->binaryData.size());
+
+                if (!state->binaryMerger->validate())
+                    state->workerFailed = true;
+                return;
+            }
+            else if (memcmp(data.data(), "WMSP", 4) == 0)
+            {
+                state->sceneJson = nlohmann::json::from_msgpack(data.begin() + 4, data.end());
+            }
+            else if (data[0] == '{')
+            {
+                state->sceneJson = nlohmann::json::parse(data.begin(), data.end());
+            }
+            else
+            {
+                logErr(WELogCategoryEngine, "Scene has unrecognized file format");
+                state->workerFailed = true;
+                return;
+            }
+
+            const nlohmann::json& root = state->sceneJson;
+            const nlohmann::json* entities = &root;
+
+            if (root.contains("entities"))
+            {
+                entities = &root["entities"];
+                state->hasSettings = true;
+                state->settings.skybox = AssetDB::pathToId(root["settings"]["skyboxPath"].get<std::string>());
+                state->settings.skyboxBoost = root["settings"].value("skyboxBoost", 1.0f);
+            }
+
+            prepareSceneEntities(*entities, state->prefabs, state->prepared);
+
+            for (size_t i = 0; i < state->prepared.componentBuckets.size(); i++)
+            {
+                ComponentMetadata* cm = ComponentMetadataManager::sorted[i];
+                for (auto& pair : state->prepared.componentBuckets[i])
+                {
+                    cm->gatherAssetReferences(*pair.second, state->assetRefs);
+                }
+            }
+        }
+        catch (std::exception& ex)
+        {
+            logErr("Failed to load scene: %s", ex.what());
+            state->workerFailed = true;
+        }
+    }
+
+    void LoadSceneAssetsTask::ExecuteRange(enki::TaskSetPartition, uint32_t)
+    {
+        ZoneScopedN("Load async scene assets");
+        state->loadedMeshes.resize(state->meshesToLoad.size());
+        state->meshLoadSucceeded.resize(state->meshesToLoad.size());
+
+        enki::TaskSet meshTask{(uint32_t)state->meshesToLoad.size(), [&](enki::TaskSetPartition range, uint32_t) {
+            for (uint32_t i = range.start; i < range.end; i++)
+            {
+                state->meshLoadSucceeded[i] = MeshManager::preload(state->meshesToLoad[i], state->loadedMeshes[i]);
+            }
+        }};
+
+        if (!state->meshesToLoad.empty())
+        {
+            g_taskSched.AddTaskSetToPipe(&meshTask);
+            g_taskSched.WaitforTask(&meshTask);
+        }
+
+        enki::TaskSet cookTask{(uint32_t)state->collisionMeshes.size(), [&](enki::TaskSetPartition range, uint32_t) {
+            for (uint32_t i = range.start; i < range.end; i++)
+            {
+                CollisionMeshToCook& cmtc = state->collisionMeshes[i];
+                const LoadedMesh* lm = cmtc.residentMesh;
+
+                if (lm == nullptr)
+                {
+                    if (!state->meshLoadSucceeded[cmtc.loadedIndex])
+                        continue;
+                    lm = &state->loadedMeshes[cmtc.loadedIndex];
+                }
+
+                cmtc.cooked = state->physics->cookTriangleMesh(*lm);
+            }
+        }};
+
+        if (state->physics && !state->collisionMeshes.empty())
+        {
+            g_taskSched.AddTaskSetToPipe(&cookTask);
+            g_taskSched.WaitforTask(&cookTask);
+        }
+    }
+
+    void removeDuplicates(std::vector<AssetID>& ids)
+    {
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    }
+
+    // Works out which of the scene's meshes aren't loaded yet. This has to happen on the main
+    // thread since the mesh and collider caches aren't thread-safe.
+    void startLoadingAssets(AsyncSceneLoadState* state)
+    {
+        SceneAssetReferences& refs = state->assetRefs;
+        removeDuplicates(refs.meshes);
+        removeDuplicates(refs.collisionMeshes);
+
+        for (AssetID id : refs.meshes)
+        {
+            if (id != INVALID_ASSET && !MeshManager::isLoaded(id))
+                state->meshesToLoad.push_back(id);
+        }
+
+        for (AssetID id : refs.collisionMeshes)
+        {
+            if (id == INVALID_ASSET || (state->physics && state->physics->hasTriangleMesh(id)))
+                continue;
+
+            CollisionMeshToCook cmtc{id, nullptr, 0};
+
+            if (MeshManager::isLoaded(id))
+            {
+                cmtc.residentMesh = &MeshManager::get(id);
+            }
+            else
+            {
+                auto it = std::find(state->meshesToLoad.begin(), state->meshesToLoad.end(), id);
+                cmtc.loadedIndex = it - state->meshesToLoad.begin();
+
+                if (it == state->meshesToLoad.end())
+                    state->meshesToLoad.push_back(id);
+            }
+
+            state->collisionMeshes.push_back(cmtc);
+        }
+
+        state->assetsTask.state = state;
+        g_taskSched.AddTaskSetToPipe(&state->assetsTask);
+    }
+
+    void finishLoadingAssets(AsyncSceneLoadState* state)
+    {
+        for (size_t i = 0; i < state->meshesToLoad.size(); i++)
+        {
+            if (state->meshLoadSucceeded[i])
+                MeshManager::insertPreloaded(state->meshesToLoad[i], std::move(state->loadedMeshes[i]));
+        }
+
+        for (CollisionMeshToCook& cmtc : state->collisionMeshes)
+        {
+            if (cmtc.cooked)
+                state->physics->addTriangleMesh(cmtc.id, cmtc.cooked);
+            cmtc.cooked = nullptr;
+        }
+
+        state->loadedMeshes.clear();
+        state->collisionMeshes.clear();
+
+        logVrb("async scene load: loaded %zu meshes on worker threads", state->meshesToLoad.size());
+    }
+
+    AsyncSceneLoad::AsyncSceneLoad(AssetID scene, entt::registry& reg, PhysicsSystem* physics, bool additive)
+        : state(new AsyncSceneLoadState(scene, reg, physics, additive))
+    {
+        state->prepareTask.state = state;
+        g_taskSched.AddTaskSetToPipe(&state->prepareTask);
+    }
+
+    AsyncSceneLoad::~AsyncSceneLoad()
+    {
+        // The tasks reference the load state, so they have to finish before it goes away
+        g_taskSched.WaitforTask(&state->prepareTask);
+        if (state->stage == AsyncLoadStage::LoadingAssets)
+            g_taskSched.WaitforTask(&state->assetsTask);
+
+        delete state;
+    }
+
+    bool AsyncSceneLoad::update(double budgetMs)
+    {
+        ZoneScoped;
+        auto start = TimingUtil::now();
+        auto elapsedMs = [&]() { return TimingUtil::toMs(TimingUtil::now() - start); };
+        AsyncLoadStage startStage = state->stage;
+        // Set when the current stage is waiting on a worker and there's nothing more to do this frame
+        bool waiting = false;
+
+        while (!waiting && elapsedMs() < budgetMs)
+        {
+            switch (state->stage)
+            {
+            case AsyncLoadStage::Preparing:
+                if (!state->prepareTask.GetIsComplete())
+                    return false;
+
+                if (state->workerFailed)
+                {
+                    state->stage = AsyncLoadStage::Failed;
+                    break;
+                }
+
+                if (state->isBinary)
+                {
+                    state->stage = AsyncLoadStage::Clearing;
+                }
+                else
+                {
+                    startLoadingAssets(state);
+                    state->stage = AsyncLoadStage::LoadingAssets;
+                }
+                break;
+            case AsyncLoadStage::LoadingAssets:
+                if (!state->assetsTask.GetIsComplete())
+                    return false;
+
+                finishLoadingAssets(state);
+                state->stage = AsyncLoadStage::Clearing;
+                break;
+            case AsyncLoadStage::Clearing:
+                if (state->clearCursor == 0 && state->entitiesToClear.empty() && !state->additive)
+                {
+                    state->reg.view<Transform>(entt::exclude_t<KeepOnSceneLoad>{}).each(
+                        [&](entt::entity e, Transform&) { state->entitiesToClear.push_back(e); });
+                }
+
+                while (state->clearCursor < state->entitiesToClear.size() && elapsedMs() < budgetMs)
+                {
+                    entt::entity e = state->entitiesToClear[state->clearCursor++];
+                    if (state->reg.valid(e))
+                        state->reg.destroy(e, 0);
+                }
+
+                if (state->clearCursor == state->entitiesToClear.size())
+                {
+                    // The navmesh and audio scene are looked up by scene name after merging, so
+                    // this has to be set before the merge rather than once the load has finished
+                    if (!state->additive)
+                    {
+                        SceneInfo& si = state->reg.ctx<SceneInfo>();
+                        si.name = std::filesystem::path(AssetDB::idToPath(state->sceneId)).stem().string();
+                        si.id = state->sceneId;
+                    }
+
+                    if (!state->isBinary)
+                        state->merger = new PreparedSceneMerger(state->prepared, state->reg, state->idRemap);
+                    state->stage = AsyncLoadStage::Merging;
+                }
+                break;
+            case AsyncLoadStage::Merging: {
+                bool done;
+
+                try
+                {
+                    if (state->isBinary)
+                        done = state->binaryMerger->step(state->reg, budgetMs - elapsedMs());
+                    else
+                        done = state->merger->step(budgetMs - elapsedMs());
+                }
+                catch (nlohmann::detail::exception& ex)
+                {
+                    logErr("Failed to load scene: %s", ex.what());
+                    state->stage = AsyncLoadStage::Failed;
+                    break;
+                }
+
+                if (!done)
+                    break;
+
+                if (state->isBinary && state->binaryMerger->failed())
+                {
+                    state->stage = AsyncLoadStage::Failed;
+                    break;
+                }
+
+                if (state->hasSettings)
+                    state->reg.set<SkySettings>(state->settings);
+
+                state->stage = AsyncLoadStage::AudioScene;
+                break;
+            }
+            case AsyncLoadStage::AudioScene:
+                // Only the instances are gathered here, the scene itself is built on a worker
+                AudioSystem::getInstance()->updateAudioScene(state->reg);
+                NavigationSystem::startNavMeshLoad(state->reg);
+                state->stage = AsyncLoadStage::NavMesh;
+                break;
+            case AsyncLoadStage::NavMesh:
+                if (!NavigationSystem::updateNavMeshLoad(state->reg, budgetMs - elapsedMs()))
+                {
+                    waiting = true;
+                    break;
+                }
+
+                SceneLoader::runLoadCallbacks(state->reg);
+                state->stage = AsyncLoadStage::Finished;
+                break;
+            case AsyncLoadStage::Finished:
+            case AsyncLoadStage::Failed:
+                return true;
+            }
+
+            if (state->stage == AsyncLoadStage::Finished)
+                break;
+        }
+
+        if (startStage >= AsyncLoadStage::Clearing || state->stage >= AsyncLoadStage::Clearing)
+        {
+            state->mainThreadFrames++;
+            state->longestSliceMs = std::max(state->longestSliceMs, elapsedMs());
+        }
+
+        if (state->stage == AsyncLoadStage::Finished)
+        {
+            logMsg("loaded scene %s asynchronously in %.3fms (%i frames on the main thread, longest slice %.3fms)",
+                   AssetDB::idToPath(state->sceneId).c_str(), state->totalTimer.stopGetMs(), state->mainThreadFrames,
+                   state->longestSliceMs);
+            return true;
+        }
+
+        return state->stage == AsyncLoadStage::Failed;
+    }
+
+    bool AsyncSceneLoad::failed() const
+    {
+        return state->stage == AsyncLoadStage::Failed;
+    }
+
+    bool AsyncSceneLoad::isMerging() const
+    {
+        return state->stage >= AsyncLoadStage::Clearing && state->stage < AsyncLoadStage::Finished;
+    }
+
+    float AsyncSceneLoad::progress() const
+    {
+        switch (state->stage)
+        {
+        case AsyncLoadStage::Preparing:
+            return 0.0f;
+        case AsyncLoadStage::LoadingAssets:
+            return 0.2f;
+        case AsyncLoadStage::Clearing:
+            if (state->entitiesToClear.empty())
+                return 0.3f;
+            return 0.3f + 0.1f * ((float)state->clearCursor / state->entitiesToClear.size());
+        case AsyncLoadStage::Merging: {
+            size_t total = state->isBinary ? state->binaryMerger->totalWork() : state->merger->totalWork();
+            size_t completed = state->isBinary ? state->binaryMerger->completedWork() : state->merger->completedWork();
+
+            if (total == 0)
+                return 0.4f;
+            return 0.4f + 0.5f * ((float)completed / total);
+        }
+        case AsyncLoadStage::AudioScene:
+            return 0.9f;
+        case AsyncLoadStage::NavMesh:
+            return 0.95f;
+        default:
+            return 1.0f;
+        }
+    }
+
+    AssetID AsyncSceneLoad::sceneId() const
+    {
+        return state->sceneId;
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "BinaryStream.hpp"
+#include <ComponentMeta/ComponentFuncs.hpp>
+#include <Core/Engine.hpp>
+#include <entt/entt.hpp>
+#include <robin_hood.h>
+#include <stdint.h>
+#include <vector>
+
+namespace worlds
+{
+    // Adds a binary (WBSC) scene to a registry a slice at a time. The data has to outlive the merger.
+    class BinarySceneMerger
+    {
+      public:
+        BinarySceneMerger(const uint8_t* data, size_t size);
+        // Reads the header and checks every chunk and record is in bounds and only refers to the
+        // scene's entities. Doesn't touch a registry, so it can be called from any thread.
+        bool validate();
+        // Must only be called once validate has succeeded. Does work until budgetMs runs out and
+        // returns true once it's finished, successfully or not.
+        bool step(entt::registry& reg, double budgetMs);
+        bool failed() const;
+        size_t totalWork() const;
+        size_t completedWork() const;
+
+      private:
+        struct Chunk
+        {
+            // nullptr for managed components
+            ComponentMetadata* mdata;
+            bool bulk;
+            uint32_t elementSize;
+            // IDs as they were saved, before being remapped
+            std::vector<entt::entity> entities;
+            const uint8_t* payload;
+            uint64_t payloadSize;
+        };
+
+        enum class Phase
+        {
+            CreateEntities,
+            Chunks,
+            Done
+        };
+
+        bool validateChunk(BinaryReader& reader, const robin_hood::unordered_flat_set<entt::entity>& entitySet);
+        // Reads the next batch or record of a chunk. Returns false if it turned out to be corrupt.
+        bool stepChunk(entt::registry& reg, Chunk& chunk);
+
+        const uint8_t* data;
+        size_t size;
+        std::vector<AssetID> assetTable;
+        SkySettings settings{};
+        std::vector<entt::entity> sceneEntities;
+        std::vector<Chunk> chunks;
+        EntityIDMap idRemap;
+        std::vector<entt::entity> remapped;
+        BinaryReader recordReader{nullptr, 0};
+        Phase phase = Phase::CreateEntities;
+        size_t chunkIdx = 0;
+        size_t cursor = 0;
+        size_t total = 0;
+        size_t completed = 0;
+        bool didFail = false;
+    };
+}
@@ -0,0 +1,533 @@
+#include "SceneSerialization.hpp"
+#include "BinarySceneMerger.hpp"
+#include "BinaryStream.hpp"
+#include <ComponentMeta/ComponentMetadata.hpp>
+#include <Core/AssetDB.hpp>
+#include <Core/Engine.hpp>
+#include <Core/Log.hpp>
+#include <Core/WorldComponents.hpp>
+#include <Scripting/NetVM.hpp>
+#include <Util/TimingUtil.hpp>
+#include <algorithm>
+#include <limits>
+#include <nlohmann/json.hpp>
+#include <Tracy.hpp>
+
+namespace worlds
+{
+    extern DotNetScriptEngine* scriptEngine;
+
+    // File layout:
+    //   char[4] magic ("WBSC"), uint32 version
+    //   uint32 asset path count, then each path as a length-prefixed string
+    //   padding up to 16 bytes, then the body.
+    //
+    // Body layout:
+    //   skybox asset, float skybox boost
+    //   uint32 entity count, uint32 entity IDs[]
+    //   uint32 chunk count, then each chunk:
+    //     uint32 serialized ID, uint32 flags, uint32 bulk element size, uint32 entity count
+    //     uint64 payload size, uint32 entity IDs[], padding to 16 bytes
+    //     payload, padding to 16 bytes
+    //
+    // Bulk payloads are a tightly packed array of the component. Other payloads are a
+    // size-prefixed record per entity, written by ComponentMetadata::writeBinary.
+    // Managed components go in their own chunk with a serialized ID of 0.
+    const char BINARY_SCENE_MAGIC[5] = "WBSC";
+    const uint32_t BINARY_SCENE_VERSION = 1;
+    const uint32_t MANAGED_CHUNK_ID = 0;
+    const uint32_t CHUNK_FLAG_BULK = 1;
+    const size_t CHUNK_ALIGNMENT = 16;
+
+    void writeChunkHeader(BinaryWriter& writer, uint32_t serializedId, uint32_t flags, uint32_t elementSize,
+                          const std::vector<entt::entity>& entities)
+    {
+        writer.write(serializedId);
+        writer.write(flags);
+        writer.write(elementSize);
+        writer.write((uint32_t)entities.size());
+    }
+
+    void writeRecordChunkPayload(BinaryWriter& writer, const std::vector<entt::entity>& entities,
+                                 const std::function<void(entt::entity)>& writeRecord)
+    {
+        size_t payloadSizeOffset = writer.size();
+        writer.write((uint64_t)0);
+
+        for (entt::entity ent : entities)
+            writer.write((uint32_t)ent);
+
+        writer.align(CHUNK_ALIGNMENT);
+        size_t payloadStart = writer.size();
+
+        for (entt::entity ent : entities)
+        {
+            size_t recordSizeOffset = writer.size();
+            writer.write((uint32_t)0);
+            writeRecord(ent);
+            writer.patch(recordSizeOffset, (uint32_t)(writer.size() - recordSizeOffset - sizeof(uint32_t)));
+        }
+
+        writer.patch(payloadSizeOffset, (uint64_t)(writer.size() - payloadStart));
+        writer.align(CHUNK_ALIGNMENT);
+    }
+
+    std::vector<uint8_t> BinarySceneSerializer::sceneToBytes(entt::registry& reg)
+    {
+        ZoneScoped;
+        BinaryWriter body;
+
+        SkySettings& skySettings = reg.ctx<SkySettings>();
+        body.writeAssetID(skySettings.skybox);
+        body.write(skySettings.skyboxBoost);
+
+        std::vector<entt::entity> entities;
+        reg.view<Transform>(entt::exclude_t<DontSerialize>{}).each(
+            [&](entt::entity ent, Transform&) { entities.push_back(ent); });
+
+        body.write((uint32_t)entities.size());
+        for (entt::entity ent : entities)
+            body.write((uint32_t)ent);
+
+        size_t chunkCountOffset = body.size();
+        uint32_t chunkCount = 0;
+        body.write(chunkCount);
+
+        std::vector<entt::entity> chunkEntities;
+        chunkEntities.reserve(entities.size());
+
+        for (ComponentMetadata* mdata : ComponentMetadataManager::sorted)
+        {
+            std::array<ENTT_ID_TYPE, 1> arr = {mdata->getComponentID()};
+            auto rView = reg.runtime_view(arr.begin(), arr.end());
+
+            chunkEntities.clear();
+            for (entt::entity ent : entities)
+            {
+                if (rView.contains(ent))
+                    chunkEntities.push_back(ent);
+            }
+
+            if (chunkEntities.empty())
+                continue;
+
+            chunkCount++;
+
+            if (mdata->isBulkSerializable())
+            {
+                uint32_t elementSize = mdata->getBulkElementSize();
+                writeChunkHeader(body, mdata->getSerializedID(), CHUNK_FLAG_BULK, elementSize, chunkEntities);
+                body.write((uint64_t)elementSize * chunkEntities.size());
+
+                for (entt::entity ent : chunkEntities)
+                    body.write((uint32_t)ent);
+
+                body.align(CHUNK_ALIGNMENT);
+                mdata->writeBulk(reg, chunkEntities, body);
+                body.align(CHUNK_ALIGNMENT);
+            }
+            else
+            {
+                writeChunkHeader(body, mdata->getSerializedID(), 0, 0, chunkEntities);
+                writeRecordChunkPayload(body, chunkEntities,
+                                        [&](entt::entity ent) { mdata->writeBinary(ent, reg, body); });
+            }
+        }
+
+        if (scriptEngine)
+        {
+            // Managed components are serialized by the script engine as a JSON object per entity,
+            // so just keep whichever entities actually have some.
+            std::vector<std::vector<uint8_t>> managedData;
+            chunkEntities.clear();
+
+            for (entt::entity ent : entities)
+            {
+                nlohmann::json j = nlohmann::json::object();
+                scriptEngine->serializeManagedComponents(j, ent);
+
+                if (j.empty())
+                    continue;
+
+                chunkEntities.push_back(ent);
+                managedData.push_back(nlohmann::json::to_msgpack(j));
+            }
+
+            if (!chunkEntities.empty())
+            {
+                chunkCount++;
+                size_t dataIdx = 0;
+                writeChunkHeader(body, MANAGED_CHUNK_ID, 0, 0, chunkEntities);
+                writeRecordChunkPayload(body, chunkEntities,
+                                        [&](entt::entity)
+                                        {
+                                            const std::vector<uint8_t>& data = managedData[dataIdx++];
+                                            body.write(data.data(), data.size());
+                                        });
+            }
+        }
+
+        body.patch(chunkCountOffset, chunkCount);
+
+        BinaryWriter file;
+        file.write(BINARY_SCENE_MAGIC, 4);
+        file.write(BINARY_SCENE_VERSION);
+        file.write((uint32_t)body.assetPaths().size());
+
+        for (const std::string& path : body.assetPaths())
+            file.writeString(path);
+
+        file.align(CHUNK_ALIGNMENT);
+        file.write(body.data(), body.size());
+
+        return std::vector<uint8_t>(file.data(), file.data() + file.size());
+    }
+
+    void BinarySceneSerializer::saveScene(std::string path, entt::registry& reg)
+    {
+        std::vector<uint8_t> data = sceneToBytes(reg);
+
+        PHYSFS_File* file = PHYSFS_openWrite(path.c_str());
+        if (file == nullptr)
+        {
+            logErr("Failed to open %s for writing", path.c_str());
+            return;
+        }
+
+        PHYSFS_writeBytes(file, data.data(), data.size());
+        PHYSFS_close(file);
+    }
+
+    void BinarySceneSerializer::saveScene(AssetID id, entt::registry& reg)
+    {
+        saveScene(AssetDB::idToPath(id), reg);
+    }
+
+    // Bulk chunks are read this many components at a time when merging over several steps
+    const size_t BULK_BATCH_SIZE = 1024;
+
+    BinarySceneMerger::BinarySceneMerger(const uint8_t* data, size_t size) : data(data), size(size)
+    {
+    }
+
+    bool BinarySceneMerger::validate()
+    {
+        ZoneScoped;
+        BinaryReader header{data, size};
+
+        char magic[5] = "____";
+        header.read(magic, 4);
+
+        if (strcmp(magic, BINARY_SCENE_MAGIC) != 0)
+        {
+            logErr("Scene file had incorrect header for binary scene");
+            return false;
+        }
+
+        uint32_t version = header.read<uint32_t>();
+        if (version != BINARY_SCENE_VERSION)
+        {
+            logErr("Binary scene has unsupported version %u", version);
+            return false;
+        }
+
+        uint32_t assetCount = header.read<uint32_t>();
+        assetTable.reserve(std::min((size_t)assetCount, header.remaining() / sizeof(uint32_t)));
+
+        for (uint32_t i = 0; i < assetCount && !header.failed(); i++)
+        {
+            assetTable.push_back(AssetDB::pathToId(header.readString()));
+        }
+
+        header.align(CHUNK_ALIGNMENT);
+
+        if (header.failed())
+        {
+            logErr("Binary scene header was truncated");
+            return false;
+        }
+
+        BinaryReader reader{header.current(), header.remaining()};
+        reader.setAssetTable(assetTable);
+
+        settings.skybox = reader.readAssetID();
+        settings.skyboxBoost = reader.read<float>();
+
+        uint32_t entityCount = reader.read<uint32_t>();
+        if (reader.failed() || reader.remaining() / sizeof(uint32_t) < entityCount)
+        {
+            logErr("Binary scene was truncated (in the entity list)");
+            return false;
+        }
+
+        logMsg("scene has %u entities", entityCount);
+
+        robin_hood::unordered_flat_set<entt::entity> entitySet;
+        entitySet.reserve(entityCount);
+        sceneEntities.reserve(entityCount);
+
+        for (uint32_t i = 0; i < entityCount; i++)
+        {
+            entt::entity id = (entt::entity)reader.read<uint32_t>();
+            sceneEntities.push_back(id);
+            entitySet.insert(id);
+        }
+
+        total = sceneEntities.size();
+        uint32_t chunkCount = reader.read<uint32_t>();
+
+        for (uint32_t i = 0; i < chunkCount; i++)
+        {
+            if (!validateChunk(reader, entitySet))
+            {
+                logErr("Binary scene was truncated or corrupt (in chunk %u of %u)", i, chunkCount);
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool BinarySceneMerger::validateChunk(BinaryReader& reader,
+                                          const robin_hood::unordered_flat_set<entt::entity>& entitySet)
+    {
+        uint32_t serializedId = reader.read<uint32_t>();
+        uint32_t flags = reader.read<uint32_t>();
+        uint32_t elementSize = reader.read<uint32_t>();
+        uint32_t entityCount = reader.read<uint32_t>();
+        uint64_t payloadSize = reader.read<uint64_t>();
+
+        if (reader.failed() || reader.remaining() / sizeof(uint32_t) < entityCount)
+            return false;
+
+        Chunk chunk{};
+        chunk.bulk = flags & CHUNK_FLAG_BULK;
+        chunk.elementSize = elementSize;
+        chunk.entities.reserve(entityCount);
+
+        for (uint32_t i = 0; i < entityCount; i++)
+        {
+            entt::entity id = (entt::entity)reader.read<uint32_t>();
+
+            if (!entitySet.contains(id))
+            {
+                logErr("Binary scene chunk referenced entity %u, which isn't in the scene", (uint32_t)id);
+                return false;
+            }
+
+            chunk.entities.push_back(id);
+        }
+
+        reader.align(CHUNK_ALIGNMENT);
+
+        if (reader.failed() || reader.remaining() < payloadSize)
+            return false;
+
+        chunk.payload = reader.current();
+        chunk.payloadSize = payloadSize;
+        reader.skip(payloadSize);
+        reader.align(CHUNK_ALIGNMENT);
+
+        bool keep = true;
+
+        if (serializedId != MANAGED_CHUNK_ID)
+        {
+            auto it = ComponentMetadataManager::bySerializedID.find(serializedId);
+            if (it != ComponentMetadataManager::bySerializedID.end())
+                chunk.mdata = it->second;
+        }
+
+        if (serializedId != MANAGED_CHUNK_ID && chunk.mdata == nullptr)
+        {
+            logWarn("Skipping binary scene chunk with unknown component ID %u", serializedId);
+            keep = false;
+        }
+        else if (chunk.bulk)
+        {
+            if (chunk.mdata == nullptr || !chunk.mdata->isBulkSerializable() ||
+                chunk.mdata->getBulkElementSize() != elementSize || payloadSize != (uint64_t)elementSize * entityCount)
+            {
+                logErr("Skipping %s chunk: the component's layout has changed since the scene was saved",
+                       chunk.mdata ? chunk.mdata->getName() : "managed");
+                keep = false;
+            }
+        }
+        else
+        {
+            // Check the records fit in the payload now, so a bad one can't fail the load halfway through
+            BinaryReader records{chunk.payload, chunk.payloadSize};
+            for (uint32_t i = 0; i < entityCount; i++)
+            {
+                uint32_t recordSize = records.read<uint32_t>();
+                if (!records.skip(recordSize))
+                    return false;
+            }
+
+            keep = chunk.mdata != nullptr || scriptEngine != nullptr;
+        }
+
+        if (keep && !chunk.entities.empty())
+        {
+            total += chunk.entities.size();
+            chunks.push_back(std::move(chunk));
+        }
+
+        return !reader.failed();
+    }
+
+    bool BinarySceneMerger::step(entt::registry& reg, double budgetMs)
+    {
+        ZoneScoped;
+        auto start = TimingUtil::now();
+        auto outOfTime = [&]() { return TimingUtil::toMs(TimingUtil::now() - start) > budgetMs; };
+
+        // 1. Create all the scene's entities
+        while (phase == Phase::CreateEntities)
+        {
+            if (cursor == sceneEntities.size())
+            {
+                phase = Phase::Chunks;
+                cursor = 0;
+                break;
+            }
+
+            if (outOfTime())
+                return false;
+
+            entt::entity id = sceneEntities[cursor++];
+            idRemap.insert({id, reg.create(id)});
+            completed++;
+        }
+
+        // 2. Read the components, a batch or a record at a time
+        while (phase == Phase::Chunks)
+        {
+            if (chunkIdx == chunks.size())
+            {
+                reg.set<SkySettings>(settings);
+                phase = Phase::Done;
+                break;
+            }
+
+            if (outOfTime())
+                return false;
+
+            if (!stepChunk(reg, chunks[chunkIdx]))
+            {
+                logErr("Binary scene was corrupt (in chunk %zu of %zu)", chunkIdx, chunks.size());
+                didFail = true;
+                phase = Phase::Done;
+            }
+        }
+
+        return true;
+    }
+
+    bool BinarySceneMerger::stepChunk(entt::registry& reg, Chunk& chunk)
+    {
+        if (chunk.bulk)
+        {
+            size_t count = std::min(chunk.entities.size() - cursor, BULK_BATCH_SIZE);
+            remapped.clear();
+
+            for (size_t i = cursor; i < cursor + count; i++)
+                remapped.push_back(idRemap.find(chunk.entities[i])->second);
+
+            BinaryReader batch{chunk.payload + cursor * chunk.elementSize, count * chunk.elementSize};
+            chunk.mdata->readBulk(reg, remapped, batch);
+            cursor += count;
+            completed += count;
+        }
+        else
+        {
+            if (cursor == 0)
+            {
+                recordReader = BinaryReader{chunk.payload, chunk.payloadSize};
+                recordReader.setAssetTable(assetTable);
+            }
+
+            entt::entity ent = idRemap.find(chunk.entities[cursor])->second;
+            uint32_t recordSize = recordReader.read<uint32_t>();
+            const uint8_t* recordEnd = recordReader.current() + recordSize;
+
+            if (chunk.mdata)
+            {
+                chunk.mdata->readBinary(ent, reg, idRemap, recordReader);
+            }
+            else
+            {
+                nlohmann::json j = nlohmann::json::from_msgpack(recordReader.current(), recordEnd);
+                for (auto& componentPair : j.items())
+                {
+                    scriptEngine->deserializeManagedComponent(componentPair.key().c_str(), componentPair.value(),
+                                                              ent);
+                }
+            }
+
+            if (recordReader.failed() || recordReader.current() > recordEnd)
+            {
+                logErr("Component record for entity %u overran its size", (uint32_t)ent);
+                return false;
+            }
+
+            recordReader.skip(recordEnd - recordReader.current());
+            cursor++;
+            completed++;
+        }
+
+        if (cursor == chunk.entities.size())
+        {
+            chunkIdx++;
+            cursor = 0;
+        }
+
+        return true;
+    }
+
+    bool BinarySceneMerger::failed() const
+    {
+        return didFail;
+    }
+
+    size_t BinarySceneMerger::totalWork() const
+    {
+        return total;
+    }
+
+    size_t BinarySceneMerger::completedWork() const
+    {
+        return completed;
+    }
+
+    bool BinarySceneSerializer::loadSceneFromBytes(const uint8_t* data, size_t size, entt::registry& reg)
+    {
+        ZoneScoped;
+        BinarySceneMerger merger{data, size};
+
+        if (!merger.validate())
+            return false;
+
+        merger.step(reg, std::numeric_limits<double>::max());
+        return !merger.failed();
+    }
+
+    void BinarySceneSerializer::loadScene(PHYSFS_File* file, entt::registry& reg)
+    {
+        PerfTimer timer;
+
+        // std::vector's allocation is aligned enough for the chunk data to be used in-place
+        std::vector<uint8_t> data;
+        data.resize(PHYSFS_fileLength(file));
+        PHYSFS_readBytes(file, data.data(), data.size());
+
+        try
+        {
+            if (loadSceneFromBytes(data.data(), data.size(), reg))
+                logMsg("loaded binary scene in %.3fms", timer.stopGetMs());
+        }
+        catch (nlohmann::detail::exception& ex)
+        {
+            logErr("Failed to load scene: %s", ex.what());
+        }
+    }
+}
@@ -0,0 +1,199 @@
+#pragma once
+#include <Core/AssetDB.hpp>
+#include <robin_hood.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace worlds
+{
+    // Growable byte buffer used by the binary scene format.
+    // Asset IDs are written as indices into a table of asset paths that gets stored
+    // alongside the data, so binary files stay valid if the AssetDB is rebuilt.
+    class BinaryWriter
+    {
+      public:
+        void write(const void* data, size_t size)
+        {
+            size_t offset = buffer.size();
+            buffer.resize(offset + size);
+            memcpy(buffer.data() + offset, data, size);
+        }
+
+        template <typename T> void write(const T& val)
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types can be written directly");
+            write(&val, sizeof(T));
+        }
+
+        void writeString(std::string_view str)
+        {
+            write((uint32_t)str.size());
+            write(str.data(), str.size());
+        }
+
+        void writeAssetID(AssetID id)
+        {
+            if (id == INVALID_ASSET)
+            {
+                write(~0u);
+                return;
+            }
+
+            auto it = assetIndices.find(id);
+            if (it != assetIndices.end())
+            {
+                write(it->second);
+                return;
+            }
+
+            uint32_t idx = (uint32_t)assetPathTable.size();
+            assetPathTable.push_back(AssetDB::idToPath(id));
+            assetIndices.insert({id, idx});
+            write(idx);
+        }
+
+        // Pads the buffer with zeroes until its size is a multiple of alignment.
+        void align(size_t alignment)
+        {
+            size_t padding = (alignment - (buffer.size() % alignment)) % alignment;
+            buffer.resize(buffer.size() + padding, 0);
+        }
+
+        // Overwrites previously written data, for sizes that aren't known up front.
+        template <typename T> void patch(size_t offset, const T& val)
+        {
+            memcpy(buffer.data() + offset, &val, sizeof(T));
+        }
+
+        size_t size() const
+        {
+            return buffer.size();
+        }
+
+        const uint8_t* data() const
+        {
+            return buffer.data();
+        }
+
+        const std::vector<std::string>& assetPaths() const
+        {
+            return assetPathTable;
+        }
+
+      private:
+        std::vector<uint8_t> buffer;
+        robin_hood::unordered_flat_map<AssetID, uint32_t> assetIndices;
+        std::vector<std::string> assetPathTable;
+    };
+
+    // Reads back data produced by BinaryWriter. Reading past the end of the buffer
+    // doesn't throw, it zero-fills the output and sets the failed flag instead.
+    class BinaryReader
+    {
+      public:
+        BinaryReader(const uint8_t* data, size_t size) : start(data), ptr(data), end(data + size)
+        {
+        }
+
+        bool read(void* out, size_t size)
+        {
+            if (!skip(size))
+            {
+                memset(out, 0, size);
+                return false;
+            }
+
+            memcpy(out, ptr - size, size);
+            return true;
+        }
+
+        template <typename T> T read()
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types can be read directly");
+            T val;
+            read(&val, sizeof(T));
+            return val;
+        }
+
+        std::string readString()
+        {
+            uint32_t length = read<uint32_t>();
+            std::string str;
+
+            if (remaining() < length)
+            {
+                didFail = true;
+                return str;
+            }
+
+            str.assign((const char*)ptr, length);
+            ptr += length;
+            return str;
+        }
+
+        AssetID readAssetID()
+        {
+            uint32_t idx = read<uint32_t>();
+
+            if (idx == ~0u)
+                return INVALID_ASSET;
+
+            if (idx >= assetTable.size())
+            {
+                didFail = true;
+                return INVALID_ASSET;
+            }
+
+            return assetTable[idx];
+        }
+
+        bool skip(size_t size)
+        {
+            if (didFail || remaining() < size)
+            {
+                didFail = true;
+                return false;
+            }
+
+            ptr += size;
+            return true;
+        }
+
+        void align(size_t alignment)
+        {
+            size_t offset = ptr - start;
+            skip((alignment - (offset % alignment)) % alignment);
+        }
+
+        void setAssetTable(std::vector<AssetID> table)
+        {
+            assetTable = std::move(table);
+        }
+
+        const uint8_t* current() const
+        {
+            return ptr;
+        }
+
+        size_t remaining() const
+        {
+            return end - ptr;
+        }
+
+        bool failed() const
+        {
+            return didFail;
+        }
+
+      private:
+        const uint8_t* start;
+        const uint8_t* ptr;
+        const uint8_t* end;
+        bool didFail = false;
+        std::vector<AssetID> assetTable;
+    };
+}
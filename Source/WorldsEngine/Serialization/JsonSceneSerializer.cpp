@@ -1,11 +1,13 @@
 #include "Core/Engine.hpp"
 #include <Core/WorldComponents.hpp>
 #include "SceneSerialization.hpp"
+#include "PreparedScene.hpp"
 #include <string>
 #include <nlohmann/json.hpp>
 #include <ComponentMeta/ComponentMetadata.hpp>
 #include <Core/Transform.hpp>
 #include <Util/TimingUtil.hpp>
+#include <Core/TaskScheduler.hpp>
 #include "Core/AssetDB.hpp"
 #include "robin_hood.h"
 #include "slib/StaticAllocList.hpp"
@@ -15,8 +17,8 @@
 
 namespace worlds
 {
-    robin_hood::unordered_flat_map<AssetID, nlohmann::json> prefabCache;
-    robin_hood::unordered_flat_map<entt::entity, entt::entity> idRemap;
+    PrefabCache prefabCache;
+    EntityIDMap idRemap;
     DotNetScriptEngine* scriptEngine;
 
     nlohmann::json getEntityJson(entt::entity ent, entt::registry& reg)
@@ -43,6 +45,16 @@ namespace worlds
         return j;
     }
 
+    nlohmann::json loadPrefabJson(AssetID id)
+    {
+        PHYSFS_File* file = AssetDB::openAssetFileRead(id);
+        std::string str;
+        str.resize(PHYSFS_fileLength(file));
+        PHYSFS_readBytes(file, str.data(), str.size());
+        PHYSFS_close(file);
+        return nlohmann::json::parse(str);
+    }
+
     nlohmann::json getPrefabJson(AssetID id)
     {
         auto cacheIt = prefabCache.find(id);
@@ -54,12 +66,7 @@ namespace worlds
         else
         {
             // not in cache, load from disk
-            PHYSFS_File* file = AssetDB::openAssetFileRead(id);
-            std::string str;
-            str.resize(PHYSFS_fileLength(file));
-            PHYSFS_readBytes(file, str.data(), str.size());
-            PHYSFS_close(file);
-            nlohmann::json prefab = nlohmann::json::parse(str);
+            nlohmann::json prefab = loadPrefabJson(id);
             prefabCache.insert({id, prefab});
             return prefab;
         }
@@ -254,81 +261,263 @@ namespace worlds
         return ent;
     }
 
-    // Loads entities into the specified registry.
-    // j is the array of entities to load.
-    void loadSceneEntities(entt::registry& reg, const nlohmann::json& j)
+    struct SceneLoadTimings
     {
-        ZoneScoped;
-        logMsg("scene has %lu entities", j.size());
-        idRemap.clear();
+        double prepareMs = 0.0;
+        double emplaceMs = 0.0;
+    };
 
-        // 1. Create all the scene's entities and deserialize transforms
-        for (const auto& p : j.items())
+    SceneLoadTimings lastLoadTimings;
+
+    // Works out the final component JSON for an entity. This only reads shared state, so it's
+    // safe to call from any thread as long as the entity's prefab has already been loaded.
+    void prepareEntity(const std::string& key, const nlohmann::json& entityJson, PreparedEntity& prepared,
+                       const PrefabCache& prefabs)
+    {
+        prepared.id = (entt::entity)std::stoul(key);
+
+        if (entityJson.contains("prefabPath"))
         {
-            entt::entity id = (entt::entity)std::stoul(p.key());
-            entt::entity newEnt = reg.create(id);
+            AssetID prefabId = AssetDB::pathToId(entityJson["prefabPath"].get<std::string>());
+            prepared.patchedComponents = prefabs.at(prefabId);
 
-            idRemap.insert({id, newEnt});
-            // Even though the ID map isn't complete, it's fine to pass it in here since transforms don't need it
-            ComponentMetadataManager::byName["Transform"]->fromJson(newEnt, reg, idRemap, p.value()["Transform"]);
+            try
+            {
+                prepared.patchedComponents = prepared.patchedComponents.patch(entityJson["diff"]);
+            }
+            catch (nlohmann::detail::out_of_range& ex)
+            {
+                logErr("Malformed prefab instance! Resetting... (%s)", ex.what());
+            }
+
+            if (entityJson.contains("Transform"))
+            {
+                prepared.patchedComponents["Transform"] = entityJson["Transform"];
+            }
+
+            prepared.components = &prepared.patchedComponents;
+        }
+        else
+        {
+            prepared.components = &entityJson;
+        }
+
+        if (!prepared.components->contains("Transform"))
+        {
+            logErr("Not deserializing entity %u because it lacks a transform", (uint32_t)prepared.id);
+            return;
         }
 
-        // 2. Create patched KVs for entities
-        std::vector<std::pair<entt::entity, nlohmann::json>> entityComponentData;
+        prepared.valid = true;
+    }
+
+    // Preparing is split from adding entities to the registry since it's where most of the time goes
+    // (patching prefabs especially) and it can be done in parallel. Adding entities has to happen on
+    // the main thread as fromJson writes to the registry.
+    void prepareSceneEntities(const nlohmann::json& j, PrefabCache& prefabs, PreparedScene& scene)
+    {
+        ZoneScoped;
+        std::vector<std::pair<const std::string*, const nlohmann::json*>> entityJson;
+        entityJson.reserve(j.size());
+
         for (const auto& p : j.items())
         {
-            entt::entity newEnt = idRemap[(entt::entity)std::stoul(p.key())];
+            entityJson.emplace_back(&p.key(), &p.value());
+
+            // The prefab cache can't be filled from worker threads, so load any prefabs up front
             if (p.value().contains("prefabPath"))
             {
-                std::string prefabPath = p.value()["prefabPath"].get<std::string>();
-                AssetID prefabId = AssetDB::pathToId(prefabPath);
+                AssetID prefabId = AssetDB::pathToId(p.value()["prefabPath"].get<std::string>());
+                if (!prefabs.contains(prefabId))
+                    prefabs.insert({prefabId, loadPrefabJson(prefabId)});
+            }
+        }
+
+        // 1. Resolve prefabs in parallel
+        scene.entities.clear();
+        scene.entities.resize(entityJson.size());
 
-                nlohmann::json components = getPrefabJson(prefabId);
+        enki::TaskSet prepareTask{(uint32_t)entityJson.size(), [&](enki::TaskSetPartition range, uint32_t) {
+            ZoneScopedN("Prepare scene entities");
+            for (uint32_t i = range.start; i < range.end; i++)
+            {
+                // Exceptions can't escape a task, so report them here and skip the entity
                 try
                 {
-                    components = components.patch(p.value()["diff"]);
+                    prepareEntity(*entityJson[i].first, *entityJson[i].second, scene.entities[i], prefabs);
                 }
-                catch (nlohmann::detail::out_of_range& ex)
+                catch (std::exception& ex)
                 {
-                    logErr("Malformed prefab instance! Resetting... (%s)", ex.what());
+                    logErr("Failed to load entity %s: %s", entityJson[i].first->c_str(), ex.what());
+                    scene.entities[i].valid = false;
                 }
+            }
+        }};
+        prepareTask.m_MinRange = 16;
 
-                if (p.value().contains("Transform"))
-                {
-                    components["Transform"] = p.value()["Transform"];
-                }
-                entityComponentData.push_back({ newEnt, components });
+        if (!entityJson.empty())
+        {
+            g_taskSched.AddTaskSetToPipe(&prepareTask);
+            g_taskSched.WaitforTask(&prepareTask);
+        }
+
+        // 2. Sort components into per-type buckets so they can be deserialized in component order
+        robin_hood::unordered_flat_map<std::string, uint32_t> sortedIndices;
+        for (uint32_t i = 0; i < ComponentMetadataManager::sorted.size(); i++)
+        {
+            sortedIndices.insert({ComponentMetadataManager::sorted[i]->getName(), i});
+        }
+
+        scene.transformIndex = sortedIndices.at("Transform");
+        scene.componentBuckets.clear();
+        scene.componentBuckets.resize(ComponentMetadataManager::sorted.size());
+
+        for (uint32_t i = 0; i < scene.entities.size(); i++)
+        {
+            PreparedEntity& pe = scene.entities[i];
+            if (!pe.valid)
+                continue;
+
+            for (const auto& componentPair : pe.components->items())
+            {
+                auto it = sortedIndices.find(componentPair.key());
+
+                if (it != sortedIndices.end())
+                    scene.componentBuckets[it->second].emplace_back(i, &componentPair.value());
+                else
+                    pe.managedComponents.emplace_back(&componentPair.key(), &componentPair.value());
             }
-            else
+        }
+    }
+
+    PreparedSceneMerger::PreparedSceneMerger(PreparedScene& scene, entt::registry& reg, EntityIDMap& idRemap)
+        : scene(scene), reg(reg), idRemap(idRemap)
+    {
+        idRemap.clear();
+        total = scene.entities.size();
+
+        for (uint32_t i = 0; i < scene.componentBuckets.size(); i++)
+        {
+            if (i != scene.transformIndex)
+                total += scene.componentBuckets[i].size();
+        }
+
+        for (const PreparedEntity& pe : scene.entities)
+        {
+            total += pe.managedComponents.size();
+        }
+    }
+
+    bool PreparedSceneMerger::step(double budgetMs)
+    {
+        ZoneScoped;
+        auto start = TimingUtil::now();
+        auto outOfTime = [&]() { return TimingUtil::toMs(TimingUtil::now() - start) > budgetMs; };
+
+        // 1. Create all the scene's entities and deserialize transforms
+        while (phase == Phase::CreateEntities)
+        {
+            if (cursor == scene.entities.size())
             {
-                entityComponentData.push_back({ newEnt, p.value() });
+                // Transforms are applied as the entities are created
+                phase = Phase::NativeComponents;
+                cursor = 0;
+                bucket = 0;
+                break;
             }
+
+            if (outOfTime())
+                return false;
+
+            PreparedEntity& pe = scene.entities[cursor++];
+            completed++;
+
+            if (!pe.valid)
+                continue;
+
+            pe.created = reg.create(pe.id);
+            idRemap.insert({pe.id, pe.created});
+            // Even though the ID map isn't complete, it's fine to pass it in here since transforms don't need it
+            ComponentMetadataManager::sorted[scene.transformIndex]->fromJson(pe.created, reg, idRemap,
+                                                                             (*pe.components)["Transform"]);
         }
 
-        // 3. Deserialize in component order
-        for (ComponentMetadata* cm : ComponentMetadataManager::sorted)
+        // 2. Deserialize in component order
+        while (phase == Phase::NativeComponents)
         {
-            for (auto& pair : entityComponentData)
+            if (bucket == scene.componentBuckets.size())
             {
-                if (pair.second.contains(cm->getName()))
-                {
-                    cm->fromJson(pair.first, reg, idRemap, pair.second[cm->getName()]);
-                }
+                phase = Phase::ManagedComponents;
+                cursor = 0;
+                break;
+            }
+
+            if (bucket == scene.transformIndex || cursor == scene.componentBuckets[bucket].size())
+            {
+                bucket++;
+                cursor = 0;
+                continue;
             }
+
+            if (outOfTime())
+                return false;
+
+            auto& pair = scene.componentBuckets[bucket][cursor++];
+            ComponentMetadataManager::sorted[bucket]->fromJson(scene.entities[pair.first].created, reg, idRemap,
+                                                               *pair.second);
+            completed++;
         }
 
-        // 4. Deserialize managed components
-        for (auto& pair : entityComponentData)
+        // 3. Deserialize managed components
+        while (phase == Phase::ManagedComponents)
         {
-            for (auto& componentPair : pair.second.items())
+            if (cursor == scene.entities.size())
             {
-                if (ComponentMetadataManager::byName.count(componentPair.key()) == 0)
-                {
-                    auto& componentJson = componentPair.value();
-                    scriptEngine->deserializeManagedComponent(componentPair.key().c_str(), componentJson, pair.first);
-                }
+                phase = Phase::Done;
+                break;
             }
+
+            if (outOfTime())
+                return false;
+
+            PreparedEntity& pe = scene.entities[cursor++];
+            for (auto& componentPair : pe.managedComponents)
+            {
+                scriptEngine->deserializeManagedComponent(componentPair.first->c_str(), *componentPair.second,
+                                                          pe.created);
+            }
+            completed += pe.managedComponents.size();
         }
+
+        return true;
+    }
+
+    size_t PreparedSceneMerger::totalWork() const
+    {
+        return total;
+    }
+
+    size_t PreparedSceneMerger::completedWork() const
+    {
+        return completed;
+    }
+
+    // Loads entities into the specified registry.
+    // j is the array of entities to load.
+    void loadSceneEntities(entt::registry& reg, const nlohmann::json& j)
+    {
+        ZoneScoped;
+        logMsg("scene has %lu entities", j.size());
+
+        PerfTimer prepareTimer;
+        PreparedScene scene;
+        prepareSceneEntities(j, prefabCache, scene);
+        lastLoadTimings.prepareMs = prepareTimer.stopGetMs();
+
+        PerfTimer emplaceTimer;
+        PreparedSceneMerger merger{scene, reg, idRemap};
+        merger.step(std::numeric_limits<double>::infinity());
+        lastLoadTimings.emplaceMs = emplaceTimer.stopGetMs();
     }
 
     void deserializeJsonScene(nlohmann::json& j, entt::registry& reg)
@@ -358,11 +547,13 @@ namespace worlds
             str.resize(PHYSFS_fileLength(file));
             PHYSFS_readBytes(file, str.data(), str.size());
 
+            PerfTimer parseTimer;
             nlohmann::json j = nlohmann::json::parse(str);
-            j.type();
+            double parseMs = parseTimer.stopGetMs();
             deserializeJsonScene(j, reg);
 
-            logMsg("loaded json scene in %.3fms", timer.stopGetMs());
+            logMsg("loaded json scene in %.3fms (parse %.3fms, prepare %.3fms, emplace %.3fms)", timer.stopGetMs(),
+                   parseMs, lastLoadTimings.prepareMs, lastLoadTimings.emplaceMs);
         }
         catch (nlohmann::detail::exception& ex)
         {
@@ -393,10 +584,13 @@ namespace worlds
             dat.resize(PHYSFS_fileLength(file) - 4);
             PHYSFS_readBytes(file, dat.data(), dat.size());
 
+            PerfTimer parseTimer;
             nlohmann::json j = nlohmann::json::from_msgpack(dat.begin(), dat.end());
+            double parseMs = parseTimer.stopGetMs();
             deserializeJsonScene(j, reg);
 
-            logMsg("loaded msgpack scene in %.3fms", timer.stopGetMs());
+            logMsg("loaded msgpack scene in %.3fms (parse %.3fms, prepare %.3fms, emplace %.3fms)",
+                   timer.stopGetMs(), parseMs, lastLoadTimings.prepareMs, lastLoadTimings.emplaceMs);
         }
         catch (nlohmann::detail::exception& ex)
         {
@@ -0,0 +1,75 @@
+#pragma once
+#include <ComponentMeta/ComponentFuncs.hpp>
+#include <entt/entt.hpp>
+#include <nlohmann/json.hpp>
+#include <robin_hood.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace worlds
+{
+    typedef uint32_t AssetID;
+    typedef robin_hood::unordered_flat_map<AssetID, nlohmann::json> PrefabCache;
+
+    struct PreparedEntity
+    {
+        entt::entity id = entt::null;
+        // The entity in the registry, once it's been created
+        entt::entity created = entt::null;
+        bool valid = false;
+        // Points at either the entity's JSON in the scene or at patchedComponents
+        const nlohmann::json* components = nullptr;
+        nlohmann::json patchedComponents;
+        std::vector<std::pair<const std::string*, const nlohmann::json*>> managedComponents;
+    };
+
+    // A scene's entities after prefab resolution, ready to be added to a registry.
+    // Holds pointers into the scene JSON, so that has to outlive it.
+    struct PreparedScene
+    {
+        std::vector<PreparedEntity> entities;
+        // Indexed by position in ComponentMetadataManager::sorted. Each entry is an
+        // index into entities along with the component's JSON.
+        std::vector<std::vector<std::pair<uint32_t, const nlohmann::json*>>> componentBuckets;
+        uint32_t transformIndex = 0;
+    };
+
+    // Loads a prefab's JSON from disk. Safe to call from any thread.
+    nlohmann::json loadPrefabJson(AssetID id);
+
+    // Resolves prefabs and works out the components of every entity in j, which is an object
+    // of entity IDs to components. Any prefabs that aren't in prefabs are loaded into it.
+    // Doesn't touch a registry, so it can be called from any thread.
+    void prepareSceneEntities(const nlohmann::json& j, PrefabCache& prefabs, PreparedScene& scene);
+
+    // Adds a prepared scene's entities to a registry, a slice at a time. Must be used
+    // on the main thread.
+    class PreparedSceneMerger
+    {
+      public:
+        PreparedSceneMerger(PreparedScene& scene, entt::registry& reg, EntityIDMap& idRemap);
+        // Does work until budgetMs runs out. Returns true once all the entities are in the registry.
+        bool step(double budgetMs);
+        size_t totalWork() const;
+        size_t completedWork() const;
+
+      private:
+        enum class Phase
+        {
+            CreateEntities,
+            NativeComponents,
+            ManagedComponents,
+            Done
+        };
+
+        PreparedScene& scene;
+        entt::registry& reg;
+        EntityIDMap& idRemap;
+        Phase phase = Phase::CreateEntities;
+        size_t cursor = 0;
+        size_t bucket = 0;
+        size_t total = 0;
+        size_t completed = 0;
+    };
+}
@@ -5,6 +5,8 @@
 #include "Core/WorldComponents.hpp"
 #include <Audio/Audio.hpp>
 #include <Navigation/Navigation.hpp>
+#include <Util/TimingUtil.hpp>
+#include <nlohmann/json.hpp>
 #include <physfs.h>
 #include <Tracy.hpp>
 
@@ -18,6 +20,9 @@ namespace worlds
 
     std::vector<LoadCallbackWithContext> loadCallbacks;
 
+    nlohmann::json sceneToJsonObject(entt::registry& reg);
+    void deserializeJsonScene(nlohmann::json& j, entt::registry& reg);
+
     void clearEntities(entt::registry& reg)
     {
         std::vector<entt::entity> entitiesToClear;
@@ -64,6 +69,10 @@ namespace worlds
             {
                 MessagePackSceneSerializer::loadScene(file, reg);
             }
+            else if (strcmp(maybeHeader, "WBSC") == 0)
+            {
+                BinarySceneSerializer::loadScene(file, reg);
+            }
             else
             {
                 logErr("Unrecognised scene header: %s", maybeHeader);
@@ -86,9 +95,18 @@ namespace worlds
         }
 
         PHYSFS_close(file);
+        onSceneLoaded(reg);
+    }
+
+    void SceneLoader::onSceneLoaded(entt::registry& reg)
+    {
         AudioSystem::getInstance()->updateAudioScene(reg);
         NavigationSystem::updateNavMesh(reg);
+        runLoadCallbacks(reg);
+    }
 
+    void SceneLoader::runLoadCallbacks(entt::registry& reg)
+    {
         for (LoadCallbackWithContext loadCallback : loadCallbacks)
         {
             loadCallback.callback(loadCallback.ctx, reg);
@@ -117,6 +135,81 @@ namespace worlds
         return ent;
     }
 
+    void SceneLoader::benchmarkFormats(entt::registry& reg, int iterations)
+    {
+        if (iterations < 1)
+            iterations = 1;
+
+        std::string jsonData;
+        std::vector<uint8_t> msgpackData;
+        std::vector<uint8_t> binaryData;
+        double jsonSaveMs = 0.0;
+        double msgpackSaveMs = 0.0;
+        double binarySaveMs = 0.0;
+
+        for (int i = 0; i < iterations; i++)
+        {
+            PerfTimer timer;
+            jsonData = sceneToJsonObject(reg).dump(2);
+            jsonSaveMs += timer.stopGetMs();
+
+            timer = PerfTimer{};
+            msgpackData = nlohmann::json::to_msgpack(sceneToJsonObject(reg));
+            msgpackSaveMs += timer.stopGetMs();
+
+            timer = PerfTimer{};
+            binaryData = BinarySceneSerializer::sceneToBytes(reg);
+            binarySaveMs += timer.stopGetMs();
+        }
+
+        // The JSON load runs last so the registry is left with the reference copy of the scene.
+        double jsonLoadMs = 0.0;
+        double msgpackLoadMs = 0.0;
+        double binaryLoadMs = 0.0;
+
+        try
+        {
+            for (int i = 0; i < iterations; i++)
+            {
+                clearEntities(reg);
+                PerfTimer timer;
+                BinarySceneSerializer::loadSceneFromBytes(binaryData.data(), binaryData.size(), reg);
+                binaryLoadMs += timer.stopGetMs();
+            }
+
+            for (int i = 0; i < iterations; i++)
+            {
+                clearEntities(reg);
+                PerfTimer timer;
+                nlohmann::json j = nlohmann::json::from_msgpack(msgpackData.begin(), msgpackData.end());
+                deserializeJsonScene(j, reg);
+                msgpackLoadMs += timer.stopGetMs();
+            }
+
+            for (int i = 0; i < iterations; i++)
+            {
+                clearEntities(reg);
+                PerfTimer timer;
+                nlohmann::json j = nlohmann::json::parse(jsonData);
+                deserializeJsonScene(j, reg);
+                jsonLoadMs += timer.stopGetMs();
+            }
+        }
+        catch (nlohmann::detail::exception& ex)
+        {
+            logErr("Scene benchmark failed: %s", ex.what());
+            return;
+        }
+
+        logMsg("scene format benchmark (%i iterations, averages):", iterations);
+        logMsg("  json:   %8zu bytes, save %.3fms, load %.3fms", jsonData.size(), jsonSaveMs / iterations,
+               jsonLoadMs / iterations);
+        logMsg("  wmsp:   %8zu bytes, save %.3fms, load %.3fms", msgpackData.size(), msgpackSaveMs / iterations,
+               msgpackLoadMs / iterations);
+        logMsg("  binary: %8zu bytes, save %.3fms, load %.3fms", binaryData.size(), binarySaveMs / iterations,
+               binaryLoadMs / iterations);
+    }
+
     void SceneLoader::registerLoadCallback(void* ctx, SceneLoadCallback callback)
     {
         loadCallbacks.emplace_back(ctx, callback);
@@ -2,11 +2,14 @@
 #include <cstdint>
 #include <entt/entt.hpp>
 #include <physfs.h>
+#include <string>
 #include <vector>
 
 namespace worlds
 {
     class DotNetScriptEngine;
+    class PhysicsSystem;
+    struct AsyncSceneLoadState;
     typedef uint32_t AssetID;
     typedef void (*SceneLoadCallback)(void* ctx, entt::registry& reg);
 
@@ -24,6 +27,14 @@ namespace worlds
         static entt::entity loadEntity(AssetID id, entt::registry& reg);
         static entt::entity createPrefab(AssetID id, entt::registry& reg);
         static void registerLoadCallback(void* ctx, SceneLoadCallback callback);
+        // Updates the audio scene and navmesh and runs the load callbacks.
+        // loadScene calls this itself, so it's only needed by other ways of loading a scene.
+        static void onSceneLoaded(entt::registry& reg);
+        // Runs the callbacks added with registerLoadCallback.
+        static void runLoadCallbacks(entt::registry& reg);
+        // Saves and loads the scene in reg with every serializer and logs how long each took.
+        // This replaces the contents of reg with an equivalent copy of the scene.
+        static void benchmarkFormats(entt::registry& reg, int iterations);
 
       private:
         SceneLoader()
@@ -34,11 +45,42 @@ namespace worlds
         }
     };
 
+    // Loads a scene without stalling the main thread. Reading and parsing the file, resolving
+    // prefabs, loading meshes and cooking mesh colliders all happen on worker threads. The
+    // entities are then added to the registry a slice at a time over several calls to update,
+    // after which the audio scene and navmesh are set up in the background.
+    class AsyncSceneLoad
+    {
+      public:
+        AsyncSceneLoad(AssetID scene, entt::registry& reg, PhysicsSystem* physics, bool additive = false);
+        ~AsyncSceneLoad();
+        // Does up to budgetMs of main thread work. Returns true once the load has finished or failed.
+        bool update(double budgetMs);
+        bool failed() const;
+        // True once the load has started changing the registry. The scene is only partially there
+        // until update returns true, so it shouldn't be simulated in the meantime.
+        bool isMerging() const;
+        // Rough estimate of how far through the load is, from 0 to 1.
+        float progress() const;
+        AssetID sceneId() const;
+
+      private:
+        AsyncSceneLoadState* state;
+    };
+
+    // Binary scene format (WBSC). Entities are stored as one chunk per component type,
+    // written with the binary hooks on ComponentMetadata. It's much faster to load than
+    // JSON or WMSP but isn't meant to be edited or merged, so treat it like a build artifact.
     class BinarySceneSerializer
     {
       public:
+        static void saveScene(std::string path, entt::registry& reg);
+        static void saveScene(AssetID id, entt::registry& reg);
         static void loadScene(PHYSFS_File* file, entt::registry& reg);
 
+        static std::vector<uint8_t> sceneToBytes(entt::registry& reg);
+        static bool loadSceneFromBytes(const uint8_t* data, size_t size, entt::registry& reg);
+
       private:
         BinarySceneSerializer()
         {
@@ -1,11 +1,12 @@
 #pragma once
+#include <stddef.h>
 
 namespace worlds
 {
     template <typename T, size_t sz> struct CircularBuffer
     {
-        T values[sz];
-        size_t idx;
+        T values[sz]{};
+        size_t idx = 0;
 
         void add(T value)
         {
@@ -0,0 +1,145 @@
+#include "FrameArena.hpp"
+#include <Core/Fatal.hpp>
+#include <atomic>
+#include <stdlib.h>
+
+namespace worlds
+{
+    const size_t DefaultBlockSize = 256 * 1024;
+
+    struct ArenaBlock
+    {
+        ArenaBlock* next;
+        size_t size;
+        size_t used;
+
+        uint8_t* data()
+        {
+            return (uint8_t*)(this + 1);
+        }
+    };
+
+    // One chain of blocks per frame slot
+    struct ThreadArena
+    {
+        ArenaBlock* blocks[FrameArena::FrameCount] = {};
+        uint64_t lastFrame = ~0ull;
+        int slot = 0;
+        size_t usedThisFrame = 0;
+
+        ~ThreadArena()
+        {
+            for (ArenaBlock* head : blocks)
+            {
+                while (head != nullptr)
+                {
+                    ArenaBlock* next = head->next;
+                    free(head);
+                    head = next;
+                }
+            }
+        }
+    };
+
+    std::atomic<uint64_t> frameNumber{0};
+    thread_local ThreadArena threadArena;
+
+    ArenaBlock* allocBlock(size_t size)
+    {
+        // Blocks come straight from malloc so they don't show up as allocations in the frame
+        ArenaBlock* block = (ArenaBlock*)malloc(sizeof(ArenaBlock) + size);
+        if (block == nullptr)
+            fatalErr("Failed to allocate frame arena block");
+
+        block->next = nullptr;
+        block->size = size;
+        block->used = 0;
+        return block;
+    }
+
+    void resetSlot(ThreadArena& arena, int slot)
+    {
+        ArenaBlock* head = arena.blocks[slot];
+        if (head == nullptr)
+            return;
+
+        if (head->next == nullptr)
+        {
+            head->used = 0;
+            return;
+        }
+
+        // The frame outgrew the first block, so replace the chain with a single block big
+        // enough for all of it.
+        size_t total = 0;
+        for (ArenaBlock* b = head; b != nullptr;)
+        {
+            ArenaBlock* next = b->next;
+            total += b->size;
+            free(b);
+            b = next;
+        }
+
+        arena.blocks[slot] = allocBlock(total);
+    }
+
+    ThreadArena& getArena()
+    {
+        ThreadArena& arena = threadArena;
+        uint64_t frame = frameNumber.load(std::memory_order_relaxed);
+
+        if (arena.lastFrame != frame)
+        {
+            arena.lastFrame = frame;
+            arena.slot = (int)(frame % FrameArena::FrameCount);
+            arena.usedThisFrame = 0;
+            resetSlot(arena, arena.slot);
+        }
+
+        return arena;
+    }
+
+    void* FrameArena::allocate(size_t size, size_t alignment)
+    {
+        ThreadArena& arena = getArena();
+        ArenaBlock* block = arena.blocks[arena.slot];
+
+        if (block != nullptr)
+        {
+            uintptr_t base = (uintptr_t)block->data();
+            uintptr_t aligned = (base + block->used + alignment - 1) & ~(uintptr_t)(alignment - 1);
+
+            if (aligned + size <= base + block->size)
+            {
+                block->used = aligned + size - base;
+                arena.usedThisFrame += size;
+                return (void*)aligned;
+            }
+        }
+
+        // Newest block goes at the front of the chain
+        size_t blockSize = block ? block->size * 2 : DefaultBlockSize;
+        while (blockSize < size + alignment)
+            blockSize *= 2;
+
+        ArenaBlock* newBlock = allocBlock(blockSize);
+        newBlock->next = block;
+        arena.blocks[arena.slot] = newBlock;
+
+        uintptr_t base = (uintptr_t)newBlock->data();
+        uintptr_t aligned = (base + alignment - 1) & ~(uintptr_t)(alignment - 1);
+        newBlock->used = aligned + size - base;
+        arena.usedThisFrame += size;
+        return (void*)aligned;
+    }
+
+    void FrameArena::nextFrame()
+    {
+        frameNumber.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    size_t FrameArena::usedThisFrame()
+    {
+        return getArena().usedThisFrame;
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace worlds
+{
+    // Linear allocator for scratch data that doesn't outlive the frame it was made in.
+    // Each thread bumps through its own blocks, so allocating never takes a lock. Memory from
+    // frame N stays valid until the same thread allocates again in frame N + FrameCount, which
+    // leaves room for data handed over from one frame to the next.
+    // Blocks are kept between frames, so once the arena has grown to fit a frame's worth of
+    // data it stops touching the heap.
+    class FrameArena
+    {
+      public:
+        static const int FrameCount = 2;
+
+        static void* allocate(size_t size, size_t alignment = alignof(max_align_t));
+
+        template <typename T> static T* allocArray(size_t count)
+        {
+            return (T*)allocate(sizeof(T) * count, alignof(T));
+        }
+
+        // Call once per frame from the main thread.
+        static void nextFrame();
+        // Bytes handed out on the calling thread so far this frame.
+        static size_t usedThisFrame();
+    };
+
+    // Lets standard containers allocate from the frame arena. Deallocation does nothing, memory is
+    // reclaimed when the arena wraps around.
+    template <typename T> class FrameAllocator
+    {
+      public:
+        typedef T value_type;
+
+        FrameAllocator() noexcept = default;
+
+        template <typename U> FrameAllocator(const FrameAllocator<U>&) noexcept
+        {
+        }
+
+        T* allocate(size_t n)
+        {
+            return FrameArena::allocArray<T>(n);
+        }
+
+        void deallocate(T*, size_t) noexcept
+        {
+        }
+
+        template <typename U> bool operator==(const FrameAllocator<U>&) const noexcept
+        {
+            return true;
+        }
+
+        template <typename U> bool operator!=(const FrameAllocator<U>&) const noexcept
+        {
+            return false;
+        }
+    };
+
+    template <typename T> using FrameVector = std::vector<T, FrameAllocator<T>>;
+}
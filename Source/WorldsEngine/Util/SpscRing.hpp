@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+
+namespace worlds
+{
+    // Fixed size lock-free queue for exactly one producer thread and one consumer thread.
+    // Capacity has to be a power of two.
+    template <typename T, size_t capacity> class SpscRing
+    {
+        static_assert((capacity & (capacity - 1)) == 0, "SpscRing capacity must be a power of two");
+
+      public:
+        // Producer only. Returns false if the ring is full.
+        bool tryPush(const T& value)
+        {
+            size_t head = writeIdx.load(std::memory_order_relaxed);
+            if (head - cachedReadIdx == capacity)
+            {
+                cachedReadIdx = readIdx.load(std::memory_order_acquire);
+                if (head - cachedReadIdx == capacity)
+                    return false;
+            }
+
+            values[head & (capacity - 1)] = value;
+            writeIdx.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer only. Returns false if the ring is empty.
+        bool tryPop(T& value)
+        {
+            size_t tail = readIdx.load(std::memory_order_relaxed);
+            if (tail == cachedWriteIdx)
+            {
+                cachedWriteIdx = writeIdx.load(std::memory_order_acquire);
+                if (tail == cachedWriteIdx)
+                    return false;
+            }
+
+            value = values[tail & (capacity - 1)];
+            readIdx.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Only a hint when called from the producer side
+        bool empty() const
+        {
+            return readIdx.load(std::memory_order_acquire) == writeIdx.load(std::memory_order_acquire);
+        }
+
+      private:
+        // Each side gets its own cache line so they don't keep stealing it from each other
+        alignas(64) std::atomic<size_t> writeIdx = 0;
+        size_t cachedReadIdx = 0;
+        alignas(64) std::atomic<size_t> readIdx = 0;
+        size_t cachedWriteIdx = 0;
+        alignas(64) T values[capacity];
+    };
+}
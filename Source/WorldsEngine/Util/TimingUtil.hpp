@@ -1,6 +1,7 @@
 #pragma once
 #include <cassert>
 #include <chrono>
+#include <thread>
 
 namespace worlds
 {
@@ -16,6 +17,26 @@ namespace worlds
         {
             return ((double)ns.count() / 1000.0 / 1000.0);
         }
+
+        // Sleeps until shortly before the deadline and spins for the rest. OS sleeps can overshoot
+        // by a millisecond or more, so spinning for the last stretch keeps the wake up precise.
+        static void waitUntil(std::chrono::time_point<std::chrono::high_resolution_clock> deadline,
+                              std::chrono::nanoseconds spin)
+        {
+            while (true)
+            {
+                auto remaining = deadline - now();
+                if (remaining <= spin)
+                    break;
+
+                std::this_thread::sleep_for(remaining - spin);
+            }
+
+            while (now() < deadline)
+            {
+                std::this_thread::yield();
+            }
+        }
     };
 
     class PerfTimer
@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+#include <stdint.h>
+
+namespace worlds
+{
+    // Hands the latest value from one producer thread to one consumer thread without either of them
+    // waiting. The producer fills back() and publishes it, the consumer picks up the most recently
+    // published value with consume() and reads it through front(). Values published in between are
+    // skipped, so the producer should recycle whatever it finds in back().
+    template <typename T> class TripleBuffer
+    {
+      public:
+        // Producer only
+        T& back()
+        {
+            return buffers[backIdx];
+        }
+
+        void publish()
+        {
+            uint8_t old = middle.exchange(backIdx | NewFlag, std::memory_order_acq_rel);
+            backIdx = old & IndexMask;
+        }
+
+        // Consumer only. Returns false if nothing has been published since the last call.
+        bool consume()
+        {
+            if ((middle.load(std::memory_order_relaxed) & NewFlag) == 0)
+                return false;
+
+            uint8_t old = middle.exchange(frontIdx, std::memory_order_acq_rel);
+            frontIdx = old & IndexMask;
+            return true;
+        }
+
+        T& front()
+        {
+            return buffers[frontIdx];
+        }
+
+      private:
+        static const uint8_t NewFlag = 4;
+        static const uint8_t IndexMask = 3;
+
+        T buffers[3];
+        uint8_t backIdx = 0;
+        std::atomic<uint8_t> middle = 1;
+        uint8_t frontIdx = 2;
+    };
+}
@@ -0,0 +1,58 @@
+using System;
+using System.Runtime.InteropServices;
+using WorldsEngine.ComponentMeta;
+using WorldsEngine.Math;
+
+namespace WorldsEngine
+{
+    public class NavAgent : BuiltinComponent
+    {
+        [DllImport(Engine.NativeModule)]
+        private static extern void navAgent_setTarget(IntPtr registryPtr, uint entityId, Vector3 target);
+
+        [DllImport(Engine.NativeModule)]
+        private static extern void navAgent_getTarget(IntPtr registryPtr, uint entityId, out Vector3 target);
+
+        [DllImport(Engine.NativeModule)]
+        private static extern float navAgent_getMaxSpeed(IntPtr registryPtr, uint entityId);
+
+        [DllImport(Engine.NativeModule)]
+        private static extern void navAgent_setMaxSpeed(IntPtr registryPtr, uint entityId, float maxSpeed);
+
+        internal static ComponentMetadata Metadata
+        {
+            get
+            {
+                if (cachedMetadata == null)
+                    cachedMetadata = MetadataManager.FindNativeMetadata("Nav Agent")!;
+
+                return cachedMetadata;
+            }
+        }
+
+        private static ComponentMetadata? cachedMetadata;
+
+        /// <summary>
+        /// Where the agent is heading. The agent moves to the closest point on the navmesh.
+        /// </summary>
+        public Vector3 Target
+        {
+            get
+            {
+                navAgent_getTarget(regPtr, entityId, out Vector3 target);
+                return target;
+            }
+            set => navAgent_setTarget(regPtr, entityId, value);
+        }
+
+        public float MaxSpeed
+        {
+            get => navAgent_getMaxSpeed(regPtr, entityId);
+            set => navAgent_setMaxSpeed(regPtr, entityId, value);
+        }
+
+        internal NavAgent(IntPtr regPtr, uint entityId) : base(regPtr, entityId)
+        {
+        }
+    }
+}
@@ -40,7 +40,8 @@ namespace WorldsEngine
 
         internal static void Initialise()
         {
-            Engine.AssemblyLoadManager.OnAssemblyLoad += RegisterCommands;
+            RegisterCommands(typeof(Console).Assembly, false);
+            Engine.AssemblyLoadManager.OnAssemblyLoad += (Assembly assembly) => RegisterCommands(assembly, true);
             Engine.AssemblyLoadManager.OnAssemblyUnload += PrepareForUnload;
         }
 
@@ -50,7 +51,7 @@ namespace WorldsEngine
             command.Method(args);
         }
 
-        private static void RegisterCommands(Assembly assembly)
+        private static void RegisterCommands(Assembly assembly, bool inGameAssembly)
         {
             foreach (Type type in assembly.GetTypes())
             {
@@ -71,7 +72,7 @@ namespace WorldsEngine
                             var cmdDelegate = method.CreateDelegate<Action<string>>();
                             Command command = new Command(cmdDelegate)
                             {
-                                InGameAssembly = true
+                                InGameAssembly = inGameAssembly
                             };
 
                             int index = commands.Count;
@@ -0,0 +1,248 @@
+using System;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+using WorldsEngine.Math;
+
+namespace WorldsEngine.ECS;
+
+/// <summary>
+/// Blittable subset of a WorldObject, used for batched access.
+/// </summary>
+[StructLayout(LayoutKind.Sequential)]
+public struct WorldObjectData
+{
+    public AssetID Mesh;
+    /// <summary>
+    /// The material of the first submesh.
+    /// </summary>
+    public AssetID Material;
+    public Vector4 TexScaleOffset;
+    public StaticFlags StaticFlags;
+    public bool CastShadows;
+}
+
+/// <summary>
+/// A view straight into native Transform storage.
+/// </summary>
+public readonly ref struct TransformStorage
+{
+    public readonly ReadOnlySpan<Entity> Entities;
+    public readonly Span<Transform> Transforms;
+
+    internal TransformStorage(ReadOnlySpan<Entity> entities, Span<Transform> transforms)
+    {
+        Entities = entities;
+        Transforms = transforms;
+    }
+}
+
+/// <summary>
+/// Access to native component data for many entities at once, so systems that touch
+/// every entity don't pay for a native call per entity.
+/// Spans handed out here point into native storage and are only valid until a component of
+/// that type is added or removed.
+/// </summary>
+public static unsafe class BulkAccess
+{
+    [DllImport(Engine.NativeModule)]
+    private static extern Entity* registry_getTransformStorage(IntPtr regPtr, out uint count, out Transform* transforms);
+
+    [DllImport(Engine.NativeModule)]
+    private static extern void registry_getTransforms(IntPtr regPtr, Entity* entities, uint count, Transform* output);
+
+    [DllImport(Engine.NativeModule)]
+    private static extern void registry_setTransforms(IntPtr regPtr, Entity* entities, uint count, Transform* input);
+
+    [DllImport(Engine.NativeModule)]
+    private static extern double registry_benchmarkTransformLoop(IntPtr regPtr, uint iterations, out Vector3 checksum);
+
+    [DllImport(Engine.NativeModule)]
+    private static extern Entity* worldObject_getEntities(IntPtr regPtr, out uint count);
+
+    [DllImport(Engine.NativeModule)]
+    private static extern void worldObject_getBulk(IntPtr regPtr, Entity* entities, uint count, WorldObjectData* output);
+
+    [DllImport(Engine.NativeModule)]
+    private static extern void worldObject_setBulk(IntPtr regPtr, Entity* entities, uint count, WorldObjectData* input);
+
+    [DllImport(Engine.NativeModule)]
+    private static extern Entity* dynamicpa_getEntities(IntPtr regPtr, out uint count);
+
+    [DllImport(Engine.NativeModule)]
+    private static extern void dynamicpa_getPoses(IntPtr regPtr, Entity* entities, uint count, Transform* poses);
+
+    [DllImport(Engine.NativeModule)]
+    private static extern void dynamicpa_setPoses(IntPtr regPtr, Entity* entities, uint count, Transform* poses);
+
+    /// <summary>
+    /// Every entity with a Transform alongside its Transform, in the same order.
+    /// Writing to a child entity's transform through this has no effect, as it gets
+    /// overwritten by its parent. Use SetTransforms for those.
+    /// </summary>
+    public static TransformStorage GetTransformStorage()
+    {
+        Entity* entities = registry_getTransformStorage(Registry.NativePtr, out uint count, out Transform* transforms);
+        return new TransformStorage(new ReadOnlySpan<Entity>(entities, (int)count), new Span<Transform>(transforms, (int)count));
+    }
+
+    public static void GetTransforms(ReadOnlySpan<Entity> entities, Span<Transform> transforms)
+    {
+        CheckLengths(entities.Length, transforms.Length);
+
+        fixed (Entity* entityPtr = entities)
+        fixed (Transform* transformPtr = transforms)
+        {
+            registry_getTransforms(Registry.NativePtr, entityPtr, (uint)entities.Length, transformPtr);
+        }
+    }
+
+    /// <summary>
+    /// Sets the transforms of the given entities. Unlike writing to the storage directly,
+    /// this handles child entities the same way Registry.SetTransform does.
+    /// </summary>
+    public static void SetTransforms(ReadOnlySpan<Entity> entities, ReadOnlySpan<Transform> transforms)
+    {
+        CheckLengths(entities.Length, transforms.Length);
+
+        fixed (Entity* entityPtr = entities)
+        fixed (Transform* transformPtr = transforms)
+        {
+            registry_setTransforms(Registry.NativePtr, entityPtr, (uint)entities.Length, transformPtr);
+        }
+    }
+
+    public static ReadOnlySpan<Entity> WorldObjectEntities
+    {
+        get
+        {
+            Entity* entities = worldObject_getEntities(Registry.NativePtr, out uint count);
+            return new ReadOnlySpan<Entity>(entities, (int)count);
+        }
+    }
+
+    public static void GetWorldObjects(ReadOnlySpan<Entity> entities, Span<WorldObjectData> worldObjects)
+    {
+        CheckLengths(entities.Length, worldObjects.Length);
+
+        fixed (Entity* entityPtr = entities)
+        fixed (WorldObjectData* woPtr = worldObjects)
+        {
+            worldObject_getBulk(Registry.NativePtr, entityPtr, (uint)entities.Length, woPtr);
+        }
+    }
+
+    public static void SetWorldObjects(ReadOnlySpan<Entity> entities, ReadOnlySpan<WorldObjectData> worldObjects)
+    {
+        CheckLengths(entities.Length, worldObjects.Length);
+
+        fixed (Entity* entityPtr = entities)
+        fixed (WorldObjectData* woPtr = worldObjects)
+        {
+            worldObject_setBulk(Registry.NativePtr, entityPtr, (uint)entities.Length, woPtr);
+        }
+    }
+
+    public static ReadOnlySpan<Entity> RigidBodyEntities
+    {
+        get
+        {
+            Entity* entities = dynamicpa_getEntities(Registry.NativePtr, out uint count);
+            return new ReadOnlySpan<Entity>(entities, (int)count);
+        }
+    }
+
+    public static void GetRigidBodyPoses(ReadOnlySpan<Entity> entities, Span<Transform> poses)
+    {
+        CheckLengths(entities.Length, poses.Length);
+
+        fixed (Entity* entityPtr = entities)
+        fixed (Transform* posePtr = poses)
+        {
+            dynamicpa_getPoses(Registry.NativePtr, entityPtr, (uint)entities.Length, posePtr);
+        }
+    }
+
+    public static void SetRigidBodyPoses(ReadOnlySpan<Entity> entities, ReadOnlySpan<Transform> poses)
+    {
+        CheckLengths(entities.Length, poses.Length);
+
+        fixed (Entity* entityPtr = entities)
+        fixed (Transform* posePtr = poses)
+        {
+            dynamicpa_setPoses(Registry.NativePtr, entityPtr, (uint)entities.Length, posePtr);
+        }
+    }
+
+    private static void CheckLengths(int entityCount, int dataCount)
+    {
+        if (entityCount != dataCount)
+            throw new ArgumentException($"Got {entityCount} entities but {dataCount} components");
+    }
+
+    [ConsoleCommand("benchmarkBulkAccess", "Compares per-entity, batched and direct transform access. Takes an iteration count.")]
+    private static void BenchmarkCommand(string args)
+    {
+        if (!uint.TryParse(args, out uint iterations) || iterations == 0)
+            iterations = 100;
+
+        // Even so every transform ends up where it started
+        iterations += iterations % 2;
+
+        Entity[] entities = GetTransformStorage().Entities.ToArray();
+        Transform[] transforms = new Transform[entities.Length];
+        Vector3 checksum = new();
+
+        Stopwatch sw = Stopwatch.StartNew();
+        for (uint i = 0; i < iterations; i++)
+        {
+            float offset = i % 2 == 0 ? 1.0f : -1.0f;
+            foreach (Entity entity in entities)
+            {
+                Transform t = new();
+                NativeRegistry.registry_getTransform(Registry.NativePtr, entity.ID, (IntPtr)(&t));
+                t.Position.y += offset;
+                checksum += t.Position;
+                NativeRegistry.registry_setTransform(Registry.NativePtr, entity.ID, (IntPtr)(&t));
+            }
+        }
+        double perEntityMs = sw.Elapsed.TotalMilliseconds;
+
+        sw.Restart();
+        for (uint i = 0; i < iterations; i++)
+        {
+            float offset = i % 2 == 0 ? 1.0f : -1.0f;
+            GetTransforms(entities, transforms);
+
+            for (int j = 0; j < transforms.Length; j++)
+            {
+                transforms[j].Position.y += offset;
+                checksum += transforms[j].Position;
+            }
+
+            SetTransforms(entities, transforms);
+        }
+        double batchedMs = sw.Elapsed.TotalMilliseconds;
+
+        sw.Restart();
+        for (uint i = 0; i < iterations; i++)
+        {
+            float offset = i % 2 == 0 ? 1.0f : -1.0f;
+            Span<Transform> storage = GetTransformStorage().Transforms;
+
+            for (int j = 0; j < storage.Length; j++)
+            {
+                storage[j].Position.y += offset;
+                checksum += storage[j].Position;
+            }
+        }
+        double directMs = sw.Elapsed.TotalMilliseconds;
+
+        double nativeMs = registry_benchmarkTransformLoop(Registry.NativePtr, iterations, out Vector3 nativeChecksum);
+
+        Log.Msg($"Bulk access benchmark: {entities.Length} transforms, {iterations} iterations (checksums {checksum.y}, {nativeChecksum.y})");
+        Log.Msg($"  per-entity: {perEntityMs / iterations:0.000}ms/iteration");
+        Log.Msg($"  batched:    {batchedMs / iterations:0.000}ms/iteration");
+        Log.Msg($"  direct:     {directMs / iterations:0.000}ms/iteration");
+        Log.Msg($"  native:     {nativeMs / iterations:0.000}ms/iteration");
+    }
+}
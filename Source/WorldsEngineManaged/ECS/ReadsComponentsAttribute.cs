@@ -0,0 +1,21 @@
+using System;
+
+namespace WorldsEngine
+{
+    /// <summary>
+    /// Declares which components a system reads. Systems that declare their component access can
+    /// run on worker threads at the same time as other systems they don't conflict with, so they
+    /// mustn't create or destroy entities, add or remove components or use main thread only APIs
+    /// like ImGui. Systems without any declared access always run on their own.
+    /// </summary>
+    [AttributeUsage(AttributeTargets.Class)]
+    public class ReadsComponentsAttribute : Attribute
+    {
+        internal Type[] Components;
+
+        public ReadsComponentsAttribute(params Type[] components)
+        {
+            Components = components;
+        }
+    }
+}
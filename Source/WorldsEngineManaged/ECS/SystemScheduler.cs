@@ -0,0 +1,157 @@
+using System;
+using System.Collections.Generic;
+using System.Reflection;
+using System.Runtime.ExceptionServices;
+using System.Runtime.InteropServices;
+using System.Threading;
+
+namespace WorldsEngine.ECS;
+
+/// <summary>
+/// Runs systems in groups that don't touch the same components. Each group runs across
+/// the native task scheduler's workers, and groups run one after another in update order.
+/// </summary>
+internal static unsafe class SystemScheduler
+{
+    [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+    private delegate void RunSystemDelegate(uint index);
+
+    [DllImport(Engine.NativeModule)]
+    private static extern void systemScheduler_runGroup(uint count, IntPtr* names, RunSystemDelegate runSystem);
+
+    class SystemAccess
+    {
+        public readonly HashSet<Type> Reads = new();
+        public readonly HashSet<Type> Writes = new();
+        public bool Declared;
+
+        public bool ConflictsWith(SystemAccess other)
+        {
+            if (!Declared || !other.Declared) return true;
+
+            return Writes.Overlaps(other.Writes) || Writes.Overlaps(other.Reads) || other.Writes.Overlaps(Reads);
+        }
+    }
+
+    public static bool Parallel = true;
+
+    private static readonly RunSystemDelegate _runSystemDelegate = RunSystem;
+    // Indices into AssemblyLoadManager.Systems rather than the systems themselves,
+    // since hotloading swaps out the instances.
+    private static readonly List<int[]> _groups = new();
+    private static IntPtr[] _names = Array.Empty<IntPtr>();
+    private static IntPtr[] _groupNames = Array.Empty<IntPtr>();
+    private static bool _dirty = true;
+
+    private static int[] _currentGroup = Array.Empty<int>();
+    private static bool _simulating;
+    private static Exception? _exception;
+
+    internal static void Invalidate() => _dirty = true;
+
+    internal static void RunUpdate() => Run(false);
+
+    internal static void RunSimulate() => Run(true);
+
+    private static SystemAccess GetAccess(Type type)
+    {
+        var access = new SystemAccess();
+        var reads = type.GetCustomAttribute<ReadsComponentsAttribute>();
+        var writes = type.GetCustomAttribute<WritesComponentsAttribute>();
+
+        access.Declared = reads != null || writes != null;
+
+        if (reads != null) access.Reads.UnionWith(reads.Components);
+        if (writes != null) access.Writes.UnionWith(writes.Components);
+
+        return access;
+    }
+
+    private static void Rebuild(IReadOnlyList<ISystem> systems)
+    {
+        foreach (IntPtr name in _names)
+            Marshal.FreeCoTaskMem(name);
+
+        _names = new IntPtr[systems.Count];
+        _groupNames = new IntPtr[systems.Count];
+        _groups.Clear();
+
+        var current = new List<int>();
+        var currentAccess = new List<SystemAccess>();
+
+        for (int i = 0; i < systems.Count; i++)
+        {
+            Type type = systems[i].GetType();
+            _names[i] = Marshal.StringToCoTaskMemUTF8(type.FullName);
+
+            SystemAccess access = GetAccess(type);
+
+            if (current.Count > 0 && (!Parallel || currentAccess.Exists(other => other.ConflictsWith(access))))
+            {
+                _groups.Add(current.ToArray());
+                current.Clear();
+                currentAccess.Clear();
+            }
+
+            current.Add(i);
+            currentAccess.Add(access);
+        }
+
+        if (current.Count > 0)
+            _groups.Add(current.ToArray());
+
+        _dirty = false;
+    }
+
+    private static void Run(bool simulate)
+    {
+        if (_dirty)
+            Rebuild(Engine.AssemblyLoadManager.Systems);
+
+        _simulating = simulate;
+
+        foreach (int[] group in _groups)
+        {
+            _currentGroup = group;
+
+            for (int i = 0; i < group.Length; i++)
+                _groupNames[i] = _names[group[i]];
+
+            fixed (IntPtr* namePtr = _groupNames)
+            {
+                systemScheduler_runGroup((uint)group.Length, namePtr, _runSystemDelegate);
+            }
+
+            // Exceptions can't cross the native boundary, so hand the first one
+            // back to the main thread and stop there like a serial update would
+            Exception? e = Interlocked.Exchange(ref _exception, null);
+            if (e != null)
+                ExceptionDispatchInfo.Capture(e).Throw();
+        }
+    }
+
+    private static void RunSystem(uint index)
+    {
+        ISystem system = Engine.AssemblyLoadManager.Systems[_currentGroup[index]];
+
+        try
+        {
+            if (_simulating)
+                system.OnSimulate();
+            else
+                system.OnUpdate();
+        }
+        catch (Exception e)
+        {
+            Interlocked.CompareExchange(ref _exception, e, null);
+        }
+    }
+
+    [ConsoleCommand("toggleParallelSystems", "Toggles running systems with declared component access in parallel.")]
+    private static void ToggleParallelCommand(string args)
+    {
+        Parallel = !Parallel;
+        Invalidate();
+        Log.Msg($"Parallel systems {(Parallel ? "enabled" : "disabled")}");
+    }
+}
@@ -72,6 +72,9 @@ public static class Registry
     private static readonly Queue<ComponentRemoval> _componentRemovals = new();
     private static readonly List<IComponentStorage> _collisionHandlers = new();
     private static readonly List<IComponentStorage> _startListeners = new();
+    // Simulated storages in type name order. Storage indices are handed out in
+    // whatever order types are first touched, so they can't be used for ordering.
+    private static readonly List<IComponentStorage> _simulatedStorages = new();
 
     [UsedImplicitly]
     [SuppressMessage("CodeQuality", "IDE0051:Remove unused private members",
@@ -198,12 +201,7 @@ public static class Registry
                 throw new ArgumentOutOfRangeException("Out of component pools. Oops.");
 
             componentStorages[index] = (IComponentStorage)Activator.CreateInstance(storageType, BindingFlags.Public | BindingFlags.Instance, null, null, null)!;
-
-            if (typeof(ICollisionHandler).IsAssignableFrom(type))
-                _collisionHandlers.Add(componentStorages[index]!);
-
-            if (typeof(IStartListener).IsAssignableFrom(type))
-                _startListeners.Add(componentStorages[index]!);
+            RegisterStorage(componentStorages[index]!);
         }
 
         return componentStorages[ComponentTypeLookup.typeIndices[type.FullName!]]!;
@@ -222,16 +220,31 @@ public static class Registry
         {
             Log.Verbose($"Creating storage for {typeof(T).FullName}, index {typeIndex}");
             componentStorages[typeIndex] = new ComponentStorage<T>();
-            if (typeof(ICollisionHandler).IsAssignableFrom(typeof(T)))
-                _collisionHandlers.Add(componentStorages[typeIndex]!);
-
-            if (typeof(IStartListener).IsAssignableFrom(typeof(T)))
-                _startListeners.Add(componentStorages[typeIndex]!);
+            RegisterStorage(componentStorages[typeIndex]!);
         }
 
         return (ComponentStorage<T>)componentStorages[typeIndex]!;
     }
 
+    private static void RegisterStorage(IComponentStorage storage)
+    {
+        if (typeof(ICollisionHandler).IsAssignableFrom(storage.Type))
+            _collisionHandlers.Add(storage);
+
+        if (typeof(IStartListener).IsAssignableFrom(storage.Type))
+            _startListeners.Add(storage);
+
+        if (storage.IsThinking)
+        {
+            int insertAt = 0;
+            while (insertAt < _simulatedStorages.Count &&
+                   string.CompareOrdinal(_simulatedStorages[insertAt].Type.FullName, storage.Type.FullName) < 0)
+                insertAt++;
+
+            _simulatedStorages.Insert(insertAt, storage);
+        }
+    }
+
     private static ComponentMetadata GetBuiltinComponentMetadata(Type componentType)
     {
         PropertyInfo propertyInfo = componentType.GetProperty(
@@ -629,10 +642,9 @@ public static class Registry
 
     internal static void RunSimulateOnComponents()
     {
-        for (int i = 0; i < ComponentPoolCount; i++)
+        foreach (IComponentStorage storage in _simulatedStorages)
         {
-            if (componentStorages[i] == null || !componentStorages[i]!.IsThinking) continue;
-            componentStorages[i]!.RunSimulate();
+            storage.RunSimulate();
         }
     }
 
@@ -0,0 +1,18 @@
+using System;
+
+namespace WorldsEngine
+{
+    /// <summary>
+    /// Declares which components a system writes. See <see cref="ReadsComponentsAttribute"/>.
+    /// </summary>
+    [AttributeUsage(AttributeTargets.Class)]
+    public class WritesComponentsAttribute : Attribute
+    {
+        internal Type[] Components;
+
+        public WritesComponentsAttribute(params Type[] components)
+        {
+            Components = components;
+        }
+    }
+}
@@ -164,10 +164,7 @@ namespace WorldsEngine
             {
                 UpdateSyncContext.RunCallbacks();
 
-                foreach (ISystem system in AssemblyLoadManager.Systems)
-                {
-                    system.OnUpdate();
-                }
+                SystemScheduler.RunUpdate();
 
                 Registry.RunUpdateOnComponents();
                 Awaitables.NextFrame.Wrapped.Run();
@@ -202,10 +199,7 @@ namespace WorldsEngine
                 Physics.FlushCollisionQueue();
                 SimulateSyncContext.RunCallbacks();
 
-                foreach (ISystem system in AssemblyLoadManager.Systems)
-                {
-                    system.OnSimulate();
-                }
+                SystemScheduler.RunSimulate();
 
                 Registry.RunSimulateOnComponents();
                 Awaitables.NextSimulationTick.Wrapped.Run();
@@ -5,6 +5,7 @@ using System.Reflection;
 using System.IO;
 using System.Linq;
 using System.Diagnostics.CodeAnalysis;
+using WorldsEngine.ECS;
 
 namespace WorldsEngine.Hotloading
 {
@@ -316,7 +317,20 @@ namespace WorldsEngine.Hotloading
                 }
             }
 
-            systems.OrderBy(s => s.GetType().GetCustomAttribute<SystemUpdateOrderAttribute>()?.Priority ?? 0);
+            // Sort by priority and then by name so that update order doesn't
+            // depend on the order types happened to be discovered in.
+            systems.Sort((a, b) =>
+            {
+                int aPriority = a.GetType().GetCustomAttribute<SystemUpdateOrderAttribute>()?.Priority ?? 0;
+                int bPriority = b.GetType().GetCustomAttribute<SystemUpdateOrderAttribute>()?.Priority ?? 0;
+
+                if (aPriority != bPriority)
+                    return aPriority.CompareTo(bPriority);
+
+                return string.CompareOrdinal(a.GetType().FullName, b.GetType().FullName);
+            });
+
+            SystemScheduler.Invalidate();
         }
     }
 }
@@ -48,8 +48,69 @@ namespace WorldsEngine.Navigation
             }
         }
     }
+    public enum PathRequestStatus
+    {
+        Unknown,
+        Pending,
+        Ready,
+        Failed
+    }
+
+    /// <summary>
+    /// A path query running on a worker thread. Results are available from the frame after it was requested.
+    /// Must be disposed once the result isn't needed anymore.
+    /// </summary>
+    public sealed class PathRequest : IDisposable
+    {
+        [DllImport(Engine.NativeModule)]
+        private static extern int navigation_getPathStatus(uint id);
+
+        [DllImport(Engine.NativeModule)]
+        private static extern int navigation_getPathPointCount(uint id);
+
+        [DllImport(Engine.NativeModule)]
+        private static extern int navigation_copyPathPoints(uint id, [Out] Vector3[] points, int maxPoints);
+
+        [DllImport(Engine.NativeModule)]
+        private static extern void navigation_releasePath(uint id);
+
+        private uint _id;
+
+        internal PathRequest(uint id)
+        {
+            _id = id;
+        }
+
+        public PathRequestStatus Status => (PathRequestStatus)navigation_getPathStatus(_id);
+
+        public bool TryGetPoints(out Vector3[] points)
+        {
+            int count = navigation_getPathPointCount(_id);
+
+            if (Status != PathRequestStatus.Ready)
+            {
+                points = Array.Empty<Vector3>();
+                return false;
+            }
+
+            points = new Vector3[count];
+            navigation_copyPathPoints(_id, points, count);
+            return true;
+        }
+
+        public void Dispose()
+        {
+            if (_id == 0) return;
+            navigation_releasePath(_id);
+            _id = 0;
+        }
+    }
+
     public static class NavigationSystem
     {
+        [DllImport(Engine.NativeModule)]
+        private static extern uint navigation_requestPath(Vector3 startPos, Vector3 endPos);
+
         [DllImport(Engine.NativeModule)]
         private static extern IntPtr navigation_findPath(Vector3 startPos, Vector3 endPos);
 
@@ -59,6 +120,8 @@ namespace WorldsEngine.Navigation
 
         public static NavigationPath FindPath(Vector3 startPos, Vector3 endPos) => new(navigation_findPath(startPos, endPos));
 
+        public static PathRequest RequestPath(Vector3 startPos, Vector3 endPos) => new(navigation_requestPath(startPos, endPos));
+
         public static bool GetClosestPoint(Vector3 point, out Vector3 foundPoint)
         {
             foundPoint = Vector3.Zero;
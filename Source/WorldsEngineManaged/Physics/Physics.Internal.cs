@@ -1,6 +1,7 @@
 ﻿using System;
 using System.Collections.Generic;
 using System.Diagnostics.CodeAnalysis;
+using System.Runtime.InteropServices;
 using JetBrains.Annotations;
 using WorldsEngine.ECS;
 
@@ -8,6 +9,8 @@ namespace WorldsEngine;
 
 public static partial class Physics
 {
+    // Must match PhysicsContactEvent in Physics.hpp
+    [StructLayout(LayoutKind.Sequential)]
     private struct Collision
     {
         public uint EntityID;
@@ -18,10 +21,13 @@ public static partial class Physics
 
     [UsedImplicitly]
     [SuppressMessage("CodeQuality", "IDE0051:Remove unused private members",
-        Justification = "Called from native C++ during deserialization")]
-    private static void HandleCollisionFromNative(uint entityId, ref PhysicsContactInfo contactInfo)
+        Justification = "Called from native C++ after each physics step")]
+    private static unsafe void HandleCollisionsFromNative(Collision* collisions, uint count)
     {
-        _collisionQueue.Enqueue(new Collision() { EntityID = entityId, ContactInfo = contactInfo });
+        for (uint i = 0; i < count; i++)
+        {
+            _collisionQueue.Enqueue(collisions[i]);
+        }
     }
 
     internal static void FlushCollisionQueue()